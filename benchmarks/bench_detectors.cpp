@@ -0,0 +1,260 @@
+/**
+ * Face detector benchmark: HOG vs MMOD CNN vs cascade on the same image set.
+ *
+ * Usage: bench_detectors <model_dir> <image_dir> [ground_truth.csv] [max_images]
+ *
+ * ground_truth.csv has one face per line: file_name,x,y,width,height
+ * With ground truth, recall and precision are reported per backend (IoU >= 0.5).
+ * Without it, each backend's recall is measured against the other's faces.
+ * Throughput excludes image decoding.
+ */
+
+#include "core/Scanner.h"
+#include "services/FaceService.h"
+#include "services/ImageLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace facefling;
+namespace fs = std::filesystem;
+
+namespace {
+
+using GroundTruth = std::map<std::string, std::vector<BoundingBox>>;
+
+struct Run {
+    std::string name;
+    double seconds = 0.0;
+    std::vector<std::vector<BoundingBox>> faces;  // Per image
+    FaceService::Stats stats;
+};
+
+float iou(const BoundingBox& a, const BoundingBox& b)
+{
+    const int x0 = std::max(a.x, b.x);
+    const int y0 = std::max(a.y, b.y);
+    const int x1 = std::min(a.right(), b.right());
+    const int y1 = std::min(a.bottom(), b.bottom());
+    if (x1 <= x0 || y1 <= y0) {
+        return 0.0f;
+    }
+    const float inter = static_cast<float>(x1 - x0) * (y1 - y0);
+    return inter / (a.area() + b.area() - inter);
+}
+
+// Number of reference boxes matched (greedily, one-to-one) by a found box
+int count_matches(const std::vector<BoundingBox>& reference, const std::vector<BoundingBox>& found)
+{
+    std::vector<bool> used(found.size(), false);
+    int matched = 0;
+    for (const auto& ref : reference) {
+        for (size_t i = 0; i < found.size(); ++i) {
+            if (!used[i] && iou(ref, found[i]) >= 0.5f) {
+                used[i] = true;
+                matched++;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+GroundTruth load_ground_truth(const std::string& path)
+{
+    GroundTruth truth;
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open ground truth file: " + path);
+    }
+    
+    std::string line;
+    while (std::getline(in, line)) {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        std::string name;
+        BoundingBox box;
+        if (fields >> name >> box.x >> box.y >> box.width >> box.height) {
+            truth[name].push_back(box);
+        }
+    }
+    return truth;
+}
+
+Run run_backend(
+    const std::string& name,
+    FaceService::Config config,
+    const std::vector<std::string>& paths,
+    ImageLoader& loader)
+{
+    FaceService service(config);
+    service.initialize();
+    
+    Run run;
+    run.name = name;
+    
+    const size_t batch_size = config.detector != FaceService::Detector::Hog
+        ? static_cast<size_t>(std::max(1, config.cnn_batch_size)) : 1;
+    
+    for (size_t start = 0; start < paths.size(); start += batch_size) {
+        const size_t end = std::min(paths.size(), start + batch_size);
+        
+        std::vector<Image> images;
+        for (size_t i = start; i < end; ++i) {
+            try {
+                images.push_back(loader.load(paths[i]));
+            } catch (const std::exception& e) {
+                std::cerr << "[Bench] Skipping " << paths[i] << ": " << e.what() << std::endl;
+                images.emplace_back();
+            }
+        }
+        std::vector<const Image*> batch;
+        for (const auto& image : images) {
+            batch.push_back(&image);
+        }
+        
+        const auto t0 = std::chrono::steady_clock::now();
+        auto detections = service.detect_faces_batch(batch);
+        run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        
+        for (const auto& image_detections : detections) {
+            std::vector<BoundingBox> boxes;
+            for (const auto& detection : image_detections) {
+                boxes.push_back(detection.bbox);
+            }
+            run.faces.push_back(std::move(boxes));
+        }
+    }
+    run.stats = service.get_stats();
+    return run;
+}
+
+int total_faces(const Run& run)
+{
+    int total = 0;
+    for (const auto& boxes : run.faces) {
+        total += static_cast<int>(boxes.size());
+    }
+    return total;
+}
+
+void print_throughput(const Run& run, size_t images)
+{
+    std::cout << std::left << std::setw(14) << run.name
+              << std::right << std::setw(8) << total_faces(run) << " faces  "
+              << std::fixed << std::setprecision(2) << std::setw(8) << images / std::max(run.seconds, 1e-9)
+              << " img/s  " << std::setw(8) << 1000.0 * run.seconds / std::max<size_t>(images, 1)
+              << " ms/img  (hog " << std::setw(6) << run.stats.hog_ms / 1000.0
+              << " s, cnn " << std::setw(6) << run.stats.cnn_ms / 1000.0
+              << " s, describe " << std::setw(6) << run.stats.describe_ms / 1000.0 << " s)"
+              << std::defaultfloat << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <model_dir> <image_dir> [ground_truth.csv] [max_images]" << std::endl;
+        return 1;
+    }
+    
+    const std::string model_dir = argv[1];
+    const std::string image_dir = argv[2];
+    const std::string truth_path = argc > 3 ? argv[3] : "";
+    const size_t max_images = argc > 4 ? std::stoul(argv[4]) : 200;
+    
+    try {
+        Scanner scanner;
+        std::vector<std::string> paths = scanner.scan(image_dir);
+        std::sort(paths.begin(), paths.end());
+        if (paths.size() > max_images) {
+            paths.resize(max_images);
+        }
+        std::cout << "[Bench] " << paths.size() << " images from " << image_dir << std::endl;
+        
+        ImageLoader loader;
+        
+        FaceService::Config config;
+        config.model_dir = model_dir;
+        
+        std::vector<Run> runs;
+        runs.push_back(run_backend("hog", config, paths, loader));
+        
+        config.detector = FaceService::Detector::Cnn;
+        for (int batch : {1, 4, 8}) {
+            config.cnn_batch_size = batch;
+            runs.push_back(run_backend("cnn/batch" + std::to_string(batch), config, paths, loader));
+        }
+        
+        config.detector = FaceService::Detector::Cascade;
+        config.cnn_batch_size = 4;
+        runs.push_back(run_backend("cascade", config, paths, loader));
+        const Run& cascade = runs.back();
+        
+        std::cout << "\nThroughput (detection + landmarks + embeddings, decode excluded)" << std::endl;
+        for (const auto& run : runs) {
+            print_throughput(run, paths.size());
+        }
+        
+        const Run& hog = runs.front();
+        const Run& cnn = runs[1];
+        
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "\nCascade: " << cascade.stats.candidate_rate() << " of images proposed, "
+                  << cascade.stats.region_precision() << " of " << cascade.stats.candidate_regions
+                  << " regions confirmed, " << cascade.stats.negatives_with_faces << "/"
+                  << cascade.stats.negatives_sampled << " sampled negatives had faces, estimated face miss rate "
+                  << cascade.stats.estimated_face_miss_rate(config.cascade_negative_sample_rate) << std::endl;
+        if (!truth_path.empty()) {
+            const GroundTruth truth = load_ground_truth(truth_path);
+            std::cout << "\nAccuracy vs ground truth (IoU >= 0.5)" << std::endl;
+            for (const Run* run : {&hog, &cnn, &cascade}) {
+                int expected = 0;
+                int matched = 0;
+                for (size_t i = 0; i < paths.size(); ++i) {
+                    auto it = truth.find(fs::path(paths[i]).filename().string());
+                    if (it == truth.end()) {
+                        continue;
+                    }
+                    expected += static_cast<int>(it->second.size());
+                    matched += count_matches(it->second, run->faces[i]);
+                }
+                const int found = total_faces(*run);
+                std::cout << std::left << std::setw(14) << run->name << std::right
+                          << " recall " << (expected > 0 ? static_cast<double>(matched) / expected : 0.0)
+                          << "  precision " << (found > 0 ? static_cast<double>(matched) / found : 0.0)
+                          << std::endl;
+            }
+        } else {
+            int hog_in_cnn = 0;
+            int cnn_in_hog = 0;
+            int cnn_in_cascade = 0;
+            for (size_t i = 0; i < paths.size(); ++i) {
+                hog_in_cnn += count_matches(hog.faces[i], cnn.faces[i]);
+                cnn_in_hog += count_matches(cnn.faces[i], hog.faces[i]);
+                cnn_in_cascade += count_matches(cnn.faces[i], cascade.faces[i]);
+            }
+            const int hog_total = total_faces(hog);
+            const int cnn_total = total_faces(cnn);
+            std::cout << "\nCross-recall (no ground truth, IoU >= 0.5)" << std::endl;
+            std::cout << "HOG faces found by CNN: " << (hog_total > 0 ? static_cast<double>(hog_in_cnn) / hog_total : 0.0)
+                      << "\nCNN faces found by HOG: " << (cnn_total > 0 ? static_cast<double>(cnn_in_hog) / cnn_total : 0.0)
+                      << "\nCNN faces found by cascade: " << (cnn_total > 0 ? static_cast<double>(cnn_in_cascade) / cnn_total : 0.0)
+                      << std::endl;
+        }
+    
+    } catch (const std::exception& e) {
+        std::cerr << "[Bench] " << e.what() << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
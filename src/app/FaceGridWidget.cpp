@@ -4,6 +4,7 @@
 
 #include "FaceGridWidget.h"
 #include "FaceThumbnailWidget.h"
+#include "../core/EmbeddingScheduler.h"
 #include "../services/Database.h"
 #include "../models/Cluster.h"
 #include <QVBoxLayout>
@@ -55,6 +56,29 @@ void FaceGridWidget::setDatabase(std::shared_ptr<IDatabase> database)
     m_database = database;
 }
 
+void FaceGridWidget::setEmbeddingScheduler(std::shared_ptr<EmbeddingScheduler> scheduler, const std::string &model)
+{
+    m_embeddingScheduler = scheduler;
+    m_embeddingModel = model;
+}
+
+void FaceGridWidget::prioritizeEmbeddings(const std::vector<Face>& faces)
+{
+    if (!m_embeddingScheduler) return;
+    
+    // Deferred, or embedded by an older model
+    std::vector<int64_t> faceIds;
+    for (const auto& face : faces) {
+        if (face.embedding_state == EmbeddingState::Pending ||
+            (face.embedding_state == EmbeddingState::Ready && face.embedding_model != m_embeddingModel)) {
+            faceIds.push_back(face.id);
+        }
+    }
+    if (!faceIds.empty()) {
+        m_embeddingScheduler->prioritize_faces(faceIds);
+    }
+}
+
 void FaceGridWidget::showAllClusters()
 {
     clearGrid();
@@ -172,6 +196,8 @@ void FaceGridWidget::showCluster(int64_t clusterId)
         return;
     }
     
+    prioritizeEmbeddings(faces);
+    
     m_placeholder->setVisible(false);
     
     auto *layout = qobject_cast<QVBoxLayout*>(m_gridContainer->layout());
@@ -243,6 +269,8 @@ void FaceGridWidget::showPerson(int64_t personId)
         return;
     }
     
+    prioritizeEmbeddings(faces);
+    
     m_placeholder->setVisible(false);
     
     auto *layout = qobject_cast<QVBoxLayout*>(m_gridContainer->layout());
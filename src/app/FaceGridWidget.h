@@ -5,14 +5,17 @@
 #include <QLabel>
 #include <memory>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace facefling {
 
 // Forward declarations
 class IDatabase;
+class EmbeddingScheduler;
 class FaceThumbnailWidget;
 struct ClusterStats;
+struct Face;
 
 /**
  * Grid widget displaying face thumbnails organized by cluster.
@@ -28,6 +31,9 @@ public:
     
     void setDatabase(std::shared_ptr<IDatabase> database);
     
+    // Faces shown that lack a current embedding are embedded first
+    void setEmbeddingScheduler(std::shared_ptr<EmbeddingScheduler> scheduler, const std::string &model);
+    
     void showAllClusters();
     void showCluster(int64_t clusterId);
     void showPerson(int64_t personId);
@@ -51,8 +57,11 @@ private:
     void addClusterSection(const ClusterStats& stats);
     void addFaceThumbnail(int64_t faceId, const QString& thumbnailPath);
     QString getThumbnailPath(int64_t faceId) const;
+    void prioritizeEmbeddings(const std::vector<Face>& faces);
     
     std::shared_ptr<IDatabase> m_database;
+    std::shared_ptr<EmbeddingScheduler> m_embeddingScheduler;
+    std::string m_embeddingModel;
     QScrollArea *m_scrollArea = nullptr;
     QWidget *m_gridContainer = nullptr;
     QWidget *m_flowWidget = nullptr;
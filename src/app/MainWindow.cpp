@@ -11,9 +11,14 @@
 #include "../core/Scanner.h"
 #include "../core/Indexer.h"
 #include "../core/Clusterer.h"
+#include "../core/ClusteringService.h"
+#include "../core/EmbeddingScheduler.h"
 #include "../services/Database.h"
+#include "../services/EmbeddingSnapshot.h"
+#include "../services/KnnGraph.h"
 #include "../services/FaceService.h"
 #include "../services/ImageLoader.h"
+#include "../models/Scan.h"
 
 #include <QApplication>
 #include <QMenuBar>
@@ -23,6 +28,7 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QCloseEvent>
+#include <QEvent>
 #include <QStandardPaths>
 #include <QDir>
 #include <QTimer>
@@ -31,6 +37,9 @@
 
 namespace facefling {
 
+// Newly embedded faces are clustered in passes of this many (and when none remain)
+static constexpr int64_t kEmbeddingsPerClusterPass = 2000;
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
@@ -51,6 +60,8 @@ MainWindow::~MainWindow()
     m_processingCancelled = true;
     if (m_scanner) m_scanner->cancel();
     if (m_indexer) m_indexer->cancel();
+    if (m_clusteringService) m_clusteringService->stop();
+    if (m_embeddingScheduler) m_embeddingScheduler->stop();
     
     saveSettings();
 }
@@ -75,8 +86,7 @@ void MainWindow::initializeServices()
         // Initialize face service
         QString modelsPath = QCoreApplication::applicationDirPath() + "/../Resources/models";
         FaceService::Config faceConfig;
-        faceConfig.shape_predictor_path = (modelsPath + "/shape_predictor_68_face_landmarks.dat").toStdString();
-        faceConfig.face_recognition_path = (modelsPath + "/dlib_face_recognition_resnet_model_v1.dat").toStdString();
+        faceConfig.model_dir = modelsPath.toStdString();
         m_faceService = std::make_shared<FaceService>(faceConfig);
         
         // Initialize image loader
@@ -85,19 +95,82 @@ void MainWindow::initializeServices()
         // Initialize scanner
         m_scanner = std::make_unique<Scanner>();
         
-        // Initialize indexer
-        m_indexer = std::make_unique<Indexer>(m_database, m_faceService, m_imageLoader);
+        // Map the embedding snapshot (validated and refreshed before each use)
+        m_embeddingSnapshot = std::make_shared<EmbeddingSnapshot>((dataPath + "/embeddings.snap").toStdString());
+        m_embeddingSnapshot->open();
+        
+        // Load the kNN graph built over it (extended as faces are added)
+        m_knnGraph = std::make_shared<KnnGraph>((dataPath + "/embeddings.knn").toStdString());
+        m_knnGraph->load();
+        
+        // Initialize indexer (frames are detected in full CNN batches)
+        // Embeddings are left to the scheduler so a new library shows up quickly
+        Indexer::Config indexerConfig;
+        indexerConfig.detect_batch_size = faceConfig.cnn_batch_size;
+        indexerConfig.defer_embeddings = true;
+        m_indexer = std::make_unique<Indexer>(m_database, m_faceService, m_imageLoader, indexerConfig);
         m_indexer->set_thumbnail_dir(thumbPath.toStdString());
+        m_indexer->set_embedding_snapshot(m_embeddingSnapshot);
         
-        // Initialize clusterer
-        m_clusterer = std::make_unique<Clusterer>(m_database, m_faceService);
+        // Initialize clusterer. Its jobs run on a worker thread in long
+        // transactions, so it gets its own connection: UI reads and edits
+        // never land in (or see half of) a clustering transaction.
+        m_clusterDatabase = std::make_shared<Database>(dbPath.toStdString());
+        m_clusterer = std::make_shared<Clusterer>(m_clusterDatabase, m_faceService);
+        m_clusterer->set_embedding_snapshot(m_embeddingSnapshot);
+        m_clusterer->set_knn_graph(m_knnGraph);
+        m_clusterer->set_change_callback([this](const std::vector<ClusterChange>& changes) {
+            const int count = static_cast<int>(changes.size());
+            QMetaObject::invokeMethod(this, [this, count]() {
+                onClusterChanges(count);
+            }, Qt::QueuedConnection);
+        });
+        
+        // Cluster on a background worker that yields while the user interacts
+        m_clusteringService = std::make_unique<ClusteringService>(m_clusterer);
+        m_clusteringService->start(
+            [this](int processed, int total) {
+                QMetaObject::invokeMethod(this, [this, processed, total]() {
+                    onClusterProgress(processed, total);
+                }, Qt::QueuedConnection);
+            },
+            [this](ClusteringService::Job, bool) {
+                QMetaObject::invokeMethod(this, [this]() {
+                    onClusterComplete();
+                }, Qt::QueuedConnection);
+            }
+        );
+        qApp->installEventFilter(this);
+        
+        // Compute deferred embeddings at background priority; faces on screen go first
+        m_embeddingDatabase = std::make_shared<Database>(dbPath.toStdString());
+        m_embeddingFaceService = std::make_shared<FaceService>(faceConfig);
+        m_embeddingScheduler = std::make_shared<EmbeddingScheduler>(
+            m_embeddingDatabase, m_embeddingFaceService, m_imageLoader);
+        m_embeddingScheduler->start([this](int64_t embedded, int remaining) {
+            QMetaObject::invokeMethod(this, [this, embedded, remaining]() {
+                onEmbeddingProgress(embedded, remaining);
+            }, Qt::QueuedConnection);
+        });
         
         // Pass database to widgets
         m_faceGrid->setDatabase(m_database);
+        m_faceGrid->setEmbeddingScheduler(m_embeddingScheduler, m_faceService->embedding_model());
         m_personList->setDatabase(m_database);
         
-        statusBar()->showMessage(tr("Ready"));
+        // Faces embedded by another encoder stay out of clustering until the
+        // scheduler has re-embedded them (after any pending faces)
+        const int staleFaces = m_embeddingDatabase->count_stale_embeddings(m_embeddingFaceService->embedding_model());
+        if (staleFaces > 0) {
+            statusBar()->showMessage(tr("Face model changed - re-embedding %1 faces").arg(staleFaces));
+            m_embeddingScheduler->wake();
+        } else {
+            statusBar()->showMessage(tr("Ready"));
+        }
         
+        // Once the window is up, offer to finish a scan the last session left
+        QTimer::singleShot(0, this, &MainWindow::offerResumeScan);
+    
     } catch (const std::exception& e) {
         QMessageBox::critical(this, tr("Initialization Error"),
             tr("Failed to initialize services: %1\n\n"
@@ -251,9 +324,97 @@ void MainWindow::openFolder()
         return;
     }
     
+    // Reopening a folder whose scan was interrupted can pick up where it stopped
+    if (askResumeScan(dir)) {
+        return;
+    }
+    
     runPipeline(dir);
 }
 
+void MainWindow::offerResumeScan()
+{
+    if (m_database) {
+        askResumeScan(QString());
+    }
+}
+
+bool MainWindow::askResumeScan(const QString &folderPath)
+{
+    // Most recent first; with no folder, offer the latest
+    for (const ScanSession &scan : m_database->get_resumable_scans()) {
+        const QString root = QString::fromStdString(scan.root_path);
+        if (!folderPath.isEmpty() && root != folderPath && !root.startsWith(folderPath + "/")) {
+            continue;
+        }
+        
+        const auto answer = QMessageBox::question(this, tr("Resume Scan"),
+            tr("The scan of %1 stopped after %2 of %3 images.\n\nResume it?")
+                .arg(root).arg(scan.processed_files).arg(scan.total_files),
+            QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+        if (answer != QMessageBox::Yes) {
+            return false;
+        }
+        
+        runResume(scan.id, scan.total_files);
+        return true;
+    }
+    return false;
+}
+
+void MainWindow::runResume(int64_t scanId, int totalFiles)
+{
+    m_processingCancelled = false;
+    m_scannedFiles.clear();
+    m_scanFileCount = totalFiles;
+    
+    m_progressDialog = new ScanProgressDialog(this);
+    connect(m_progressDialog, &ScanProgressDialog::cancelled, this, [this]() {
+        m_processingCancelled = true;
+        if (m_indexer) m_indexer->cancel();
+    });
+    m_progressDialog->setMessage(tr("Resuming scan..."));
+    m_progressDialog->show();
+    
+    auto *watcher = new QFutureWatcher<void>(this);
+    
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        onIndexComplete();
+    });
+    
+    beginIndexRun();
+    
+    QFuture<void> future = QtConcurrent::run([this, scanId]() {
+        m_indexer->resume_index(
+            scanId,
+            [this](int current, int total, const std::string& file, int faces) {
+                QMetaObject::invokeMethod(this, [this, current, total, file, faces]() {
+                    onIndexProgress(current, total, QString::fromStdString(file), faces);
+                }, Qt::QueuedConnection);
+            }
+        );
+    });
+    
+    watcher->setFuture(future);
+}
+
+void MainWindow::beginIndexRun()
+{
+    // The indexer and the clusterer both sync the embedding snapshot and
+    // write the database: stop clustering (its commits are kept) and let
+    // the run recluster when it ends
+    if (m_clusteringService->is_busy()) {
+        statusBar()->showMessage(tr("Stopping clustering..."));
+        m_clusteringService->cancel();
+        m_clusteringService->wait_idle();
+    }
+    m_indexRunning = true;
+    
+    // The index run gets the CPU; deferred embeddings continue afterwards
+    m_embeddingScheduler->pause();
+}
+
 void MainWindow::runPipeline(const QString &folderPath)
 {
     m_currentScanPath = folderPath;
@@ -345,6 +506,17 @@ void MainWindow::closeEvent(QCloseEvent *event)
     event->accept();
 }
 
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    // Background clustering backs off while the user is interacting
+    const QEvent::Type type = event->type();
+    if (m_clusteringService && (type == QEvent::KeyPress || type == QEvent::MouseButtonPress ||
+                                type == QEvent::MouseMove || type == QEvent::Wheel)) {
+        m_clusteringService->notify_user_activity();
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
 void MainWindow::onScanProgress(int current, int total, const QString &file)
 {
     if (m_progressDialog) {
@@ -358,6 +530,7 @@ void MainWindow::onScanComplete()
     if (m_processingCancelled) return;
     
     // Move to indexing phase
+    m_scanFileCount = static_cast<int>(m_scannedFiles.size());
     if (m_progressDialog) {
         m_progressDialog->setMessage(tr("Detecting faces in %1 images...").arg(m_scannedFiles.size()));
         m_progressDialog->setProgress(0, static_cast<int>(m_scannedFiles.size()));
@@ -371,6 +544,8 @@ void MainWindow::onScanComplete()
         onIndexComplete();
     });
     
+    beginIndexRun();
+    
     QFuture<void> future = QtConcurrent::run([this]() {
         m_indexer->index(
             m_scannedFiles,
@@ -397,6 +572,12 @@ void MainWindow::onIndexProgress(int current, int total, const QString &file, in
 
 void MainWindow::onIndexComplete()
 {
+    m_indexRunning = false;
+    
+    // Embed what the run deferred
+    m_embeddingScheduler->resume();
+    m_embeddingScheduler->wake();
+    
     if (m_processingCancelled) {
         if (m_progressDialog) {
             m_progressDialog->accept();
@@ -405,59 +586,88 @@ void MainWindow::onIndexComplete()
         return;
     }
     
-    // Move to clustering phase
+    // Move to clustering phase. It runs in the background and clusters
+    // appear as they are committed, so the window stays usable meanwhile.
     if (m_progressDialog) {
-        m_progressDialog->setMessage(tr("Clustering faces..."));
-        m_progressDialog->setProgress(0, 0); // Indeterminate
+        m_progressDialog->accept();
+        m_progressDialog = nullptr;
     }
+    m_progressBar->setRange(0, 0); // Indeterminate
+    m_progressBar->setVisible(true);
+    statusBar()->showMessage(tr("Clustering faces..."));
     
-    // Run clusterer in background
-    auto *watcher = new QFutureWatcher<void>(this);
-    
-    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher]() {
-        watcher->deleteLater();
-        onClusterComplete();
-    });
-    
-    QFuture<void> future = QtConcurrent::run([this]() {
-        m_clusterer->cluster_all(
-            [this](int processed, int total) {
-                QMetaObject::invokeMethod(this, [this, processed, total]() {
-                    onClusterProgress(processed, total);
-                }, Qt::QueuedConnection);
-            }
-        );
-    });
-    
-    watcher->setFuture(future);
+    requestClustering(ClusteringService::Job::All);
 }
 
 void MainWindow::onClusterProgress(int current, int total)
 {
-    if (m_progressDialog && total > 0) {
-        m_progressDialog->setProgress(current, total);
-        m_progressDialog->setMessage(tr("Clustering faces: %1/%2").arg(current).arg(total));
+    if (total > 0) {
+        m_progressBar->setRange(0, total);
+        m_progressBar->setValue(current);
+        statusBar()->showMessage(tr("Clustering faces: %1/%2").arg(current).arg(total));
     }
 }
 
+void MainWindow::requestClustering(ClusteringService::Job job)
+{
+    // Edits would write under a running job's feet; they resume when it is done
+    m_personList->setEditingEnabled(false);
+    m_mergeAction->setEnabled(false);
+    m_splitAction->setEnabled(false);
+    
+    m_clusteringService->request(job);
+}
+
 void MainWindow::onClusterComplete()
 {
-    // Close progress dialog
-    if (m_progressDialog) {
-        m_progressDialog->accept();
-        m_progressDialog = nullptr;
+    m_progressBar->setVisible(false);
+    
+    if (!m_clusteringService->is_busy()) {
+        m_personList->setEditingEnabled(true);
+        m_splitAction->setEnabled(m_faceGrid->selectedClusterId() > 0);
     }
     
-    // Refresh the UI to show results
-    refreshUI();
+    // Refresh the UI only if clustering changed anything
+    if (m_pendingClusterChanges > 0) {
+        refreshUI();
+    }
+    
+    statusBar()->showMessage(tr("Scan complete - found %1 images").arg(m_scanFileCount));
+}
+
+void MainWindow::onClusterChanges(int count)
+{
+    m_pendingClusterChanges += count;
+    
+    // Show clusters committed by a run still in progress
+    if (m_clusteringService && m_clusteringService->is_busy()) {
+        refreshUI();
+    }
+}
+
+void MainWindow::onEmbeddingProgress(int64_t embedded, int remaining)
+{
+    if (remaining > 0 && !m_clusteringService->is_busy()) {
+        statusBar()->showMessage(tr("Computing face embeddings: %1 remaining").arg(remaining));
+    }
     
-    statusBar()->showMessage(tr("Scan complete - found %1 images").arg(m_scannedFiles.size()));
+    // Cluster newly embedded faces as they accumulate, and once all are done.
+    // After a model change this also rebuilds clusters made with the old
+    // model, each once all of its faces have been re-embedded. An index run
+    // in progress reclusters when it ends.
+    if (m_indexRunning) {
+        return;
+    }
+    if (remaining == 0 || embedded - m_embeddingsClustered >= kEmbeddingsPerClusterPass) {
+        m_embeddingsClustered = embedded;
+        requestClustering(ClusteringService::Job::NewFaces);
+    }
 }
 
 void MainWindow::onClusterSelected(int64_t clusterId)
 {
     m_exportAction->setEnabled(clusterId > 0);
-    m_splitAction->setEnabled(clusterId > 0);
+    m_splitAction->setEnabled(clusterId > 0 && !m_clusteringService->is_busy());
     
     if (clusterId > 0) {
         m_faceGrid->showCluster(clusterId);
@@ -477,6 +687,7 @@ void MainWindow::onPersonSelected(int64_t personId)
 
 void MainWindow::refreshUI()
 {
+    m_pendingClusterChanges = 0;
     m_personList->refresh();
     m_faceGrid->showAllClusters();
 }
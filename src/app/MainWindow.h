@@ -7,6 +7,7 @@
 #include <QThread>
 #include <memory>
 #include <atomic>
+#include "../core/ClusteringService.h"
 
 namespace facefling {
 
@@ -17,9 +18,12 @@ class ScanProgressDialog;
 class Scanner;
 class Indexer;
 class Clusterer;
+class EmbeddingScheduler;
 class Database;
 class FaceService;
 class ImageLoader;
+class EmbeddingSnapshot;
+class KnnGraph;
 
 /**
  * Main application window.
@@ -42,11 +46,11 @@ class ImageLoader;
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
-    
+
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow() override;
-    
+
 public slots:
     // File menu actions
     void openFolder();
@@ -58,20 +62,24 @@ public slots:
     
     // View menu actions
     void toggleSidebar();
-    
+
 protected:
     void closeEvent(QCloseEvent *event) override;
-    
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void onScanProgress(int current, int total, const QString &file);
     void onScanComplete();
     void onIndexProgress(int current, int total, const QString &file, int faces);
     void onIndexComplete();
+    void offerResumeScan();
     void onClusterProgress(int current, int total);
     void onClusterComplete();
+    void onClusterChanges(int count);
+    void onEmbeddingProgress(int64_t embedded, int remaining);
     void onClusterSelected(int64_t clusterId);
     void onPersonSelected(int64_t personId);
-    
+
 private:
     void setupUi();
     void setupMenuBar();
@@ -98,19 +106,36 @@ private:
     std::shared_ptr<Database> m_database;
     std::shared_ptr<FaceService> m_faceService;
     std::shared_ptr<ImageLoader> m_imageLoader;
+    std::shared_ptr<EmbeddingSnapshot> m_embeddingSnapshot;
+    std::shared_ptr<KnnGraph> m_knnGraph;
     std::unique_ptr<Scanner> m_scanner;
     std::unique_ptr<Indexer> m_indexer;
-    std::unique_ptr<Clusterer> m_clusterer;
+    std::shared_ptr<Database> m_clusterDatabase;   // Used only by clustering jobs
+    std::shared_ptr<Clusterer> m_clusterer;
+    std::unique_ptr<ClusteringService> m_clusteringService;
+    
+    // Background embeddings, on their own connection and FaceService
+    std::shared_ptr<Database> m_embeddingDatabase;
+    std::shared_ptr<FaceService> m_embeddingFaceService;
+    std::shared_ptr<EmbeddingScheduler> m_embeddingScheduler;
     
     // Processing state
     QString m_currentScanPath;
     std::vector<std::string> m_scannedFiles;
+    int m_scanFileCount = 0;          // Images in the scan being processed
     ScanProgressDialog *m_progressDialog = nullptr;
     std::atomic<bool> m_processingCancelled{false};
+    int m_pendingClusterChanges = 0;  // Change feed entries not yet shown
+    bool m_indexRunning = false;      // Clustering is held off meanwhile
+    int64_t m_embeddingsClustered = 0;  // Scheduler's embedded count at the last clustering request
     
     // Helper methods
     void initializeServices();
     void runPipeline(const QString &folderPath);
+    void beginIndexRun();
+    void requestClustering(ClusteringService::Job job);
+    bool askResumeScan(const QString &folderPath);
+    void runResume(int64_t scanId, int totalFiles);
     void refreshUI();
     QString getThumbnailPath(int64_t faceId) const;
 };
@@ -9,6 +9,7 @@
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QInputDialog>
+#include <QMessageBox>
 #include <QDateTime>
 
 namespace facefling {
@@ -80,6 +81,11 @@ void PersonListWidget::setDatabase(std::shared_ptr<IDatabase> database)
     m_database = database;
 }
 
+void PersonListWidget::setEditingEnabled(bool enabled)
+{
+    m_editingEnabled = enabled;
+}
+
 void PersonListWidget::refresh()
 {
     m_listWidget->clear();
@@ -176,6 +182,12 @@ void PersonListWidget::onItemDoubleClicked(QListWidgetItem *item)
 {
     if (!item || !m_database) return;
     
+    if (!m_editingEnabled) {
+        QMessageBox::information(this, tr("Clustering in Progress"),
+            tr("Names can be edited once clustering has finished."));
+        return;
+    }
+    
     int itemType = item->data(ItemTypeRole).toInt();
     
     if (itemType == 1) {
@@ -23,6 +23,10 @@ public:
     ~PersonListWidget() override = default;
     
     void setDatabase(std::shared_ptr<IDatabase> database);
+    
+    // Naming is held off while a clustering job is running
+    void setEditingEnabled(bool enabled);
+    
     void refresh();
     void clear();
     
@@ -45,6 +49,7 @@ private:
     std::shared_ptr<IDatabase> m_database;
     QListWidget *m_listWidget = nullptr;
     QPushButton *m_showAllButton = nullptr;
+    bool m_editingEnabled = true;
 };
 
 } // namespace facefling
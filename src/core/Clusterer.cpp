@@ -7,13 +7,29 @@
 #include "Clusterer.h"
 #include "../services/Database.h"
 #include "../services/FaceService.h"
+#include "../services/EmbeddingQuantizer.h"
+#include "../services/EmbeddingSnapshot.h"
+#include "../services/DistanceEngine.h"
+#include "../services/KnnGraph.h"
+#include "../services/GraphClusterer.h"
+#include "../services/ConcurrentUnionFind.h"
+#include "../services/KMeans.h"
+#include "../services/PrototypeSet.h"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <limits>
+#include <map>
 #include <iostream>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
 #include <set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
 
 namespace facefling {
 
@@ -30,6 +46,80 @@ public:
     std::shared_ptr<IDatabase> database;
     std::shared_ptr<FaceService> face_service;
     Config config;
+    Stats stats;
+    std::shared_ptr<EmbeddingSnapshot> snapshot;
+    std::shared_ptr<KnnGraph> graph;
+    DistanceEngine distances;
+    ChangeCallback on_changes;
+    int64_t change_cursor = 0;  // Last sequence delivered to on_changes
+    CheckpointCallback on_checkpoint;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> writing{false};  // A write transaction spans the checkpoints
+    
+    // Safe point of a long run, on any clustering thread: lets the
+    // checkpoint callback yield the CPU. Returns false once cancelled.
+    // While writing only cancellation is checked, since yielding with the
+    // write lock held would stall the other connections.
+    bool checkpoint() {
+        if (cancelled) {
+            return false;
+        }
+        if (on_checkpoint && !writing) {
+            on_checkpoint();
+        }
+        return !cancelled;
+    }
+    
+    // Commit the open write transaction and begin the next one, yielding
+    // in between. Returns false once cancelled; a transaction is open either way.
+    bool commit_and_checkpoint() {
+        database->commit();
+        writing = false;
+        publish_changes();
+        const bool running = checkpoint();
+        database->begin_transaction();
+        writing = true;
+        return running;
+    }
+    
+    void report_cancelled() const {
+        if (cancelled) {
+            std::cout << "[Clusterer] Cancelled; results committed so far are kept" << std::endl;
+        }
+    }
+    
+    // Rewrite faces of merged clusters, batch_size per transaction
+    int compact_aliases(int batch_size) {
+        int total = 0;
+        int rewritten = 0;
+        do {
+            database->begin_transaction();
+            try {
+                rewritten = database->compact_cluster_aliases(batch_size);
+                database->commit();
+            } catch (...) {
+                database->rollback();
+                throw;
+            }
+            total += rewritten;
+        } while (rewritten >= batch_size);
+        return total;
+    }
+    
+    // Deliver changes logged since the last call, then trim the log
+    void publish_changes() {
+        const int kPage = 10000;
+        if (on_changes) {
+            for (auto changes = database->get_cluster_changes(change_cursor, kPage); !changes.empty();
+                 changes = database->get_cluster_changes(change_cursor, kPage)) {
+                change_cursor = changes.back().sequence;
+                on_changes(changes);
+            }
+        }
+        if (config.changelog_keep > 0) {
+            database->trim_cluster_changes(config.changelog_keep);
+        }
+    }
     
     // Compute centroid (average) of multiple embeddings
     std::vector<float> compute_centroid(const std::vector<FaceEmbedding>& embeddings) {
@@ -53,25 +143,1148 @@ public:
         return centroid;
     }
     
-    // Update cluster's centroid after faces have been modified
-    void update_cluster_centroid(int64_t cluster_id) {
-        std::vector<Face> faces = database->get_faces_for_cluster(cluster_id);
+    // Encoder whose embeddings may be clustered. Embeddings from different
+    // encoders live in unrelated spaces, so they are never compared or averaged.
+    const std::string& model() const {
+        return face_service->embedding_model();
+    }
+    
+    bool is_current(const Face& face) const {
+        return (face.has_embedding() || !face.embedding_q.empty()) && face.embedding_model == model();
+    }
+    
+    // Faces read through get_quantized_faces() carry only the code
+    const FaceEmbedding& float_embedding(Face& face) {
+        if (!face.has_embedding()) {
+            auto full = database->get_face(face.id);
+            if (full.has_value()) {
+                face.embedding = std::move(full->embedding);
+            }
+        }
+        return face.embedding;
+    }
+    
+    // Prototypes for a cluster with these members (none when disabled).
+    // Large clusters are subsampled before selection.
+    std::vector<float> select_prototypes(const std::vector<const FaceEmbedding*>& members) const {
+        const size_t dims = 128;
+        const size_t k = static_cast<size_t>(std::max(0, config.prototypes));
+        
+        std::vector<const FaceEmbedding*> usable;
+        for (const FaceEmbedding* member : members) {
+            if (member->size() == dims) {
+                usable.push_back(member);
+            }
+        }
+        const size_t m = std::min(usable.size(), PrototypeSet::kMaxSample);
+        if (k == 0 || m == 0) {
+            return {};
+        }
         
+        std::vector<float> rows(m * dims);
+        for (size_t i = 0; i < m; ++i) {
+            const FaceEmbedding& row = *usable[i * usable.size() / m];
+            std::copy(row.begin(), row.end(), rows.begin() + i * dims);
+        }
+        return PrototypeSet::select(rows.data(), m, dims, k);
+    }
+    
+    // select_prototypes() for a working cluster; index maps face id to embedding
+    std::vector<float> select_prototypes(const std::vector<int64_t>& face_ids,
+                                         const std::unordered_map<int64_t, const FaceEmbedding*>& index) const {
+        std::vector<const FaceEmbedding*> members;
+        members.reserve(face_ids.size());
+        for (int64_t face_id : face_ids) {
+            auto it = index.find(face_id);
+            if (it != index.end()) {
+                members.push_back(it->second);
+            }
+        }
+        return select_prototypes(members);
+    }
+    
+    static std::unordered_map<int64_t, const FaceEmbedding*> embedding_index(const std::vector<Face>& faces) {
+        std::unordered_map<int64_t, const FaceEmbedding*> index;
+        index.reserve(faces.size());
+        for (const auto& face : faces) {
+            index.emplace(face.id, &face.embedding);
+        }
+        return index;
+    }
+    
+    // Rows a cluster is matched on: its prototypes, or the centroid without them
+    const std::vector<float>& anchors(const Cluster& cluster) const {
+        return config.prototypes > 0 && !cluster.prototypes.empty() ? cluster.prototypes : cluster.centroid;
+    }
+    
+    std::vector<QuantizedEmbedding> quantize_anchors(const Cluster& cluster) const {
+        const size_t dims = 128;
+        const std::vector<float>& rows = anchors(cluster);
+        std::vector<QuantizedEmbedding> codes;
+        for (size_t offset = 0; offset + dims <= rows.size(); offset += dims) {
+            codes.push_back(EmbeddingQuantizer::quantize(FaceEmbedding(rows.begin() + offset,
+                                                                       rows.begin() + offset + dims)));
+        }
+        return codes;
+    }
+    
+    // Embeddings of those faces that are Ready with the current model, from
+    // the snapshot when there is one (looked up by id, no row reads),
+    // otherwise in one query
+    std::vector<FaceEmbedding> current_embeddings(const std::vector<int64_t>& face_ids) {
         std::vector<FaceEmbedding> embeddings;
-        embeddings.reserve(faces.size());
-        for (const auto& f : faces) {
-            if (f.has_embedding()) {
-                embeddings.push_back(f.embedding);
+        if (!snapshot) {
+            for (auto& [face_id, embedding] : database->get_embeddings(face_ids, model())) {
+                embeddings.push_back(std::move(embedding));
+            }
+            return embeddings;
+        }
+        
+        std::lock_guard<std::mutex> lock(snapshot->mutex());  // Shared with the indexer
+        snapshot->sync(*database, model());
+        embeddings.reserve(face_ids.size());
+        for (int64_t face_id : face_ids) {
+            if (auto index = snapshot->find(face_id)) {
+                const float* row = snapshot->row(*index);
+                embeddings.emplace_back(row, row + EmbeddingSnapshot::kDims);
+            }
+        }
+        return embeddings;
+    }
+    
+    // Recompute a cluster's centroid and prototypes from its faces after
+    // they have been modified. Returns the cluster's new geometry.
+    Cluster rebuild_cluster(int64_t cluster_id) {
+        return rebuild_cluster(cluster_id, database->get_cluster_face_ids(cluster_id));
+    }
+    
+    Cluster rebuild_cluster(int64_t cluster_id, const std::vector<int64_t>& face_ids) {
+        std::vector<FaceEmbedding> embeddings = current_embeddings(face_ids);
+        
+        Cluster cluster;
+        cluster.id = cluster_id;
+        cluster.centroid = compute_centroid(embeddings);
+        if (!cluster.centroid.empty()) {
+            std::vector<const FaceEmbedding*> members;
+            for (const auto& embedding : embeddings) {
+                members.push_back(&embedding);
+            }
+            cluster.prototypes = select_prototypes(members);
+            database->update_cluster_centroid(cluster_id, cluster.centroid, model());
+            database->update_cluster_prototypes(cluster_id, cluster.prototypes);
+        }
+        return cluster;
+    }
+    
+    // Clusters usable for matching with the current encoder. A cluster built
+    // with another encoder is rebuilt once all of its faces have been
+    // re-embedded; until then it is left out. Clusters saved before
+    // prototypes were kept get them here, once.
+    std::vector<Cluster> current_clusters(std::vector<Cluster> clusters) {
+        std::vector<Cluster> usable;
+        int waiting = 0;
+        for (auto& cluster : clusters) {
+            if (cluster.embedding_model != model()) {
+                std::vector<Face> faces = database->get_faces_for_cluster(cluster.id);
+                bool reembedded = std::all_of(faces.begin(), faces.end(), [this](const Face& f) {
+                    return f.embedding_state != EmbeddingState::Ready || f.embedding_model == model();
+                });
+                if (!reembedded) {
+                    waiting++;
+                    continue;
+                }
+                Cluster rebuilt = rebuild_cluster(cluster.id);
+                cluster.centroid = std::move(rebuilt.centroid);
+                cluster.prototypes = std::move(rebuilt.prototypes);
+                cluster.embedding_model = model();
+            } else if (config.prototypes > 0 && cluster.prototypes.empty()) {
+                Cluster rebuilt = rebuild_cluster(cluster.id);
+                cluster.prototypes = std::move(rebuilt.prototypes);
+            }
+            usable.push_back(std::move(cluster));
+        }
+        
+        if (waiting > 0) {
+            std::cout << "[Clusterer] " << waiting << " clusters still hold embeddings from another model; "
+                      << "skipped until re-embedded" << std::endl;
+        }
+        return usable;
+    }
+    
+    // All Ready faces of the current model, with id and embedding only
+    std::vector<Face> load_faces_with_embeddings() {
+        if (!snapshot) {
+            return current_faces(database->get_all_faces_with_embeddings());
+        }
+        
+        std::lock_guard<std::mutex> lock(snapshot->mutex());
+        snapshot->sync(*database, model());
+        std::vector<Face> faces(snapshot->size());
+        const int64_t* ids = snapshot->face_ids();
+        for (size_t i = 0; i < faces.size(); ++i) {
+            faces[i].id = ids[i];
+            faces[i].embedding.assign(snapshot->row(i), snapshot->row(i) + EmbeddingSnapshot::kDims);
+            faces[i].embedding_model = model();
+        }
+        return faces;
+    }
+    
+    // Graph over the current snapshot, or nullptr without one. Nodes are
+    // snapshot rows, so both are synced together.
+    const KnnGraph* knn_graph() {
+        if (!graph || !snapshot) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(snapshot->mutex());
+        snapshot->sync(*database, model());
+        graph->sync(*snapshot);
+        return graph.get();
+    }
+    
+    struct WorkingCluster {
+        std::vector<int64_t> face_ids;
+        FaceEmbedding centroid;
+    };
+    
+    // cluster_all() by centroid linkage
+    std::vector<WorkingCluster> agglomerate(const std::vector<Face>& faces, ProgressCallback progress,
+                                            const DistanceEngine& engine) {
+        // Centroid linkage on a packed centroid matrix. Each live cluster caches
+        // its nearest neighbour within the threshold, so a merge only recomputes
+        // the distance rows of the merged cluster and of clusters whose nearest
+        // neighbour took part in it, instead of rescanning all pairs.
+        const size_t dims = 128;
+        const size_t n = faces.size();
+        const float threshold = config.distance_threshold;
+        const float no_neighbour = std::numeric_limits<float>::infinity();
+        
+        std::vector<float> centroids(n * dims);
+        std::vector<size_t> counts(n, 1);
+        std::vector<bool> alive(n, true);
+        std::vector<std::vector<int64_t>> members(n);
+        for (size_t i = 0; i < n; ++i) {
+            std::copy(faces[i].embedding.begin(), faces[i].embedding.end(), centroids.begin() + i * dims);
+            members[i].push_back(faces[i].id);
+        }
+        
+        std::vector<size_t> nearest(n, n);
+        std::vector<float> nearest_dist(n, no_neighbour);
+        for (const auto& pair : engine.pairs_within(centroids.data(), n, dims, threshold)) {
+            if (pair.distance < nearest_dist[pair.a]) {
+                nearest_dist[pair.a] = pair.distance;
+                nearest[pair.a] = pair.b;
+            }
+            if (pair.distance < nearest_dist[pair.b]) {
+                nearest_dist[pair.b] = pair.distance;
+                nearest[pair.b] = pair.a;
+            }
+        }
+        
+        // Recompute the nearest live neighbour of each listed cluster
+        std::vector<float> block;
+        auto refresh_rows = [&](const std::vector<size_t>& rows) {
+            std::vector<float> queries(rows.size() * dims);
+            for (size_t r = 0; r < rows.size(); ++r) {
+                std::copy_n(centroids.begin() + rows[r] * dims, dims, queries.begin() + r * dims);
+            }
+            block.resize(rows.size() * n);
+            engine.squared_distances(queries.data(), rows.size(), centroids.data(), n, dims, block.data());
+            
+            for (size_t r = 0; r < rows.size(); ++r) {
+                const size_t i = rows[r];
+                nearest[i] = n;
+                nearest_dist[i] = no_neighbour;
+                for (size_t k = 0; k < n; ++k) {
+                    if (k == i || !alive[k]) continue;
+                    const float dist = std::sqrt(block[r * n + k]);
+                    if (dist <= threshold && dist < nearest_dist[i]) {
+                        nearest_dist[i] = dist;
+                        nearest[i] = k;
+                    }
+                }
+            }
+        };
+        
+        const int total_faces = static_cast<int>(n);
+        int merges_done = 0;
+        
+        // Agglomerative clustering: iteratively merge closest clusters
+        while (true) {
+            if (!checkpoint()) {
+                return {};
+            }
+            
+            float min_dist = no_neighbour;
+            size_t merge_i = n;
+            for (size_t i = 0; i < n; ++i) {
+                if (alive[i] && nearest_dist[i] < min_dist) {
+                    min_dist = nearest_dist[i];
+                    merge_i = i;
+                }
+            }
+            
+            // Stop if no clusters are close enough
+            if (merge_i == n) {
+                break;
+            }
+            const size_t merge_j = nearest[merge_i];
+            
+            // Merge cluster j into cluster i; the centroid stays the mean of all members
+            const float wi = static_cast<float>(counts[merge_i]);
+            const float wj = static_cast<float>(counts[merge_j]);
+            for (size_t k = 0; k < dims; ++k) {
+                float& c = centroids[merge_i * dims + k];
+                c = (c * wi + centroids[merge_j * dims + k] * wj) / (wi + wj);
+            }
+            counts[merge_i] += counts[merge_j];
+            members[merge_i].insert(members[merge_i].end(), members[merge_j].begin(), members[merge_j].end());
+            members[merge_j].clear();
+            alive[merge_j] = false;
+            
+            // Only distances to the moved centroid changed
+            std::vector<size_t> stale = {merge_i};
+            for (size_t k = 0; k < n; ++k) {
+                if (alive[k] && k != merge_i && (nearest[k] == merge_i || nearest[k] == merge_j)) {
+                    stale.push_back(k);
+                }
+            }
+            refresh_rows(stale);
+            
+            // Clusters that now have the merged one as their nearest neighbour
+            for (size_t k = 0; k < n; ++k) {
+                if (!alive[k] || k == merge_i) continue;
+                const float dist = std::sqrt(block[k]);  // Row 0 of the block is merge_i
+                if (dist <= threshold && dist < nearest_dist[k]) {
+                    nearest_dist[k] = dist;
+                    nearest[k] = merge_i;
+                }
+            }
+            
+            merges_done++;
+            if (progress) {
+                progress(merges_done, total_faces);
+            }
+        }
+        
+        std::vector<WorkingCluster> clusters;
+        for (size_t i = 0; i < n; ++i) {
+            if (alive[i]) {
+                WorkingCluster wc;
+                wc.face_ids = std::move(members[i]);
+                wc.centroid.assign(centroids.begin() + i * dims, centroids.begin() + (i + 1) * dims);
+                clusters.push_back(std::move(wc));
+            }
+        }
+        
+        return clusters;
+    }
+    
+    // kNN graph over exactly these faces: the shared one when it matches (it
+    // does when both come from the snapshot), otherwise one built into local
+    const KnnGraph* graph_for(const std::vector<Face>& faces, bool use_shared, int threads,
+                              std::unique_ptr<KnnGraph>& local) {
+        const size_t dims = 128;
+        const size_t n = faces.size();
+        
+        const KnnGraph* knn = use_shared ? knn_graph() : nullptr;
+        bool matches = knn && knn->size() == n;
+        for (size_t i = 0; matches && i < n; ++i) {
+            matches = knn->face_id(i) == faces[i].id;
+        }
+        if (matches) {
+            return knn;
+        }
+        
+        std::vector<float> matrix(n * dims);
+        std::vector<int64_t> ids(n);
+        for (size_t i = 0; i < n; ++i) {
+            std::copy(faces[i].embedding.begin(), faces[i].embedding.end(), matrix.begin() + i * dims);
+            ids[i] = faces[i].id;
+        }
+        KnnGraph::Config graph_config;
+        graph_config.max_distance = config.distance_threshold;
+        graph_config.threads = threads;
+        local = std::make_unique<KnnGraph>(std::string(), graph_config);
+        local->build(matrix.data(), ids.data(), n, dims);
+        return local.get();
+    }
+    
+    // Group faces by label, with each group's mean embedding
+    std::vector<WorkingCluster> group_by_label(const std::vector<Face>& faces, const std::vector<uint32_t>& labels) {
+        std::vector<std::vector<FaceEmbedding>> embeddings(GraphClusterer::label_count(labels));
+        std::vector<WorkingCluster> clusters(embeddings.size());
+        for (size_t i = 0; i < faces.size(); ++i) {
+            clusters[labels[i]].face_ids.push_back(faces[i].id);
+            embeddings[labels[i]].push_back(faces[i].embedding);
+        }
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            clusters[c].centroid = compute_centroid(embeddings[c]);
+        }
+        return clusters;
+    }
+    
+    // cluster_all() by graph clustering on the kNN graph at distance_threshold
+    std::vector<WorkingCluster> cluster_on_graph(const std::vector<Face>& faces, ProgressCallback progress,
+                                                 bool use_shared_graph, int threads) {
+        std::unique_ptr<KnnGraph> local;
+        const KnnGraph* knn = graph_for(faces, use_shared_graph, threads, local);
+        
+        GraphClusterer::Config graph_config;
+        graph_config.threshold = config.distance_threshold;
+        graph_config.iterations = config.whispers_iterations;
+        graph_config.threads = threads;
+        GraphClusterer clusterer(graph_config);
+        
+        const std::vector<uint32_t> labels = config.algorithm == Algorithm::ChineseWhispers
+            ? clusterer.chinese_whispers(*knn)
+            : clusterer.connected_components(*knn);
+        
+        if (progress) {
+            progress(static_cast<int>(faces.size()), static_cast<int>(faces.size()));
+        }
+        return group_by_label(faces, labels);
+    }
+    
+    // Connected components at distance_threshold over all pairs (single
+    // linkage). Small sets stream an exact threshold join straight into a
+    // concurrent union-find; large ones unite the edges of the kNN graph.
+    std::vector<uint32_t> threshold_components(const std::vector<Face>& faces) {
+        const size_t dims = 128;
+        const size_t n = faces.size();
+        
+        if (n > config.exact_join_max_faces) {
+            std::unique_ptr<KnnGraph> local;
+            const KnnGraph* knn = graph_for(faces, true, config.distance_threads, local);
+            GraphClusterer::Config graph_config;
+            graph_config.threshold = config.distance_threshold;
+            graph_config.threads = config.distance_threads;
+            return GraphClusterer(graph_config).connected_components(*knn);
+        }
+        
+        std::vector<float> matrix(n * dims);
+        for (size_t i = 0; i < n; ++i) {
+            std::copy(faces[i].embedding.begin(), faces[i].embedding.end(), matrix.begin() + i * dims);
+        }
+        ConcurrentUnionFind sets(n);
+        distances.for_each_pair_within(matrix.data(), n, dims, config.distance_threshold,
+            [&sets](const DistanceEngine::Pair* pairs, size_t count) {
+                for (size_t p = 0; p < count; ++p) {
+                    sets.unite(pairs[p].a, pairs[p].b);
+                }
+            });
+        return sets.labels();
+    }
+    
+    // cluster_all() for large libraries. k-means splits the faces into shards
+    // of about shard_faces; each shard is clustered on its own, shards in
+    // parallel with one thread each, so working memory is bounded by the
+    // shard size. Each shard is saved (and its changes published) as soon as
+    // it is done, so results appear shard by shard. A boundary pass then
+    // merges clusters from different shards whose centroids are within
+    // distance_threshold. Only clusters within the threshold of a shard
+    // boundary (in the k-means Voronoi sense) can have such a partner, and
+    // only shards sharing that boundary are compared.
+    // Returns the number of clusters left after the boundary pass.
+    size_t cluster_sharded(const std::vector<Face>& faces, ProgressCallback progress) {
+        const size_t dims = 128;
+        const size_t n = faces.size();
+        const float threshold = config.distance_threshold;
+        
+        std::vector<float> matrix(n * dims);
+        for (size_t i = 0; i < n; ++i) {
+            std::copy(faces[i].embedding.begin(), faces[i].embedding.end(), matrix.begin() + i * dims);
+        }
+        
+        KMeans::Config kmeans_config;
+        kmeans_config.threads = config.distance_threads;
+        const KMeans kmeans(kmeans_config);
+        const size_t shard_count = (n + config.shard_faces - 1) / config.shard_faces;
+        const std::vector<float> cells = kmeans.train(matrix.data(), n, dims, shard_count);
+        const size_t shards = cells.size() / dims;
+        const std::vector<uint32_t> shard_of = kmeans.assign(matrix.data(), n, cells.data(), shards, dims);
+        matrix = std::vector<float>();
+        
+        std::vector<std::vector<size_t>> members(shards);
+        for (size_t i = 0; i < n; ++i) {
+            members[shard_of[i]].push_back(i);
+        }
+        size_t largest = 0;
+        for (const auto& shard : members) {
+            largest = std::max(largest, shard.size());
+        }
+        std::cout << "[Clusterer] Clustering " << shards << " shards (largest " << largest
+                  << " faces)..." << std::endl;
+        
+        // Fine clustering on worker threads, shards claimed from a counter.
+        // This thread saves each shard as it comes in.
+        std::vector<std::vector<WorkingCluster>> results(shards);
+        DistanceEngine::Config single;
+        single.threads = 1;
+        const DistanceEngine engine(single);
+        std::atomic<size_t> next_shard{0};
+        std::mutex done_mutex;
+        std::condition_variable shard_done;
+        std::deque<size_t> done;
+        std::exception_ptr error;
+        auto run = [&]() {
+            for (size_t shard = next_shard++; shard < shards; shard = next_shard++) {
+                std::vector<WorkingCluster> result;
+                try {
+                    if (checkpoint()) {
+                        std::vector<Face> shard_faces(members[shard].size());
+                        for (size_t j = 0; j < members[shard].size(); ++j) {
+                            shard_faces[j].id = faces[members[shard][j]].id;
+                            shard_faces[j].embedding = faces[members[shard][j]].embedding;
+                        }
+                        result = config.algorithm == Algorithm::Agglomerative
+                            ? agglomerate(shard_faces, nullptr, engine)
+                            : cluster_on_graph(shard_faces, nullptr, false, 1);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    error = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    results[shard] = std::move(result);
+                    done.push_back(shard);
+                }
+                shard_done.notify_one();
+            }
+        };
+        
+        int workers = config.distance_threads > 0
+            ? config.distance_threads
+            : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        workers = std::max(1, std::min(workers, static_cast<int>(shards)));
+        std::vector<std::thread> pool;
+        for (int w = 0; w < workers; ++w) {
+            pool.emplace_back(run);
+        }
+        
+        const auto index = embedding_index(faces);
+        std::vector<WorkingCluster> clusters;
+        std::vector<Cluster> saved;  // Per cluster; id 0 if below min_cluster_size
+        std::vector<uint32_t> cluster_shard;
+        size_t faces_done = 0;
+        try {
+            for (size_t received = 0; received < shards; ++received) {
+                size_t shard;
+                std::vector<WorkingCluster> result;
+                {
+                    std::unique_lock<std::mutex> lock(done_mutex);
+                    shard_done.wait(lock, [&]() { return !done.empty(); });
+                    shard = done.front();
+                    done.pop_front();
+                    result = std::move(results[shard]);
+                    if (error) {
+                        cancelled = true;  // Stop the other workers; rethrown below
+                        continue;
+                    }
+                }
+                if (result.empty() || !checkpoint()) {
+                    continue;
+                }
+                
+                std::vector<Cluster> shard_saved = save_clusters(index, result);
+                for (size_t c = 0; c < result.size(); ++c) {
+                    clusters.push_back(std::move(result[c]));
+                    saved.push_back(std::move(shard_saved[c]));
+                    cluster_shard.push_back(static_cast<uint32_t>(shard));
+                }
+                publish_changes();
+                faces_done += members[shard].size();
+                if (progress) {
+                    progress(static_cast<int>(faces_done), static_cast<int>(n));
+                }
+            }
+        } catch (...) {
+            cancelled = true;
+            for (auto& thread : pool) {
+                thread.join();
+            }
+            throw;
+        }
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (cancelled) {
+            return clusters.size();
+        }
+        
+        // Boundary pass. A centroid c in shard a lies within the threshold of
+        // shard b's half-space iff (|c - m_b|^2 - |c - m_a|^2) / (2 |m_a - m_b|) <= threshold.
+        std::vector<float> centroids(clusters.size() * dims);
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            std::copy(clusters[c].centroid.begin(), clusters[c].centroid.end(), centroids.begin() + c * dims);
+        }
+        std::vector<float> cell_d2(shards * shards);
+        distances.squared_distances(cells.data(), shards, cells.data(), shards, dims, cell_d2.data());
+        std::vector<float> to_cells(clusters.size() * shards);
+        distances.squared_distances(centroids.data(), clusters.size(), cells.data(), shards, dims, to_cells.data());
+        
+        std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> near;  // (own, other) -> clusters
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            const uint32_t a = cluster_shard[c];
+            const float* d2 = to_cells.data() + c * shards;
+            for (uint32_t b = 0; b < shards; ++b) {
+                if (b == a) continue;
+                const float gap = std::sqrt(cell_d2[a * shards + b]);
+                if (gap > 0.0f && (d2[b] - d2[a]) / (2.0f * gap) <= threshold) {
+                    near[{a, b}].push_back(static_cast<uint32_t>(c));
+                }
+            }
+        }
+        
+        ConcurrentUnionFind joined(clusters.size());
+        size_t boundary_merges = 0;
+        std::vector<float> left;
+        std::vector<float> right;
+        for (const auto& [key, own] : near) {
+            if (key.first > key.second) continue;
+            auto other = near.find({key.second, key.first});
+            if (other == near.end()) continue;
+            
+            auto gather = [&](const std::vector<uint32_t>& ids, std::vector<float>& out) {
+                out.resize(ids.size() * dims);
+                for (size_t r = 0; r < ids.size(); ++r) {
+                    std::copy_n(centroids.begin() + ids[r] * dims, dims, out.begin() + r * dims);
+                }
+            };
+            gather(own, left);
+            gather(other->second, right);
+            for (const auto& pair : distances.pairs_within(left.data(), own.size(), right.data(),
+                                                           other->second.size(), dims, threshold)) {
+                if (joined.unite(own[pair.a], other->second[pair.b])) {
+                    boundary_merges++;
+                }
+            }
+        }
+        
+        // Apply the merges to the saved clusters: the largest saved member of
+        // each group absorbs the others by alias (see merge_clusters), with a
+        // size-weighted centroid and prototypes re-picked from the members'
+        const std::vector<uint32_t> labels = joined.labels();
+        std::vector<std::vector<size_t>> groups(GraphClusterer::label_count(labels));
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            groups[labels[c]].push_back(c);
+        }
+        const size_t k = static_cast<size_t>(std::max(0, config.prototypes));
+        size_t kept = 0;
+        
+        database->begin_transaction();
+        
+        try {
+            for (const auto& group : groups) {
+                size_t root = SIZE_MAX;
+                size_t group_faces = 0;
+                for (size_t c : group) {
+                    group_faces += clusters[c].face_ids.size();
+                    if (saved[c].id != 0 &&
+                        (root == SIZE_MAX || clusters[c].face_ids.size() > clusters[root].face_ids.size())) {
+                        root = c;
+                    }
+                }
+                if (root == SIZE_MAX && static_cast<int>(group_faces) < config.min_cluster_size) {
+                    continue;
+                }
+                kept++;
+                if (group.size() < 2) {
+                    continue;
+                }
+                
+                std::vector<double> sum(dims, 0.0);
+                std::vector<float> pool;
+                for (size_t c : group) {
+                    const double weight = static_cast<double>(clusters[c].face_ids.size());
+                    for (size_t d = 0; d < dims; ++d) {
+                        sum[d] += clusters[c].centroid[d] * weight;
+                    }
+                    const std::vector<float> rows = saved[c].id != 0
+                        ? saved[c].prototypes
+                        : select_prototypes(clusters[c].face_ids, index);
+                    pool.insert(pool.end(), rows.begin(), rows.end());
+                }
+                FaceEmbedding centroid(dims);
+                for (size_t d = 0; d < dims; ++d) {
+                    centroid[d] = static_cast<float>(sum[d] / group_faces);
+                }
+                std::vector<float> prototypes = PrototypeSet::select(pool.data(), pool.size() / dims, dims, k);
+                
+                int64_t root_id = 0;
+                if (root != SIZE_MAX) {
+                    root_id = saved[root].id;
+                    database->update_cluster_centroid(root_id, centroid, model());
+                    database->update_cluster_prototypes(root_id, prototypes);
+                } else {
+                    // Only clusters held back as too small: together they count
+                    Cluster cluster;
+                    cluster.centroid = std::move(centroid);
+                    cluster.prototypes = std::move(prototypes);
+                    cluster.embedding_model = model();
+                    cluster.face_count = static_cast<int>(group_faces);
+                    cluster.created_date = get_current_timestamp();
+                    root_id = database->insert_cluster(cluster);
+                }
+                for (size_t c : group) {
+                    if (saved[c].id == root_id) continue;
+                    if (saved[c].id != 0) {
+                        database->merge_clusters(root_id, saved[c].id);
+                    } else {
+                        database->move_faces_to_cluster(clusters[c].face_ids, root_id);
+                    }
+                }
+            }
+            
+            database->commit();
+        
+        } catch (...) {
+            database->rollback();
+            throw;
+        }
+        
+        std::cout << "[Clusterer] Boundary pass merged " << boundary_merges << " cluster pairs across shards"
+                  << std::endl;
+        if (boundary_merges > 0) {
+            publish_changes();
+            compact_aliases(5000);
+        }
+        return kept;
+    }
+    
+    // Insert clusters and assign their faces. Commits (and publishes the
+    // changes) every commit_faces faces, stopping early if cancelled.
+    // Returns the stored clusters by position; id 0 for those skipped as
+    // smaller than min_cluster_size or not reached.
+    std::vector<Cluster> save_clusters(const std::unordered_map<int64_t, const FaceEmbedding*>& index,
+                                       const std::vector<WorkingCluster>& clusters) {
+        std::vector<Cluster> saved(clusters.size());
+        size_t uncommitted = 0;
+        
+        // Save clusters to database
+        database->begin_transaction();
+        
+        try {
+            for (size_t c = 0; c < clusters.size(); ++c) {
+                const WorkingCluster& wc = clusters[c];
+                if (static_cast<int>(wc.face_ids.size()) < config.min_cluster_size) {
+                    continue;
+                }
+                
+                // Create cluster record
+                Cluster& cluster = saved[c];
+                cluster.centroid = wc.centroid;
+                cluster.prototypes = select_prototypes(wc.face_ids, index);
+                cluster.embedding_model = model();
+                cluster.face_count = static_cast<int>(wc.face_ids.size());
+                cluster.created_date = get_current_timestamp();
+                
+                cluster.id = database->insert_cluster(cluster);
+                
+                // Assign faces to this cluster
+                database->move_faces_to_cluster(wc.face_ids, cluster.id);
+                
+                uncommitted += wc.face_ids.size();
+                if (config.commit_faces > 0 && uncommitted >= config.commit_faces && c + 1 < clusters.size()) {
+                    database->commit();
+                    uncommitted = 0;
+                    publish_changes();
+                    if (!checkpoint()) {
+                        return saved;
+                    }
+                    database->begin_transaction();
+                }
+            }
+            
+            database->commit();
+        
+        } catch (...) {
+            database->rollback();
+            throw;
+        }
+        return saved;
+    }
+    
+    // cluster_new_faces() one face at a time: each face is matched against
+    // the clusters as they stand after the faces before it
+    void assign_one_by_one(std::vector<Face>& unclustered, ProgressCallback progress) {
+        const bool quantized = config.quantized;
+        
+        database->begin_transaction();
+        writing = true;
+        
+        try {
+            // Get existing clusters
+            std::vector<Cluster> existing_clusters = current_clusters(database->get_all_clusters());
+            std::vector<std::vector<QuantizedEmbedding>> codes;
+            if (quantized) {
+                for (const auto& cluster : existing_clusters) {
+                    codes.push_back(quantize_anchors(cluster));
+                }
+            }
+            
+            int processed = 0;
+            int total = static_cast<int>(unclustered.size());
+            size_t uncommitted = 0;
+            
+            for (auto& face : unclustered) {
+                if (config.commit_faces > 0 && uncommitted >= config.commit_faces) {
+                    uncommitted = 0;
+                    if (!commit_and_checkpoint()) {
+                        break;
+                    }
+                }
+                if (!checkpoint()) {
+                    break;
+                }
+                if (!is_current(face)) continue;
+                
+                // Try to find a matching existing cluster
+                auto nearest = quantized
+                    ? find_nearest_cluster_quantized(face, existing_clusters, codes)
+                    : find_nearest_cluster(face.embedding, existing_clusters);
+                
+                if (nearest.has_value()) {
+                    // Add to existing cluster
+                    database->update_face_cluster(face.id, nearest.value());
+                    Cluster rebuilt = rebuild_cluster(nearest.value());
+                    
+                    // Keep the working copy in step with the stored cluster
+                    for (size_t i = 0; i < existing_clusters.size(); ++i) {
+                        if (existing_clusters[i].id == nearest.value() && !rebuilt.centroid.empty()) {
+                            existing_clusters[i].centroid = std::move(rebuilt.centroid);
+                            existing_clusters[i].prototypes = std::move(rebuilt.prototypes);
+                            if (quantized) {
+                                codes[i] = quantize_anchors(existing_clusters[i]);
+                            }
+                            break;
+                        }
+                    }
+                } else {
+                    // Create a new cluster for this face
+                    Cluster cluster;
+                    cluster.centroid = float_embedding(face);
+                    if (config.prototypes > 0) {
+                        cluster.prototypes = cluster.centroid;
+                    }
+                    cluster.embedding_model = model();
+                    cluster.face_count = 1;
+                    cluster.created_date = get_current_timestamp();
+                    
+                    int64_t cluster_id = database->insert_cluster(cluster);
+                    database->update_face_cluster(face.id, cluster_id);
+                    
+                    // Add to our working list so subsequent faces can join
+                    cluster.id = cluster_id;
+                    if (quantized) {
+                        codes.push_back({face.embedding_q});
+                    }
+                    existing_clusters.push_back(cluster);
+                }
+                
+                processed++;
+                uncommitted++;
+                if (progress) {
+                    progress(processed, total);
+                }
             }
+            
+            database->commit();
+            writing = false;
+        
+        } catch (...) {
+            writing = false;
+            database->rollback();
+            throw;
         }
+    
+    }
+    
+    // cluster_new_faces() in mini-batches. A batch is matched against the
+    // packed prototypes of every cluster in one DistanceEngine pass; faces
+    // read as int8 codes are dequantized for it and settled in float32 near a
+    // decision, as in find_nearest_cluster_quantized(). Existing clusters stay
+    // fixed within a batch, while faces that match nothing open clusters the
+    // rest of the batch can join. Centroids then move by running-mean deltas,
+    // prototype sets take in their new members (PrototypeSet::add). The
+    // state is written (and the changes published) after every
+    // commit_faces faces and at the end, so results show up as they come.
+    void assign_in_batches(std::vector<Face>& unclustered, ProgressCallback progress) {
+        const size_t dims = 128;
+        const size_t batch_size = static_cast<size_t>(config.batch_size);
+        const float threshold = config.distance_threshold;
+        const float margin = config.rerank_margin;
+        
+        auto distance = [dims](const float* a, const float* b) {
+            float sum = 0.0f;
+            for (size_t k = 0; k < dims; ++k) {
+                const float diff = a[k] - b[k];
+                sum += diff * diff;
+            }
+            return std::sqrt(sum);
+        };
         
-        auto centroid = compute_centroid(embeddings);
-        if (!centroid.empty()) {
-            database->update_cluster_centroid(cluster_id, centroid);
+        // Working clusters: existing ones first, then those opened here (id 0 until inserted)
+        std::vector<Cluster> clusters = current_clusters(database->get_all_clusters());
+        clusters.erase(std::remove_if(clusters.begin(), clusters.end(),
+                                      [dims](const Cluster& c) { return c.centroid.size() != dims; }),
+                       clusters.end());
+        const size_t existing = clusters.size();
+        std::map<int64_t, int> sizes = database->get_cluster_sizes(model());
+        
+        const bool use_prototypes = config.prototypes > 0;
+        const size_t k = static_cast<size_t>(std::max(0, config.prototypes));
+        
+        std::vector<float> centroids(existing * dims);
+        std::vector<std::vector<float>> prototypes(existing);  // Empty: matched on the centroid
+        std::vector<int64_t> ids(existing);
+        std::vector<int> counts(existing);
+        std::vector<bool> moved(existing, false);
+        std::vector<bool> reshaped(existing, false);
+        for (size_t c = 0; c < existing; ++c) {
+            std::copy(clusters[c].centroid.begin(), clusters[c].centroid.end(), centroids.begin() + c * dims);
+            if (use_prototypes) {
+                prototypes[c] = std::move(clusters[c].prototypes);
+            }
+            ids[c] = clusters[c].id;
+            counts[c] = sizes[clusters[c].id];
         }
+        
+        // Distance from a row to working cluster c
+        auto cluster_distance = [&](const float* row, size_t c) {
+            return prototypes[c].empty()
+                ? distance(row, centroids.data() + c * dims)
+                : PrototypeSet::distance(prototypes[c], row, dims);
+        };
+        
+        std::vector<std::pair<int64_t, size_t>> assignments;  // (face_id, working cluster), not yet written
+        size_t assigned = 0;
+        const int total = static_cast<int>(unclustered.size());
+        
+        // Write moved clusters, insert opened ones and store the assignments
+        auto flush = [&]() {
+            database->begin_transaction();
+            
+            try {
+                for (size_t c = 0; c < ids.size(); ++c) {
+                    if (!moved[c]) continue;
+                    FaceEmbedding centroid(centroids.begin() + c * dims, centroids.begin() + (c + 1) * dims);
+                    if (ids[c] != 0) {
+                        database->update_cluster_centroid(ids[c], centroid, model());
+                        if (reshaped[c]) {
+                            database->update_cluster_prototypes(ids[c], prototypes[c]);
+                        }
+                    } else {
+                        Cluster cluster;
+                        cluster.centroid = std::move(centroid);
+                        cluster.prototypes = prototypes[c];
+                        cluster.embedding_model = model();
+                        cluster.face_count = counts[c];
+                        cluster.created_date = get_current_timestamp();
+                        ids[c] = database->insert_cluster(cluster);
+                    }
+                    moved[c] = false;
+                    reshaped[c] = false;
+                }
+                
+                std::vector<std::pair<int64_t, int64_t>> face_clusters;
+                face_clusters.reserve(assignments.size());
+                for (const auto& [face_id, c] : assignments) {
+                    face_clusters.emplace_back(face_id, ids[c]);
+                }
+                database->update_face_clusters(face_clusters);
+                
+                database->commit();
+            
+            } catch (...) {
+                database->rollback();
+                throw;
+            }
+            
+            assigned += assignments.size();
+            assignments.clear();
+            publish_changes();
+        };
+        
+        for (size_t begin = 0; begin < unclustered.size(); begin += batch_size) {
+            const size_t count = std::min(batch_size, unclustered.size() - begin);
+            
+            // Batch rows: float32 where loaded, dequantized codes otherwise
+            std::vector<float> rows(count * dims);
+            std::vector<bool> approximate(count, false);
+            for (size_t i = 0; i < count; ++i) {
+                Face& face = unclustered[begin + i];
+                const FaceEmbedding row = face.has_embedding()
+                    ? face.embedding
+                    : EmbeddingQuantizer::dequantize(face.embedding_q);
+                std::copy(row.begin(), row.end(), rows.begin() + i * dims);
+                approximate[i] = !face.has_embedding();
+            }
+            
+            // Every cluster's prototypes (or centroid) packed into one matrix
+            const size_t known = ids.size();
+            std::vector<float> anchors;
+            std::vector<uint32_t> owner;
+            for (size_t c = 0; c < known; ++c) {
+                const float* begin = prototypes[c].empty() ? centroids.data() + c * dims : prototypes[c].data();
+                const size_t rows_of = prototypes[c].empty() ? 1 : prototypes[c].size() / dims;
+                anchors.insert(anchors.end(), begin, begin + rows_of * dims);
+                owner.insert(owner.end(), rows_of, static_cast<uint32_t>(c));
+            }
+            
+            std::vector<float> block(count * known, std::numeric_limits<float>::max());
+            if (known > 0) {
+                std::vector<float> to_anchors(count * owner.size());
+                distances.squared_distances(rows.data(), count, anchors.data(), owner.size(), dims,
+                                            to_anchors.data());
+                for (size_t i = 0; i < count; ++i) {
+                    const float* from = to_anchors.data() + i * owner.size();
+                    float* to = block.data() + i * known;
+                    for (size_t a = 0; a < owner.size(); ++a) {
+                        to[owner[a]] = std::min(to[owner[a]], from[a]);
+                    }
+                }
+            }
+            
+            std::map<size_t, std::vector<float>> sums;  // Deltas for clusters known before the batch
+            std::map<size_t, int> added;
+            std::vector<std::pair<size_t, size_t>> joins;  // (cluster known before the batch, batch row)
+            
+            for (size_t i = 0; i < count; ++i) {
+                Face& face = unclustered[begin + i];
+                float* row = rows.data() + i * dims;
+                const float* d2 = block.data() + i * known;
+                
+                size_t best = SIZE_MAX;
+                float best_dist = std::numeric_limits<float>::max();
+                float second_dist = std::numeric_limits<float>::max();
+                for (size_t c = 0; c < known; ++c) {
+                    const float dist = std::sqrt(d2[c]);
+                    if (dist < best_dist) {
+                        second_dist = best_dist;
+                        best_dist = dist;
+                        best = c;
+                    } else if (dist < second_dist) {
+                        second_dist = dist;
+                    }
+                }
+                
+                if (approximate[i]) {
+                    stats.faces_assigned++;
+                    const bool clear = best_dist > threshold + margin ||
+                        (best_dist < threshold - margin && second_dist > best_dist + 2.0f * margin);
+                    if (!clear) {
+                        // Borderline: settle with the stored float32 embedding
+                        const FaceEmbedding& exact = float_embedding(face);
+                        if (exact.size() == dims) {
+                            std::copy(exact.begin(), exact.end(), row);
+                            best_dist = std::numeric_limits<float>::max();
+                            for (size_t c = 0; c < known; ++c) {
+                                if (std::sqrt(d2[c]) > threshold + margin) continue;
+                                const float dist = cluster_distance(row, c);
+                                if (dist < best_dist) {
+                                    best_dist = dist;
+                                    best = c;
+                                }
+                            }
+                        }
+                        stats.faces_reranked++;
+                    }
+                }
+                
+                // Clusters opened earlier in this batch
+                for (size_t c = known; c < ids.size(); ++c) {
+                    const float dist = cluster_distance(row, c);
+                    if (dist < best_dist) {
+                        best_dist = dist;
+                        best = c;
+                    }
+                }
+                
+                if (best != SIZE_MAX && best_dist <= threshold) {
+                    if (best < known) {
+                        auto& sum = sums[best];
+                        sum.resize(dims, 0.0f);
+                        for (size_t k = 0; k < dims; ++k) {
+                            sum[k] += row[k];
+                        }
+                        added[best]++;
+                        joins.emplace_back(best, i);
+                    } else {
+                        // Opened in this batch: move its centroid right away
+                        float* centroid = centroids.data() + best * dims;
+                        const float n = static_cast<float>(counts[best]);
+                        for (size_t k = 0; k < dims; ++k) {
+                            centroid[k] = (centroid[k] * n + row[k]) / (n + 1.0f);
+                        }
+                        counts[best]++;
+                        if (!prototypes[best].empty()) {
+                            PrototypeSet::add(prototypes[best], row, dims, k);
+                        }
+                    }
+                } else {
+                    best = ids.size();
+                    centroids.insert(centroids.end(), row, row + dims);
+                    prototypes.emplace_back(use_prototypes ? std::vector<float>(row, row + dims) : std::vector<float>());
+                    ids.push_back(0);
+                    counts.push_back(1);
+                    moved.push_back(true);
+                    reshaped.push_back(true);
+                }
+                assignments.emplace_back(face.id, best);
+            }
+            
+            // Apply the batch's deltas as running means
+            for (const auto& [c, sum] : sums) {
+                float* centroid = centroids.data() + c * dims;
+                const float n = static_cast<float>(counts[c]);
+                const float m = static_cast<float>(added[c]);
+                for (size_t k = 0; k < dims; ++k) {
+                    centroid[k] = (centroid[k] * n + sum[k]) / (n + m);
+                }
+                counts[c] += added[c];
+                moved[c] = true;
+            }
+            for (const auto& [c, i] : joins) {
+                if (!prototypes[c].empty() && PrototypeSet::add(prototypes[c], rows.data() + i * dims, dims, k)) {
+                    reshaped[c] = true;
+                }
+            }
+            
+            if (progress) {
+                progress(static_cast<int>(begin + count), total);
+            }
+            if (config.commit_faces > 0 && assignments.size() >= config.commit_faces) {
+                flush();
+            }
+            if (!checkpoint()) {
+                break;
+            }
+        }
+        flush();
+        
+        std::cout << "[Clusterer] Assigned " << assigned << " faces in batches of " << batch_size
+                  << " (" << ids.size() - existing << " new clusters)" << std::endl;
+    }
+    
+    // Drop faces embedded by another encoder (they wait for re-embedding)
+    std::vector<Face> current_faces(std::vector<Face> faces) {
+        const size_t before = faces.size();
+        faces.erase(std::remove_if(faces.begin(), faces.end(),
+                                   [this](const Face& f) { return !is_current(f); }),
+                    faces.end());
+        if (faces.size() < before) {
+            std::cout << "[Clusterer] Skipping " << before - faces.size()
+                      << " faces embedded by another model (waiting for re-embedding)" << std::endl;
+        }
+        return faces;
     }
     
-    // Find the cluster whose centroid is nearest to given embedding
+    // Find the cluster nearest to given embedding, by its nearest prototype
+    // (or its centroid, for clusters without prototypes)
     std::optional<int64_t> find_nearest_cluster(
         const FaceEmbedding& embedding,
         const std::vector<Cluster>& clusters)
@@ -84,7 +1297,7 @@ public:
         for (const auto& cluster : clusters) {
             if (cluster.centroid.empty()) continue;
             
-            float dist = FaceService::embedding_distance(embedding, cluster.centroid);
+            float dist = PrototypeSet::distance(anchors(cluster), embedding.data(), embedding.size());
             if (dist < best_dist) {
                 best_dist = dist;
                 best_id = cluster.id;
@@ -98,6 +1311,60 @@ public:
         
         return std::nullopt;
     }
+    
+    // find_nearest_cluster on int8 codes (codes[i] are the prototypes of
+    // clusters[i], see quantize_anchors()).
+    // Each quantized distance is within rerank_margin of the float32 one for
+    // typical embeddings, so the decision can only differ from float32 when a
+    // candidate lies that close to the threshold or two candidates lie within
+    // twice that of each other; those cases are settled in float32.
+    std::optional<int64_t> find_nearest_cluster_quantized(
+        Face& face,
+        const std::vector<Cluster>& clusters,
+        const std::vector<std::vector<QuantizedEmbedding>>& codes)
+    {
+        const float threshold = config.distance_threshold;
+        const float margin = config.rerank_margin;
+        
+        std::vector<std::pair<float, size_t>> candidates;
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            float dist = std::numeric_limits<float>::infinity();
+            for (const auto& code : codes[i]) {
+                dist = std::min(dist, EmbeddingQuantizer::distance(face.embedding_q, code));
+            }
+            if (dist <= threshold + margin) {
+                candidates.emplace_back(dist, i);
+            }
+        }
+        
+        std::optional<int64_t> result;
+        if (!candidates.empty()) {
+            std::sort(candidates.begin(), candidates.end());
+            const float best = candidates.front().first;
+            const bool clear_winner = best < threshold - margin &&
+                (candidates.size() == 1 || candidates[1].first > best + 2.0f * margin);
+            
+            if (clear_winner) {
+                result = clusters[candidates.front().second].id;
+            } else {
+                std::vector<Cluster> borderline;
+                for (const auto& candidate : candidates) {
+                    borderline.push_back(clusters[candidate.second]);
+                }
+                result = find_nearest_cluster(float_embedding(face), borderline);
+                stats.faces_reranked++;
+            }
+        }
+        
+        stats.faces_assigned++;
+        if (config.measure_agreement) {
+            stats.agreement_checked++;
+            if (find_nearest_cluster(float_embedding(face), clusters) == result) {
+                stats.agreement_matched++;
+            }
+        }
+        return result;
+    }
 };
 
 Clusterer::Clusterer(
@@ -109,14 +1376,20 @@ Clusterer::Clusterer(
     m_impl->database = database;
     m_impl->face_service = face_service;
     m_impl->config = config;
+    
+    DistanceEngine::Config distance_config;
+    distance_config.threads = config.distance_threads;
+    m_impl->distances = DistanceEngine(distance_config);
 }
 
 Clusterer::~Clusterer() = default;
 
 void Clusterer::cluster_all(ProgressCallback progress)
 {
+    m_impl->cancelled = false;
+    
     // Get all faces with embeddings that aren't already clustered
-    std::vector<Face> faces = m_impl->database->get_all_faces_with_embeddings();
+    std::vector<Face> faces = m_impl->load_faces_with_embeddings();
     
     if (faces.empty()) {
         std::cout << "[Clusterer] No faces to cluster" << std::endl;
@@ -125,117 +1398,152 @@ void Clusterer::cluster_all(ProgressCallback progress)
     
     std::cout << "[Clusterer] Clustering " << faces.size() << " faces..." << std::endl;
     
-    // Structure to track cluster building
-    struct WorkingCluster {
-        std::vector<int64_t> face_ids;
-        FaceEmbedding centroid;
-    };
+    if (m_impl->config.shard_faces > 0 && faces.size() > 2 * m_impl->config.shard_faces) {
+        // Saves shard by shard
+        const size_t created = m_impl->cluster_sharded(faces, progress);
+        std::cout << "[Clusterer] Created " << created << " clusters" << std::endl;
+    } else {
+        std::vector<Impl::WorkingCluster> clusters;
+        if (m_impl->config.algorithm == Algorithm::Agglomerative) {
+            clusters = m_impl->agglomerate(faces, progress, m_impl->distances);
+        } else {
+            clusters = m_impl->cluster_on_graph(faces, progress, true, m_impl->config.distance_threads);
+        }
+        
+        if (m_impl->checkpoint()) {
+            std::cout << "[Clusterer] Created " << clusters.size() << " clusters" << std::endl;
+            m_impl->save_clusters(m_impl->embedding_index(faces), clusters);
+        }
+    }
     
-    // Start with each face in its own cluster
-    std::vector<WorkingCluster> clusters;
-    clusters.reserve(faces.size());
+    m_impl->report_cancelled();
+    m_impl->publish_changes();
+}
+
+void Clusterer::seed_clusters(ProgressCallback progress)
+{
+    m_impl->cancelled = false;
     
-    for (const auto& face : faces) {
-        WorkingCluster wc;
-        wc.face_ids.push_back(face.id);
-        wc.centroid = face.embedding;
-        clusters.push_back(std::move(wc));
+    std::vector<Face> faces = m_impl->load_faces_with_embeddings();
+    
+    if (faces.empty()) {
+        std::cout << "[Clusterer] No faces to cluster" << std::endl;
+        return;
     }
     
-    const int total_faces = static_cast<int>(faces.size());
-    int merges_done = 0;
+    std::cout << "[Clusterer] Seeding clusters from " << faces.size() << " faces..." << std::endl;
     
-    // Agglomerative clustering: iteratively merge closest clusters
-    while (clusters.size() > 1) {
-        float min_dist = std::numeric_limits<float>::max();
-        size_t merge_i = 0, merge_j = 0;
-        
-        // Find closest pair of clusters
-        for (size_t i = 0; i < clusters.size(); ++i) {
-            for (size_t j = i + 1; j < clusters.size(); ++j) {
-                float dist = FaceService::embedding_distance(
-                    clusters[i].centroid, 
-                    clusters[j].centroid
-                );
-                if (dist < min_dist) {
-                    min_dist = dist;
-                    merge_i = i;
-                    merge_j = j;
-                }
-            }
-        }
-        
-        // Stop if no clusters are close enough
-        if (min_dist > m_impl->config.distance_threshold) {
-            break;
-        }
-        
-        // Merge cluster j into cluster i
-        clusters[merge_i].face_ids.insert(
-            clusters[merge_i].face_ids.end(),
-            clusters[merge_j].face_ids.begin(),
-            clusters[merge_j].face_ids.end()
-        );
-        
-        // Recompute centroid for merged cluster
-        std::vector<FaceEmbedding> embeddings;
-        for (int64_t fid : clusters[merge_i].face_ids) {
-            // Find the face embedding from our list
-            for (const auto& face : faces) {
-                if (face.id == fid) {
-                    embeddings.push_back(face.embedding);
-                    break;
-                }
-            }
-        }
-        clusters[merge_i].centroid = m_impl->compute_centroid(embeddings);
-        
-        // Remove cluster j
-        clusters.erase(clusters.begin() + static_cast<long>(merge_j));
-        
-        merges_done++;
-        if (progress) {
-            progress(merges_done, total_faces);
-        }
+    auto clusters = m_impl->group_by_label(faces, m_impl->threshold_components(faces));
+    if (progress) {
+        progress(static_cast<int>(faces.size()), static_cast<int>(faces.size()));
     }
     
-    std::cout << "[Clusterer] Created " << clusters.size() << " clusters" << std::endl;
+    std::cout << "[Clusterer] Seeded " << clusters.size() << " clusters" << std::endl;
+    
+    m_impl->save_clusters(m_impl->embedding_index(faces), clusters);
+    m_impl->report_cancelled();
+    m_impl->publish_changes();
+}
+
+void Clusterer::refine_clusters(ProgressCallback progress)
+{
+    m_impl->cancelled = false;
+    
+    std::vector<Cluster> clusters = m_impl->current_clusters(m_impl->database->get_all_clusters());
+    const int total = static_cast<int>(clusters.size());
+    int processed = 0;
+    int refined = 0;
+    int created = 0;
+    size_t uncommitted = 0;
     
-    // Save clusters to database
     m_impl->database->begin_transaction();
+    m_impl->writing = true;
     
     try {
-        for (const auto& wc : clusters) {
-            if (static_cast<int>(wc.face_ids.size()) < m_impl->config.min_cluster_size) {
+        for (const auto& cluster : clusters) {
+            if (m_impl->config.commit_faces > 0 && uncommitted >= m_impl->config.commit_faces) {
+                uncommitted = 0;
+                if (!m_impl->commit_and_checkpoint()) {
+                    break;
+                }
+            }
+            if (!m_impl->checkpoint()) {
+                break;
+            }
+            processed++;
+            if (progress) {
+                progress(processed, total);
+            }
+            
+            // Clusters the user has named are left as they are
+            if (cluster.is_identified()) {
                 continue;
             }
             
-            // Create cluster record
-            Cluster cluster;
-            cluster.centroid = wc.centroid;
-            cluster.face_count = static_cast<int>(wc.face_ids.size());
-            cluster.created_date = get_current_timestamp();
+            std::vector<Face> faces = m_impl->database->get_faces_for_cluster(cluster.id);
+            faces.erase(std::remove_if(faces.begin(), faces.end(),
+                                       [this](const Face& f) { return !m_impl->is_current(f) || !f.has_embedding(); }),
+                        faces.end());
+            if (faces.size() < 2) {
+                continue;
+            }
+            
+            auto parts = m_impl->config.algorithm == Algorithm::Agglomerative
+                ? m_impl->agglomerate(faces, nullptr, m_impl->distances)
+                : m_impl->cluster_on_graph(faces, nullptr, false, m_impl->config.distance_threads);
+            if (parts.size() < 2) {
+                continue;
+            }
             
-            int64_t cluster_id = m_impl->database->insert_cluster(cluster);
+            // The largest part keeps the cluster; the rest become new clusters
+            std::sort(parts.begin(), parts.end(), [](const auto& a, const auto& b) {
+                return a.face_ids.size() > b.face_ids.size();
+            });
+            const auto index = m_impl->embedding_index(faces);
+            m_impl->database->update_cluster_centroid(cluster.id, parts.front().centroid, m_impl->model());
+            m_impl->database->update_cluster_prototypes(cluster.id,
+                                                        m_impl->select_prototypes(parts.front().face_ids, index));
             
-            // Assign faces to this cluster
-            for (int64_t face_id : wc.face_ids) {
-                m_impl->database->update_face_cluster(face_id, cluster_id);
+            for (size_t p = 1; p < parts.size(); ++p) {
+                Cluster part;
+                part.centroid = parts[p].centroid;
+                part.prototypes = m_impl->select_prototypes(parts[p].face_ids, index);
+                part.embedding_model = m_impl->model();
+                part.face_count = static_cast<int>(parts[p].face_ids.size());
+                part.created_date = get_current_timestamp();
+                
+                int64_t part_id = m_impl->database->insert_cluster(part);
+                m_impl->database->move_faces_to_cluster(parts[p].face_ids, part_id);
+                created++;
             }
+            uncommitted += faces.size();
+            refined++;
         }
         
         m_impl->database->commit();
-        
+        m_impl->writing = false;
+    
     } catch (...) {
+        m_impl->writing = false;
         m_impl->database->rollback();
         throw;
     }
+    
+    std::cout << "[Clusterer] Refined " << refined << " clusters (" << created
+              << " split off)" << std::endl;
+    m_impl->report_cancelled();
+    m_impl->publish_changes();
 }
 
 void Clusterer::cluster_new_faces(ProgressCallback progress)
 {
+    m_impl->cancelled = false;
+    
     // Get faces without a cluster assignment
-    std::vector<Face> unclustered = m_impl->database->get_unclustered_faces();
+    const bool quantized = m_impl->config.quantized;
+    std::vector<Face> unclustered = m_impl->current_faces(quantized
+        ? m_impl->database->get_quantized_faces(true)
+        : m_impl->database->get_unclustered_faces());
     
     if (unclustered.empty()) {
         std::cout << "[Clusterer] No unclustered faces" << std::endl;
@@ -244,85 +1552,92 @@ void Clusterer::cluster_new_faces(ProgressCallback progress)
     
     std::cout << "[Clusterer] Clustering " << unclustered.size() << " new faces..." << std::endl;
     
-    // Get existing clusters
-    std::vector<Cluster> existing_clusters = m_impl->database->get_all_clusters();
-    
-    m_impl->database->begin_transaction();
+    if (m_impl->config.batch_size > 0) {
+        m_impl->assign_in_batches(unclustered, progress);
+    } else {
+        m_impl->assign_one_by_one(unclustered, progress);
+    }
     
-    try {
-        int processed = 0;
-        int total = static_cast<int>(unclustered.size());
-        
-        for (const auto& face : unclustered) {
-            if (!face.has_embedding()) continue;
-            
-            // Try to find a matching existing cluster
-            auto nearest = m_impl->find_nearest_cluster(face.embedding, existing_clusters);
-            
-            if (nearest.has_value()) {
-                // Add to existing cluster
-                m_impl->database->update_face_cluster(face.id, nearest.value());
-                m_impl->update_cluster_centroid(nearest.value());
-            } else {
-                // Create a new cluster for this face
-                Cluster cluster;
-                cluster.centroid = face.embedding;
-                cluster.face_count = 1;
-                cluster.created_date = get_current_timestamp();
-                
-                int64_t cluster_id = m_impl->database->insert_cluster(cluster);
-                m_impl->database->update_face_cluster(face.id, cluster_id);
-                
-                // Add to our working list so subsequent faces can join
-                cluster.id = cluster_id;
-                existing_clusters.push_back(cluster);
-            }
-            
-            processed++;
-            if (progress) {
-                progress(processed, total);
-            }
+    if (quantized) {
+        const Stats& stats = m_impl->stats;
+        std::cout << "[Clusterer] Quantized assignment: " << stats.faces_assigned << " faces, "
+                  << static_cast<int>(stats.rerank_rate() * 100.0 + 0.5) << "% re-ranked in float32";
+        if (stats.agreement_checked > 0) {
+            std::ostringstream rate;
+            rate << std::fixed << std::setprecision(2) << stats.agreement_rate() * 100.0;
+            std::cout << ", agreement with float32 " << rate.str() << "% of " << stats.agreement_checked;
         }
-        
-        m_impl->database->commit();
-        
-    } catch (...) {
-        m_impl->database->rollback();
-        throw;
+        std::cout << std::endl;
     }
+    
+    m_impl->report_cancelled();
+    m_impl->publish_changes();
 }
 
 int64_t Clusterer::merge(int64_t cluster_a_id, int64_t cluster_b_id)
 {
-    if (cluster_a_id == cluster_b_id) {
-        return cluster_a_id;  // Same cluster, nothing to do
+    // Ids of clusters merged earlier read as the cluster they joined
+    auto a = m_impl->database->get_cluster(cluster_a_id);
+    auto b = m_impl->database->get_cluster(cluster_b_id);
+    if (!a.has_value() || !b.has_value()) {
+        throw std::invalid_argument("Unknown cluster");
+    }
+    if (a->id == b->id) {
+        return a->id;  // Same cluster, nothing to do
     }
     
+    const size_t dims = 128;
+    const std::string& model = m_impl->model();
+    const bool combinable = a->embedding_model == model && b->embedding_model == model &&
+                            a->centroid.size() == dims && b->centroid.size() == dims;
+    
     m_impl->database->begin_transaction();
     
     try {
-        // Get faces from cluster B
-        std::vector<Face> faces_b = m_impl->database->get_faces_for_cluster(cluster_b_id);
-        
-        // Move all faces from B to A
-        for (const auto& face : faces_b) {
-            m_impl->database->update_face_cluster(face.id, cluster_a_id);
-        }
+        const int count_a = combinable ? m_impl->database->count_cluster_faces(a->id, model) : 0;
+        const int count_b = combinable ? m_impl->database->count_cluster_faces(b->id, model) : 0;
         
-        // Update centroid of cluster A
-        m_impl->update_cluster_centroid(cluster_a_id);
+        // B's faces keep their rows and read as A's (compact_merges() rewrites them later)
+        m_impl->database->merge_clusters(a->id, b->id);
         
-        // Delete cluster B
-        m_impl->database->delete_cluster(cluster_b_id);
+        if (combinable && count_a + count_b > 0) {
+            // Size-weighted mean of the two centroids; prototypes re-picked from both sets
+            std::vector<float> centroid(dims);
+            for (size_t k = 0; k < dims; ++k) {
+                centroid[k] = (a->centroid[k] * count_a + b->centroid[k] * count_b) /
+                              static_cast<float>(count_a + count_b);
+            }
+            std::vector<float> pool = m_impl->anchors(*a);
+            const std::vector<float>& from_b = m_impl->anchors(*b);
+            pool.insert(pool.end(), from_b.begin(), from_b.end());
+            const size_t k = static_cast<size_t>(std::max(0, m_impl->config.prototypes));
+            
+            m_impl->database->update_cluster_centroid(a->id, centroid, model);
+            m_impl->database->update_cluster_prototypes(a->id,
+                                                        PrototypeSet::select(pool.data(), pool.size() / dims, dims, k));
+        } else {
+            // Clusters from another encoder: recompute from the faces
+            m_impl->rebuild_cluster(a->id);
+        }
         
         m_impl->database->commit();
-        
+    
     } catch (...) {
         m_impl->database->rollback();
         throw;
     }
     
-    return cluster_a_id;
+    m_impl->publish_changes();
+    return a->id;
+}
+
+int Clusterer::compact_merges(int batch_size)
+{
+    const int total = m_impl->compact_aliases(batch_size);
+    if (total > 0) {
+        std::cout << "[Clusterer] Compacted " << total << " faces of merged clusters" << std::endl;
+    }
+    return total;
 }
 
 int64_t Clusterer::split(int64_t source_cluster_id, const std::vector<int64_t>& face_ids)
@@ -331,48 +1646,51 @@ int64_t Clusterer::split(int64_t source_cluster_id, const std::vector<int64_t>&
         throw std::invalid_argument("No faces to split");
     }
     
+    // An id merged into another cluster names that cluster
+    auto source = m_impl->database->get_cluster(source_cluster_id);
+    const int64_t source_id = source.has_value() ? source->id : source_cluster_id;
+    
+    int64_t new_cluster_id = 0;
     m_impl->database->begin_transaction();
     
     try {
         // Get embeddings for the faces being moved
-        std::vector<FaceEmbedding> embeddings;
-        for (int64_t fid : face_ids) {
-            auto face = m_impl->database->get_face(fid);
-            if (face.has_value() && face->has_embedding()) {
-                embeddings.push_back(face->embedding);
-            }
+        std::vector<FaceEmbedding> embeddings = m_impl->current_embeddings(face_ids);
+        std::vector<const FaceEmbedding*> members;
+        for (const auto& embedding : embeddings) {
+            members.push_back(&embedding);
         }
         
         // Create new cluster
         Cluster new_cluster;
         new_cluster.centroid = m_impl->compute_centroid(embeddings);
+        new_cluster.prototypes = m_impl->select_prototypes(members);
+        new_cluster.embedding_model = m_impl->model();
         new_cluster.face_count = static_cast<int>(face_ids.size());
         new_cluster.created_date = get_current_timestamp();
         
-        int64_t new_cluster_id = m_impl->database->insert_cluster(new_cluster);
+        new_cluster_id = m_impl->database->insert_cluster(new_cluster);
         
         // Move faces to new cluster
-        for (int64_t face_id : face_ids) {
-            m_impl->database->update_face_cluster(face_id, new_cluster_id);
-        }
+        m_impl->database->move_faces_to_cluster(face_ids, new_cluster_id);
         
-        // Update source cluster centroid
-        m_impl->update_cluster_centroid(source_cluster_id);
-        
-        // Check if source cluster is now empty
-        std::vector<Face> remaining = m_impl->database->get_faces_for_cluster(source_cluster_id);
+        // Update source cluster centroid and prototypes, or drop it if now empty
+        std::vector<int64_t> remaining = m_impl->database->get_cluster_face_ids(source_id);
         if (remaining.empty()) {
-            m_impl->database->delete_cluster(source_cluster_id);
+            m_impl->database->delete_cluster(source_id);
+        } else {
+            m_impl->rebuild_cluster(source_id, remaining);
         }
         
         m_impl->database->commit();
-        
-        return new_cluster_id;
-        
+    
     } catch (...) {
         m_impl->database->rollback();
         throw;
     }
+    
+    m_impl->publish_changes();
+    return new_cluster_id;
 }
 
 void Clusterer::assign_person(int64_t cluster_id, int64_t person_id)
@@ -380,20 +1698,17 @@ void Clusterer::assign_person(int64_t cluster_id, int64_t person_id)
     m_impl->database->begin_transaction();
     
     try {
-        // Get all faces in this cluster
-        std::vector<Face> faces = m_impl->database->get_faces_for_cluster(cluster_id);
-        
-        // Update each face with the person ID
-        for (const auto& face : faces) {
-            m_impl->database->update_face_person(face.id, person_id);
-        }
+        m_impl->database->update_cluster_faces_person(cluster_id, person_id);
+        m_impl->database->update_cluster_person(cluster_id, person_id);
         
         m_impl->database->commit();
-        
+    
     } catch (...) {
         m_impl->database->rollback();
         throw;
     }
+    
+    m_impl->publish_changes();
 }
 
 void Clusterer::unassign_person(int64_t cluster_id)
@@ -401,20 +1716,17 @@ void Clusterer::unassign_person(int64_t cluster_id)
     m_impl->database->begin_transaction();
     
     try {
-        std::vector<Face> faces = m_impl->database->get_faces_for_cluster(cluster_id);
-        
-        for (const auto& face : faces) {
-            // Set person_id to null by using a special "unset" operation
-            // We need to modify Database to support this, for now just note it
-            // This would require an update_face_person that accepts optional
-        }
+        m_impl->database->update_cluster_faces_person(cluster_id, std::nullopt);
+        m_impl->database->update_cluster_person(cluster_id, std::nullopt);
         
         m_impl->database->commit();
-        
+    
     } catch (...) {
         m_impl->database->rollback();
         throw;
     }
+    
+    m_impl->publish_changes();
 }
 
 std::optional<Face> Clusterer::get_representative_face(int64_t cluster_id)
@@ -434,7 +1746,7 @@ std::optional<Face> Clusterer::get_representative_face(int64_t cluster_id)
     const Face* best = nullptr;
     
     for (const auto& face : faces) {
-        if (!face.has_embedding()) continue;
+        if (!face.has_embedding() || face.embedding_model != cluster->embedding_model) continue;
         
         float dist = FaceService::embedding_distance(face.embedding, cluster->centroid);
         if (dist < min_dist) {
@@ -455,21 +1767,24 @@ std::vector<std::pair<int64_t, int64_t>> Clusterer::get_merge_suggestions(float
     
     std::vector<Cluster> clusters = m_impl->database->get_all_clusters();
     
-    // Find pairs of clusters that are close but not quite at clustering threshold
-    for (size_t i = 0; i < clusters.size(); ++i) {
-        for (size_t j = i + 1; j < clusters.size(); ++j) {
-            if (clusters[i].centroid.empty() || clusters[j].centroid.empty()) {
-                continue;
-            }
-            
-            float dist = FaceService::embedding_distance(
-                clusters[i].centroid, 
-                clusters[j].centroid
-            );
-            
-            // Suggest if distance is between clustering threshold and suggestion threshold
-            if (dist > m_impl->config.distance_threshold && dist <= threshold) {
-                suggestions.emplace_back(clusters[i].id, clusters[j].id);
+    // Centroids are only comparable within one embedding model
+    std::map<std::string, std::vector<const Cluster*>> by_model;
+    for (const auto& cluster : clusters) {
+        if (cluster.centroid.size() == 128) {
+            by_model[cluster.embedding_model].push_back(&cluster);
+        }
+    }
+    
+    for (const auto& [model, group] : by_model) {
+        std::vector<float> centroids(group.size() * 128);
+        for (size_t i = 0; i < group.size(); ++i) {
+            std::copy(group[i]->centroid.begin(), group[i]->centroid.end(), centroids.begin() + i * 128);
+        }
+        
+        // Find pairs of clusters that are close but not quite at clustering threshold
+        for (const auto& pair : m_impl->distances.pairs_within(centroids.data(), group.size(), 128, threshold)) {
+            if (pair.distance > m_impl->config.distance_threshold) {
+                suggestions.emplace_back(group[pair.a]->id, group[pair.b]->id);
             }
         }
     }
@@ -477,6 +1792,26 @@ std::vector<std::pair<int64_t, int64_t>> Clusterer::get_merge_suggestions(float
     return suggestions;
 }
 
+std::vector<std::pair<int64_t, float>> Clusterer::get_similar_faces(int64_t face_id, int limit)
+{
+    std::vector<std::pair<int64_t, float>> similar;
+    const KnnGraph* graph = m_impl->knn_graph();
+    if (!graph) {
+        return similar;
+    }
+    
+    auto node = graph->node_of(face_id);
+    if (!node.has_value()) {
+        return similar;
+    }
+    
+    const size_t count = std::min(graph->degree(*node), static_cast<size_t>(std::max(0, limit)));
+    for (size_t e = 0; e < count; ++e) {
+        similar.emplace_back(graph->face_id(graph->neighbors(*node)[e]), graph->distances(*node)[e]);
+    }
+    return similar;
+}
+
 std::vector<ClusterStats> Clusterer::get_cluster_stats()
 {
     std::vector<ClusterStats> stats;
@@ -527,4 +1862,45 @@ float Clusterer::get_threshold() const
     return m_impl->config.distance_threshold;
 }
 
+Clusterer::Stats Clusterer::get_stats() const
+{
+    return m_impl->stats;
+}
+
+void Clusterer::reset_stats()
+{
+    m_impl->stats = Stats{};
+}
+
+void Clusterer::set_embedding_snapshot(std::shared_ptr<EmbeddingSnapshot> snapshot)
+{
+    m_impl->snapshot = snapshot;
+}
+
+void Clusterer::set_knn_graph(std::shared_ptr<KnnGraph> graph)
+{
+    m_impl->graph = graph;
+}
+
+void Clusterer::set_change_callback(ChangeCallback callback)
+{
+    m_impl->on_changes = std::move(callback);
+    m_impl->change_cursor = m_impl->database->get_cluster_change_sequence();
+}
+
+void Clusterer::set_checkpoint_callback(CheckpointCallback callback)
+{
+    m_impl->on_checkpoint = std::move(callback);
+}
+
+void Clusterer::cancel()
+{
+    m_impl->cancelled = true;
+}
+
+bool Clusterer::is_cancelled() const
+{
+    return m_impl->cancelled;
+}
+
 } // namespace facefling
@@ -12,20 +12,73 @@ namespace facefling {
 // Forward declarations
 class IDatabase;
 class FaceService;
+class EmbeddingSnapshot;
+class KnnGraph;
 
 /**
  * Groups similar faces into clusters.
+ * Only embeddings from the FaceService's encoder (Face::embedding_model) are
+ * clustered; faces and clusters from other encoders wait for re-embedding.
  * See docs/specs/003-face-clusterer.md for specification.
  */
 class Clusterer {
 public:
+    /**
+     * cluster_all() method. The graph methods run on the kNN graph
+     * (set_knn_graph(), or one built for the run) at distance_threshold.
+     */
+    enum class Algorithm {
+        Agglomerative,                    // Centroid linkage
+        ChineseWhispers,                  // Label voting on the graph
+        ConnectedComponents               // Any chain of close faces joins
+    };
+    
     struct Config {
         float distance_threshold = 0.6f;  // Faces within this distance = same cluster
         int min_cluster_size = 1;         // Minimum faces per cluster
+        int distance_threads = 0;         // Pairwise distance workers (0 = hardware concurrency)
+        Algorithm algorithm = Algorithm::Agglomerative;
+        int whispers_iterations = 20;     // Chinese Whispers passes
+        size_t exact_join_max_faces = 20000; // seed_clusters(): larger sets join through the kNN graph
+        size_t shard_faces = 50000;       // cluster_all(): above twice this, cluster k-means shards separately (0 = never)
+        
+        // Incremental assignment (cluster_new_faces) on int8 codes, see EmbeddingQuantizer
+        bool quantized = true;
+        float rerank_margin = 0.02f;      // Quantized distances this close to a decision are re-checked in float32
+        bool measure_agreement = false;   // Also compute the float32 decision for every face (costly, one at a time only)
+        int batch_size = 256;             // Faces matched per distance pass (0 = one at a time)
+        int prototypes = 4;               // Member faces per cluster matched against (0 = centroid only)
+        int64_t changelog_keep = 100000;  // Change feed entries kept in the database (0 = keep all)
+        size_t commit_faces = 10000;      // Long runs commit and publish changes after this many faces (0 = at the end)
+    };
+    
+    /**
+     * Counters for quantized assignment, accumulated since the last reset.
+     */
+    struct Stats {
+        int64_t faces_assigned = 0;       // Faces matched against existing clusters
+        int64_t faces_reranked = 0;       // Decisions settled in float32
+        int64_t agreement_checked = 0;    // Faces with both decisions (measure_agreement)
+        int64_t agreement_matched = 0;    // ...where quantized picked the same cluster as float32
+        
+        double rerank_rate() const {
+            return faces_assigned > 0 ? static_cast<double>(faces_reranked) / faces_assigned : 0.0;
+        }
+        double agreement_rate() const {
+            return agreement_checked > 0 ? static_cast<double>(agreement_matched) / agreement_checked : 1.0;
+        }
     };
     
     using ProgressCallback = std::function<void(int processed, int total)>;
     
+    // Receives cluster changes in sequence order, in pages
+    using ChangeCallback = std::function<void(const std::vector<ClusterChange>& changes)>;
+    
+    // Called at safe points of long runs, possibly from several clustering
+    // threads at once, and never with a write transaction open; may block
+    // to yield the CPU
+    using CheckpointCallback = std::function<void()>;
+    
     Clusterer(
         std::shared_ptr<IDatabase> database,
         std::shared_ptr<FaceService> face_service,
@@ -35,20 +88,45 @@ public:
     
     /**
      * Run clustering on all unclustered faces.
+     * Large runs are committed as they go (shard by shard, or every
+     * Config::commit_faces faces), and each commit publishes its changes.
      */
     void cluster_all(ProgressCallback progress = nullptr);
     
+    /**
+     * Fast first pass for a fresh library: connected components at
+     * distance_threshold (any chain of close faces joins), found by a
+     * parallel threshold join into a lock-free union-find.
+     * Refine the result with refine_clusters().
+     */
+    void seed_clusters(ProgressCallback progress = nullptr);
+    
+    /**
+     * Re-cluster the faces of each unidentified cluster with the configured
+     * algorithm, splitting off the parts it separates.
+     */
+    void refine_clusters(ProgressCallback progress = nullptr);
+    
     /**
      * Cluster only new (unclustered) faces.
      */
     void cluster_new_faces(ProgressCallback progress = nullptr);
     
     /**
-     * Merge two clusters into one.
+     * Merge two clusters into one. Constant work in the size of the
+     * clusters: B becomes an alias of A and the centroids are combined by
+     * face count; B's face rows are rewritten later by compact_merges().
      * @return ID of the merged cluster
      */
     int64_t merge(int64_t cluster_a_id, int64_t cluster_b_id);
     
+    /**
+     * Point faces of merged clusters at the cluster they were merged into,
+     * in transactions of batch_size faces. Meant for a background thread.
+     * @return number of faces rewritten
+     */
+    int compact_merges(int batch_size = 5000);
+    
     /**
      * Split faces from a cluster into a new cluster.
      * @return ID of the new cluster
@@ -75,6 +153,12 @@ public:
      */
     std::vector<std::pair<int64_t, int64_t>> get_merge_suggestions(float threshold = 0.7f);
     
+    /**
+     * Nearest faces to a face, nearest first (requires a kNN graph).
+     * @return (face_id, distance) pairs, at most limit
+     */
+    std::vector<std::pair<int64_t, float>> get_similar_faces(int64_t face_id, int limit = 16);
+    
     /**
      * Get statistics for all clusters.
      */
@@ -83,6 +167,43 @@ public:
     // Configuration
     void set_threshold(float threshold);
     float get_threshold() const;
+    
+    Stats get_stats() const;
+    void reset_stats();
+    
+    /**
+     * Load embeddings for cluster_all() from a snapshot (synced before use)
+     * instead of reading every row from the database.
+     */
+    void set_embedding_snapshot(std::shared_ptr<EmbeddingSnapshot> snapshot);
+    
+    /**
+     * kNN graph over the snapshot's embeddings, kept in step with it and
+     * used by graph-based operations. Requires an embedding snapshot.
+     */
+    void set_knn_graph(std::shared_ptr<KnnGraph> graph);
+    
+    /**
+     * Deliver the change feed (see IDatabase::get_cluster_changes) after each
+     * clustering run or edit, on the calling thread, starting with changes
+     * made after this is set. The persisted log is trimmed to
+     * Config::changelog_keep entries at the same points.
+     */
+    void set_change_callback(ChangeCallback callback);
+    
+    /**
+     * Hook for throttling long runs (see CheckpointCallback), e.g. while
+     * the user is interacting.
+     */
+    void set_checkpoint_callback(CheckpointCallback callback);
+    
+    /**
+     * Ask the running cluster_all(), seed_clusters(), refine_clusters() or
+     * cluster_new_faces() to stop at its next checkpoint (thread-safe).
+     * Work committed by then is kept. Cleared when the next run starts.
+     */
+    void cancel();
+    bool is_cancelled() const;
 
 private:
     class Impl;
@@ -0,0 +1,262 @@
+/**
+ * ClusteringService implementation.
+ */
+
+#include "ClusteringService.h"
+#include "Clusterer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#if defined(__APPLE__)
+#include <pthread.h>
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace facefling {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Let interactive work win the CPU
+void lower_thread_priority()
+{
+#if defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+int64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+class ClusteringService::Impl {
+public:
+    std::shared_ptr<Clusterer> clusterer;
+    Config config;
+    ProgressCallback progress;
+    CompleteCallback complete;
+    
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+    bool running = false;
+    bool stop_requested = false;
+    std::optional<Job> queued;
+    bool in_job = false;
+    std::atomic<bool> job_cancelled{false};  // Re-asserted at checkpoints: a run clears the Clusterer's flag on start
+    Stats stats;
+    
+    std::atomic<int64_t> last_activity_ms{std::numeric_limits<int64_t>::min() / 2};
+    
+    // Checkpoint hook, on any clustering thread: while the user is active,
+    // work throttle_work_ms, then sleep throttle_pause_ms
+    void checkpoint() {
+        if (job_cancelled) {
+            clusterer->cancel();
+            return;
+        }
+        
+        const int64_t now = now_ms();
+        if (now - last_activity_ms.load(std::memory_order_relaxed) > config.interaction_idle_ms) {
+            return;
+        }
+        thread_local int64_t slice_start = 0;
+        if (now - slice_start < config.throttle_work_ms) {
+            return;
+        }
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.throttle_pause_ms));
+        slice_start = now_ms();
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.throttled_ms += static_cast<double>(slice_start - now);
+    }
+    
+    // Returns true unless the job ran to completion
+    bool run_job(Job job) {
+        bool failed = false;
+        try {
+            if (config.compact_merges) {
+                clusterer->compact_merges();
+            }
+            if (job_cancelled) {
+                // Cancelled before the run began
+            } else if (job == Job::All) {
+                clusterer->cluster_all(progress);
+            } else {
+                clusterer->cluster_new_faces(progress);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[ClusteringService] Job failed: " << e.what() << std::endl;
+            failed = true;
+        }
+        
+        const bool cancelled = job_cancelled || clusterer->is_cancelled();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (failed) {
+                stats.jobs_failed++;
+            } else if (cancelled) {
+                stats.jobs_cancelled++;
+            } else {
+                stats.jobs_completed++;
+            }
+        }
+        return cancelled || failed;
+    }
+    
+    void worker_loop() {
+        if (config.low_priority) {
+            lower_thread_priority();
+        }
+        
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this]() { return stop_requested || queued.has_value(); });
+                if (stop_requested) {
+                    break;
+                }
+                job = *queued;
+                queued.reset();
+                in_job = true;
+                job_cancelled = false;
+            }
+            const bool cancelled = run_job(job);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                in_job = false;
+            }
+            changed.notify_all();
+            if (complete) {
+                complete(job, cancelled);
+            }
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            in_job = false;
+            running = false;
+        }
+        changed.notify_all();
+    }
+};
+
+ClusteringService::ClusteringService(std::shared_ptr<Clusterer> clusterer, const Config& config)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->clusterer = clusterer;
+    m_impl->config = config;
+    m_impl->clusterer->set_checkpoint_callback([impl = m_impl.get()]() { impl->checkpoint(); });
+}
+
+ClusteringService::~ClusteringService()
+{
+    stop();
+    m_impl->clusterer->set_checkpoint_callback(nullptr);
+}
+
+void ClusteringService::start(ProgressCallback progress, CompleteCallback complete)
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    if (m_impl->running) {
+        return;
+    }
+    if (m_impl->worker.joinable()) {
+        m_impl->worker.join();
+    }
+    
+    m_impl->progress = progress;
+    m_impl->complete = complete;
+    m_impl->stop_requested = false;
+    m_impl->running = true;
+    m_impl->worker = std::thread([impl = m_impl.get()]() { impl->worker_loop(); });
+}
+
+void ClusteringService::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stop_requested = true;
+        m_impl->queued.reset();
+        if (m_impl->in_job) {
+            m_impl->job_cancelled = true;
+            m_impl->clusterer->cancel();
+        }
+    }
+    m_impl->changed.notify_all();
+    
+    if (m_impl->worker.joinable()) {
+        m_impl->worker.join();
+    }
+}
+
+bool ClusteringService::is_running() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->running;
+}
+
+void ClusteringService::request(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        if (!m_impl->queued.has_value() || job == Job::All) {
+            m_impl->queued = job;
+        }
+    }
+    m_impl->changed.notify_all();
+}
+
+void ClusteringService::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->queued.reset();
+    if (m_impl->in_job) {
+        m_impl->job_cancelled = true;
+        m_impl->clusterer->cancel();
+    }
+}
+
+bool ClusteringService::is_busy() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->in_job || m_impl->queued.has_value();
+}
+
+void ClusteringService::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->changed.wait(lock, [impl = m_impl.get()]() {
+        return !impl->running || (!impl->in_job && !impl->queued.has_value());
+    });
+}
+
+void ClusteringService::notify_user_activity()
+{
+    m_impl->last_activity_ms.store(now_ms(), std::memory_order_relaxed);
+}
+
+ClusteringService::Stats ClusteringService::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->stats;
+}
+
+} // namespace facefling
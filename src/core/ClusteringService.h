@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace facefling {
+
+// Forward declarations
+class Clusterer;
+
+/**
+ * Runs clustering jobs on a background thread.
+ * Long runs commit as they go (Clusterer::Config::commit_faces, and shard
+ * by shard for sharded cluster_all()), and each commit is published through
+ * the Clusterer's change callback, so the UI can show clusters while the
+ * rest is still being worked on. A job can be cancelled at the next
+ * checkpoint; what it committed is kept.
+ *
+ * While the user is interacting (notify_user_activity()) every clustering
+ * thread is throttled at its checkpoints to a fraction of the CPU, on top
+ * of running at background priority.
+ *
+ * The Clusterer is used from the worker thread while a job runs. Give it
+ * its own database connection, since jobs open transactions on it, and
+ * hold edits through the Clusterer until is_busy() is false.
+ */
+class ClusteringService {
+public:
+    enum class Job {
+        NewFaces,                    // Clusterer::cluster_new_faces()
+        All                          // Clusterer::cluster_all()
+    };
+    
+    struct Config {
+        bool low_priority = true;    // Run at background thread priority (threads it starts inherit it)
+        int interaction_idle_ms = 1500;  // Throttled until the user has been idle this long
+        int throttle_work_ms = 20;   // While throttled, each thread works this long...
+        int throttle_pause_ms = 80;  // ...then sleeps this long
+        bool compact_merges = true;  // Rewrite faces of merged clusters before each job
+    };
+    
+    struct Stats {
+        int64_t jobs_completed = 0;
+        int64_t jobs_cancelled = 0;
+        int64_t jobs_failed = 0;
+        double throttled_ms = 0.0;   // Time clustering threads spent yielding to the user
+    };
+    
+    // Called on the worker thread
+    using ProgressCallback = std::function<void(int processed, int total)>;
+    using CompleteCallback = std::function<void(Job job, bool cancelled)>;
+    
+    explicit ClusteringService(std::shared_ptr<Clusterer> clusterer, const Config& config = {});
+    ~ClusteringService();
+    
+    /**
+     * Start the worker thread (no-op if already running).
+     */
+    void start(ProgressCallback progress = nullptr, CompleteCallback complete = nullptr);
+    
+    /**
+     * Cancel the current job and stop the worker.
+     */
+    void stop();
+    bool is_running() const;
+    
+    /**
+     * Queue a job. Requests made while one is queued coalesce (All covers
+     * NewFaces); a request made during a job runs after it.
+     */
+    void request(Job job);
+    
+    /**
+     * Cancel the running job at its next checkpoint and drop the queued one.
+     */
+    void cancel();
+    
+    // A job is queued or running
+    bool is_busy() const;
+    
+    /**
+     * Block until no job is queued or running (e.g. after cancel()).
+     */
+    void wait_idle();
+    
+    /**
+     * Signal user input; clustering is throttled until the user has been
+     * idle for Config::interaction_idle_ms. Cheap, callable from any thread.
+     */
+    void notify_user_activity();
+    
+    Stats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace facefling
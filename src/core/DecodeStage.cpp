@@ -0,0 +1,189 @@
+/**
+ * DecodeStage implementation.
+ */
+
+#include "DecodeStage.h"
+#include "../services/ImageLoader.h"
+#include "../services/ImageBufferPool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace facefling {
+
+class DecodeStage::Impl {
+public:
+    std::shared_ptr<ImageLoader> image_loader;
+    std::shared_ptr<ImageBufferPool> buffer_pool;
+    std::vector<std::string> paths;
+    Config config;
+    
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    size_t next_to_claim = 0;
+    size_t next_to_deliver = 0;
+    std::map<size_t, Result> ready;
+    size_t bytes_in_flight = 0;
+    bool stopped = false;
+    Stats stats;
+    
+    std::vector<std::thread> workers;
+    
+    // Bytes to reserve before decoding. While decoding, Qt's own frame and
+    // our RGB copy coexist, so twice the final size is held until it settles.
+    size_t estimate_bytes(const std::string& path) const {
+        auto size = image_loader->image_size(path);
+        if (!size.has_value()) {
+            return 0;
+        }
+        return static_cast<size_t>(size->first) * size->second * 3 * 2;
+    }
+    
+    void worker_loop() {
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this]() {
+                    return stopped || next_to_claim >= paths.size() ||
+                           next_to_claim < next_to_deliver + static_cast<size_t>(std::max(1, config.max_ahead));
+                });
+                if (stopped || next_to_claim >= paths.size()) {
+                    return;
+                }
+                index = next_to_claim++;
+            }
+            
+            const std::string& path = paths[index];
+            const size_t reserved = estimate_bytes(path);
+            
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                
+                // The frame the consumer is waiting for is always admitted, so the
+                // budget can be exceeded by at most one frame but never deadlocks
+                auto admitted = [this, index, reserved]() {
+                    return stopped || index == next_to_deliver ||
+                           bytes_in_flight + reserved <= config.memory_budget_bytes;
+                };
+                if (!admitted()) {
+                    const auto wait_start = std::chrono::steady_clock::now();
+                    changed.wait(lock, admitted);
+                    stats.blocked_ms += std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - wait_start).count();
+                }
+                if (stopped) {
+                    return;
+                }
+                bytes_in_flight += reserved;
+                stats.peak_bytes_in_flight = std::max(stats.peak_bytes_in_flight, bytes_in_flight);
+            }
+            
+            Result result;
+            result.path = path;
+            try {
+                result.image = image_loader->load(path, *buffer_pool);
+                result.ok = true;
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bytes_in_flight = bytes_in_flight - reserved + result.image.data.size();
+                stats.peak_bytes_in_flight = std::max(stats.peak_bytes_in_flight, bytes_in_flight);
+                ready.emplace(index, std::move(result));
+            }
+            changed.notify_all();
+        }
+    }
+};
+
+DecodeStage::DecodeStage(
+    std::shared_ptr<ImageLoader> image_loader,
+    std::shared_ptr<ImageBufferPool> buffer_pool,
+    const std::vector<std::string>& paths,
+    const Config& config)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->image_loader = image_loader;
+    m_impl->buffer_pool = buffer_pool;
+    m_impl->paths = paths;
+    m_impl->config = config;
+    
+    const int threads = std::max(1, config.threads);
+    for (int i = 0; i < threads; ++i) {
+        m_impl->workers.emplace_back([impl = m_impl.get()]() { impl->worker_loop(); });
+    }
+}
+
+DecodeStage::~DecodeStage()
+{
+    stop();
+    for (auto& worker : m_impl->workers) {
+        worker.join();
+    }
+    
+    // Recycle frames that were decoded but never delivered
+    for (auto& entry : m_impl->ready) {
+        m_impl->buffer_pool->release(std::move(entry.second.image.data));
+    }
+}
+
+bool DecodeStage::next(Result& out)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    if (m_impl->next_to_deliver >= m_impl->paths.size()) {
+        return false;
+    }
+    
+    m_impl->changed.wait(lock, [this]() {
+        return m_impl->stopped || m_impl->ready.count(m_impl->next_to_deliver) > 0;
+    });
+    
+    auto it = m_impl->ready.find(m_impl->next_to_deliver);
+    if (it == m_impl->ready.end()) {
+        return false;  // Stopped
+    }
+    
+    out = std::move(it->second);
+    m_impl->ready.erase(it);
+    m_impl->next_to_deliver++;
+    lock.unlock();
+    
+    m_impl->changed.notify_all();
+    return true;
+}
+
+void DecodeStage::release(Image& image)
+{
+    const size_t bytes = image.data.size();
+    m_impl->buffer_pool->release(std::move(image.data));
+    image = Image{};
+    
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->bytes_in_flight -= std::min(bytes, m_impl->bytes_in_flight);
+    }
+    m_impl->changed.notify_all();
+}
+
+void DecodeStage::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stopped = true;
+    }
+    m_impl->changed.notify_all();
+}
+
+DecodeStage::Stats DecodeStage::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->stats;
+}
+
+} // namespace facefling
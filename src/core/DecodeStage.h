@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "../services/FaceService.h"
+
+namespace facefling {
+
+// Forward declarations
+class ImageLoader;
+class ImageBufferPool;
+
+/**
+ * Parallel image decode stage with a global decoded-pixel memory budget.
+ * Decoder threads read ahead of the consumer; a decoder blocks before
+ * decoding while the bytes of frames in flight (decoded but not yet
+ * released by the consumer) would exceed the budget.
+ * Results are delivered in input order.
+ */
+class DecodeStage {
+public:
+    struct Config {
+        int threads = 2;                          // Decoder threads
+        int max_ahead = 8;                        // Max frames decoded ahead of the consumer
+        size_t memory_budget_bytes = 1536u << 20; // Cap on decoded bytes in flight
+    };
+    
+    struct Result {
+        std::string path;
+        Image image;
+        bool ok = false;
+        std::string error;
+    };
+    
+    struct Stats {
+        size_t peak_bytes_in_flight = 0;
+        double blocked_ms = 0.0;                  // Decoder time spent waiting on the budget
+    };
+    
+    DecodeStage(
+        std::shared_ptr<ImageLoader> image_loader,
+        std::shared_ptr<ImageBufferPool> buffer_pool,
+        const std::vector<std::string>& paths,
+        const Config& config = {}
+    );
+    ~DecodeStage();
+    
+    /**
+     * Get the next decoded image (in input order).
+     * @return false when all paths have been delivered or the stage is stopped
+     */
+    bool next(Result& out);
+    
+    /**
+     * Hand a delivered image back: its bytes leave the budget and its
+     * buffer returns to the pool.
+     */
+    void release(Image& image);
+    
+    /**
+     * Stop decoding; in-progress decodes finish, queued ones are dropped.
+     */
+    void stop();
+    
+    Stats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace facefling
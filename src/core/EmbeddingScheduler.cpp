@@ -0,0 +1,431 @@
+/**
+ * EmbeddingScheduler implementation.
+ */
+
+#include "EmbeddingScheduler.h"
+#include "../services/Database.h"
+#include "../services/FaceService.h"
+#include "../services/ImageLoader.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+#if defined(__APPLE__)
+#include <pthread.h>
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace facefling {
+
+namespace {
+
+// Let interactive work and the indexer win the CPU
+void lower_thread_priority()
+{
+#if defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+// Faces of one photo that need an embedding
+struct PhotoWork {
+    int64_t photo_id = 0;
+    std::vector<Face> faces;
+};
+
+// Embeddings computed in a round, written once it is done
+struct RoundWrites {
+    std::vector<std::pair<int64_t, FaceEmbedding>> embeddings;  // (face_id, embedding)
+    int64_t reembedded = 0;                                     // Of those, faces already Ready
+};
+
+} // namespace
+
+class EmbeddingScheduler::Impl {
+public:
+    std::shared_ptr<IDatabase> database;
+    std::shared_ptr<FaceService> face_service;
+    std::shared_ptr<ImageLoader> image_loader;
+    Config config;
+    ProgressCallback progress;
+    
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+    bool running = false;
+    bool stop_requested = false;
+    bool paused = false;
+    bool woken = false;
+    std::deque<int64_t> priority_faces;
+    Stats stats;
+    
+    // Worker-thread state
+    int64_t cursor = 0;                 // Last photo id taken in order
+    std::set<int64_t> failed_photos;    // Skipped for the rest of this run
+    bool reembedding = false;           // Ordered work is currently stale faces
+    int64_t parked_cursor = 0;          // Cursor of the other (pending / stale) queue
+    
+    // Pending, or embedded by another encoder
+    bool needs_embedding(const Face& face) const {
+        if (face.embedding_state == EmbeddingState::Pending) {
+            return true;
+        }
+        return config.reembed_stale && face.embedding_state == EmbeddingState::Ready &&
+               face.embedding_model != face_service->embedding_model();
+    }
+    
+    int count_remaining() {
+        int remaining = database->count_faces_in_state(EmbeddingState::Pending);
+        if (config.reembed_stale) {
+            remaining += database->count_stale_embeddings(face_service->embedding_model());
+        }
+        return remaining;
+    }
+    
+    bool should_stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stop_requested;
+    }
+    
+    bool has_priority_work() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !priority_faces.empty();
+    }
+    
+    // Photos holding the prioritized faces, with all their faces needing embeddings
+    std::vector<PhotoWork> take_priority_work() {
+        std::deque<int64_t> face_ids;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            face_ids.swap(priority_faces);
+        }
+        
+        std::vector<PhotoWork> work;
+        std::set<int64_t> seen;
+        for (int64_t face_id : face_ids) {
+            auto face = database->get_face(face_id);
+            if (!face.has_value() || !needs_embedding(*face) ||
+                !seen.insert(face->photo_id).second || failed_photos.count(face->photo_id) > 0) {
+                continue;
+            }
+            
+            PhotoWork photo;
+            photo.photo_id = face->photo_id;
+            for (auto& other : database->get_faces_for_photo(face->photo_id)) {
+                if (needs_embedding(other)) {
+                    photo.faces.push_back(std::move(other));
+                }
+            }
+            work.push_back(std::move(photo));
+        }
+        return work;
+    }
+    
+    std::vector<Face> fetch_ordered(bool stale, int limit) {
+        if (stale) {
+            return database->get_stale_embedding_faces(face_service->embedding_model(), cursor, limit);
+        }
+        return database->get_pending_embedding_faces(cursor, limit);
+    }
+    
+    // Next faces in photo order, grouped by photo. Pending faces come first;
+    // stale ones are re-embedded once none are pending.
+    std::vector<PhotoWork> take_ordered_work() {
+        const int limit = std::max(1, config.faces_per_round);
+        std::vector<Face> faces;
+        for (bool stale : {false, true}) {
+            if (stale && !config.reembed_stale) {
+                break;
+            }
+            if (reembedding != stale) {
+                reembedding = stale;
+                std::swap(cursor, parked_cursor);
+            }
+            faces = fetch_ordered(stale, limit);
+            if (faces.empty() && cursor > 0) {
+                // Wrap around for faces stored behind the cursor since the last pass
+                cursor = 0;
+                faces = fetch_ordered(stale, limit);
+            }
+            if (!faces.empty()) {
+                break;
+            }
+        }
+        
+        std::vector<PhotoWork> work;
+        for (auto& face : faces) {
+            if (work.empty() || work.back().photo_id != face.photo_id) {
+                work.push_back(PhotoWork{face.photo_id, {}});
+            }
+            work.back().faces.push_back(std::move(face));
+        }
+        
+        // The limit may have cut the last photo short; leave it for the next
+        // round unless it is the only one
+        if (static_cast<int>(faces.size()) == limit && work.size() > 1) {
+            work.pop_back();
+        }
+        return work;
+    }
+    
+    // Decode a photo once and embed all of its faces, batched through the encoder.
+    // Nothing is written here; run_round() stores the round's results at once.
+    void process_photo(const PhotoWork& photo, RoundWrites& writes) {
+        auto record = database->get_photo(photo.photo_id);
+        if (!record.has_value()) {
+            failed_photos.insert(photo.photo_id);
+            return;
+        }
+        
+        Image image;
+        try {
+            image = image_loader->load(record->file_path);
+        } catch (const std::exception& e) {
+            std::cerr << "[EmbeddingScheduler] Failed to load " << record->file_path << ": " << e.what() << std::endl;
+            failed_photos.insert(photo.photo_id);
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.photos_failed++;
+            return;
+        }
+        
+        // Stored chip geometry skips the shape predictor
+        auto embeddings = face_service->compute_embeddings(image, photo.faces);
+        
+        size_t embedded = 0;
+        for (size_t i = 0; i < photo.faces.size(); ++i) {
+            if (embeddings[i].has_value()) {
+                writes.embeddings.emplace_back(photo.faces[i].id, std::move(embeddings[i].value()));
+                embedded++;
+                if (photo.faces[i].embedding_state == EmbeddingState::Ready) {
+                    writes.reembedded++;
+                }
+            }
+        }
+        if (embedded < photo.faces.size()) {
+            // Some bboxes fall outside the decoded image; don't keep retrying them
+            failed_photos.insert(photo.photo_id);
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.photos_decoded++;
+    }
+    
+    // Store a round's embeddings in one short transaction
+    void write_round(const RoundWrites& writes) {
+        if (writes.embeddings.empty()) {
+            return;
+        }
+        
+        const std::string& model = face_service->embedding_model();
+        database->begin_transaction();
+        try {
+            for (const auto& [face_id, embedding] : writes.embeddings) {
+                database->update_face_embedding(face_id, embedding, model);
+            }
+            database->commit();
+        } catch (...) {
+            database->rollback();
+            throw;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.faces_embedded += static_cast<int64_t>(writes.embeddings.size());
+        stats.faces_reembedded += writes.reembedded;
+    }
+    
+    // Process one round of work. Photos are decoded and embedded first and
+    // the results written afterwards, so the write lock is never held
+    // across decoding or inference.
+    // @return false if no photo was processed
+    bool run_round() {
+        bool priority = true;
+        std::vector<PhotoWork> work = take_priority_work();
+        if (work.empty()) {
+            priority = false;
+            work = take_ordered_work();
+        }
+        if (work.empty()) {
+            return false;
+        }
+        
+        bool progressed = false;
+        RoundWrites writes;
+        for (const auto& photo : work) {
+            if (should_stop() || (!priority && has_priority_work())) {
+                break;
+            }
+            if (!priority) {
+                cursor = std::max(cursor, photo.photo_id);
+            }
+            if (failed_photos.count(photo.photo_id) > 0) {
+                continue;
+            }
+            
+            process_photo(photo, writes);
+            progressed = true;
+            if (priority) {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.priority_photos++;
+            }
+        }
+        write_round(writes);
+        
+        // A single oversized photo is revisited until all its faces are done
+        if (!priority && work.size() == 1 && !failed_photos.count(work.front().photo_id)) {
+            cursor = work.front().photo_id - 1;
+        }
+        
+        if (progress && progressed) {
+            progress(get_faces_embedded(), count_remaining());
+        }
+        return progressed;
+    }
+    
+    int64_t get_faces_embedded() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats.faces_embedded;
+    }
+    
+    void worker_loop() {
+        if (config.low_priority) {
+            lower_thread_priority();
+        }
+        
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this]() { return stop_requested || !paused; });
+                if (stop_requested) {
+                    break;
+                }
+            }
+            
+            bool did_work = false;
+            try {
+                did_work = run_round();
+            } catch (const std::exception& e) {
+                std::cerr << "[EmbeddingScheduler] Round failed: " << e.what() << std::endl;
+            }
+            
+            if (!did_work) {
+                // Nothing pending (or only unreadable photos): wait for new work
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait_for(lock, std::chrono::milliseconds(config.idle_poll_ms), [this]() {
+                    return stop_requested || woken || !priority_faces.empty();
+                });
+                woken = false;
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+};
+
+EmbeddingScheduler::EmbeddingScheduler(
+    std::shared_ptr<IDatabase> database,
+    std::shared_ptr<FaceService> face_service,
+    std::shared_ptr<ImageLoader> image_loader,
+    const Config& config)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->database = database;
+    m_impl->face_service = face_service;
+    m_impl->image_loader = image_loader;
+    m_impl->config = config;
+}
+
+EmbeddingScheduler::~EmbeddingScheduler()
+{
+    stop();
+}
+
+void EmbeddingScheduler::start(ProgressCallback progress)
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    if (m_impl->running) {
+        return;
+    }
+    if (m_impl->worker.joinable()) {
+        m_impl->worker.join();
+    }
+    
+    m_impl->progress = progress;
+    m_impl->stop_requested = false;
+    m_impl->running = true;
+    m_impl->worker = std::thread([impl = m_impl.get()]() { impl->worker_loop(); });
+}
+
+void EmbeddingScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stop_requested = true;
+    }
+    m_impl->changed.notify_all();
+    
+    if (m_impl->worker.joinable()) {
+        m_impl->worker.join();
+    }
+}
+
+bool EmbeddingScheduler::is_running() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->running;
+}
+
+void EmbeddingScheduler::pause()
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->paused = true;
+}
+
+void EmbeddingScheduler::resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->paused = false;
+    }
+    m_impl->changed.notify_all();
+}
+
+void EmbeddingScheduler::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->woken = true;
+    }
+    m_impl->changed.notify_all();
+}
+
+void EmbeddingScheduler::prioritize_faces(const std::vector<int64_t>& face_ids)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->priority_faces.insert(m_impl->priority_faces.end(), face_ids.begin(), face_ids.end());
+    }
+    m_impl->changed.notify_all();
+}
+
+EmbeddingScheduler::Stats EmbeddingScheduler::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->stats;
+}
+
+} // namespace facefling
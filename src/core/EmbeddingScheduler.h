@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace facefling {
+
+// Forward declarations
+class IDatabase;
+class FaceService;
+class ImageLoader;
+
+/**
+ * Background computation of deferred face embeddings.
+ * Works through faces stored as EmbeddingState::Pending (see
+ * Indexer::Config::defer_embeddings) on a low-priority thread, decoding each
+ * photo once for all of its pending faces. Progress lives in the faces table,
+ * so a stopped or crashed run simply resumes with the faces still pending.
+ *
+ * Once nothing is pending it re-embeds faces whose embedding came from a
+ * different encoder than the FaceService's (FaceService::Config::embedding_model),
+ * realigning from the stored chip geometry, so swapping models needs no rescan.
+ *
+ * Not safe to share its FaceService or database connection with the
+ * indexing thread: give it its own instances.
+ */
+class EmbeddingScheduler {
+public:
+    struct Config {
+        int faces_per_round = 64;    // Pending faces fetched per round
+        int idle_poll_ms = 2000;     // Recheck interval when nothing is pending
+        bool low_priority = true;    // Run the worker at background thread priority
+        bool reembed_stale = true;   // Re-embed faces from other encoder versions when idle
+    };
+    
+    struct Stats {
+        int64_t faces_embedded = 0;  // Includes re-embedded faces
+        int64_t faces_reembedded = 0;
+        int64_t photos_decoded = 0;
+        int64_t photos_failed = 0;   // Could not be loaded; their faces stay pending
+        int64_t priority_photos = 0; // Photos processed ahead of order via prioritize_faces()
+    };
+    
+    // Progress callback: (faces_embedded, faces_remaining). Called on the worker thread.
+    using ProgressCallback = std::function<void(int64_t embedded, int remaining)>;
+    
+    EmbeddingScheduler(
+        std::shared_ptr<IDatabase> database,
+        std::shared_ptr<FaceService> face_service,
+        std::shared_ptr<ImageLoader> image_loader,
+        const Config& config = {}
+    );
+    ~EmbeddingScheduler();
+    
+    /**
+     * Start the worker thread (no-op if already running).
+     */
+    void start(ProgressCallback progress = nullptr);
+    
+    /**
+     * Stop after the current photo; finished work is committed.
+     */
+    void stop();
+    bool is_running() const;
+    
+    // Temporarily hold the worker (e.g. while an index run is using the CPU)
+    void pause();
+    void resume();
+    
+    /**
+     * Signal that new pending faces were stored.
+     */
+    void wake();
+    
+    /**
+     * Embed these faces (and the other faces of their photos needing one) next,
+     * e.g. the faces currently visible in the UI.
+     */
+    void prioritize_faces(const std::vector<int64_t>& face_ids);
+    
+    Stats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace facefling
@@ -1,21 +1,320 @@
 /**
- * Exporter implementation stub.
+ * Exporter implementation.
+ * The calling thread plans names while a bounded pool of workers copies.
  */
 
 #include "Exporter.h"
 #include "../services/Database.h"
+#include "../models/Photo.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
 #include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
 
 namespace facefling {
 
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr size_t kCopyBufferBytes = 1u << 20;
+constexpr size_t kKernelCopyChunk = 1u << 30;
+constexpr int kQueuedPerWorker = 4;          // Planned files waiting per copy worker
+constexpr const char* kPartialSuffix = ".part";
+constexpr std::chrono::seconds kTimeTolerance{2};  // FAT/exFAT store times to 2 s; network filesystems also round
+
+enum class Outcome { Cloned, Linked, Copied, Skipped, Failed };
+
+struct ExportTask {
+    std::string source;
+    fs::path target;
+    bool same_device = false;
+};
+
+// Names are compared as a case-insensitive filesystem would
+std::string name_key(const std::string& name) {
+    std::string key = name;
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return key;
+}
+
+// "YYYY-MM-DD" from an EXIF ("YYYY:MM:DD hh:mm:ss") or ISO date, else from the file time
+std::string photo_date(const Photo& photo, std::time_t modified) {
+    if (photo.exif_date.has_value() && photo.exif_date->size() >= 10) {
+        std::string date = photo.exif_date->substr(0, 10);
+        std::replace(date.begin(), date.end(), ':', '-');
+        const bool well_formed = date[4] == '-' && date[7] == '-' &&
+            std::all_of(date.begin(), date.end(), [](char c) { return c == '-' || std::isdigit(static_cast<unsigned char>(c)); });
+        if (well_formed && date.compare(0, 4, "0000") != 0) {
+            return date;
+        }
+    }
+    
+    std::tm local{};
+    char buffer[16];
+    if (localtime_r(&modified, &local) && std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &local) > 0) {
+        return buffer;
+    }
+    return {};
+}
+
+// A file an earlier run of this export finished: the source itself
+// (hardlinked), or a copy stamped with the source's size and time, give or
+// take what the destination filesystem can store
+bool is_exported_copy(const fs::path& target, const std::string& source, uintmax_t size) {
+    std::error_code ec;
+    if (fs::equivalent(target, source, ec)) {
+        return true;
+    }
+    if (fs::file_size(target, ec) != size || ec) {
+        return false;
+    }
+    const auto target_time = fs::last_write_time(target, ec);
+    if (ec) {
+        return false;
+    }
+    const auto source_time = fs::last_write_time(source, ec);
+    if (ec) {
+        return false;
+    }
+    const auto skew = target_time > source_time ? target_time - source_time : source_time - target_time;
+    return skew <= kTimeTolerance;
+}
+
+// Copy from the current offsets to end of file
+bool copy_buffered(int in, int out, int64_t& bytes) {
+    std::vector<char> buffer(kCopyBufferBytes);
+    while (true) {
+        const ssize_t n = ::read(in, buffer.data(), buffer.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        for (ssize_t written = 0; written < n;) {
+            const ssize_t w = ::write(out, buffer.data() + written, static_cast<size_t>(n - written));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            written += w;
+        }
+        bytes += n;
+    }
+}
+
+#if defined(__linux__)
+enum class KernelCopy { Done, Unsupported, Failed };
+
+// copy_file_range() keeps the data in the kernel (and lets filesystems that
+// can share extents or copy server-side do so)
+KernelCopy copy_in_kernel(int in, int out, int64_t& bytes) {
+    int64_t copied = 0;
+    while (true) {
+        const ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, kKernelCopyChunk, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            const bool unsupported = errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                                     errno == EOPNOTSUPP || errno == EPERM;
+            return copied == 0 && unsupported ? KernelCopy::Unsupported : KernelCopy::Failed;
+        }
+        if (n == 0) {
+            return KernelCopy::Done;
+        }
+        copied += n;
+        bytes += n;
+    }
+}
+#endif
+
+// Fill out from in by the cheapest route that works
+Outcome copy_contents(int in, int out, bool same_device, int64_t& bytes) {
+#if defined(FICLONE)
+    if (same_device && ::ioctl(out, FICLONE, in) == 0) {
+        return Outcome::Cloned;
+    }
+#else
+    (void)same_device;
+#endif
+#if defined(__linux__)
+    if (copy_in_kernel(in, out, bytes) == KernelCopy::Failed) {
+        return Outcome::Failed;
+    }
+#endif
+    // The whole file, or nothing if the kernel copy already reached the end
+    return copy_buffered(in, out, bytes) ? Outcome::Copied : Outcome::Failed;
+}
+
+// Stamp with the source's time and move into place, so that a file at its
+// final name is always complete
+bool publish(const std::string& partial, const ExportTask& task) {
+    std::error_code ec;
+    const auto time = fs::last_write_time(task.source, ec);
+    if (!ec) {
+        fs::last_write_time(partial, time, ec);
+    }
+    if (!ec) {
+        fs::rename(partial, task.target, ec);
+    }
+    if (ec) {
+        fs::remove(partial, ec);
+        return false;
+    }
+    return true;
+}
+
+Outcome transfer(const ExportTask& task, bool hardlink, int64_t& bytes) {
+    if (hardlink && task.same_device && ::link(task.source.c_str(), task.target.c_str()) == 0) {
+        return Outcome::Linked;
+    }
+    
+    const std::string partial = task.target.string() + kPartialSuffix;
+#if defined(__APPLE__)
+    ::unlink(partial.c_str());
+    if (task.same_device && ::clonefile(task.source.c_str(), partial.c_str(), 0) == 0) {
+        return publish(partial, task) ? Outcome::Cloned : Outcome::Failed;
+    }
+#endif
+    
+    const int in = ::open(task.source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return Outcome::Failed;
+    }
+    const int out = ::open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return Outcome::Failed;
+    }
+    
+    Outcome outcome = copy_contents(in, out, task.same_device, bytes);
+    ::close(in);
+    if (::close(out) != 0) {
+        outcome = Outcome::Failed;
+    }
+    if (outcome == Outcome::Failed || !publish(partial, task)) {
+        ::unlink(partial.c_str());
+        return Outcome::Failed;
+    }
+    return outcome;
+}
+
+} // namespace
+
 class Exporter::Impl {
 public:
     std::shared_ptr<IDatabase> database;
+    std::atomic<bool> cancelled{false};
+    std::mutex export_mutex;                  // One export at a time
+    
+    // Plan -> copy queue
+    std::mutex queue_mutex;
+    std::condition_variable work_available;
+    std::condition_variable space_available;
+    std::deque<ExportTask> queue;
+    bool planned_all = false;
+    
+    // Results, in the order files finish
+    std::mutex progress_mutex;                // Keeps progress calls in order; not held by get_stats()
+    mutable std::mutex stats_mutex;
+    Stats stats;
+    int finished = 0;
+    ProgressCallback progress;
     
     std::string build_filename(
-        const std::string& original_path,
+        const Photo& photo,
+        std::time_t modified,
         const std::string& person_name,
         const Options& options);
+    
+    void export_photos(
+        const std::vector<Photo>& photos,
+        const std::string& person_name,
+        const std::string& destination,
+        const Options& options,
+        ProgressCallback progress);
+    
+    void finish_file(Outcome outcome, int64_t bytes) {
+        std::lock_guard<std::mutex> progress_lock(progress_mutex);
+        int current;
+        int total;
+        ProgressCallback report;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            if (outcome == Outcome::Cloned) {
+                stats.cloned++;
+            } else if (outcome == Outcome::Linked) {
+                stats.linked++;
+            } else if (outcome == Outcome::Copied) {
+                stats.copied++;
+            } else if (outcome == Outcome::Skipped) {
+                stats.skipped++;
+            } else {
+                stats.failed++;
+            }
+            stats.bytes_copied += bytes;
+            
+            current = ++finished;
+            total = static_cast<int>(stats.files_total);
+            report = progress;
+        }
+        
+        // Outside stats_mutex, so the callback may call get_stats()
+        if (report) {
+            report(current, total);
+        }
+    }
+    
+    void worker_loop(bool hardlink) {
+        while (true) {
+            ExportTask task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                work_available.wait(lock, [this]() { return planned_all || !queue.empty(); });
+                if (queue.empty()) {
+                    return;  // Planned and drained
+                }
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            space_available.notify_one();
+            
+            if (cancelled) {
+                continue;
+            }
+            
+            int64_t bytes = 0;
+            const Outcome outcome = transfer(task, hardlink, bytes);
+            if (outcome == Outcome::Failed) {
+                std::cerr << "[Exporter] Failed to export " << task.source
+                          << " to " << task.target.string() << std::endl;
+            }
+            finish_file(outcome, bytes);
+        }
+    }
 };
 
 Exporter::Exporter(std::shared_ptr<IDatabase> database)
@@ -32,13 +331,13 @@ void Exporter::export_person(
     const Options& options,
     ProgressCallback progress)
 {
-    // TODO: Implement
-    // 1. Query all photos for person
-    // 2. For each photo, copy to destination with smart filename
-    (void)person_id;
-    (void)destination;
-    (void)options;
-    (void)progress;
+    auto person = m_impl->database->get_person(person_id);
+    if (!person.has_value()) {
+        throw std::invalid_argument("Unknown person");
+    }
+    
+    m_impl->export_photos(m_impl->database->get_photos_for_person(person_id),
+                          person->name, destination, options, progress);
 }
 
 void Exporter::export_cluster(
@@ -47,25 +346,167 @@ void Exporter::export_cluster(
     const Options& options,
     ProgressCallback progress)
 {
-    // TODO: Implement
-    (void)cluster_id;
-    (void)destination;
-    (void)options;
-    (void)progress;
+    auto cluster = m_impl->database->get_cluster(cluster_id);
+    if (!cluster.has_value()) {
+        throw std::invalid_argument("Unknown cluster");
+    }
+    
+    std::string person_name;
+    if (cluster->person_id.has_value()) {
+        if (auto person = m_impl->database->get_person(*cluster->person_id)) {
+            person_name = person->name;
+        }
+    }
+    
+    m_impl->export_photos(m_impl->database->get_photos_for_cluster(cluster_id),
+                          person_name, destination, options, progress);
+}
+
+void Exporter::cancel()
+{
+    m_impl->cancelled = true;
+}
+
+bool Exporter::is_cancelled() const
+{
+    return m_impl->cancelled;
+}
+
+Exporter::Stats Exporter::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->stats_mutex);
+    return m_impl->stats;
+}
+
+void Exporter::Impl::export_photos(
+    const std::vector<Photo>& photos,
+    const std::string& person_name,
+    const std::string& destination,
+    const Options& options,
+    ProgressCallback on_progress)
+{
+    std::lock_guard<std::mutex> export_lock(export_mutex);
+    const auto start = std::chrono::steady_clock::now();
+    cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats = Stats{};
+        stats.files_total = static_cast<int64_t>(photos.size());
+        finished = 0;
+        progress = on_progress;
+    }
+    
+    fs::create_directories(destination);
+    struct stat destination_info;
+    if (::stat(destination.c_str(), &destination_info) != 0) {
+        throw std::runtime_error("Export destination is not accessible: " + destination);
+    }
+    
+    queue.clear();
+    planned_all = false;
+    const int worker_count = std::max(1, options.workers);
+    const size_t max_queued = static_cast<size_t>(worker_count) * kQueuedPerWorker;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < worker_count; ++i) {
+        workers.emplace_back([this, hardlink = options.hardlink]() { worker_loop(hardlink); });
+    }
+    auto finish_planning = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            planned_all = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+    
+    try {
+        // Names are settled in photo order, so a rerun gives each photo the
+        // same name and finds the files it already exported
+        std::unordered_set<std::string> taken;
+        for (const Photo& photo : photos) {
+            if (cancelled) {
+                break;
+            }
+            
+            struct stat info;
+            if (::stat(photo.file_path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+                std::cerr << "[Exporter] Missing source photo: " << photo.file_path << std::endl;
+                finish_file(Outcome::Failed, 0);
+                continue;
+            }
+            
+            const fs::path name = build_filename(photo, info.st_mtime, person_name, options);
+            ExportTask task{photo.file_path, {}, info.st_dev == destination_info.st_dev};
+            bool exported = false;
+            for (int n = 1; task.target.empty() && !exported; ++n) {
+                const fs::path candidate = n == 1 ? name
+                    : fs::path(name.stem().string() + options.separator + std::to_string(n) + name.extension().string());
+                if (!taken.insert(name_key(candidate.string())).second) {
+                    continue;  // Claimed by an earlier photo
+                }
+                
+                const fs::path target = fs::path(destination) / candidate;
+                std::error_code ec;
+                if (!fs::exists(fs::symlink_status(target, ec))) {
+                    task.target = target;
+                } else {
+                    exported = is_exported_copy(target, photo.file_path, static_cast<uintmax_t>(info.st_size));
+                }
+            }
+            
+            if (exported) {
+                finish_file(Outcome::Skipped, 0);
+                continue;
+            }
+            
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                space_available.wait(lock, [&]() { return queue.size() < max_queued; });
+                queue.push_back(std::move(task));
+            }
+            work_available.notify_one();
+        }
+    } catch (...) {
+        cancelled = true;
+        finish_planning();
+        throw;
+    }
+    finish_planning();
+    
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats.elapsed_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    progress = nullptr;
+    
+    std::cout << "[Exporter] " << (cancelled ? "Cancelled export of " : "Exported ") << stats.files_total
+              << " photos to " << destination << ": " << stats.cloned << " cloned, " << stats.linked
+              << " linked, " << stats.copied << " copied, " << stats.skipped << " already there, "
+              << stats.failed << " failed (" << static_cast<int>(stats.elapsed_ms) << " ms)" << std::endl;
 }
 
 std::string Exporter::Impl::build_filename(
-    const std::string& original_path,
+    const Photo& photo,
+    std::time_t modified,
     const std::string& person_name,
     const Options& options)
 {
-    namespace fs = std::filesystem;
-    
-    fs::path path(original_path);
+    fs::path path(photo.file_path);
     std::string result;
     
     if (options.include_person_name && !person_name.empty()) {
-        result += person_name + options.separator;
+        std::string name = person_name;
+        std::replace(name.begin(), name.end(), '/', '-');
+        std::replace(name.begin(), name.end(), '\\', '-');
+        result += name + options.separator;
+    }
+    
+    if (options.include_date) {
+        auto date = photo_date(photo, modified);
+        if (!date.empty()) {
+            result += date + options.separator;
+        }
     }
     
     if (options.include_original_folder) {
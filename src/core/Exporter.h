@@ -12,6 +12,14 @@ class IDatabase;
 
 /**
  * Exports photos for a person to a destination folder.
+ * Files are planned in photo order on the calling thread and handed through
+ * a bounded queue to a pool of copy workers. Each copy takes the cheapest
+ * route available: a reflink (copy-on-write clone) when source and
+ * destination share a filesystem that supports it, then an in-kernel
+ * copy_file_range(), then a buffered copy. Files are written under a
+ * temporary name and renamed into place with the source's modification
+ * time, so a file at its final name with the source's size and time is
+ * complete; a rerun after a partial export skips those.
  */
 class Exporter {
 public:
@@ -20,8 +28,23 @@ public:
         bool include_original_folder = true;
         bool include_date = true;
         std::string separator = "_";
+        bool hardlink = false;       // Link rather than copy when on the same filesystem (shares the original's data)
+        int workers = 4;             // Files copied concurrently
     };
     
+    struct Stats {
+        int64_t files_total = 0;
+        int64_t cloned = 0;          // Reflinked
+        int64_t linked = 0;          // Hardlinked (Options::hardlink)
+        int64_t copied = 0;          // copy_file_range() or buffered
+        int64_t skipped = 0;         // Already exported by an earlier run
+        int64_t failed = 0;
+        int64_t bytes_copied = 0;    // Bytes actually moved by copies
+        double elapsed_ms = 0.0;
+    };
+    
+    // Called from the copy workers or, for files skipped or missing, the
+    // exporting thread; one call at a time, in order
     using ProgressCallback = std::function<void(int current, int total)>;
     
     explicit Exporter(std::shared_ptr<IDatabase> database);
@@ -29,6 +52,9 @@ public:
     
     /**
      * Export all photos containing a person.
+     * Name collisions get a numbered suffix; files already exported to the
+     * same folder are kept.
+     * @throws std::invalid_argument for an unknown person
      * @param person_id ID of the person to export
      * @param destination Destination folder path
      * @param options Export options
@@ -37,19 +63,29 @@ public:
     void export_person(
         int64_t person_id,
         const std::string& destination,
-        const Options& options = {},
+        const Options& options,
         ProgressCallback progress = nullptr
     );
     
     /**
-     * Export photos from a specific cluster.
+     * Export photos from a specific cluster, named for its person if it has one.
+     * @throws std::invalid_argument for an unknown cluster
      */
     void export_cluster(
         int64_t cluster_id,
         const std::string& destination,
-        const Options& options = {},
+        const Options& options,
         ProgressCallback progress = nullptr
     );
+    
+    /**
+     * Stop the running export after the files being copied.
+     */
+    void cancel();
+    bool is_cancelled() const;
+    
+    // Of the last export
+    Stats get_stats() const;
 
 private:
     class Impl;
@@ -4,15 +4,27 @@
  */
 
 #include "Indexer.h"
+#include "DecodeStage.h"
+#include "ThumbnailWriter.h"
 #include "../services/Database.h"
+#include "../services/EmbeddingSnapshot.h"
 #include "../services/FaceService.h"
 #include "../services/ImageLoader.h"
+#include "../services/ImageBufferPool.h"
+#include "../services/PerceptualHash.h"
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <unordered_set>
 
 namespace fs = std::filesystem;
 
@@ -26,6 +38,138 @@ static std::string get_current_timestamp() {
     return oss.str();
 }
 
+// Peak resident set size of this process
+static int64_t peak_rss_bytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<int64_t>(usage.ru_maxrss);         // Bytes on macOS
+#else
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024;  // Kilobytes on Linux
+#endif
+}
+
+// Deepest directory containing all paths (recorded as the scan root)
+static std::string common_root(const std::vector<std::string>& paths) {
+    if (paths.empty()) {
+        return {};
+    }
+    
+    fs::path root = fs::path(paths.front()).parent_path();
+    for (const auto& path : paths) {
+        fs::path parent = fs::path(path).parent_path();
+        fs::path common;
+        auto it_a = root.begin();
+        auto it_b = parent.begin();
+        for (; it_a != root.end() && it_b != parent.end() && *it_a == *it_b; ++it_a, ++it_b) {
+            common /= *it_a;
+        }
+        root = common;
+    }
+    return root.string();
+}
+
+// Paths with duplicates dropped, keeping first occurrences in order.
+// The queue keys on (scan, path), so the scan's totals must count the same set.
+static std::vector<std::string> unique_paths(const std::vector<std::string>& paths) {
+    std::vector<std::string> unique;
+    unique.reserve(paths.size());
+    std::unordered_set<std::string> seen;
+    for (const auto& path : paths) {
+        if (seen.insert(path).second) {
+            unique.push_back(path);
+        }
+    }
+    return unique;
+}
+
+// Decides when to commit the open write transaction.
+// A batch ends after target_rows rows or commit_max_interval_ms, whichever
+// comes first. In adaptive mode target_rows is re-derived after every commit
+// so that COMMIT (fsync) stays near commit_target_overhead of the batch time.
+class CommitBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    explicit CommitBatcher(const Indexer::Config& config)
+        : m_config(config)
+        , m_target_rows(std::max(1, config.commit_rows))
+    {
+    }
+    
+    void begin() {
+        m_batch_start = Clock::now();
+        m_rows = 0;
+    }
+    
+    void add_rows(int rows) {
+        m_rows += rows;
+    }
+    
+    bool should_commit() const {
+        if (m_rows == 0) {
+            return false;
+        }
+        if (m_rows >= m_target_rows) {
+            return true;
+        }
+        return elapsed_ms(m_batch_start, Clock::now()) >= m_config.commit_max_interval_ms;
+    }
+    
+    // Run the commit, record its latency and adapt the batch size
+    template <typename CommitFn>
+    void commit(CommitFn&& do_commit, Indexer::Stats& stats) {
+        const auto commit_start = Clock::now();
+        do_commit();
+        const auto commit_end = Clock::now();
+        
+        const double commit_ms = elapsed_ms(commit_start, commit_end);
+        const double batch_ms = elapsed_ms(m_batch_start, commit_start);
+        
+        stats.commits++;
+        stats.rows_committed += m_rows;
+        stats.commit_ms_total += commit_ms;
+        stats.commit_ms_max = std::max(stats.commit_ms_max, commit_ms);
+        
+        if (m_config.adaptive_commit && m_rows > 0) {
+            adapt(commit_ms, batch_ms / m_rows);
+        }
+    }
+    
+    int target_rows() const { return m_target_rows; }
+
+private:
+    static double elapsed_ms(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+    
+    void adapt(double commit_ms, double ms_per_row) {
+        // Smooth both measurements so one slow fsync or image does not swing the target
+        constexpr double alpha = 0.3;
+        m_commit_ms = m_have_samples ? alpha * commit_ms + (1.0 - alpha) * m_commit_ms : commit_ms;
+        m_row_ms = m_have_samples ? alpha * ms_per_row + (1.0 - alpha) * m_row_ms : ms_per_row;
+        m_have_samples = true;
+        
+        // Rows needed so that commit_ms / (rows * row_ms) <= target overhead
+        const double overhead = std::max(0.001f, m_config.commit_target_overhead);
+        const double rows = m_commit_ms / (overhead * std::max(m_row_ms, 0.001));
+        
+        const int min_rows = std::max(1, m_config.commit_min_rows);
+        const int max_rows = std::max(min_rows, m_config.commit_max_rows);
+        m_target_rows = static_cast<int>(std::clamp(rows, static_cast<double>(min_rows), static_cast<double>(max_rows)));
+    }
+    
+    const Indexer::Config& m_config;
+    int m_target_rows;
+    int m_rows = 0;
+    Clock::time_point m_batch_start = Clock::now();
+    double m_commit_ms = 0.0;
+    double m_row_ms = 0.0;
+    bool m_have_samples = false;
+};
+
 class Indexer::Impl {
 public:
     std::shared_ptr<IDatabase> database;
@@ -34,20 +178,234 @@ public:
     std::atomic<bool> cancelled{false};
     std::string thumbnail_dir;
     int thumbnail_size = 150;
+    Config config;
+    Stats stats;
+    
+    // Perceptual hashes of already-indexed photos
+    BkTree hash_index;
+    
+    // Decoded frames are recycled across images and runs
+    std::shared_ptr<ImageBufferPool> buffer_pool;
+    
+    // Refreshed at the end of each run so the next clustering pass maps it
+    std::shared_ptr<EmbeddingSnapshot> embedding_snapshot;
+    
+    // Thumbnail encoding runs off the indexing thread for the duration of a run
+    std::unique_ptr<ThumbnailWriter> thumbnail_writer;
     
     // Generate thumbnail path for a face
     std::string get_thumbnail_path(int64_t face_id) const {
         return thumbnail_dir + "/face_" + std::to_string(face_id) + ".jpg";
     }
     
-    // Process a single image and store results in database
-    int process_image(const std::string& image_path, const Image& image) {
+    void record_decode_stats(const DecodeStage& decoder) {
+        auto decode_stats = decoder.get_stats();
+        auto pool_stats = buffer_pool->get_stats();
+        stats.peak_decoded_bytes = std::max(stats.peak_decoded_bytes, decode_stats.peak_bytes_in_flight);
+        stats.decode_blocked_ms += decode_stats.blocked_ms;
+        stats.buffer_pool_hits = pool_stats.hits;
+        stats.buffer_pool_misses = pool_stats.misses;
+        stats.peak_rss_bytes = peak_rss_bytes();
+    }
+    
+    // Log pipeline statistics for the finished run
+    void report_stats() const {
+        if (stats.near_duplicates_skipped > 0) {
+            std::cout << "[Indexer] Reused detections for " << stats.near_duplicates_skipped
+                      << " near-duplicate images (" << stats.faces_reused << " faces)." << std::endl;
+        }
+        
+        std::cout << "[Indexer] " << stats.commits << " commits, "
+                  << std::fixed << std::setprecision(1) << stats.rows_per_commit() << " rows/commit, "
+                  << stats.avg_commit_ms() << " ms avg / " << stats.commit_ms_max << " ms max commit time"
+                  << std::defaultfloat << std::endl;
+        
+        std::cout << "[Indexer] Decode: peak " << (stats.peak_decoded_bytes >> 20) << " MB in flight (budget "
+                  << (config.decode_memory_budget_bytes >> 20) << " MB), decoders blocked "
+                  << static_cast<int64_t>(stats.decode_blocked_ms) << " ms, buffer pool "
+                  << stats.buffer_pool_hits << " hits / " << stats.buffer_pool_misses << " misses, peak RSS "
+                  << (stats.peak_rss_bytes >> 20) << " MB" << std::endl;
+        
+        auto detect_stats = face_service->get_stats();
+        std::cout << "[Indexer] Detection: HOG " << static_cast<int64_t>(detect_stats.hog_ms)
+                  << " ms, CNN " << static_cast<int64_t>(detect_stats.cnn_ms)
+                  << " ms, landmarks/embeddings " << static_cast<int64_t>(detect_stats.describe_ms)
+                  << " ms, " << stats.faces_low_quality << " low-quality faces stored without embedding"
+                  << std::endl;
+        if (stats.faces_pending > 0) {
+            std::cout << "[Indexer] " << stats.faces_pending
+                      << " faces stored with deferred embeddings." << std::endl;
+        }
+        if (detect_stats.images_with_candidates > 0 || detect_stats.negatives_sampled > 0) {
+            std::cout << "[Indexer] Cascade: " << std::fixed << std::setprecision(1)
+                      << 100.0 * detect_stats.candidate_rate() << "% of images proposed, "
+                      << 100.0 * detect_stats.region_precision() << "% of " << detect_stats.candidate_regions
+                      << " regions confirmed, " << detect_stats.negatives_with_faces << "/"
+                      << detect_stats.negatives_sampled << " sampled negatives had faces"
+                      << std::defaultfloat << std::endl;
+        }
+    }
+    
+    void sync_snapshot() {
+        if (!embedding_snapshot) {
+            return;
+        }
+        try {
+            std::lock_guard<std::mutex> lock(embedding_snapshot->mutex());
+            embedding_snapshot->sync(*database, face_service->embedding_model());
+        } catch (const std::exception& e) {
+            // The snapshot is a cache; clustering falls back to the database
+            std::cerr << "[Indexer] Embedding snapshot not updated: " << e.what() << std::endl;
+        }
+    }
+    
+    // Load hashes of photos indexed in earlier runs
+    void load_hash_index() {
+        hash_index.clear();
+        if (!config.reuse_near_duplicates) {
+            return;
+        }
+        for (const auto& [photo_id, hash] : database->get_photo_hashes()) {
+            if (PerceptualHash::is_informative(hash)) {
+                hash_index.insert(hash, photo_id);
+            }
+        }
+    }
+    
+    // Find an indexed photo that is a resized/re-encoded copy of this one.
+    // Flat images all hash alike, so they never match.
+    std::optional<Photo> find_near_duplicate(uint64_t hash, const Image& image) {
+        if (!config.reuse_near_duplicates || hash_index.empty() ||
+            !image.is_valid() || !PerceptualHash::is_informative(hash)) {
+            return std::nullopt;
+        }
+        
+        BkTree::Match match;
+        if (!hash_index.find_nearest(hash, config.near_duplicate_max_distance, match)) {
+            return std::nullopt;
+        }
+        
+        auto original = database->get_photo(match.id);
+        if (!original.has_value() || original->width <= 0 || original->height <= 0) {
+            return std::nullopt;
+        }
+        
+        // Crops hash similarly but cannot reuse bboxes, so require matching framing
+        const float aspect = static_cast<float>(image.width) / image.height;
+        const float original_aspect = static_cast<float>(original->width) / original->height;
+        if (std::abs(aspect - original_aspect) > config.near_duplicate_aspect_tolerance * original_aspect) {
+            return std::nullopt;
+        }
+        
+        return original;
+    }
+    
+    // Reuse the detections of a near-duplicate, rescaled to this image
+    std::vector<FaceDetection> reuse_detections(const Photo& original, const Image& image) {
+        const float sx = static_cast<float>(image.width) / original.width;
+        const float sy = static_cast<float>(image.height) / original.height;
+        
+        std::vector<FaceDetection> detections;
+        for (const auto& face : database->get_faces_for_photo(original.id)) {
+            FaceDetection detection;
+            detection.bbox.x = static_cast<int>(std::lround(face.bbox.x * sx));
+            detection.bbox.y = static_cast<int>(std::lround(face.bbox.y * sy));
+            detection.bbox.width = static_cast<int>(std::lround(face.bbox.width * sx));
+            detection.bbox.height = static_cast<int>(std::lround(face.bbox.height * sy));
+            detection.confidence = face.confidence;
+            detection.quality = face.quality;
+            detection.embedding = face.embedding;
+            detection.embedding_state = face.embedding_state;
+            detection.embedding_model = face.embedding_model;
+            for (const auto& [x, y] : face.landmarks) {
+                detection.landmarks.emplace_back(static_cast<int>(std::lround(x * sx)),
+                                                 static_cast<int>(std::lround(y * sy)));
+            }
+            if (face.chip.is_valid()) {
+                // Aspect ratios match within tolerance, so the rotation carries over
+                detection.chip = face.chip;
+                detection.chip.center_x *= sx;
+                detection.chip.center_y *= sy;
+                detection.chip.width *= sx;
+                detection.chip.height *= sy;
+            }
+            detections.push_back(std::move(detection));
+        }
+        return detections;
+    }
+    
+    void start_thumbnail_stage() {
+        if (thumbnail_dir.empty()) {
+            return;
+        }
+        ThumbnailWriter::Config writer_config;
+        writer_config.threads = config.thumbnail_threads;
+        writer_config.max_queued_pixels = config.thumbnail_max_queued_pixels;
+        writer_config.thumbnail_size = thumbnail_size;
+        thumbnail_writer = std::make_unique<ThumbnailWriter>(image_loader, writer_config);
+    }
+    
+    // Drain outstanding thumbnails and stop the encoder threads
+    void finish_thumbnail_stage() {
+        if (!thumbnail_writer) {
+            return;
+        }
+        thumbnail_writer->flush();
+        auto writer_stats = thumbnail_writer->get_stats();
+        thumbnail_writer.reset();
+        
+        if (writer_stats.failed > 0 || writer_stats.blocked_ms > 0.0) {
+            std::cout << "[Indexer] Thumbnails: " << writer_stats.written << " written, "
+                      << writer_stats.failed << " failed, producer blocked "
+                      << writer_stats.blocked_ms << " ms" << std::endl;
+        }
+    }
+    
+    // Queue the thumbnail for a stored face; only the face crop is retained
+    void save_face_thumbnail(int64_t face_id, const BoundingBox& bbox, const Image& image) {
+        if (!thumbnail_writer) {
+            return;
+        }
+        
+        try {
+            // Expand bounding box slightly for better crop
+            BoundingBox expanded_bbox = bbox;
+            int expand = static_cast<int>(expanded_bbox.width * 0.2);
+            expanded_bbox.x = std::max(0, expanded_bbox.x - expand);
+            expanded_bbox.y = std::max(0, expanded_bbox.y - expand);
+            expanded_bbox.width = std::min(image.width - expanded_bbox.x, 
+                                           expanded_bbox.width + expand * 2);
+            expanded_bbox.height = std::min(image.height - expanded_bbox.y, 
+                                            expanded_bbox.height + expand * 2);
+            
+            thumbnail_writer->enqueue(image, expanded_bbox, get_thumbnail_path(face_id));
+        } catch (const std::exception& e) {
+            std::cerr << "[Indexer] Failed to queue thumbnail for face " 
+                      << face_id << ": " << e.what() << std::endl;
+        }
+    }
+    
+    // A decoded frame on its way through detection. The photo row is stored
+    // first; faces follow once the frame's detection group has run.
+    struct Frame {
+        DecodeStage::Result decoded;
+        int64_t photo_id = 0;               // 0 if already indexed or not stored
+        bool needs_detection = false;       // No near-duplicate to reuse
+        std::vector<FaceDetection> detections;
+    };
+    
+    // Store the photo row of a frame and reuse the detections of a
+    // near-duplicate when there is one. Photos earlier in the same group have
+    // no faces stored yet, so they are not offered for reuse.
+    void prepare_frame(Frame& frame, const std::vector<Frame>& group) {
+        const std::string& image_path = frame.decoded.path;
+        const Image& image = frame.decoded.image;
         try {
             // Check if photo already exists in database
             auto existing = database->get_photo_by_path(image_path);
             if (existing.has_value()) {
                 // Already indexed, skip
-                return 0;
+                return;
             }
             
             // Create photo record
@@ -68,51 +426,245 @@ public:
             }
             
             photo.scan_date = get_current_timestamp();
+            photo.phash = PerceptualHash::dhash(image);
             
-            // Insert photo and get ID
-            int64_t photo_id = database->insert_photo(photo);
+            auto original = find_near_duplicate(photo.phash.value(), image);
+            for (const auto& earlier : group) {
+                if (original.has_value() && earlier.photo_id == original->id) {
+                    original.reset();
+                }
+            }
             
-            // Detect faces
-            std::vector<FaceDetection> detections = face_service->detect_faces(image);
+            // Insert photo and get ID
+            frame.photo_id = database->insert_photo(photo);
+            if (config.reuse_near_duplicates && PerceptualHash::is_informative(photo.phash.value())) {
+                hash_index.insert(photo.phash.value(), frame.photo_id);
+            }
             
-            // Store each detected face
-            for (const auto& detection : detections) {
+            // Reuse the faces of a near-duplicate, or detect with the group
+            if (original.has_value()) {
+                frame.detections = reuse_detections(original.value(), image);
+                stats.near_duplicates_skipped++;
+                stats.faces_reused += static_cast<int>(frame.detections.size());
+            } else {
+                frame.needs_detection = true;
+            }
+        
+        } catch (const std::exception& e) {
+            std::cerr << "[Indexer] Error processing " << image_path << ": " << e.what() << std::endl;
+        }
+    }
+    
+    std::vector<std::vector<FaceDetection>> detect(const std::vector<const Image*>& images) {
+        if (config.defer_embeddings) {
+            return face_service->detect_faces_deferred_batch(images);
+        }
+        return face_service->detect_faces_batch(images);
+    }
+    
+    // Detect faces in all frames of a group at once, so CNN forward passes
+    // (and cascade regions) are shared across images
+    void detect_frames(std::vector<Frame>& group) {
+        std::vector<const Image*> images;
+        std::vector<Frame*> targets;
+        for (auto& frame : group) {
+            if (frame.needs_detection) {
+                images.push_back(&frame.decoded.image);
+                targets.push_back(&frame);
+            }
+        }
+        if (images.empty()) {
+            return;
+        }
+        
+        try {
+            auto results = detect(images);
+            for (size_t k = 0; k < targets.size(); ++k) {
+                targets[k]->detections = std::move(results[k]);
+            }
+        } catch (const std::exception& e) {
+            // Retry one by one so a single bad image does not cost the group
+            for (Frame* frame : targets) {
+                try {
+                    frame->detections = std::move(detect({&frame->decoded.image}).front());
+                } catch (const std::exception& image_error) {
+                    std::cerr << "[Indexer] Error processing " << frame->decoded.path << ": "
+                              << image_error.what() << std::endl;
+                }
+            }
+        }
+    }
+    
+    // Store the faces of a prepared frame
+    int store_faces(const Frame& frame) {
+        if (frame.photo_id == 0) {
+            return 0;
+        }
+        
+        try {
+            for (const auto& detection : frame.detections) {
                 Face face;
-                face.photo_id = photo_id;
+                face.photo_id = frame.photo_id;
                 face.bbox = detection.bbox;
                 face.embedding = detection.embedding;
                 face.confidence = detection.confidence;
+                face.quality = detection.quality;
+                face.embedding_state = detection.embedding_state;
+                face.embedding_model = detection.embedding_model;
+                face.landmarks = detection.landmarks;
+                face.chip = detection.chip;
+                if (face.embedding_state == EmbeddingState::LowQuality) {
+                    // Below the quality gate: kept for display, left out of clustering
+                    stats.faces_low_quality++;
+                } else if (face.embedding_state == EmbeddingState::Pending) {
+                    stats.faces_pending++;
+                }
                 // cluster_id and person_id remain unset (will be assigned during clustering)
                 
                 int64_t face_id = database->insert_face(face);
+                save_face_thumbnail(face_id, detection.bbox, frame.decoded.image);
+            }
+            
+            return static_cast<int>(frame.detections.size());
+        
+        } catch (const std::exception& e) {
+            std::cerr << "[Indexer] Error processing " << frame.decoded.path << ": " << e.what() << std::endl;
+            return 0;
+        }
+    }
+    
+    // Work through the pending files of a scan session, checkpointing each batch.
+    // Files are marked done in the same transaction as their photo/face rows, so
+    // a crash loses at most the uncommitted batch and resume picks up exactly there.
+    void run_queue(
+        ScanSession& scan,
+        const std::vector<std::string>& pending,
+        const ProgressCallback& progress)
+    {
+        const int total = scan.total_files;
+        CommitBatcher batcher(config);
+        
+        start_thumbnail_stage();
+        struct ThumbnailStageGuard {
+            Impl* impl;
+            ~ThumbnailStageGuard() { impl->finish_thumbnail_stage(); }
+        } thumbnail_guard{this};
+        
+        // Decoding runs ahead on its own threads under the memory budget
+        DecodeStage::Config decode_config;
+        decode_config.threads = config.decode_threads;
+        decode_config.max_ahead = config.decode_max_ahead;
+        decode_config.memory_budget_bytes = config.decode_memory_budget_bytes;
+        DecodeStage decoder(image_loader, buffer_pool, pending, decode_config);
+        struct DecodeStatsGuard {
+            Impl* impl;
+            DecodeStage& decoder;
+            ~DecodeStatsGuard() { impl->record_decode_stats(decoder); }
+        } decode_guard{this, decoder};
+        
+        // Batches run in transactions; only an open one is rolled back on error
+        bool in_transaction = false;
+        auto begin_batch = [&]() {
+            database->begin_transaction();
+            in_transaction = true;
+            batcher.begin();
+        };
+        auto checkpoint = [&]() {
+            database->update_scan_progress(scan.id, scan.processed_files, scan.total_faces);
+            batcher.commit([&]() {
+                database->commit();
+                in_transaction = false;
+            }, stats);
+        };
+        
+        begin_batch();
+        
+        // Frames are detected in groups; a group's photo rows and faces are
+        // committed together, so commits happen only between groups
+        const size_t group_size = static_cast<size_t>(std::max(1, config.detect_batch_size));
+        std::vector<Frame> group;
+        group.reserve(group_size);
+        
+        try {
+            bool decoding = true;
+            while (decoding) {
+                if (cancelled) {
+                    // Keep the finished part of the batch so resume does not redo it
+                    checkpoint();
+                    database->update_scan_status(scan.id, ScanSession::kCancelled);
+                    return;
+                }
                 
-                // Generate thumbnail
-                if (!thumbnail_dir.empty()) {
-                    try {
-                        // Expand bounding box slightly for better crop
-                        BoundingBox expanded_bbox = detection.bbox;
-                        int expand = static_cast<int>(expanded_bbox.width * 0.2);
-                        expanded_bbox.x = std::max(0, expanded_bbox.x - expand);
-                        expanded_bbox.y = std::max(0, expanded_bbox.y - expand);
-                        expanded_bbox.width = std::min(image.width - expanded_bbox.x, 
-                                                       expanded_bbox.width + expand * 2);
-                        expanded_bbox.height = std::min(image.height - expanded_bbox.y, 
-                                                        expanded_bbox.height + expand * 2);
-                        
-                        std::string thumb_path = get_thumbnail_path(face_id);
-                        image_loader->save_thumbnail(image, expanded_bbox, thumb_path, thumbnail_size);
-                    } catch (const std::exception& e) {
-                        std::cerr << "[Indexer] Failed to save thumbnail for face " 
-                                  << face_id << ": " << e.what() << std::endl;
+                // Next frames from the parallel decoders (blocks until each is ready)
+                group.clear();
+                while (group.size() < group_size) {
+                    DecodeStage::Result decoded;
+                    if (!decoder.next(decoded)) {
+                        decoding = false;
+                        break;
+                    }
+                    
+                    if (!decoded.ok) {
+                        std::cerr << "[Indexer] Failed to load image " << decoded.path << ": " << decoded.error << std::endl;
+                        stats.images_failed++;
+                        database->update_scan_file_status(scan.id, decoded.path, ScanFileStatus::Failed);
+                        batcher.add_rows(1);
+                        scan.processed_files++;
+                        if (progress) {
+                            progress(scan.processed_files, total, decoded.path, scan.total_faces);
+                        }
+                        continue;
                     }
+                    
+                    Frame frame;
+                    frame.decoded = std::move(decoded);
+                    prepare_frame(frame, group);
+                    group.push_back(std::move(frame));
+                }
+                
+                detect_frames(group);
+                
+                for (auto& frame : group) {
+                    int faces_found = store_faces(frame);
+                    
+                    // Thumbnails hold their own crops, so the frame can go back to the pool now
+                    decoder.release(frame.decoded.image);
+                    
+                    const std::string& path = frame.decoded.path;
+                    database->update_scan_file_status(scan.id, path, ScanFileStatus::Done);
+                    batcher.add_rows(1 + faces_found);
+                    scan.processed_files++;
+                    scan.total_faces += faces_found;
+                    stats.images_processed++;
+                    stats.faces_found += faces_found;
+                    
+                    // Report progress
+                    if (progress) {
+                        progress(scan.processed_files, total, path, scan.total_faces);
+                    }
+                }
+                
+                // Commit when the batch is large or old enough
+                if (batcher.should_commit()) {
+                    checkpoint();
+                    begin_batch();
                 }
             }
             
-            return static_cast<int>(detections.size());
-            
-        } catch (const std::exception& e) {
-            std::cerr << "[Indexer] Error processing " << image_path << ": " << e.what() << std::endl;
-            return 0;
+            checkpoint();
+            database->update_scan_status(scan.id, ScanSession::kCompleted);
+        
+        } catch (...) {
+            // Don't let cleanup errors hide the original one
+            try {
+                if (in_transaction) {
+                    database->rollback();
+                }
+                database->update_scan_status(scan.id, ScanSession::kInterrupted);
+            } catch (const std::exception& e) {
+                std::cerr << "[Indexer] Failed to mark scan " << scan.id << " interrupted: " << e.what() << std::endl;
+            }
+            throw;
         }
     }
 };
@@ -120,21 +672,28 @@ public:
 Indexer::Indexer(
     std::shared_ptr<IDatabase> database,
     std::shared_ptr<FaceService> face_service,
-    std::shared_ptr<ImageLoader> image_loader)
+    std::shared_ptr<ImageLoader> image_loader,
+    const Config& config)
     : m_impl(std::make_unique<Impl>())
 {
     m_impl->database = database;
     m_impl->face_service = face_service;
     m_impl->image_loader = image_loader;
+    m_impl->config = config;
+    m_impl->buffer_pool = std::make_shared<ImageBufferPool>(config.buffer_pool_max_bytes);
 }
 
 Indexer::~Indexer() = default;
 
-void Indexer::index(
-    const std::vector<std::string>& image_paths,
+int64_t Indexer::index(
+    const std::vector<std::string>& paths,
     ProgressCallback progress)
 {
+    const std::vector<std::string> image_paths = unique_paths(paths);
+    
     m_impl->cancelled = false;
+    m_impl->stats = Stats{};
+    m_impl->face_service->reset_stats();
     
     // Initialize face service if not already done
     if (!m_impl->face_service->is_initialized()) {
@@ -144,68 +703,76 @@ void Indexer::index(
         m_impl->face_service->initialize();
     }
     
-    int total = static_cast<int>(image_paths.size());
-    int total_faces = 0;
+    m_impl->load_hash_index();
     
-    // Use transactions for better performance with batch inserts
-    m_impl->database->begin_transaction();
+    // Record the session and its work queue before touching any image
+    ScanSession scan;
+    scan.root_path = common_root(image_paths);
+    scan.start_date = get_current_timestamp();
+    scan.status = ScanSession::kRunning;
+    scan.total_files = static_cast<int>(image_paths.size());
     
+    m_impl->database->begin_transaction();
     try {
-        for (int i = 0; i < total; ++i) {
-            if (m_impl->cancelled) {
-                m_impl->database->rollback();
-                return;
-            }
-            
-            const std::string& path = image_paths[i];
-            
-            // Load image first
-            Image image;
-            try {
-                image = m_impl->image_loader->load(path);
-            } catch (const std::exception& e) {
-                std::cerr << "[Indexer] Failed to load image " << path << ": " << e.what() << std::endl;
-                if (progress) {
-                    progress(i + 1, total, path, 0);
-                }
-                continue;
-            }
-            
-            // Process image
-            int faces_found = m_impl->process_image(path, image);
-            total_faces += faces_found;
-            
-            // Report progress
-            if (progress) {
-                progress(i + 1, total, path, total_faces);
-            }
-            
-            // Commit in batches of 50 for better performance
-            if ((i + 1) % 50 == 0) {
-                m_impl->database->commit();
-                m_impl->database->begin_transaction();
-            }
-        }
-        
+        scan.id = m_impl->database->insert_scan(scan);
+        m_impl->database->enqueue_scan_files(scan.id, image_paths);
         m_impl->database->commit();
-        
     } catch (...) {
         m_impl->database->rollback();
         throw;
     }
     
-    std::cout << "[Indexer] Indexing complete. Processed " << total 
-              << " images, found " << total_faces << " faces." << std::endl;
+    m_impl->run_queue(scan, image_paths, progress);
+    
+    std::cout << "[Indexer] Indexing complete. Processed " << scan.processed_files 
+              << " images, found " << scan.total_faces << " faces." << std::endl;
+    m_impl->report_stats();
+    m_impl->sync_snapshot();
+    
+    return scan.id;
 }
 
 void Indexer::resume_index(int64_t scan_id, ProgressCallback progress)
 {
-    // TODO: Load scan session from database and resume from last checkpoint
-    // For now, this is a placeholder
-    (void)scan_id;
-    (void)progress;
+    auto scan = m_impl->database->get_scan(scan_id);
+    if (!scan.has_value()) {
+        throw std::invalid_argument("Unknown scan session: " + std::to_string(scan_id));
+    }
     
-    std::cerr << "[Indexer] Resume not yet implemented" << std::endl;
+    if (!scan->is_resumable()) {
+        std::cout << "[Indexer] Scan " << scan_id << " already completed" << std::endl;
+        return;
+    }
+    
+    m_impl->cancelled = false;
+    m_impl->stats = Stats{};
+    m_impl->face_service->reset_stats();
+    
+    // Only files that never made it into a committed batch are left
+    std::vector<std::string> pending = m_impl->database->get_pending_scan_files(scan_id);
+    
+    std::cout << "[Indexer] Resuming scan " << scan_id << ": " << pending.size()
+              << " of " << scan->total_files << " files remaining" << std::endl;
+    
+    if (!m_impl->face_service->is_initialized()) {
+        if (progress) {
+            progress(scan->processed_files, scan->total_files, "Loading face detection models...", scan->total_faces);
+        }
+        m_impl->face_service->initialize();
+    }
+    
+    m_impl->load_hash_index();
+    
+    // Counters are recomputed from the queue so they match what was committed
+    scan->processed_files = scan->total_files - static_cast<int>(pending.size());
+    m_impl->database->update_scan_status(scan_id, ScanSession::kRunning);
+    
+    m_impl->run_queue(scan.value(), pending, progress);
+    
+    std::cout << "[Indexer] Resumed scan complete. Processed " << scan->processed_files
+              << " images, found " << scan->total_faces << " faces." << std::endl;
+    m_impl->report_stats();
+    m_impl->sync_snapshot();
 }
 
 void Indexer::cancel()
@@ -228,4 +795,25 @@ void Indexer::set_thumbnail_size(int size)
     m_impl->thumbnail_size = size;
 }
 
+void Indexer::set_config(const Config& config)
+{
+    m_impl->config = config;
+    m_impl->buffer_pool = std::make_shared<ImageBufferPool>(config.buffer_pool_max_bytes);
+}
+
+Indexer::Config Indexer::get_config() const
+{
+    return m_impl->config;
+}
+
+Indexer::Stats Indexer::get_stats() const
+{
+    return m_impl->stats;
+}
+
+void Indexer::set_embedding_snapshot(std::shared_ptr<EmbeddingSnapshot> snapshot)
+{
+    m_impl->embedding_snapshot = snapshot;
+}
+
 } // namespace facefling
@@ -4,6 +4,8 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <cstdint>
+#include <cstddef>
 #include "../models/Face.h"
 
 namespace facefling {
@@ -12,12 +14,77 @@ namespace facefling {
 class IDatabase;
 class FaceService;
 class ImageLoader;
+class EmbeddingSnapshot;
 
 /**
  * Orchestrates face detection and embedding generation.
  */
 class Indexer {
 public:
+    struct Config {
+        // Two-phase indexing: store bboxes and landmarks now, leave embeddings
+        // Pending for the EmbeddingScheduler (fast first look at a new library)
+        bool defer_embeddings = false;
+        
+        // Decoded frames handed to the detector together (set to the
+        // FaceService's cnn_batch_size so CNN passes are full)
+        int detect_batch_size = 4;
+        
+        // Near-duplicate detection (resized / re-encoded copies of the same shot)
+        bool reuse_near_duplicates = true;      // Reuse detections of a near-identical photo
+        int near_duplicate_max_distance = 4;    // Max Hamming distance between 64-bit dHashes
+        float near_duplicate_aspect_tolerance = 0.02f;  // Max relative aspect ratio difference
+        
+        // Commit batching: the write transaction is committed after target_rows
+        // rows (photos + faces) or commit_max_interval_ms, whichever comes first
+        bool adaptive_commit = true;            // Derive target_rows from measured commit latency
+        int commit_rows = 50;                   // Fixed target (or initial target when adaptive)
+        int commit_min_rows = 10;
+        int commit_max_rows = 2000;
+        int commit_max_interval_ms = 1000;      // Bounds how long readers (UI) can be blocked
+        float commit_target_overhead = 0.05f;   // Desired fraction of batch time spent in COMMIT
+        
+        // Background thumbnail stage
+        int thumbnail_threads = 2;
+        size_t thumbnail_max_queued_pixels = 16u << 20;  // Producer blocks beyond this
+        
+        // Parallel decode under a global memory budget
+        int decode_threads = 2;
+        int decode_max_ahead = 8;                        // Frames decoded ahead of detection
+        size_t decode_memory_budget_bytes = 1536u << 20; // Decoders block beyond this
+        size_t buffer_pool_max_bytes = 512u << 20;       // Idle pixel buffers kept for reuse
+    };
+    
+    struct Stats {
+        int images_processed = 0;
+        int images_failed = 0;
+        int faces_found = 0;
+        int near_duplicates_skipped = 0;  // Images whose detection was reused
+        int faces_reused = 0;
+        int faces_low_quality = 0;        // Stored without embedding (quality gate)
+        int faces_pending = 0;            // Stored with a deferred embedding
+        
+        // Commit batching
+        int commits = 0;
+        int64_t rows_committed = 0;
+        double commit_ms_total = 0.0;
+        double commit_ms_max = 0.0;
+        
+        // Memory
+        size_t peak_decoded_bytes = 0;   // Decoded frame bytes in flight (high-water mark)
+        double decode_blocked_ms = 0.0;  // Decoder time spent waiting on the budget
+        int64_t buffer_pool_hits = 0;
+        int64_t buffer_pool_misses = 0;
+        int64_t peak_rss_bytes = 0;      // Process high-water RSS
+        
+        double rows_per_commit() const {
+            return commits > 0 ? static_cast<double>(rows_committed) / commits : 0.0;
+        }
+        double avg_commit_ms() const {
+            return commits > 0 ? commit_ms_total / commits : 0.0;
+        }
+    };
+    
     // Progress callback: (current, total, file, faces_found)
     using ProgressCallback = std::function<void(
         int current, int total, 
@@ -28,22 +95,26 @@ public:
     Indexer(
         std::shared_ptr<IDatabase> database,
         std::shared_ptr<FaceService> face_service,
-        std::shared_ptr<ImageLoader> image_loader
+        std::shared_ptr<ImageLoader> image_loader,
+        const Config& config = {}
     );
     ~Indexer();
     
     /**
      * Process images and extract faces.
-     * @param image_paths List of image file paths
+     * Creates a persistent scan session so the run can be resumed.
+     * @param paths List of image file paths (duplicates are indexed once)
      * @param progress Optional progress callback
+     * @return ID of the scan session
      */
-    void index(
-        const std::vector<std::string>& image_paths,
+    int64_t index(
+        const std::vector<std::string>& paths,
         ProgressCallback progress = nullptr
     );
     
     /**
      * Resume from last checkpoint.
+     * Only files not yet committed by the interrupted run are processed.
      * @param scan_id ID of the scan session to resume
      * @param progress Optional progress callback
      */
@@ -56,6 +127,18 @@ public:
     // Thumbnail settings
     void set_thumbnail_dir(const std::string& dir);
     void set_thumbnail_size(int size);
+    
+    // Configuration
+    void set_config(const Config& config);
+    Config get_config() const;
+    
+    // Statistics for the last index() run
+    Stats get_stats() const;
+    
+    /**
+     * Snapshot brought up to date after each run (see EmbeddingSnapshot).
+     */
+    void set_embedding_snapshot(std::shared_ptr<EmbeddingSnapshot> snapshot);
 
 private:
     class Impl;
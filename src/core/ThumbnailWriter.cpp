@@ -0,0 +1,215 @@
+/**
+ * ThumbnailWriter implementation.
+ * Bounded producer/consumer queue with its own encoder threads.
+ */
+
+#include "ThumbnailWriter.h"
+#include "../services/ImageLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace facefling {
+
+namespace {
+
+struct ThumbnailJob {
+    Image crop;
+    std::string output_path;
+    
+    size_t pixels() const {
+        return static_cast<size_t>(crop.width) * crop.height;
+    }
+};
+
+// Copy a region out of image, box-downsampling by an integer factor so the
+// crop is at most ~2x the thumbnail size (enough for a smooth final scale)
+Image crop_region(const Image& image, const BoundingBox& region, int thumbnail_size) {
+    const int x0 = std::clamp(region.x, 0, image.width);
+    const int y0 = std::clamp(region.y, 0, image.height);
+    const int x1 = std::clamp(region.right(), x0, image.width);
+    const int y1 = std::clamp(region.bottom(), y0, image.height);
+    
+    const int src_w = x1 - x0;
+    const int src_h = y1 - y0;
+    const int channels = image.channels;
+    
+    const int factor = std::max(1, std::min(src_w, src_h) / std::max(1, thumbnail_size * 2));
+    
+    Image crop;
+    crop.channels = channels;
+    crop.width = src_w / factor;
+    crop.height = src_h / factor;
+    crop.data.resize(static_cast<size_t>(crop.width) * crop.height * channels);
+    
+    const size_t src_stride = static_cast<size_t>(image.width) * channels;
+    const unsigned char* src = image.data.data();
+    
+    if (factor == 1) {
+        const size_t row_bytes = static_cast<size_t>(crop.width) * channels;
+        for (int y = 0; y < crop.height; ++y) {
+            const unsigned char* row = src + (y0 + y) * src_stride + static_cast<size_t>(x0) * channels;
+            std::copy(row, row + row_bytes, crop.data.data() + y * row_bytes);
+        }
+        return crop;
+    }
+    
+    const int area = factor * factor;
+    std::vector<int> sums(channels);
+    for (int y = 0; y < crop.height; ++y) {
+        for (int x = 0; x < crop.width; ++x) {
+            std::fill(sums.begin(), sums.end(), 0);
+            for (int dy = 0; dy < factor; ++dy) {
+                const unsigned char* px = src + (y0 + y * factor + dy) * src_stride
+                                        + static_cast<size_t>(x0 + x * factor) * channels;
+                for (int dx = 0; dx < factor; ++dx, px += channels) {
+                    for (int c = 0; c < channels; ++c) {
+                        sums[c] += px[c];
+                    }
+                }
+            }
+            unsigned char* dst = crop.data.data() + (static_cast<size_t>(y) * crop.width + x) * channels;
+            for (int c = 0; c < channels; ++c) {
+                dst[c] = static_cast<unsigned char>(sums[c] / area);
+            }
+        }
+    }
+    return crop;
+}
+
+} // namespace
+
+class ThumbnailWriter::Impl {
+public:
+    std::shared_ptr<ImageLoader> image_loader;
+    Config config;
+    
+    mutable std::mutex mutex;
+    std::condition_variable work_available;   // Signals workers
+    std::condition_variable space_available;  // Signals blocked producers / flush()
+    std::deque<ThumbnailJob> queue;
+    size_t queued_pixels = 0;
+    int in_flight = 0;
+    bool stopping = false;
+    Stats stats;
+    
+    std::vector<std::thread> workers;
+    
+    void worker_loop() {
+        while (true) {
+            ThumbnailJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;  // Stopping and drained
+                }
+                job = std::move(queue.front());
+                queue.pop_front();
+                in_flight++;
+            }
+            
+            bool ok = true;
+            try {
+                BoundingBox full{0, 0, job.crop.width, job.crop.height};
+                image_loader->save_thumbnail(job.crop, full, job.output_path, config.thumbnail_size);
+            } catch (const std::exception& e) {
+                ok = false;
+                std::cerr << "[ThumbnailWriter] Failed to save thumbnail "
+                          << job.output_path << ": " << e.what() << std::endl;
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued_pixels -= job.pixels();
+                in_flight--;
+                if (ok) {
+                    stats.written++;
+                } else {
+                    stats.failed++;
+                }
+            }
+            space_available.notify_all();
+        }
+    }
+};
+
+ThumbnailWriter::ThumbnailWriter(std::shared_ptr<ImageLoader> image_loader, const Config& config)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->image_loader = image_loader;
+    m_impl->config = config;
+    
+    const int threads = std::max(1, config.threads);
+    for (int i = 0; i < threads; ++i) {
+        m_impl->workers.emplace_back([impl = m_impl.get()]() { impl->worker_loop(); });
+    }
+}
+
+ThumbnailWriter::~ThumbnailWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stopping = true;
+    }
+    m_impl->work_available.notify_all();
+    
+    for (auto& worker : m_impl->workers) {
+        worker.join();
+    }
+}
+
+void ThumbnailWriter::enqueue(const Image& image, const BoundingBox& region, const std::string& output_path)
+{
+    if (!image.is_valid() || region.width <= 0 || region.height <= 0) {
+        throw std::invalid_argument("Invalid thumbnail region");
+    }
+    
+    ThumbnailJob job;
+    job.crop = crop_region(image, region, m_impl->config.thumbnail_size);
+    job.output_path = output_path;
+    const size_t pixels = job.pixels();
+    
+    {
+        std::unique_lock<std::mutex> lock(m_impl->mutex);
+        
+        // Backpressure: wait for room, but always admit a job into an empty queue
+        auto has_room = [this, pixels]() {
+            return m_impl->queued_pixels == 0 ||
+                   m_impl->queued_pixels + pixels <= m_impl->config.max_queued_pixels;
+        };
+        if (!has_room()) {
+            const auto wait_start = std::chrono::steady_clock::now();
+            m_impl->space_available.wait(lock, has_room);
+            m_impl->stats.blocked_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - wait_start).count();
+        }
+        
+        m_impl->queued_pixels += pixels;
+        m_impl->stats.peak_queued_pixels = std::max(m_impl->stats.peak_queued_pixels, m_impl->queued_pixels);
+        m_impl->queue.push_back(std::move(job));
+    }
+    m_impl->work_available.notify_one();
+}
+
+void ThumbnailWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->space_available.wait(lock, [this]() {
+        return m_impl->queue.empty() && m_impl->in_flight == 0;
+    });
+}
+
+ThumbnailWriter::Stats ThumbnailWriter::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->stats;
+}
+
+} // namespace facefling
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "../models/Face.h"
+
+namespace facefling {
+
+// Forward declarations
+class ImageLoader;
+struct Image;
+
+/**
+ * Background stage that scales and encodes face thumbnails.
+ * Jobs carry only a small crop of the face region, so the decoded source
+ * image can be released as soon as the crops are taken.
+ */
+class ThumbnailWriter {
+public:
+    struct Config {
+        int threads = 2;                        // Encoder worker threads
+        size_t max_queued_pixels = 16u << 20;   // Backpressure limit on queued crop pixels
+        int thumbnail_size = 150;               // Output size (square)
+    };
+    
+    struct Stats {
+        int64_t written = 0;
+        int64_t failed = 0;
+        size_t peak_queued_pixels = 0;
+        double blocked_ms = 0.0;                // Time producers spent waiting on backpressure
+    };
+    
+    ThumbnailWriter(std::shared_ptr<ImageLoader> image_loader, const Config& config = {});
+    ~ThumbnailWriter();
+    
+    /**
+     * Queue a thumbnail of a region of image.
+     * Copies (and pre-shrinks) the region; blocks while the queue is over
+     * its pixel budget.
+     */
+    void enqueue(const Image& image, const BoundingBox& region, const std::string& output_path);
+    
+    /**
+     * Wait until every queued thumbnail has been written.
+     */
+    void flush();
+    
+    Stats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace facefling
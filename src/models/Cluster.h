@@ -17,6 +17,8 @@ struct Cluster {
     int face_count = 0;
     std::string created_date;
     std::optional<int64_t> person_id; // Set when user identifies this cluster
+    std::string embedding_model;      // Encoder of the embeddings the centroid averages
+    std::vector<float> prototypes;    // Member embeddings matched against (k x 128 packed; empty = centroid)
     
     // Populated on demand
     std::vector<Face> faces;
@@ -38,4 +40,25 @@ struct ClusterStats {
     int64_t representative_face_id = 0;
 };
 
+/**
+ * One entry of the cluster change feed (cluster_changes table), so views and
+ * indexes can apply deltas instead of reloading everything.
+ */
+struct ClusterChange {
+    enum class Type {
+        FaceMoved = 0,        // face_id left from_cluster_id for cluster_id (unset = no cluster)
+        ClusterCreated = 1,
+        ClusterDeleted = 2,
+        PersonAssigned = 3,   // cluster_id now belongs to person_id (unset = unassigned)
+        ClustersMerged = 4,   // from_cluster_id was merged into cluster_id (its faces with it)
+    };
+    
+    int64_t sequence = 0;     // Monotonic across the life of the database
+    Type type = Type::FaceMoved;
+    int64_t face_id = 0;
+    std::optional<int64_t> cluster_id;
+    std::optional<int64_t> from_cluster_id;
+    std::optional<int64_t> person_id;
+};
+
 } // namespace facefling
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <vector>
 #include <optional>
+#include <string>
+#include <utility>
 
 namespace facefling {
 
@@ -22,11 +24,58 @@ struct BoundingBox {
     int center_y() const { return y + height / 2; }
 };
 
+/**
+ * Geometry of the aligned 150x150 chip the embedding is computed from
+ * (dlib chip_details): a rectangle in image coordinates, rotated about
+ * its center. Lets embeddings be recomputed without re-running detection
+ * or the shape predictor.
+ */
+struct ChipGeometry {
+    float center_x = 0.0f;
+    float center_y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    float angle = 0.0f;  // Radians
+    
+    bool is_valid() const {
+        return width > 0.0f && height > 0.0f;
+    }
+};
+
 /**
  * Face embedding - 128-dimensional vector from dlib.
  */
 using FaceEmbedding = std::vector<float>;
 
+/**
+ * int8 form of a FaceEmbedding: value[i] ~= values[i] * scale.
+ * See EmbeddingQuantizer.
+ */
+struct QuantizedEmbedding {
+    std::vector<int8_t> values;
+    float scale = 0.0f;
+    int32_t norm_sq = 0;               // Sum of values[i]^2, cached for distances
+    
+    bool empty() const {
+        return values.empty();
+    }
+};
+
+/**
+ * Whether a face's embedding is usable for clustering.
+ */
+enum class EmbeddingState {
+    Ready = 0,       // Embedding computed
+    LowQuality = 1,  // Skipped: face below the quality threshold, no embedding
+    Pending = 2      // Deferred: computed later by the EmbeddingScheduler
+};
+
+/**
+ * Encoder that produced embeddings stored before model versions were
+ * recorded, and the default FaceService encoder.
+ */
+constexpr const char* kDefaultEmbeddingModel = "dlib_face_recognition_resnet_model_v1";
+
 /**
  * Represents a detected face in a photo.
  */
@@ -38,6 +87,12 @@ struct Face {
     std::optional<int64_t> cluster_id;
     std::optional<int64_t> person_id;
     float confidence = 0.0f;
+    float quality = 1.0f;              // Pose/sharpness score [0, 1]
+    EmbeddingState embedding_state = EmbeddingState::Ready;
+    std::vector<std::pair<int, int>> landmarks;  // 68 points (empty for faces indexed before landmarks were stored)
+    ChipGeometry chip;
+    std::string embedding_model;       // Encoder that produced the embedding (empty if none)
+    QuantizedEmbedding embedding_q;    // int8 copy of embedding (clustering read path)
     
     bool has_embedding() const {
         return embedding.size() == 128;
@@ -58,8 +113,12 @@ struct Face {
 struct FaceDetection {
     BoundingBox bbox;
     float confidence = 0.0f;
-    FaceEmbedding embedding;
+    float quality = 1.0f;              // Pose/sharpness score [0, 1]
+    FaceEmbedding embedding;           // Empty unless embedding_state is Ready
+    EmbeddingState embedding_state = EmbeddingState::Ready;
     std::vector<std::pair<int, int>> landmarks;  // 68 facial landmarks
+    ChipGeometry chip;                 // Aligned chip used for the embedding
+    std::string embedding_model;       // Set with the embedding
 };
 
 } // namespace facefling
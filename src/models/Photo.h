@@ -20,6 +20,7 @@ struct Photo {
     std::optional<std::string> exif_date;
     std::string scan_date;
     std::string checksum;
+    std::optional<uint64_t> phash;    // Perceptual hash (dHash) for near-duplicate lookup
     
     bool is_valid() const {
         return !file_path.empty();
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace facefling {
+
+/**
+ * Persistent indexing session, used to resume an interrupted scan.
+ */
+struct ScanSession {
+    // Values stored in scans.status
+    static constexpr const char* kRunning = "running";
+    static constexpr const char* kCancelled = "cancelled";
+    static constexpr const char* kInterrupted = "interrupted";
+    static constexpr const char* kCompleted = "completed";
+    
+    int64_t id = 0;
+    std::string root_path;
+    std::string start_date;
+    std::optional<std::string> end_date;
+    std::string status = kRunning;
+    int total_files = 0;
+    int processed_files = 0;          // Files taken off the work queue so far
+    int total_faces = 0;
+    
+    bool is_resumable() const {
+        return status != kCompleted;
+    }
+};
+
+/**
+ * State of a file in a scan's work queue (scan_queue.status).
+ */
+enum class ScanFileStatus {
+    Pending = 0,
+    Done = 1,
+    Failed = 2
+};
+
+} // namespace facefling
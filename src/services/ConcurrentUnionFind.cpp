@@ -0,0 +1,75 @@
+/**
+ * ConcurrentUnionFind implementation.
+ */
+
+#include "ConcurrentUnionFind.h"
+#include <utility>
+
+namespace facefling {
+
+ConcurrentUnionFind::ConcurrentUnionFind(size_t size)
+    : m_parent(size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        m_parent[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+    }
+}
+
+uint32_t ConcurrentUnionFind::find(uint32_t x)
+{
+    while (true) {
+        uint32_t parent = m_parent[x].load(std::memory_order_acquire);
+        if (parent == x) {
+            return x;
+        }
+        const uint32_t grandparent = m_parent[parent].load(std::memory_order_acquire);
+        if (grandparent != parent) {
+            // Path halving; losing the race to another writer is harmless
+            m_parent[x].compare_exchange_weak(parent, grandparent, std::memory_order_acq_rel);
+        }
+        x = grandparent;
+    }
+}
+
+bool ConcurrentUnionFind::unite(uint32_t a, uint32_t b)
+{
+    while (true) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return false;
+        }
+        if (a < b) {
+            std::swap(a, b);
+        }
+        
+        // Link the larger root below the smaller; fails if a stopped being a root
+        uint32_t expected = a;
+        if (m_parent[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+size_t ConcurrentUnionFind::size() const
+{
+    return m_parent.size();
+}
+
+std::vector<uint32_t> ConcurrentUnionFind::labels()
+{
+    const size_t n = size();
+    std::vector<uint32_t> mapping(n, UINT32_MAX);
+    std::vector<uint32_t> result(n);
+    uint32_t next = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t& label = mapping[find(static_cast<uint32_t>(i))];
+        if (label == UINT32_MAX) {
+            label = next++;
+        }
+        result[i] = label;
+    }
+    return result;
+}
+
+} // namespace facefling
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace facefling {
+
+/**
+ * Lock-free disjoint sets over indices 0..size-1.
+ * find() and unite() may be called from any number of threads at once.
+ * A root is always linked below a smaller root and path halving only moves
+ * pointers to smaller indices, so parents strictly decrease and the root of
+ * a set is its smallest member.
+ */
+class ConcurrentUnionFind {
+public:
+    explicit ConcurrentUnionFind(size_t size);
+    
+    uint32_t find(uint32_t x);
+    
+    /**
+     * Join the sets of a and b. @return true if they were separate
+     */
+    bool unite(uint32_t a, uint32_t b);
+    
+    size_t size() const;
+    
+    /**
+     * Set of every index, numbered 0.. in order of first appearance.
+     * Not safe while other threads are uniting.
+     */
+    std::vector<uint32_t> labels();
+
+private:
+    std::vector<std::atomic<uint32_t>> m_parent;
+};
+
+} // namespace facefling
@@ -3,8 +3,13 @@
  */
 
 #include "Database.h"
+#include "EmbeddingQuantizer.h"
 #include <sqlite3.h>
 #include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
@@ -52,6 +57,10 @@ public:
         sqlite3_bind_blob(m_stmt, index, data, size, SQLITE_TRANSIENT);
     }
     
+    void bind_zeroblob(int index, int size) {
+        sqlite3_bind_zeroblob(m_stmt, index, size);
+    }
+    
     void bind_null(int index) {
         sqlite3_bind_null(m_stmt, index);
     }
@@ -94,6 +103,67 @@ public:
     int64_t last_insert_rowid() {
         return sqlite3_last_insert_rowid(db);
     }
+    
+    // Schema migration helper for databases created by older versions
+    // @return true if the column was added
+    bool add_column_if_missing(const std::string& table, const std::string& column, const std::string& decl) {
+        {
+            Statement stmt(db, "PRAGMA table_info(" + table + ")");
+            while (stmt.step()) {
+                const unsigned char* name = sqlite3_column_text(stmt.get(), 1);
+                if (name && column == reinterpret_cast<const char*>(name)) {
+                    return false;
+                }
+            }
+        }
+        exec("ALTER TABLE " + table + " ADD COLUMN " + column + " " + decl);
+        return true;
+    }
+    
+    // Merged clusters whose faces still carry the old id (see merge_clusters).
+    // The table is small: compaction removes entries once faces are rewritten.
+    std::unordered_map<int64_t, int64_t> cluster_aliases() {
+        std::unordered_map<int64_t, int64_t> aliases;
+        Statement stmt(db, "SELECT id, alias_of FROM clusters WHERE alias_of IS NOT NULL");
+        while (stmt.step()) {
+            aliases.emplace(sqlite3_column_int64(stmt.get(), 0), sqlite3_column_int64(stmt.get(), 1));
+        }
+        return aliases;
+    }
+    
+    // Fill temp.face_selection with these ids, for set-based statements that
+    // join against it instead of running once per face
+    void select_faces(const std::vector<int64_t>& face_ids) {
+        exec("CREATE TEMP TABLE IF NOT EXISTS face_selection (id INTEGER PRIMARY KEY)");
+        exec("DELETE FROM temp.face_selection");
+        Statement stmt(db, "INSERT OR IGNORE INTO temp.face_selection (id) VALUES (?)");
+        for (int64_t face_id : face_ids) {
+            stmt.bind_int(1, face_id);
+            stmt.step();
+            stmt.reset();
+        }
+    }
+    
+    // Report faces of merged clusters under the cluster they were merged into
+    void resolve_clusters(std::vector<Face>& faces) {
+        const bool any = std::any_of(faces.begin(), faces.end(),
+                                     [](const Face& f) { return f.cluster_id.has_value(); });
+        if (!any) {
+            return;
+        }
+        const auto aliases = cluster_aliases();
+        if (aliases.empty()) {
+            return;
+        }
+        for (auto& face : faces) {
+            if (face.cluster_id.has_value()) {
+                auto it = aliases.find(*face.cluster_id);
+                if (it != aliases.end()) {
+                    face.cluster_id = it->second;
+                }
+            }
+        }
+    }
 };
 
 Database::Database(const std::string& db_path)
@@ -104,6 +174,12 @@ Database::Database(const std::string& db_path)
     if (sqlite3_open(db_path.c_str(), &m_impl->db) != SQLITE_OK) {
         throw std::runtime_error("Failed to open database: " + db_path);
     }
+    
+    // Background jobs (e.g. the embedding scheduler) write through their own
+    // connection; wait for the other writer's transaction instead of failing,
+    // and let readers proceed while it is open
+    sqlite3_busy_timeout(m_impl->db, 5000);
+    sqlite3_exec(m_impl->db, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr);
 }
 
 Database::~Database() = default;
@@ -121,7 +197,8 @@ void Database::initialize()
             file_size INTEGER,
             exif_date TEXT,
             scan_date TEXT NOT NULL,
-            checksum TEXT
+            checksum TEXT,
+            phash INTEGER
         );
         
         CREATE TABLE IF NOT EXISTS faces (
@@ -135,6 +212,12 @@ void Database::initialize()
             cluster_id INTEGER,
             person_id INTEGER,
             confidence REAL,
+            quality REAL,
+            embedding_state INTEGER NOT NULL DEFAULT 0,
+            landmarks BLOB,
+            chip BLOB,
+            embedding_model TEXT,
+            embedding_q BLOB,
             FOREIGN KEY (photo_id) REFERENCES photos(id),
             FOREIGN KEY (cluster_id) REFERENCES clusters(id),
             FOREIGN KEY (person_id) REFERENCES persons(id)
@@ -146,6 +229,9 @@ void Database::initialize()
             face_count INTEGER DEFAULT 0,
             created_date TEXT NOT NULL,
             person_id INTEGER,
+            embedding_model TEXT,
+            prototypes BLOB,
+            alias_of INTEGER,
             FOREIGN KEY (person_id) REFERENCES persons(id)
         );
         
@@ -167,13 +253,171 @@ void Database::initialize()
             total_faces INTEGER
         );
         
+        CREATE TABLE IF NOT EXISTS scan_queue (
+            scan_id INTEGER NOT NULL,
+            file_path TEXT NOT NULL,
+            status INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (scan_id, file_path),
+            FOREIGN KEY (scan_id) REFERENCES scans(id)
+        );
+        
         CREATE INDEX IF NOT EXISTS idx_faces_photo ON faces(photo_id);
         CREATE INDEX IF NOT EXISTS idx_faces_cluster ON faces(cluster_id);
         CREATE INDEX IF NOT EXISTS idx_faces_person ON faces(person_id);
         CREATE INDEX IF NOT EXISTS idx_photos_path ON photos(file_path);
+        CREATE INDEX IF NOT EXISTS idx_scan_queue_status ON scan_queue(scan_id, status);
     )";
     
     m_impl->exec(schema);
+    
+    // Columns added after the initial schema
+    m_impl->add_column_if_missing("photos", "phash", "INTEGER");
+    m_impl->add_column_if_missing("faces", "quality", "REAL");
+    m_impl->add_column_if_missing("faces", "embedding_state", "INTEGER NOT NULL DEFAULT 0");
+    m_impl->add_column_if_missing("faces", "landmarks", "BLOB");
+    m_impl->add_column_if_missing("faces", "chip", "BLOB");
+    
+    // Everything embedded before versions were recorded came from the default encoder
+    const std::string legacy_model = std::string("'") + kDefaultEmbeddingModel + "'";
+    if (m_impl->add_column_if_missing("faces", "embedding_model", "TEXT")) {
+        m_impl->exec("UPDATE faces SET embedding_model = " + legacy_model + " WHERE embedding_state = 0");
+    }
+    if (m_impl->add_column_if_missing("clusters", "embedding_model", "TEXT")) {
+        m_impl->exec("UPDATE clusters SET embedding_model = " + legacy_model + " WHERE centroid IS NOT NULL");
+    }
+    m_impl->add_column_if_missing("faces", "embedding_q", "BLOB");  // Older rows are quantized on read
+    m_impl->add_column_if_missing("clusters", "prototypes", "BLOB");  // Older clusters match on the centroid
+    m_impl->add_column_if_missing("clusters", "alias_of", "INTEGER");
+    m_impl->exec("CREATE INDEX IF NOT EXISTS idx_clusters_alias ON clusters(alias_of)");
+    m_impl->exec("CREATE INDEX IF NOT EXISTS idx_faces_embedding_state ON faces(embedding_state)");
+    
+    // Earlier versions kept the queues of completed scans
+    m_impl->exec("DELETE FROM scan_queue WHERE scan_id IN (SELECT id FROM scans WHERE status = 'completed')");
+    
+    // Counters validating embedding snapshots: the ready sequence orders
+    // rows as they become Ready, and each model's generation marks changes
+    // to rows a snapshot of it may already hold. Earlier versions bumped one
+    // generation on any embedding write, which forced a rewrite each time a
+    // deferred or re-embedded face became Ready.
+    m_impl->exec(R"(
+        CREATE TABLE IF NOT EXISTS meta (
+            key TEXT PRIMARY KEY,
+            value INTEGER NOT NULL
+        );
+        
+        INSERT OR IGNORE INTO meta (key, value) VALUES ('embedding_ready_sequence', 0);
+        
+        DROP TRIGGER IF EXISTS faces_embedding_changed;
+        DROP TRIGGER IF EXISTS faces_deleted;
+    )");
+    if (m_impl->add_column_if_missing("faces", "ready_sequence", "INTEGER")) {
+        // Existing Ready rows keep id order
+        m_impl->exec(R"(
+            UPDATE faces SET ready_sequence = id WHERE embedding_state = 0;
+            UPDATE meta SET value = (SELECT COALESCE(MAX(ready_sequence), 0) FROM faces)
+            WHERE key = 'embedding_ready_sequence';
+        )");
+    }
+    m_impl->exec(R"(
+        CREATE INDEX IF NOT EXISTS idx_faces_ready_sequence ON faces(ready_sequence);
+        
+        CREATE TRIGGER IF NOT EXISTS faces_inserted_ready
+        AFTER INSERT ON faces WHEN NEW.embedding_state = 0
+        BEGIN
+            UPDATE meta SET value = value + 1 WHERE key = 'embedding_ready_sequence';
+            UPDATE faces SET ready_sequence = (SELECT value FROM meta WHERE key = 'embedding_ready_sequence')
+            WHERE id = NEW.id;
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS faces_became_ready
+        AFTER UPDATE OF embedding, embedding_state, embedding_model ON faces
+        WHEN NEW.embedding_state = 0 AND (OLD.embedding_state != 0 OR
+             NEW.embedding_model IS NOT OLD.embedding_model OR NEW.embedding IS NOT OLD.embedding)
+        BEGIN
+            UPDATE meta SET value = value + 1 WHERE key = 'embedding_ready_sequence';
+            UPDATE faces SET ready_sequence = (SELECT value FROM meta WHERE key = 'embedding_ready_sequence')
+            WHERE id = NEW.id;
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS faces_ready_embedding_changed
+        AFTER UPDATE OF embedding, embedding_state, embedding_model ON faces
+        WHEN OLD.embedding_state = 0 AND (NEW.embedding_state != 0 OR
+             NEW.embedding_model IS NOT OLD.embedding_model OR NEW.embedding IS NOT OLD.embedding)
+        BEGIN
+            INSERT OR IGNORE INTO meta (key, value)
+            VALUES ('embedding_generation:' || COALESCE(OLD.embedding_model, ''), 0);
+            UPDATE meta SET value = value + 1
+            WHERE key = 'embedding_generation:' || COALESCE(OLD.embedding_model, '');
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS faces_ready_deleted
+        AFTER DELETE ON faces WHEN OLD.embedding_state = 0
+        BEGIN
+            INSERT OR IGNORE INTO meta (key, value)
+            VALUES ('embedding_generation:' || COALESCE(OLD.embedding_model, ''), 0);
+            UPDATE meta SET value = value + 1
+            WHERE key = 'embedding_generation:' || COALESCE(OLD.embedding_model, '');
+        END;
+    )");
+    
+    // Cluster change feed (see ClusterChange for the columns used by each type)
+    m_impl->exec(R"(
+        CREATE TABLE IF NOT EXISTS cluster_changes (
+            sequence INTEGER PRIMARY KEY AUTOINCREMENT,
+            type INTEGER NOT NULL,
+            face_id INTEGER,
+            cluster_id INTEGER,
+            from_cluster_id INTEGER,
+            person_id INTEGER
+        );
+        
+        CREATE TRIGGER IF NOT EXISTS faces_cluster_inserted
+        AFTER INSERT ON faces WHEN NEW.cluster_id IS NOT NULL
+        BEGIN
+            INSERT INTO cluster_changes (type, face_id, cluster_id) VALUES (0, NEW.id, NEW.cluster_id);
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS faces_cluster_changed
+        AFTER UPDATE OF cluster_id ON faces
+        WHEN OLD.cluster_id IS NOT NEW.cluster_id AND NOT EXISTS (
+            SELECT 1 FROM clusters WHERE id = OLD.cluster_id AND alias_of = NEW.cluster_id)
+        BEGIN
+            INSERT INTO cluster_changes (type, face_id, cluster_id, from_cluster_id)
+            VALUES (0, NEW.id, NEW.cluster_id,
+                    COALESCE((SELECT alias_of FROM clusters WHERE id = OLD.cluster_id), OLD.cluster_id));
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS faces_cluster_deleted
+        AFTER DELETE ON faces WHEN OLD.cluster_id IS NOT NULL
+        BEGIN
+            INSERT INTO cluster_changes (type, face_id, from_cluster_id)
+            VALUES (0, OLD.id, COALESCE((SELECT alias_of FROM clusters WHERE id = OLD.cluster_id), OLD.cluster_id));
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS clusters_created
+        AFTER INSERT ON clusters
+        BEGIN
+            INSERT INTO cluster_changes (type, cluster_id, person_id) VALUES (1, NEW.id, NEW.person_id);
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS clusters_deleted
+        AFTER DELETE ON clusters WHEN OLD.alias_of IS NULL
+        BEGIN
+            INSERT INTO cluster_changes (type, cluster_id) VALUES (2, OLD.id);
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS clusters_merged
+        AFTER UPDATE OF alias_of ON clusters WHEN OLD.alias_of IS NULL AND NEW.alias_of IS NOT NULL
+        BEGIN
+            INSERT INTO cluster_changes (type, cluster_id, from_cluster_id) VALUES (4, NEW.alias_of, NEW.id);
+        END;
+        
+        CREATE TRIGGER IF NOT EXISTS clusters_person_changed
+        AFTER UPDATE OF person_id ON clusters WHEN OLD.person_id IS NOT NEW.person_id
+        BEGIN
+            INSERT INTO cluster_changes (type, cluster_id, person_id) VALUES (3, NEW.id, NEW.person_id);
+        END;
+    )");
 }
 
 // ============================================================================
@@ -182,8 +426,8 @@ void Database::initialize()
 
 int64_t Database::insert_photo(const Photo& photo) {
     Statement stmt(m_impl->db, R"(
-        INSERT INTO photos (file_path, file_name, folder_path, width, height, file_size, exif_date, scan_date, checksum)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO photos (file_path, file_name, folder_path, width, height, file_size, exif_date, scan_date, checksum, phash)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )");
     
     stmt.bind_text(1, photo.file_path);
@@ -202,70 +446,64 @@ int64_t Database::insert_photo(const Photo& photo) {
     stmt.bind_text(8, photo.scan_date.empty() ? get_current_timestamp() : photo.scan_date);
     stmt.bind_text(9, photo.checksum);
     
+    if (photo.phash.has_value()) {
+        stmt.bind_int(10, static_cast<int64_t>(photo.phash.value()));
+    } else {
+        stmt.bind_null(10);
+    }
+    
     stmt.step();
     return m_impl->last_insert_rowid();
 }
 
-std::optional<Photo> Database::get_photo(int64_t id) {
-    Statement stmt(m_impl->db, "SELECT * FROM photos WHERE id = ?");
-    stmt.bind_int(1, id);
-    
-    if (!stmt.step()) {
-        return std::nullopt;
-    }
-    
+static Photo read_photo(sqlite3_stmt* stmt) {
     Photo photo;
-    photo.id = sqlite3_column_int64(stmt.get(), 0);
-    photo.file_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1));
-    photo.file_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 2));
-    photo.folder_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 3));
-    photo.width = sqlite3_column_int(stmt.get(), 4);
-    photo.height = sqlite3_column_int(stmt.get(), 5);
-    photo.file_size = sqlite3_column_int64(stmt.get(), 6);
+    photo.id = sqlite3_column_int64(stmt, 0);
+    photo.file_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    photo.file_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    photo.folder_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+    photo.width = sqlite3_column_int(stmt, 4);
+    photo.height = sqlite3_column_int(stmt, 5);
+    photo.file_size = sqlite3_column_int64(stmt, 6);
     
-    if (sqlite3_column_type(stmt.get(), 7) != SQLITE_NULL) {
-        photo.exif_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 7));
+    if (sqlite3_column_type(stmt, 7) != SQLITE_NULL) {
+        photo.exif_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
     }
     
-    if (sqlite3_column_text(stmt.get(), 8)) {
-        photo.scan_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 8));
+    if (sqlite3_column_text(stmt, 8)) {
+        photo.scan_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
     }
-    if (sqlite3_column_text(stmt.get(), 9)) {
-        photo.checksum = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 9));
+    if (sqlite3_column_text(stmt, 9)) {
+        photo.checksum = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+    }
+    
+    if (sqlite3_column_type(stmt, 10) != SQLITE_NULL) {
+        photo.phash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 10));
     }
     
     return photo;
 }
 
-std::optional<Photo> Database::get_photo_by_path(const std::string& path) {
-    Statement stmt(m_impl->db, "SELECT * FROM photos WHERE file_path = ?");
-    stmt.bind_text(1, path);
+std::optional<Photo> Database::get_photo(int64_t id) {
+    Statement stmt(m_impl->db, "SELECT * FROM photos WHERE id = ?");
+    stmt.bind_int(1, id);
     
     if (!stmt.step()) {
         return std::nullopt;
     }
     
-    Photo photo;
-    photo.id = sqlite3_column_int64(stmt.get(), 0);
-    photo.file_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1));
-    photo.file_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 2));
-    photo.folder_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 3));
-    photo.width = sqlite3_column_int(stmt.get(), 4);
-    photo.height = sqlite3_column_int(stmt.get(), 5);
-    photo.file_size = sqlite3_column_int64(stmt.get(), 6);
-    
-    if (sqlite3_column_type(stmt.get(), 7) != SQLITE_NULL) {
-        photo.exif_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 7));
-    }
+    return read_photo(stmt.get());
+}
+
+std::optional<Photo> Database::get_photo_by_path(const std::string& path) {
+    Statement stmt(m_impl->db, "SELECT * FROM photos WHERE file_path = ?");
+    stmt.bind_text(1, path);
     
-    if (sqlite3_column_text(stmt.get(), 8)) {
-        photo.scan_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 8));
-    }
-    if (sqlite3_column_text(stmt.get(), 9)) {
-        photo.checksum = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 9));
+    if (!stmt.step()) {
+        return std::nullopt;
     }
     
-    return photo;
+    return read_photo(stmt.get());
 }
 
 std::vector<Photo> Database::get_photos_for_person(int64_t person_id) {
@@ -273,33 +511,84 @@ std::vector<Photo> Database::get_photos_for_person(int64_t person_id) {
         SELECT DISTINCT p.* FROM photos p
         INNER JOIN faces f ON f.photo_id = p.id
         WHERE f.person_id = ?
+        ORDER BY p.id
     )");
     stmt.bind_int(1, person_id);
     
     std::vector<Photo> results;
     while (stmt.step()) {
-        Photo photo;
-        photo.id = sqlite3_column_int64(stmt.get(), 0);
-        photo.file_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1));
-        photo.file_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 2));
-        photo.folder_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 3));
-        photo.width = sqlite3_column_int(stmt.get(), 4);
-        photo.height = sqlite3_column_int(stmt.get(), 5);
-        photo.file_size = sqlite3_column_int64(stmt.get(), 6);
-        results.push_back(photo);
+        results.push_back(read_photo(stmt.get()));
+    }
+    
+    return results;
+}
+
+std::vector<Photo> Database::get_photos_for_cluster(int64_t cluster_id) {
+    Statement stmt(m_impl->db, R"(
+        SELECT DISTINCT p.* FROM photos p
+        INNER JOIN faces f ON f.photo_id = p.id
+        WHERE f.cluster_id = ?1 OR f.cluster_id IN (SELECT id FROM clusters WHERE alias_of = ?1)
+        ORDER BY p.id
+    )");
+    stmt.bind_int(1, cluster_id);
+    
+    std::vector<Photo> results;
+    while (stmt.step()) {
+        results.push_back(read_photo(stmt.get()));
     }
     
     return results;
 }
 
+std::vector<std::pair<int64_t, uint64_t>> Database::get_photo_hashes() {
+    Statement stmt(m_impl->db, "SELECT id, phash FROM photos WHERE phash IS NOT NULL");
+    
+    std::vector<std::pair<int64_t, uint64_t>> results;
+    while (stmt.step()) {
+        results.emplace_back(
+            sqlite3_column_int64(stmt.get(), 0),
+            static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 1))
+        );
+    }
+    return results;
+}
+
 // ============================================================================
 // Face operations
 // ============================================================================
 
+// Landmarks are stored as interleaved int16 (x, y) pairs: 272 bytes for 68 points
+static std::vector<int16_t> encode_landmarks(const std::vector<std::pair<int, int>>& landmarks) {
+    std::vector<int16_t> packed;
+    packed.reserve(landmarks.size() * 2);
+    for (const auto& [x, y] : landmarks) {
+        packed.push_back(static_cast<int16_t>(std::clamp(x, INT16_MIN, INT16_MAX)));
+        packed.push_back(static_cast<int16_t>(std::clamp(y, INT16_MIN, INT16_MAX)));
+    }
+    return packed;
+}
+
+static std::vector<std::pair<int, int>> decode_landmarks(const void* blob, int bytes) {
+    std::vector<int16_t> packed(bytes / sizeof(int16_t));
+    if (!packed.empty()) {
+        std::memcpy(packed.data(), blob, packed.size() * sizeof(int16_t));
+    }
+    
+    std::vector<std::pair<int, int>> landmarks;
+    landmarks.reserve(packed.size() / 2);
+    for (size_t i = 0; i + 1 < packed.size(); i += 2) {
+        landmarks.emplace_back(packed[i], packed[i + 1]);
+    }
+    return landmarks;
+}
+
+// Chip geometry is stored as 5 float32 values in ChipGeometry field order
+static constexpr int kChipFields = 5;
+
 int64_t Database::insert_face(const Face& face) {
     Statement stmt(m_impl->db, R"(
-        INSERT INTO faces (photo_id, bbox_x, bbox_y, bbox_width, bbox_height, embedding, cluster_id, person_id, confidence)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO faces (photo_id, bbox_x, bbox_y, bbox_width, bbox_height, embedding, cluster_id, person_id, confidence, quality, embedding_state, landmarks, chip, embedding_model, embedding_q)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )");
     
     stmt.bind_int(1, face.photo_id);
@@ -307,7 +596,11 @@ int64_t Database::insert_face(const Face& face) {
     stmt.bind_int(3, face.bbox.y);
     stmt.bind_int(4, face.bbox.width);
     stmt.bind_int(5, face.bbox.height);
-    stmt.bind_blob(6, face.embedding.data(), static_cast<int>(face.embedding.size() * sizeof(float)));
+    if (face.embedding.empty()) {
+        stmt.bind_zeroblob(6, 0);  // Column is NOT NULL; skipped faces store an empty blob
+    } else {
+        stmt.bind_blob(6, face.embedding.data(), static_cast<int>(face.embedding.size() * sizeof(float)));
+    }
     
     if (face.cluster_id.has_value()) {
         stmt.bind_int(7, face.cluster_id.value());
@@ -322,6 +615,37 @@ int64_t Database::insert_face(const Face& face) {
     }
     
     stmt.bind_double(9, face.confidence);
+    stmt.bind_double(10, face.quality);
+    stmt.bind_int(11, static_cast<int>(face.embedding_state));
+    
+    if (face.landmarks.empty()) {
+        stmt.bind_null(12);
+    } else {
+        auto packed = encode_landmarks(face.landmarks);
+        stmt.bind_blob(12, packed.data(), static_cast<int>(packed.size() * sizeof(int16_t)));
+    }
+    
+    if (face.chip.is_valid()) {
+        const float chip[kChipFields] = {
+            face.chip.center_x, face.chip.center_y, face.chip.width, face.chip.height, face.chip.angle
+        };
+        stmt.bind_blob(13, chip, static_cast<int>(sizeof(chip)));
+    } else {
+        stmt.bind_null(13);
+    }
+    
+    if (face.embedding_model.empty()) {
+        stmt.bind_null(14);
+    } else {
+        stmt.bind_text(14, face.embedding_model);
+    }
+    
+    if (face.embedding.empty()) {
+        stmt.bind_null(15);
+    } else {
+        auto code = EmbeddingQuantizer::encode(EmbeddingQuantizer::quantize(face.embedding));
+        stmt.bind_blob(15, code.data(), static_cast<int>(code.size()));
+    }
     
     stmt.step();
     return m_impl->last_insert_rowid();
@@ -355,6 +679,38 @@ static Face read_face(sqlite3_stmt* stmt) {
     
     face.confidence = static_cast<float>(sqlite3_column_double(stmt, 9));
     
+    if (sqlite3_column_type(stmt, 10) != SQLITE_NULL) {
+        face.quality = static_cast<float>(sqlite3_column_double(stmt, 10));
+    }
+    face.embedding_state = static_cast<EmbeddingState>(sqlite3_column_int(stmt, 11));
+    
+    const void* landmarks = sqlite3_column_blob(stmt, 12);
+    if (landmarks) {
+        face.landmarks = decode_landmarks(landmarks, sqlite3_column_bytes(stmt, 12));
+    }
+    
+    const void* chip = sqlite3_column_blob(stmt, 13);
+    if (chip && sqlite3_column_bytes(stmt, 13) == kChipFields * static_cast<int>(sizeof(float))) {
+        float fields[kChipFields];
+        std::memcpy(fields, chip, sizeof(fields));
+        face.chip.center_x = fields[0];
+        face.chip.center_y = fields[1];
+        face.chip.width = fields[2];
+        face.chip.height = fields[3];
+        face.chip.angle = fields[4];
+    }
+    
+    if (sqlite3_column_text(stmt, 14)) {
+        face.embedding_model = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 14));
+    }
+    
+    const void* code = sqlite3_column_blob(stmt, 15);
+    if (code) {
+        face.embedding_q = EmbeddingQuantizer::decode(code, sqlite3_column_bytes(stmt, 15));
+    } else if (!face.embedding.empty()) {
+        face.embedding_q = EmbeddingQuantizer::quantize(face.embedding);
+    }
+    
     return face;
 }
 
@@ -366,7 +722,9 @@ std::optional<Face> Database::get_face(int64_t id) {
         return std::nullopt;
     }
     
-    return read_face(stmt.get());
+    std::vector<Face> face{read_face(stmt.get())};
+    m_impl->resolve_clusters(face);
+    return face.front();
 }
 
 std::vector<Face> Database::get_faces_for_photo(int64_t photo_id) {
@@ -377,17 +735,23 @@ std::vector<Face> Database::get_faces_for_photo(int64_t photo_id) {
     while (stmt.step()) {
         results.push_back(read_face(stmt.get()));
     }
+    m_impl->resolve_clusters(results);
     return results;
 }
 
 std::vector<Face> Database::get_faces_for_cluster(int64_t cluster_id) {
-    Statement stmt(m_impl->db, "SELECT * FROM faces WHERE cluster_id = ?");
+    // Includes faces still carrying the id of a cluster merged into this one
+    Statement stmt(m_impl->db, R"(
+        SELECT * FROM faces
+        WHERE cluster_id = ?1 OR cluster_id IN (SELECT id FROM clusters WHERE alias_of = ?1)
+    )");
     stmt.bind_int(1, cluster_id);
     
     std::vector<Face> results;
     while (stmt.step()) {
         results.push_back(read_face(stmt.get()));
     }
+    m_impl->resolve_clusters(results);
     return results;
 }
 
@@ -399,36 +763,79 @@ std::vector<Face> Database::get_faces_for_person(int64_t person_id) {
     while (stmt.step()) {
         results.push_back(read_face(stmt.get()));
     }
+    m_impl->resolve_clusters(results);
     return results;
 }
 
 std::vector<Face> Database::get_all_faces_with_embeddings() {
-    Statement stmt(m_impl->db, "SELECT * FROM faces WHERE embedding IS NOT NULL");
+    Statement stmt(m_impl->db, "SELECT * FROM faces WHERE embedding_state = 0");
     
     std::vector<Face> results;
     while (stmt.step()) {
         results.push_back(read_face(stmt.get()));
     }
+    m_impl->resolve_clusters(results);
     return results;
 }
 
 std::vector<Face> Database::get_unclustered_faces() {
-    Statement stmt(m_impl->db, "SELECT * FROM faces WHERE cluster_id IS NULL AND embedding IS NOT NULL");
+    Statement stmt(m_impl->db, "SELECT * FROM faces WHERE cluster_id IS NULL AND embedding_state = 0");
     
     std::vector<Face> results;
     while (stmt.step()) {
         results.push_back(read_face(stmt.get()));
     }
+    m_impl->resolve_clusters(results);
     return results;
 }
 
 void Database::update_face_cluster(int64_t face_id, int64_t cluster_id) {
-    Statement stmt(m_impl->db, "UPDATE faces SET cluster_id = ? WHERE id = ?");
+    Statement stmt(m_impl->db, R"(
+        UPDATE faces SET cluster_id = COALESCE((SELECT alias_of FROM clusters WHERE id = ?1), ?1) WHERE id = ?2
+    )");
     stmt.bind_int(1, cluster_id);
     stmt.bind_int(2, face_id);
     stmt.step();
 }
 
+void Database::update_face_clusters(const std::vector<std::pair<int64_t, int64_t>>& assignments) {
+    Statement stmt(m_impl->db, R"(
+        UPDATE faces SET cluster_id = COALESCE((SELECT alias_of FROM clusters WHERE id = ?1), ?1) WHERE id = ?2
+    )");
+    for (const auto& [face_id, cluster_id] : assignments) {
+        stmt.bind_int(1, cluster_id);
+        stmt.bind_int(2, face_id);
+        stmt.step();
+        stmt.reset();
+    }
+}
+
+int Database::move_faces_to_cluster(const std::vector<int64_t>& face_ids, int64_t cluster_id) {
+    m_impl->select_faces(face_ids);
+    Statement stmt(m_impl->db, R"(
+        UPDATE faces SET cluster_id = COALESCE((SELECT alias_of FROM clusters WHERE id = ?1), ?1)
+        WHERE id IN (SELECT id FROM temp.face_selection)
+    )");
+    stmt.bind_int(1, cluster_id);
+    stmt.step();
+    return sqlite3_changes(m_impl->db);
+}
+
+std::vector<int64_t> Database::get_cluster_face_ids(int64_t cluster_id) {
+    Statement stmt(m_impl->db, R"(
+        SELECT id FROM faces
+        WHERE cluster_id = ?1 OR cluster_id IN (SELECT id FROM clusters WHERE alias_of = ?1)
+        ORDER BY id
+    )");
+    stmt.bind_int(1, cluster_id);
+    
+    std::vector<int64_t> ids;
+    while (stmt.step()) {
+        ids.push_back(sqlite3_column_int64(stmt.get(), 0));
+    }
+    return ids;
+}
+
 void Database::update_face_person(int64_t face_id, int64_t person_id) {
     Statement stmt(m_impl->db, "UPDATE faces SET person_id = ? WHERE id = ?");
     stmt.bind_int(1, person_id);
@@ -436,14 +843,182 @@ void Database::update_face_person(int64_t face_id, int64_t person_id) {
     stmt.step();
 }
 
+std::vector<Face> Database::get_pending_embedding_faces(int64_t after_photo_id, int limit) {
+    Statement stmt(m_impl->db, R"(
+        SELECT * FROM faces WHERE embedding_state = ? AND photo_id > ?
+        ORDER BY photo_id, id LIMIT ?
+    )");
+    stmt.bind_int(1, static_cast<int>(EmbeddingState::Pending));
+    stmt.bind_int(2, after_photo_id);
+    stmt.bind_int(3, limit);
+    
+    std::vector<Face> results;
+    while (stmt.step()) {
+        results.push_back(read_face(stmt.get()));
+    }
+    m_impl->resolve_clusters(results);
+    return results;
+}
+
+void Database::update_face_embedding(int64_t face_id, const FaceEmbedding& embedding,
+                                     const std::string& model) {
+    Statement stmt(m_impl->db, R"(
+        UPDATE faces SET embedding = ?, embedding_state = ?, embedding_model = ?, embedding_q = ?
+        WHERE id = ?
+    )");
+    auto code = EmbeddingQuantizer::encode(EmbeddingQuantizer::quantize(embedding));
+    stmt.bind_blob(1, embedding.data(), static_cast<int>(embedding.size() * sizeof(float)));
+    stmt.bind_int(2, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(3, model);
+    stmt.bind_blob(4, code.data(), static_cast<int>(code.size()));
+    stmt.bind_int(5, face_id);
+    stmt.step();
+}
+
+int Database::count_faces_in_state(EmbeddingState state) {
+    Statement stmt(m_impl->db, "SELECT COUNT(*) FROM faces WHERE embedding_state = ?");
+    stmt.bind_int(1, static_cast<int>(state));
+    return stmt.step() ? sqlite3_column_int(stmt.get(), 0) : 0;
+}
+
+std::vector<Face> Database::get_stale_embedding_faces(const std::string& model, int64_t after_photo_id, int limit) {
+    Statement stmt(m_impl->db, R"(
+        SELECT * FROM faces WHERE embedding_state = ? AND embedding_model IS NOT ? AND photo_id > ?
+        ORDER BY photo_id, id LIMIT ?
+    )");
+    stmt.bind_int(1, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(2, model);
+    stmt.bind_int(3, after_photo_id);
+    stmt.bind_int(4, limit);
+    
+    std::vector<Face> results;
+    while (stmt.step()) {
+        results.push_back(read_face(stmt.get()));
+    }
+    m_impl->resolve_clusters(results);
+    return results;
+}
+
+int Database::count_stale_embeddings(const std::string& model) {
+    Statement stmt(m_impl->db, "SELECT COUNT(*) FROM faces WHERE embedding_state = ? AND embedding_model IS NOT ?");
+    stmt.bind_int(1, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(2, model);
+    return stmt.step() ? sqlite3_column_int(stmt.get(), 0) : 0;
+}
+
+std::vector<Face> Database::get_quantized_faces(bool unclustered_only) {
+    // The float32 blob is only read for rows stored before codes existed
+    std::string sql = R"(
+        SELECT id, photo_id, cluster_id, embedding_model, embedding_q,
+               CASE WHEN embedding_q IS NULL THEN embedding END
+        FROM faces WHERE embedding_state = ?
+    )";
+    if (unclustered_only) {
+        sql += " AND cluster_id IS NULL";
+    }
+    Statement stmt(m_impl->db, sql);
+    stmt.bind_int(1, static_cast<int>(EmbeddingState::Ready));
+    
+    std::vector<Face> results;
+    while (stmt.step()) {
+        sqlite3_stmt* row = stmt.get();
+        Face face;
+        face.id = sqlite3_column_int64(row, 0);
+        face.photo_id = sqlite3_column_int64(row, 1);
+        if (sqlite3_column_type(row, 2) != SQLITE_NULL) {
+            face.cluster_id = sqlite3_column_int64(row, 2);
+        }
+        if (sqlite3_column_text(row, 3)) {
+            face.embedding_model = reinterpret_cast<const char*>(sqlite3_column_text(row, 3));
+        }
+        
+        const void* code = sqlite3_column_blob(row, 4);
+        const void* blob = sqlite3_column_blob(row, 5);
+        if (code) {
+            face.embedding_q = EmbeddingQuantizer::decode(code, sqlite3_column_bytes(row, 4));
+        } else if (blob) {
+            FaceEmbedding embedding(sqlite3_column_bytes(row, 5) / sizeof(float));
+            std::memcpy(embedding.data(), blob, embedding.size() * sizeof(float));
+            face.embedding_q = EmbeddingQuantizer::quantize(embedding);
+        }
+        results.push_back(std::move(face));
+    }
+    m_impl->resolve_clusters(results);
+    return results;
+}
+
+int64_t Database::get_embedding_generation(const std::string& model) {
+    Statement stmt(m_impl->db, "SELECT value FROM meta WHERE key = 'embedding_generation:' || ?");
+    stmt.bind_text(1, model);
+    return stmt.step() ? sqlite3_column_int64(stmt.get(), 0) : 0;
+}
+
+std::vector<ReadyEmbedding> Database::get_embeddings_page(
+    const std::string& model, int64_t after_sequence, int limit) {
+    Statement stmt(m_impl->db, R"(
+        SELECT id, ready_sequence, embedding FROM faces
+        WHERE ready_sequence > ? AND embedding_state = ? AND embedding_model = ?
+        ORDER BY ready_sequence LIMIT ?
+    )");
+    stmt.bind_int(1, after_sequence);
+    stmt.bind_int(2, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(3, model);
+    stmt.bind_int(4, limit);
+    
+    std::vector<ReadyEmbedding> results;
+    while (stmt.step()) {
+        ReadyEmbedding row;
+        row.face_id = sqlite3_column_int64(stmt.get(), 0);
+        row.sequence = sqlite3_column_int64(stmt.get(), 1);
+        row.embedding.resize(sqlite3_column_bytes(stmt.get(), 2) / sizeof(float));
+        if (!row.embedding.empty()) {
+            std::memcpy(row.embedding.data(), sqlite3_column_blob(stmt.get(), 2), row.embedding.size() * sizeof(float));
+        }
+        results.push_back(std::move(row));
+    }
+    return results;
+}
+
+std::vector<std::pair<int64_t, FaceEmbedding>> Database::get_embeddings(
+    const std::vector<int64_t>& face_ids, const std::string& model) {
+    m_impl->select_faces(face_ids);
+    Statement stmt(m_impl->db, R"(
+        SELECT id, embedding FROM faces
+        WHERE id IN (SELECT id FROM temp.face_selection) AND embedding_state = ? AND embedding_model = ?
+        ORDER BY id
+    )");
+    stmt.bind_int(1, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(2, model);
+    
+    std::vector<std::pair<int64_t, FaceEmbedding>> results;
+    while (stmt.step()) {
+        FaceEmbedding embedding(sqlite3_column_bytes(stmt.get(), 1) / sizeof(float));
+        if (!embedding.empty()) {
+            std::memcpy(embedding.data(), sqlite3_column_blob(stmt.get(), 1), embedding.size() * sizeof(float));
+        }
+        results.emplace_back(sqlite3_column_int64(stmt.get(), 0), std::move(embedding));
+    }
+    return results;
+}
+
+int Database::count_embeddings_after(const std::string& model, int64_t after_sequence) {
+    Statement stmt(m_impl->db, R"(
+        SELECT COUNT(*) FROM faces WHERE ready_sequence > ? AND embedding_state = ? AND embedding_model = ?
+    )");
+    stmt.bind_int(1, after_sequence);
+    stmt.bind_int(2, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(3, model);
+    return stmt.step() ? sqlite3_column_int(stmt.get(), 0) : 0;
+}
+
 // ============================================================================
 // Cluster operations
 // ============================================================================
 
 int64_t Database::insert_cluster(const Cluster& cluster) {
     Statement stmt(m_impl->db, R"(
-        INSERT INTO clusters (centroid, face_count, created_date, person_id)
-        VALUES (?, ?, ?, ?)
+        INSERT INTO clusters (centroid, face_count, created_date, person_id, embedding_model, prototypes)
+        VALUES (?, ?, ?, ?, ?, ?)
     )");
     
     if (!cluster.centroid.empty()) {
@@ -462,6 +1037,19 @@ int64_t Database::insert_cluster(const Cluster& cluster) {
         stmt.bind_null(4);
     }
     
+    if (cluster.embedding_model.empty()) {
+        stmt.bind_null(5);
+    } else {
+        stmt.bind_text(5, cluster.embedding_model);
+    }
+    
+    if (!cluster.prototypes.empty()) {
+        stmt.bind_blob(6, cluster.prototypes.data(),
+                      static_cast<int>(cluster.prototypes.size() * sizeof(float)));
+    } else {
+        stmt.bind_null(6);
+    }
+    
     stmt.step();
     return m_impl->last_insert_rowid();
 }
@@ -488,11 +1076,25 @@ static Cluster read_cluster(sqlite3_stmt* stmt) {
         cluster.person_id = sqlite3_column_int64(stmt, 4);
     }
     
+    if (sqlite3_column_text(stmt, 5)) {
+        cluster.embedding_model = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    }
+    
+    blob = sqlite3_column_blob(stmt, 6);
+    blob_bytes = sqlite3_column_bytes(stmt, 6);
+    if (blob && blob_bytes > 0) {
+        cluster.prototypes.resize(blob_bytes / sizeof(float));
+        std::memcpy(cluster.prototypes.data(), blob, blob_bytes);
+    }
+    
     return cluster;
 }
 
 std::optional<Cluster> Database::get_cluster(int64_t id) {
-    Statement stmt(m_impl->db, "SELECT * FROM clusters WHERE id = ?");
+    // A merged cluster's id reads as the cluster it was merged into
+    Statement stmt(m_impl->db, R"(
+        SELECT * FROM clusters WHERE id = COALESCE((SELECT alias_of FROM clusters WHERE id = ?1), ?1)
+    )");
     stmt.bind_int(1, id);
     
     if (!stmt.step()) {
@@ -503,7 +1105,7 @@ std::optional<Cluster> Database::get_cluster(int64_t id) {
 }
 
 std::vector<Cluster> Database::get_all_clusters() {
-    Statement stmt(m_impl->db, "SELECT * FROM clusters");
+    Statement stmt(m_impl->db, "SELECT * FROM clusters WHERE alias_of IS NULL");
     
     std::vector<Cluster> results;
     while (stmt.step()) {
@@ -512,29 +1114,176 @@ std::vector<Cluster> Database::get_all_clusters() {
     return results;
 }
 
-void Database::update_cluster_centroid(int64_t cluster_id, const std::vector<float>& centroid) {
-    Statement stmt(m_impl->db, "UPDATE clusters SET centroid = ? WHERE id = ?");
+void Database::update_cluster_centroid(int64_t cluster_id, const std::vector<float>& centroid,
+                                       const std::string& model) {
+    Statement stmt(m_impl->db, "UPDATE clusters SET centroid = ?, embedding_model = ? WHERE id = ?");
     stmt.bind_blob(1, centroid.data(), static_cast<int>(centroid.size() * sizeof(float)));
+    stmt.bind_text(2, model);
+    stmt.bind_int(3, cluster_id);
+    stmt.step();
+}
+
+void Database::update_cluster_prototypes(int64_t cluster_id, const std::vector<float>& prototypes) {
+    Statement stmt(m_impl->db, "UPDATE clusters SET prototypes = ? WHERE id = ?");
+    if (prototypes.empty()) {
+        stmt.bind_null(1);
+    } else {
+        stmt.bind_blob(1, prototypes.data(), static_cast<int>(prototypes.size() * sizeof(float)));
+    }
     stmt.bind_int(2, cluster_id);
     stmt.step();
 }
 
+void Database::update_cluster_person(int64_t cluster_id, std::optional<int64_t> person_id) {
+    Statement stmt(m_impl->db, "UPDATE clusters SET person_id = ? WHERE id = ?");
+    if (person_id.has_value()) {
+        stmt.bind_int(1, person_id.value());
+    } else {
+        stmt.bind_null(1);
+    }
+    stmt.bind_int(2, cluster_id);
+    stmt.step();
+}
+
+int Database::update_cluster_faces_person(int64_t cluster_id, std::optional<int64_t> person_id) {
+    Statement stmt(m_impl->db, R"(
+        UPDATE faces SET person_id = ?2
+        WHERE cluster_id = ?1 OR cluster_id IN (SELECT id FROM clusters WHERE alias_of = ?1)
+    )");
+    stmt.bind_int(1, cluster_id);
+    if (person_id.has_value()) {
+        stmt.bind_int(2, person_id.value());
+    } else {
+        stmt.bind_null(2);
+    }
+    stmt.step();
+    return sqlite3_changes(m_impl->db);
+}
+
 void Database::delete_cluster(int64_t cluster_id) {
-    // First unlink all faces from this cluster
+    // First unlink all faces from this cluster (and clusters merged into it)
     {
-        Statement stmt(m_impl->db, "UPDATE faces SET cluster_id = NULL WHERE cluster_id = ?");
+        Statement stmt(m_impl->db, R"(
+            UPDATE faces SET cluster_id = NULL
+            WHERE cluster_id = ?1 OR cluster_id IN (SELECT id FROM clusters WHERE alias_of = ?1)
+        )");
         stmt.bind_int(1, cluster_id);
         stmt.step();
     }
     
     // Then delete the cluster
     {
-        Statement stmt(m_impl->db, "DELETE FROM clusters WHERE id = ?");
+        Statement stmt(m_impl->db, "DELETE FROM clusters WHERE id = ?1 OR alias_of = ?1");
         stmt.bind_int(1, cluster_id);
         stmt.step();
     }
 }
 
+void Database::merge_clusters(int64_t into_cluster_id, int64_t from_cluster_id) {
+    // Clusters already merged into `from` are repointed too, so aliases stay one level deep
+    Statement stmt(m_impl->db, "UPDATE clusters SET alias_of = ?1 WHERE id = ?2 OR alias_of = ?2");
+    stmt.bind_int(1, into_cluster_id);
+    stmt.bind_int(2, from_cluster_id);
+    stmt.step();
+}
+
+int Database::compact_cluster_aliases(int limit) {
+    int rewritten = 0;
+    {
+        Statement stmt(m_impl->db, R"(
+            UPDATE faces SET cluster_id = (SELECT alias_of FROM clusters WHERE id = faces.cluster_id)
+            WHERE id IN (
+                SELECT faces.id FROM faces JOIN clusters ON clusters.id = faces.cluster_id
+                WHERE clusters.alias_of IS NOT NULL LIMIT ?
+            )
+        )");
+        stmt.bind_int(1, limit);
+        stmt.step();
+        rewritten = sqlite3_changes(m_impl->db);
+    }
+    
+    if (rewritten < limit) {
+        m_impl->exec(R"(
+            DELETE FROM clusters WHERE alias_of IS NOT NULL
+            AND NOT EXISTS (SELECT 1 FROM faces WHERE faces.cluster_id = clusters.id)
+        )");
+    }
+    return rewritten;
+}
+
+int Database::count_cluster_faces(int64_t cluster_id, const std::string& model) {
+    Statement stmt(m_impl->db, R"(
+        SELECT COUNT(*) FROM faces
+        WHERE (cluster_id = ?1 OR cluster_id IN (SELECT id FROM clusters WHERE alias_of = ?1))
+        AND embedding_state = ?2 AND embedding_model = ?3
+    )");
+    stmt.bind_int(1, cluster_id);
+    stmt.bind_int(2, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(3, model);
+    return stmt.step() ? sqlite3_column_int(stmt.get(), 0) : 0;
+}
+
+std::map<int64_t, int> Database::get_cluster_sizes(const std::string& model) {
+    Statement stmt(m_impl->db, R"(
+        SELECT cluster_id, COUNT(*) FROM faces
+        WHERE cluster_id IS NOT NULL AND embedding_state = ? AND embedding_model = ?
+        GROUP BY cluster_id
+    )");
+    stmt.bind_int(1, static_cast<int>(EmbeddingState::Ready));
+    stmt.bind_text(2, model);
+    
+    // Faces of merged clusters count towards the cluster they were merged into
+    const auto aliases = m_impl->cluster_aliases();
+    std::map<int64_t, int> sizes;
+    while (stmt.step()) {
+        const int64_t cluster_id = sqlite3_column_int64(stmt.get(), 0);
+        auto alias = aliases.find(cluster_id);
+        sizes[alias != aliases.end() ? alias->second : cluster_id] += sqlite3_column_int(stmt.get(), 1);
+    }
+    return sizes;
+}
+
+std::vector<ClusterChange> Database::get_cluster_changes(int64_t after_sequence, int limit) {
+    Statement stmt(m_impl->db, R"(
+        SELECT sequence, type, face_id, cluster_id, from_cluster_id, person_id
+        FROM cluster_changes WHERE sequence > ? ORDER BY sequence LIMIT ?
+    )");
+    stmt.bind_int(1, after_sequence);
+    stmt.bind_int(2, limit);
+    
+    auto optional_id = [&stmt](int column) -> std::optional<int64_t> {
+        if (sqlite3_column_type(stmt.get(), column) == SQLITE_NULL) {
+            return std::nullopt;
+        }
+        return sqlite3_column_int64(stmt.get(), column);
+    };
+    
+    std::vector<ClusterChange> changes;
+    while (stmt.step()) {
+        ClusterChange change;
+        change.sequence = sqlite3_column_int64(stmt.get(), 0);
+        change.type = static_cast<ClusterChange::Type>(sqlite3_column_int(stmt.get(), 1));
+        change.face_id = sqlite3_column_int64(stmt.get(), 2);
+        change.cluster_id = optional_id(3);
+        change.from_cluster_id = optional_id(4);
+        change.person_id = optional_id(5);
+        changes.push_back(change);
+    }
+    return changes;
+}
+
+int64_t Database::get_cluster_change_sequence() {
+    // Kept by AUTOINCREMENT, so trimming the log does not reset it
+    Statement stmt(m_impl->db, "SELECT seq FROM sqlite_sequence WHERE name = 'cluster_changes'");
+    return stmt.step() ? sqlite3_column_int64(stmt.get(), 0) : 0;
+}
+
+void Database::trim_cluster_changes(int64_t keep_latest) {
+    Statement stmt(m_impl->db, "DELETE FROM cluster_changes WHERE sequence <= ?");
+    stmt.bind_int(1, get_cluster_change_sequence() - keep_latest);
+    stmt.step();
+}
+
 // ============================================================================
 // Person operations
 // ============================================================================
@@ -632,6 +1381,126 @@ void Database::delete_person(int64_t person_id) {
     }
 }
 
+// ============================================================================
+// Scan session operations
+// ============================================================================
+
+int64_t Database::insert_scan(const ScanSession& scan) {
+    Statement stmt(m_impl->db, R"(
+        INSERT INTO scans (root_path, start_date, status, total_files, processed_files, total_faces)
+        VALUES (?, ?, ?, ?, ?, ?)
+    )");
+    
+    stmt.bind_text(1, scan.root_path);
+    stmt.bind_text(2, scan.start_date.empty() ? get_current_timestamp() : scan.start_date);
+    stmt.bind_text(3, scan.status);
+    stmt.bind_int(4, scan.total_files);
+    stmt.bind_int(5, scan.processed_files);
+    stmt.bind_int(6, scan.total_faces);
+    
+    stmt.step();
+    return m_impl->last_insert_rowid();
+}
+
+static ScanSession read_scan(sqlite3_stmt* stmt) {
+    ScanSession scan;
+    scan.id = sqlite3_column_int64(stmt, 0);
+    scan.root_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    scan.start_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    
+    if (sqlite3_column_type(stmt, 3) != SQLITE_NULL) {
+        scan.end_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+    }
+    
+    scan.status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    scan.total_files = sqlite3_column_int(stmt, 5);
+    scan.processed_files = sqlite3_column_int(stmt, 6);
+    scan.total_faces = sqlite3_column_int(stmt, 7);
+    
+    return scan;
+}
+
+std::optional<ScanSession> Database::get_scan(int64_t id) {
+    Statement stmt(m_impl->db, "SELECT * FROM scans WHERE id = ?");
+    stmt.bind_int(1, id);
+    
+    if (!stmt.step()) {
+        return std::nullopt;
+    }
+    
+    return read_scan(stmt.get());
+}
+
+std::vector<ScanSession> Database::get_resumable_scans() {
+    Statement stmt(m_impl->db, "SELECT * FROM scans WHERE status != ? ORDER BY id DESC");
+    stmt.bind_text(1, ScanSession::kCompleted);
+    
+    std::vector<ScanSession> results;
+    while (stmt.step()) {
+        results.push_back(read_scan(stmt.get()));
+    }
+    return results;
+}
+
+void Database::update_scan_progress(int64_t scan_id, int processed_files, int total_faces) {
+    Statement stmt(m_impl->db, "UPDATE scans SET processed_files = ?, total_faces = ? WHERE id = ?");
+    stmt.bind_int(1, processed_files);
+    stmt.bind_int(2, total_faces);
+    stmt.bind_int(3, scan_id);
+    stmt.step();
+}
+
+void Database::update_scan_status(int64_t scan_id, const std::string& status) {
+    Statement stmt(m_impl->db, "UPDATE scans SET status = ?, end_date = ? WHERE id = ?");
+    stmt.bind_text(1, status);
+    
+    if (status == ScanSession::kRunning) {
+        stmt.bind_null(2);
+    } else {
+        stmt.bind_text(2, get_current_timestamp());
+    }
+    
+    stmt.bind_int(3, scan_id);
+    stmt.step();
+    
+    // A completed scan is never resumed; its queue is only dead weight
+    if (status == ScanSession::kCompleted) {
+        Statement clear(m_impl->db, "DELETE FROM scan_queue WHERE scan_id = ?");
+        clear.bind_int(1, scan_id);
+        clear.step();
+    }
+}
+
+void Database::enqueue_scan_files(int64_t scan_id, const std::vector<std::string>& paths) {
+    Statement stmt(m_impl->db, "INSERT OR IGNORE INTO scan_queue (scan_id, file_path, status) VALUES (?, ?, 0)");
+    
+    for (const auto& path : paths) {
+        stmt.bind_int(1, scan_id);
+        stmt.bind_text(2, path);
+        stmt.step();
+        stmt.reset();
+    }
+}
+
+std::vector<std::string> Database::get_pending_scan_files(int64_t scan_id) {
+    Statement stmt(m_impl->db, "SELECT file_path FROM scan_queue WHERE scan_id = ? AND status = 0 ORDER BY rowid");
+    stmt.bind_int(1, scan_id);
+    
+    std::vector<std::string> results;
+    while (stmt.step()) {
+        results.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0)));
+    }
+    return results;
+}
+
+void Database::update_scan_file_status(int64_t scan_id, const std::string& path, ScanFileStatus status) {
+    Statement stmt(m_impl->db, "UPDATE scan_queue SET status = ? WHERE scan_id = ? AND file_path = ?");
+    stmt.bind_int(1, static_cast<int>(status));
+    stmt.bind_int(2, scan_id);
+    stmt.bind_text(3, path);
+    stmt.step();
+}
+
 // ============================================================================
 // Transaction operations
 // ============================================================================
@@ -3,15 +3,27 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <map>
 #include <memory>
 #include <cstdint>
+#include <utility>
 #include "../models/Photo.h"
 #include "../models/Face.h"
 #include "../models/Cluster.h"
 #include "../models/Person.h"
+#include "../models/Scan.h"
 
 namespace facefling {
 
+/**
+ * A Ready embedding and the sequence number it became Ready at.
+ */
+struct ReadyEmbedding {
+    int64_t face_id = 0;
+    int64_t sequence = 0;
+    FaceEmbedding embedding;
+};
+
 /**
  * Database interface for persistence.
  */
@@ -23,7 +35,9 @@ public:
     virtual int64_t insert_photo(const Photo& photo) = 0;
     virtual std::optional<Photo> get_photo(int64_t id) = 0;
     virtual std::optional<Photo> get_photo_by_path(const std::string& path) = 0;
-    virtual std::vector<Photo> get_photos_for_person(int64_t person_id) = 0;
+    virtual std::vector<Photo> get_photos_for_person(int64_t person_id) = 0;  // Ordered by id
+    virtual std::vector<Photo> get_photos_for_cluster(int64_t cluster_id) = 0;  // Including merged-in clusters; ordered by id
+    virtual std::vector<std::pair<int64_t, uint64_t>> get_photo_hashes() = 0;  // (photo_id, phash)
     
     // Faces
     virtual int64_t insert_face(const Face& face) = 0;
@@ -34,14 +48,66 @@ public:
     virtual std::vector<Face> get_all_faces_with_embeddings() = 0;
     virtual std::vector<Face> get_unclustered_faces() = 0;
     virtual void update_face_cluster(int64_t face_id, int64_t cluster_id) = 0;
+    // (face_id, cluster_id) pairs through one prepared statement
+    virtual void update_face_clusters(const std::vector<std::pair<int64_t, int64_t>>& assignments) = 0;
+    // Set-based: one statement for the whole set of faces. Returns rows changed.
+    virtual int move_faces_to_cluster(const std::vector<int64_t>& face_ids, int64_t cluster_id) = 0;
+    // Ids of all faces in a cluster (and clusters merged into it), ordered
+    virtual std::vector<int64_t> get_cluster_face_ids(int64_t cluster_id) = 0;
     virtual void update_face_person(int64_t face_id, int64_t person_id) = 0;
+    virtual std::vector<Face> get_pending_embedding_faces(int64_t after_photo_id, int limit) = 0;  // Ordered by photo
+    virtual void update_face_embedding(int64_t face_id, const FaceEmbedding& embedding,
+                                       const std::string& model) = 0;  // Marks Ready
+    virtual int count_faces_in_state(EmbeddingState state) = 0;
+    // Ready faces embedded by a model other than `model`, ordered by photo
+    virtual std::vector<Face> get_stale_embedding_faces(const std::string& model, int64_t after_photo_id, int limit) = 0;
+    virtual int count_stale_embeddings(const std::string& model) = 0;
+    // Ready faces with only id, photo_id, cluster_id, embedding_model and
+    // embedding_q filled: the float32 blob is not read
+    virtual std::vector<Face> get_quantized_faces(bool unclustered_only) = 0;
+    
+    // Embedding snapshot support (see EmbeddingSnapshot). A face takes the
+    // next ready sequence number whenever its embedding becomes Ready or is
+    // replaced, so rows that are new to a model (inserted, embedded late or
+    // re-embedded) can be appended in that order. A model's generation
+    // changes only when one of its Ready embeddings is modified, stops being
+    // Ready or is deleted.
+    virtual int64_t get_embedding_generation(const std::string& model) = 0;
+    // Ready faces from `model` with ready sequence > after_sequence, in sequence order
+    virtual std::vector<ReadyEmbedding> get_embeddings_page(
+        const std::string& model, int64_t after_sequence, int limit) = 0;
+    virtual int count_embeddings_after(const std::string& model, int64_t after_sequence) = 0;
+    // (face_id, embedding) of those face_ids that are Ready faces from `model`, ordered by id
+    virtual std::vector<std::pair<int64_t, FaceEmbedding>> get_embeddings(
+        const std::vector<int64_t>& face_ids, const std::string& model) = 0;
     
     // Clusters
     virtual int64_t insert_cluster(const Cluster& cluster) = 0;
     virtual std::optional<Cluster> get_cluster(int64_t id) = 0;
     virtual std::vector<Cluster> get_all_clusters() = 0;
-    virtual void update_cluster_centroid(int64_t cluster_id, const std::vector<float>& centroid) = 0;
+    virtual void update_cluster_centroid(int64_t cluster_id, const std::vector<float>& centroid,
+                                         const std::string& model) = 0;
+    virtual void update_cluster_prototypes(int64_t cluster_id, const std::vector<float>& prototypes) = 0;
+    virtual void update_cluster_person(int64_t cluster_id, std::optional<int64_t> person_id) = 0;
+    // Set (or clear) person_id on every face of a cluster in one statement; returns faces changed
+    virtual int update_cluster_faces_person(int64_t cluster_id, std::optional<int64_t> person_id) = 0;
     virtual void delete_cluster(int64_t cluster_id) = 0;
+    // Merge by alias: from_cluster's row points at into_cluster and its faces
+    // read as into_cluster's, without rewriting them. Compaction rewrites the
+    // faces in batches of up to limit; returns the number rewritten (0 = done).
+    virtual void merge_clusters(int64_t into_cluster_id, int64_t from_cluster_id) = 0;
+    virtual int compact_cluster_aliases(int limit) = 0;
+    // Ready faces from `model` in a cluster, including faces of clusters merged into it
+    virtual int count_cluster_faces(int64_t cluster_id, const std::string& model) = 0;
+    // cluster_id -> number of Ready faces from `model` (the faces its centroid averages)
+    virtual std::map<int64_t, int> get_cluster_sizes(const std::string& model) = 0;
+    
+    // Cluster change feed. Triggers log every membership, cluster and person
+    // assignment change with a monotonic sequence; the log is trimmed to its
+    // newest entries, so a reader whose next sequence is missing must reload.
+    virtual std::vector<ClusterChange> get_cluster_changes(int64_t after_sequence, int limit) = 0;
+    virtual int64_t get_cluster_change_sequence() = 0;  // Latest sequence (0 if none yet)
+    virtual void trim_cluster_changes(int64_t keep_latest) = 0;
     
     // Persons
     virtual int64_t insert_person(const Person& person) = 0;
@@ -50,6 +116,16 @@ public:
     virtual void update_person(const Person& person) = 0;
     virtual void delete_person(int64_t person_id) = 0;
     
+    // Scan sessions (resumable indexing)
+    virtual int64_t insert_scan(const ScanSession& scan) = 0;
+    virtual std::optional<ScanSession> get_scan(int64_t id) = 0;
+    virtual std::vector<ScanSession> get_resumable_scans() = 0;
+    virtual void update_scan_progress(int64_t scan_id, int processed_files, int total_faces) = 0;
+    virtual void update_scan_status(int64_t scan_id, const std::string& status) = 0;
+    virtual void enqueue_scan_files(int64_t scan_id, const std::vector<std::string>& paths) = 0;
+    virtual std::vector<std::string> get_pending_scan_files(int64_t scan_id) = 0;
+    virtual void update_scan_file_status(int64_t scan_id, const std::string& path, ScanFileStatus status) = 0;
+    
     // Transactions
     virtual void begin_transaction() = 0;
     virtual void commit() = 0;
@@ -72,6 +148,8 @@ public:
     std::optional<Photo> get_photo(int64_t id) override;
     std::optional<Photo> get_photo_by_path(const std::string& path) override;
     std::vector<Photo> get_photos_for_person(int64_t person_id) override;
+    std::vector<Photo> get_photos_for_cluster(int64_t cluster_id) override;
+    std::vector<std::pair<int64_t, uint64_t>> get_photo_hashes() override;
     
     int64_t insert_face(const Face& face) override;
     std::optional<Face> get_face(int64_t id) override;
@@ -81,13 +159,40 @@ public:
     std::vector<Face> get_all_faces_with_embeddings() override;
     std::vector<Face> get_unclustered_faces() override;
     void update_face_cluster(int64_t face_id, int64_t cluster_id) override;
+    void update_face_clusters(const std::vector<std::pair<int64_t, int64_t>>& assignments) override;
+    int move_faces_to_cluster(const std::vector<int64_t>& face_ids, int64_t cluster_id) override;
+    std::vector<int64_t> get_cluster_face_ids(int64_t cluster_id) override;
     void update_face_person(int64_t face_id, int64_t person_id) override;
+    std::vector<Face> get_pending_embedding_faces(int64_t after_photo_id, int limit) override;
+    void update_face_embedding(int64_t face_id, const FaceEmbedding& embedding,
+                               const std::string& model) override;
+    int count_faces_in_state(EmbeddingState state) override;
+    std::vector<Face> get_stale_embedding_faces(const std::string& model, int64_t after_photo_id, int limit) override;
+    int count_stale_embeddings(const std::string& model) override;
+    std::vector<Face> get_quantized_faces(bool unclustered_only) override;
+    int64_t get_embedding_generation(const std::string& model) override;
+    std::vector<ReadyEmbedding> get_embeddings_page(
+        const std::string& model, int64_t after_sequence, int limit) override;
+    int count_embeddings_after(const std::string& model, int64_t after_sequence) override;
+    std::vector<std::pair<int64_t, FaceEmbedding>> get_embeddings(
+        const std::vector<int64_t>& face_ids, const std::string& model) override;
     
     int64_t insert_cluster(const Cluster& cluster) override;
     std::optional<Cluster> get_cluster(int64_t id) override;
     std::vector<Cluster> get_all_clusters() override;
-    void update_cluster_centroid(int64_t cluster_id, const std::vector<float>& centroid) override;
+    void update_cluster_centroid(int64_t cluster_id, const std::vector<float>& centroid,
+                                 const std::string& model) override;
+    void update_cluster_prototypes(int64_t cluster_id, const std::vector<float>& prototypes) override;
+    void update_cluster_person(int64_t cluster_id, std::optional<int64_t> person_id) override;
+    int update_cluster_faces_person(int64_t cluster_id, std::optional<int64_t> person_id) override;
     void delete_cluster(int64_t cluster_id) override;
+    void merge_clusters(int64_t into_cluster_id, int64_t from_cluster_id) override;
+    int compact_cluster_aliases(int limit) override;
+    int count_cluster_faces(int64_t cluster_id, const std::string& model) override;
+    std::map<int64_t, int> get_cluster_sizes(const std::string& model) override;
+    std::vector<ClusterChange> get_cluster_changes(int64_t after_sequence, int limit) override;
+    int64_t get_cluster_change_sequence() override;
+    void trim_cluster_changes(int64_t keep_latest) override;
     
     int64_t insert_person(const Person& person) override;
     std::optional<Person> get_person(int64_t id) override;
@@ -95,6 +200,15 @@ public:
     void update_person(const Person& person) override;
     void delete_person(int64_t person_id) override;
     
+    int64_t insert_scan(const ScanSession& scan) override;
+    std::optional<ScanSession> get_scan(int64_t id) override;
+    std::vector<ScanSession> get_resumable_scans() override;
+    void update_scan_progress(int64_t scan_id, int processed_files, int total_faces) override;
+    void update_scan_status(int64_t scan_id, const std::string& status) override;
+    void enqueue_scan_files(int64_t scan_id, const std::vector<std::string>& paths) override;
+    std::vector<std::string> get_pending_scan_files(int64_t scan_id) override;
+    void update_scan_file_status(int64_t scan_id, const std::string& path, ScanFileStatus status) override;
+    
     void begin_transaction() override;
     void commit() override;
     void rollback() override;
@@ -0,0 +1,226 @@
+/**
+ * DistanceEngine implementation.
+ */
+
+#include "DistanceEngine.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace facefling {
+
+namespace {
+
+// Below this many multiply-adds a block is computed on the calling thread
+constexpr size_t kMinParallelWork = size_t(1) << 22;
+constexpr size_t kSinkBatch = 4096;         // Pairs handed to a PairSink at a time
+
+struct Tile {
+    size_t row_begin, row_end;
+    size_t col_begin, col_end;
+};
+
+std::vector<float> squared_norms(const float* x, size_t rows, size_t dims)
+{
+    std::vector<float> norms(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        const float* v = x + i * dims;
+        float sum = 0.0f;
+        for (size_t k = 0; k < dims; ++k) {
+            sum += v[k] * v[k];
+        }
+        norms[i] = sum;
+    }
+    return norms;
+}
+
+// Shared driver: computes each tile's squared distances and hands every
+// (i, j, d2) to emit(worker, i, j, d2). Tiles are claimed from an atomic
+// counter so uneven tiles (the triangular self case) balance out.
+template <typename Emit>
+void for_each_tile(const DistanceEngine::Config& config,
+                   const float* a, size_t n, const float* b, size_t m, size_t dims,
+                   bool upper_only, int workers, Emit emit)
+{
+    const size_t tile_rows = static_cast<size_t>(std::max(1, config.tile_rows));
+    const size_t tile_cols = static_cast<size_t>(std::max(1, config.tile_cols));
+    
+    std::vector<Tile> tiles;
+    for (size_t r = 0; r < n; r += tile_rows) {
+        for (size_t c = 0; c < m; c += tile_cols) {
+            const size_t r_end = std::min(n, r + tile_rows);
+            const size_t c_end = std::min(m, c + tile_cols);
+            if (upper_only && c_end <= r + 1) {
+                continue;  // Entirely on or below the diagonal
+            }
+            tiles.push_back({r, r_end, c, c_end});
+        }
+    }
+    
+    const std::vector<float> norms_a = squared_norms(a, n, dims);
+    const std::vector<float> norms_b = (a == b && n == m) ? norms_a : squared_norms(b, m, dims);
+    
+    std::atomic<size_t> next_tile{0};
+    auto run = [&](int worker) {
+        std::vector<float> packed(dims * tile_cols);
+        std::vector<float> dots(tile_cols);
+        
+        for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
+            const Tile& tile = tiles[t];
+            const size_t cols = tile.col_end - tile.col_begin;
+            
+            // Pack B's tile transposed: packed[k * cols + j] = b[col_begin + j][k]
+            for (size_t j = 0; j < cols; ++j) {
+                const float* src = b + (tile.col_begin + j) * dims;
+                for (size_t k = 0; k < dims; ++k) {
+                    packed[k * cols + j] = src[k];
+                }
+            }
+            
+            for (size_t i = tile.row_begin; i < tile.row_end; ++i) {
+                const float* row = a + i * dims;
+                float* acc = dots.data();
+                std::fill(acc, acc + cols, 0.0f);
+                for (size_t k = 0; k < dims; ++k) {
+                    const float aik = row[k];
+                    const float* bk = packed.data() + k * cols;
+                    for (size_t j = 0; j < cols; ++j) {
+                        acc[j] += aik * bk[j];
+                    }
+                }
+                
+                const size_t j_begin = upper_only ? std::max(tile.col_begin, i + 1) : tile.col_begin;
+                for (size_t j = j_begin; j < tile.col_end; ++j) {
+                    const size_t local = j - tile.col_begin;
+                    const float d2 = norms_a[i] + norms_b[j] - 2.0f * acc[local];
+                    emit(worker, i, j, std::max(0.0f, d2));
+                }
+            }
+        }
+    };
+    
+    if (workers <= 1 || tiles.size() <= 1) {
+        run(0);
+        return;
+    }
+    
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; ++w) {
+        threads.emplace_back(run, w);
+    }
+    run(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+int worker_count(const DistanceEngine::Config& config, size_t n, size_t m, size_t dims)
+{
+    if (n * m * dims < kMinParallelWork) {
+        return 1;
+    }
+    int threads = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, threads);
+}
+
+std::vector<DistanceEngine::Pair> collect_pairs(
+    const DistanceEngine::Config& config,
+    const float* a, size_t n, const float* b, size_t m, size_t dims,
+    float threshold, bool upper_only)
+{
+    const int workers = worker_count(config, n, m, dims);
+    const float limit = threshold * threshold;
+    
+    std::vector<std::vector<DistanceEngine::Pair>> found(static_cast<size_t>(workers));
+    for_each_tile(config, a, n, b, m, dims, upper_only, workers,
+        [&](int worker, size_t i, size_t j, float d2) {
+            if (d2 <= limit) {
+                found[static_cast<size_t>(worker)].push_back(
+                    {static_cast<uint32_t>(i), static_cast<uint32_t>(j), std::sqrt(d2)});
+            }
+        });
+    
+    std::vector<DistanceEngine::Pair> pairs;
+    for (auto& part : found) {
+        pairs.insert(pairs.end(), part.begin(), part.end());
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const auto& x, const auto& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    return pairs;
+}
+
+} // namespace
+
+DistanceEngine::DistanceEngine()
+    : m_config()
+{
+}
+
+DistanceEngine::DistanceEngine(const Config& config)
+    : m_config(config)
+{
+}
+
+std::vector<DistanceEngine::Pair> DistanceEngine::pairs_within(
+    const float* a, size_t n, const float* b, size_t m, size_t dims, float threshold) const
+{
+    return collect_pairs(m_config, a, n, b, m, dims, threshold, false);
+}
+
+std::vector<DistanceEngine::Pair> DistanceEngine::pairs_within(
+    const float* a, size_t n, size_t dims, float threshold) const
+{
+    return collect_pairs(m_config, a, n, a, n, dims, threshold, true);
+}
+
+void DistanceEngine::for_each_pair_within(
+    const float* a, size_t n, size_t dims, float threshold, const PairSink& sink) const
+{
+    const int workers = worker_count(m_config, n, n, dims);
+    const float limit = threshold * threshold;
+    
+    std::vector<std::vector<Pair>> batches(static_cast<size_t>(workers));
+    for_each_tile(m_config, a, n, a, n, dims, true, workers,
+        [&](int worker, size_t i, size_t j, float d2) {
+            if (d2 > limit) {
+                return;
+            }
+            auto& batch = batches[static_cast<size_t>(worker)];
+            batch.push_back({static_cast<uint32_t>(i), static_cast<uint32_t>(j), std::sqrt(d2)});
+            if (batch.size() >= kSinkBatch) {
+                sink(batch.data(), batch.size());
+                batch.clear();
+            }
+        });
+    
+    for (const auto& batch : batches) {
+        if (!batch.empty()) {
+            sink(batch.data(), batch.size());
+        }
+    }
+}
+
+void DistanceEngine::squared_distances(
+    const float* a, size_t n, const float* b, size_t m, size_t dims, float* out) const
+{
+    // Each (i, j) is written by exactly one tile, so workers never share a cell
+    for_each_tile(m_config, a, n, b, m, dims, false, worker_count(m_config, n, m, dims),
+        [out, m](int, size_t i, size_t j, float d2) {
+            out[i * m + j] = d2;
+        });
+}
+
+std::vector<float> DistanceEngine::pack(const std::vector<FaceEmbedding>& vectors, size_t dims)
+{
+    std::vector<float> matrix(vectors.size() * dims, 0.0f);
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        if (vectors[i].size() == dims) {
+            std::copy(vectors[i].begin(), vectors[i].end(), matrix.begin() + i * dims);
+        }
+    }
+    return matrix;
+}
+
+} // namespace facefling
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "../models/Face.h"
+
+namespace facefling {
+
+/**
+ * Blocked pairwise Euclidean distances between sets of embeddings.
+ * Distances come from ||a||^2 + ||b||^2 - 2 a.b, with the dot products
+ * computed tile by tile: each tile of B is packed transposed so the inner
+ * loop runs over contiguous columns and vectorizes without reassociating
+ * the sums. Tiles are spread over worker threads.
+ *
+ * Matrices are row-major, `dims` floats per row (see pack()).
+ */
+class DistanceEngine {
+public:
+    struct Config {
+        int threads = 0;        // Worker threads (0 = hardware concurrency)
+        int tile_rows = 64;     // Rows of A per tile
+        int tile_cols = 256;    // Rows of B per tile (packed transposed, 128 KB at 128 dims)
+    };
+    
+    // Sparse result: indices into A and B
+    struct Pair {
+        uint32_t a = 0;
+        uint32_t b = 0;
+        float distance = 0.0f;
+    };
+    
+    // Receives batches of pairs from for_each_pair_within()
+    using PairSink = std::function<void(const Pair* pairs, size_t count)>;
+    
+    DistanceEngine();
+    explicit DistanceEngine(const Config& config);
+    
+    /**
+     * All pairs with distance <= threshold, sorted by (a, b).
+     */
+    std::vector<Pair> pairs_within(const float* a, size_t n, const float* b, size_t m,
+                                   size_t dims, float threshold) const;
+    
+    /**
+     * Pairs within one set (a < b only), sorted by (a, b).
+     */
+    std::vector<Pair> pairs_within(const float* a, size_t n, size_t dims, float threshold) const;
+    
+    /**
+     * Pairs within one set (a < b) streamed to sink in batches instead of
+     * collected, for joins too large to hold. sink is called concurrently
+     * from the worker threads; pairs arrive in no particular order.
+     */
+    void for_each_pair_within(const float* a, size_t n, size_t dims, float threshold,
+                              const PairSink& sink) const;
+    
+    /**
+     * Dense n x m block of squared distances into out (row-major).
+     */
+    void squared_distances(const float* a, size_t n, const float* b, size_t m,
+                           size_t dims, float* out) const;
+    
+    /**
+     * Copy embeddings into one contiguous row-major matrix.
+     * Vectors of the wrong size become zero rows.
+     */
+    static std::vector<float> pack(const std::vector<FaceEmbedding>& vectors, size_t dims = 128);
+
+private:
+    Config m_config;
+};
+
+} // namespace facefling
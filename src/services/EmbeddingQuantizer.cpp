@@ -0,0 +1,105 @@
+/**
+ * EmbeddingQuantizer implementation.
+ */
+
+#include "EmbeddingQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace facefling {
+
+static constexpr float kMaxCode = 127.0f;
+
+QuantizedEmbedding EmbeddingQuantizer::quantize(const FaceEmbedding& embedding)
+{
+    QuantizedEmbedding code;
+    if (embedding.empty()) {
+        return code;
+    }
+    
+    float max_abs = 0.0f;
+    for (float v : embedding) {
+        max_abs = std::max(max_abs, std::fabs(v));
+    }
+    code.scale = max_abs > 0.0f ? max_abs / kMaxCode : 1.0f;
+    
+    code.values.resize(embedding.size());
+    int32_t norm_sq = 0;
+    for (size_t i = 0; i < embedding.size(); ++i) {
+        const float q = std::clamp(std::round(embedding[i] / code.scale), -kMaxCode, kMaxCode);
+        code.values[i] = static_cast<int8_t>(q);
+        norm_sq += static_cast<int32_t>(code.values[i]) * code.values[i];
+    }
+    code.norm_sq = norm_sq;
+    return code;
+}
+
+FaceEmbedding EmbeddingQuantizer::dequantize(const QuantizedEmbedding& code)
+{
+    FaceEmbedding embedding(code.values.size());
+    for (size_t i = 0; i < code.values.size(); ++i) {
+        embedding[i] = static_cast<float>(code.values[i]) * code.scale;
+    }
+    return embedding;
+}
+
+float EmbeddingQuantizer::distance(const QuantizedEmbedding& a, const QuantizedEmbedding& b)
+{
+    if (a.empty() || b.empty() || a.values.size() != b.values.size()) {
+        return std::numeric_limits<float>::infinity();
+    }
+    
+    // |sa*qa - sb*qb|^2 = sa^2 |qa|^2 + sb^2 |qb|^2 - 2 sa sb (qa . qb),
+    // with the dot product accumulated exactly in integers
+    const int8_t* qa = a.values.data();
+    const int8_t* qb = b.values.data();
+    int32_t dot = 0;
+    for (size_t i = 0; i < a.values.size(); ++i) {
+        dot += static_cast<int32_t>(qa[i]) * qb[i];
+    }
+    
+    const double sa = a.scale;
+    const double sb = b.scale;
+    const double sq = sa * sa * a.norm_sq + sb * sb * b.norm_sq - 2.0 * sa * sb * dot;
+    return static_cast<float>(std::sqrt(std::max(0.0, sq)));
+}
+
+float EmbeddingQuantizer::max_error(const QuantizedEmbedding& a, const QuantizedEmbedding& b)
+{
+    // Each code is within scale/2 of its vector per dimension; the distance
+    // moves by at most the norms of the two error vectors
+    const float root_n = std::sqrt(static_cast<float>(std::max(a.values.size(), b.values.size())));
+    return 0.5f * root_n * (a.scale + b.scale);
+}
+
+std::vector<unsigned char> EmbeddingQuantizer::encode(const QuantizedEmbedding& code)
+{
+    std::vector<unsigned char> bytes(sizeof(float) + code.values.size());
+    std::memcpy(bytes.data(), &code.scale, sizeof(float));
+    std::memcpy(bytes.data() + sizeof(float), code.values.data(), code.values.size());
+    return bytes;
+}
+
+QuantizedEmbedding EmbeddingQuantizer::decode(const void* data, int bytes)
+{
+    QuantizedEmbedding code;
+    if (!data || bytes <= static_cast<int>(sizeof(float))) {
+        return code;
+    }
+    
+    const unsigned char* src = static_cast<const unsigned char*>(data);
+    std::memcpy(&code.scale, src, sizeof(float));
+    code.values.resize(static_cast<size_t>(bytes) - sizeof(float));
+    std::memcpy(code.values.data(), src + sizeof(float), code.values.size());
+    
+    int32_t norm_sq = 0;
+    for (int8_t q : code.values) {
+        norm_sq += static_cast<int32_t>(q) * q;
+    }
+    code.norm_sq = norm_sq;
+    return code;
+}
+
+} // namespace facefling
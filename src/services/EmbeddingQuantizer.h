@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include "../models/Face.h"
+
+namespace facefling {
+
+/**
+ * Symmetric int8 quantization of face embeddings with a per-vector scale.
+ * A 128-d embedding shrinks from 512 bytes of float32 to a 132-byte code,
+ * and distances are computed on the integer codes directly. Rounding error
+ * is at most scale / 2 per dimension; callers re-rank pairs whose quantized
+ * distance lies close to a decision threshold against the float32 vectors.
+ */
+class EmbeddingQuantizer {
+public:
+    static QuantizedEmbedding quantize(const FaceEmbedding& embedding);
+    static FaceEmbedding dequantize(const QuantizedEmbedding& code);
+    
+    /**
+     * Euclidean distance between two codes (approximates
+     * FaceService::embedding_distance of the original vectors).
+     * Returns infinity if either code is empty or the dimensions differ.
+     */
+    static float distance(const QuantizedEmbedding& a, const QuantizedEmbedding& b);
+    
+    /**
+     * Worst-case |distance(a, b) - float32 distance| from rounding alone.
+     */
+    static float max_error(const QuantizedEmbedding& a, const QuantizedEmbedding& b);
+    
+    // Storage format: float32 scale followed by one int8 per dimension
+    static std::vector<unsigned char> encode(const QuantizedEmbedding& code);
+    static QuantizedEmbedding decode(const void* data, int bytes);
+};
+
+} // namespace facefling
@@ -0,0 +1,427 @@
+/**
+ * EmbeddingSnapshot implementation.
+ */
+
+#include "EmbeddingSnapshot.h"
+#include "Database.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace facefling {
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'F', 'E', 'M', 'B', 'S', 'N', 'P'};
+constexpr uint32_t kVersion = 2;            // 2: rows ordered by ready sequence
+constexpr size_t kModelChars = 64;
+constexpr size_t kHeaderBytes = 128;
+constexpr size_t kMatrixAlignment = 64;
+constexpr size_t kRowBytes = EmbeddingSnapshot::kDims * sizeof(float);
+constexpr int kPageRows = 16384;            // Rows fetched from the database at a time
+constexpr uint64_t kMinCapacity = 1024;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t dims;
+    uint64_t count;                         // Rows in use
+    uint64_t capacity;                      // Rows the file has room for
+    int64_t generation;                     // Database embedding generation of the model
+    int64_t last_sequence;                  // Highest ready sequence held
+    char model[kModelChars];
+};
+static_assert(sizeof(Header) <= kHeaderBytes, "Header must fit its reserved space");
+
+size_t ids_offset()
+{
+    return kHeaderBytes;
+}
+
+size_t matrix_offset(uint64_t capacity)
+{
+    const size_t end_of_ids = ids_offset() + capacity * sizeof(int64_t);
+    return (end_of_ids + kMatrixAlignment - 1) / kMatrixAlignment * kMatrixAlignment;
+}
+
+size_t file_bytes(uint64_t capacity)
+{
+    return matrix_offset(capacity) + capacity * kRowBytes;
+}
+
+// Room to append without rewriting
+uint64_t capacity_for(uint64_t rows)
+{
+    return std::max<uint64_t>(kMinCapacity, rows + rows / 4);
+}
+
+void write_at(int fd, const void* data, size_t bytes, size_t offset)
+{
+    const char* src = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = ::pwrite(fd, src, bytes, static_cast<off_t>(offset));
+        if (written < 0) {
+            throw std::runtime_error("Failed to write embedding snapshot");
+        }
+        src += written;
+        bytes -= static_cast<size_t>(written);
+        offset += static_cast<size_t>(written);
+    }
+}
+
+// Writes rows at the end of a file with the given header, from database pages
+// and/or an existing mapping. Updates header.count / last_sequence.
+class RowWriter {
+public:
+    RowWriter(int fd, Header& header) : m_fd(fd), m_header(header) {}
+    
+    void append(int64_t face_id, const float* row) {
+        const uint64_t index = m_header.count;
+        write_at(m_fd, &face_id, sizeof(face_id), ids_offset() + index * sizeof(int64_t));
+        write_at(m_fd, row, kRowBytes, matrix_offset(m_header.capacity) + index * kRowBytes);
+        m_header.count++;
+    }
+    
+    // Database rows with sequence > header.last_sequence; limited to max_rows
+    int64_t append_from(IDatabase& database, const std::string& model, uint64_t max_rows) {
+        int64_t appended = 0;
+        while (m_header.count < max_rows) {
+            const int limit = static_cast<int>(std::min<uint64_t>(kPageRows, max_rows - m_header.count));
+            auto page = database.get_embeddings_page(model, m_header.last_sequence, limit);
+            for (const auto& row : page) {
+                m_header.last_sequence = row.sequence;
+                if (row.embedding.size() != static_cast<size_t>(EmbeddingSnapshot::kDims)) {
+                    continue;
+                }
+                append(row.face_id, row.embedding.data());
+                appended++;
+            }
+            if (static_cast<int>(page.size()) < limit) {
+                break;
+            }
+        }
+        return appended;
+    }
+
+private:
+    int m_fd;
+    Header& m_header;
+};
+
+} // namespace
+
+class EmbeddingSnapshot::Impl {
+public:
+    std::string path;
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mapped_bytes = 0;
+    Stats stats;
+    std::mutex mutex;
+    std::vector<uint32_t> by_id;            // Rows ordered by face id; empty when they already are
+    
+    const Header* header() const {
+        return static_cast<const Header*>(mapping);
+    }
+    
+    const int64_t* ids() const {
+        return reinterpret_cast<const int64_t*>(static_cast<const char*>(mapping) + ids_offset());
+    }
+    
+    // Faces embedded late or re-embedded are appended after higher ids
+    void index_ids() {
+        by_id.clear();
+        const int64_t* row_ids = ids();
+        const uint64_t count = header()->count;
+        if (std::is_sorted(row_ids, row_ids + count)) {
+            return;
+        }
+        by_id.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            by_id[i] = i;
+        }
+        std::sort(by_id.begin(), by_id.end(),
+                  [row_ids](uint32_t a, uint32_t b) { return row_ids[a] < row_ids[b]; });
+    }
+    
+    void unmap() {
+        if (mapping) {
+            ::munmap(mapping, mapped_bytes);
+            mapping = nullptr;
+            mapped_bytes = 0;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    
+    bool map() {
+        unmap();
+        fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0) {
+            return false;
+        }
+        
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderBytes) {
+            unmap();
+            return false;
+        }
+        
+        mapped_bytes = static_cast<size_t>(st.st_size);
+        mapping = ::mmap(nullptr, mapped_bytes, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            unmap();
+            return false;
+        }
+        
+        const Header* h = header();
+        if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion ||
+            h->dims != static_cast<uint32_t>(kDims) || h->count > h->capacity ||
+            file_bytes(h->capacity) > mapped_bytes) {
+            std::cerr << "[EmbeddingSnapshot] Ignoring malformed snapshot: " << path << std::endl;
+            unmap();
+            return false;
+        }
+        index_ids();
+        return true;
+    }
+    
+    bool matches(int64_t generation, const std::string& model) const {
+        const Header* h = header();
+        return h && h->generation == generation &&
+               std::strncmp(h->model, model.c_str(), kModelChars) == 0;
+    }
+    
+    // Write a fresh file next to the old one and swap it in. Rows already
+    // mapped (if keep_rows) are carried over before the database rows.
+    void rewrite(IDatabase& database, const std::string& model, int64_t generation, bool keep_rows) {
+        const uint64_t kept = keep_rows ? header()->count : 0;
+        const int64_t after = keep_rows ? header()->last_sequence : 0;
+        const uint64_t rows = kept + static_cast<uint64_t>(database.count_embeddings_after(model, after));
+        
+        Header fresh{};
+        std::memcpy(fresh.magic, kMagic, sizeof(kMagic));
+        fresh.version = kVersion;
+        fresh.dims = kDims;
+        fresh.capacity = capacity_for(rows);
+        fresh.generation = generation;
+        std::strncpy(fresh.model, model.c_str(), kModelChars - 1);
+        
+        const std::string tmp_path = path + ".tmp";
+        int out = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) {
+            throw std::runtime_error("Failed to create embedding snapshot: " + tmp_path);
+        }
+        
+        try {
+            if (::ftruncate(out, static_cast<off_t>(file_bytes(fresh.capacity))) != 0) {
+                throw std::runtime_error("Failed to size embedding snapshot: " + tmp_path);
+            }
+            
+            RowWriter writer(out, fresh);
+            if (kept > 0) {
+                const Header* old = header();
+                const int64_t* ids = reinterpret_cast<const int64_t*>(
+                    static_cast<const char*>(mapping) + ids_offset());
+                const float* matrix = reinterpret_cast<const float*>(
+                    static_cast<const char*>(mapping) + matrix_offset(old->capacity));
+                for (uint64_t i = 0; i < kept; ++i) {
+                    writer.append(ids[i], matrix + i * kDims);
+                }
+                fresh.last_sequence = after;
+            }
+            stats.rows_appended = writer.append_from(database, model, fresh.capacity);
+            
+            // Header last: a torn write leaves no valid magic
+            write_at(out, &fresh, sizeof(fresh), 0);
+            ::fsync(out);
+        } catch (...) {
+            ::close(out);
+            std::remove(tmp_path.c_str());
+            throw;
+        }
+        ::close(out);
+        
+        unmap();
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to replace embedding snapshot: " + path);
+        }
+        if (!map()) {
+            throw std::runtime_error("Failed to map embedding snapshot: " + path);
+        }
+        stats.rebuilt = !keep_rows;
+    }
+    
+    // Append new database rows in place; false if they don't fit
+    bool append_in_place(IDatabase& database, const std::string& model) {
+        Header updated = *header();
+        const uint64_t incoming = static_cast<uint64_t>(
+            database.count_embeddings_after(model, updated.last_sequence));
+        if (incoming == 0) {
+            return true;
+        }
+        if (updated.count + incoming > updated.capacity) {
+            return false;
+        }
+        
+        RowWriter writer(fd, updated);
+        stats.rows_appended = writer.append_from(database, model, updated.capacity);
+        
+        // Rows first, then the header that makes them visible
+        ::fsync(fd);
+        write_at(fd, &updated, sizeof(updated), 0);
+        if (stats.rows_appended > 0) {
+            index_ids();
+        }
+        return true;
+    }
+};
+
+EmbeddingSnapshot::EmbeddingSnapshot(const std::string& path)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->path = path;
+}
+
+EmbeddingSnapshot::~EmbeddingSnapshot()
+{
+    m_impl->unmap();
+}
+
+bool EmbeddingSnapshot::open()
+{
+    return m_impl->map();
+}
+
+void EmbeddingSnapshot::close()
+{
+    m_impl->unmap();
+}
+
+bool EmbeddingSnapshot::is_open() const
+{
+    return m_impl->mapping != nullptr;
+}
+
+void EmbeddingSnapshot::sync(IDatabase& database, const std::string& model)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_impl->stats = Stats{};
+    
+    const int64_t generation = database.get_embedding_generation(model);
+    if (!is_open()) {
+        m_impl->map();
+    }
+    
+    if (!m_impl->matches(generation, model)) {
+        m_impl->rewrite(database, model, generation, false);
+    } else if (!m_impl->append_in_place(database, model)) {
+        // Out of spare capacity: carry the mapped rows into a larger file
+        m_impl->rewrite(database, model, generation, true);
+    }
+    
+    m_impl->stats.sync_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    if (m_impl->stats.rebuilt || m_impl->stats.rows_appended > 0) {
+        std::cout << "[EmbeddingSnapshot] " << (m_impl->stats.rebuilt ? "Rebuilt" : "Appended")
+                  << " " << m_impl->stats.rows_appended << " rows (" << size() << " total) in "
+                  << static_cast<int64_t>(m_impl->stats.sync_ms) << " ms" << std::endl;
+    }
+}
+
+bool EmbeddingSnapshot::is_current(IDatabase& database, const std::string& model) const
+{
+    if (!is_open() || !m_impl->matches(database.get_embedding_generation(model), model)) {
+        return false;
+    }
+    return database.count_embeddings_after(model, m_impl->header()->last_sequence) == 0;
+}
+
+std::mutex& EmbeddingSnapshot::mutex() const
+{
+    return m_impl->mutex;
+}
+
+size_t EmbeddingSnapshot::size() const
+{
+    return is_open() ? static_cast<size_t>(m_impl->header()->count) : 0;
+}
+
+const int64_t* EmbeddingSnapshot::face_ids() const
+{
+    if (!is_open()) {
+        return nullptr;
+    }
+    return m_impl->ids();
+}
+
+std::optional<size_t> EmbeddingSnapshot::find(int64_t face_id) const
+{
+    if (!is_open()) {
+        return std::nullopt;
+    }
+    const int64_t* ids = m_impl->ids();
+    const auto& by_id = m_impl->by_id;
+    if (by_id.empty()) {
+        const int64_t* end = ids + size();
+        const int64_t* it = std::lower_bound(ids, end, face_id);
+        if (it == end || *it != face_id) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(it - ids);
+    }
+    auto it = std::lower_bound(by_id.begin(), by_id.end(), face_id,
+                               [ids](uint32_t row, int64_t id) { return ids[row] < id; });
+    if (it == by_id.end() || ids[*it] != face_id) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+const float* EmbeddingSnapshot::matrix() const
+{
+    if (!is_open()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const float*>(
+        static_cast<const char*>(m_impl->mapping) + matrix_offset(m_impl->header()->capacity));
+}
+
+const float* EmbeddingSnapshot::row(size_t index) const
+{
+    return matrix() + index * kDims;
+}
+
+int64_t EmbeddingSnapshot::generation() const
+{
+    return is_open() ? m_impl->header()->generation : -1;
+}
+
+std::string EmbeddingSnapshot::model() const
+{
+    if (!is_open()) {
+        return {};
+    }
+    const char* name = m_impl->header()->model;
+    return std::string(name, strnlen(name, kModelChars));
+}
+
+EmbeddingSnapshot::Stats EmbeddingSnapshot::get_stats() const
+{
+    return m_impl->stats;
+}
+
+} // namespace facefling
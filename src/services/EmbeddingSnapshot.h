@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace facefling {
+
+// Forward declarations
+class IDatabase;
+
+/**
+ * Memory-mapped copy of all Ready embeddings of one model.
+ * Loading every embedding through SQLite means stepping row by row and
+ * copying each blob; the snapshot is a flat file (header, face_id array,
+ * 64-byte aligned N x 128 float matrix) that is mapped instead, so loading
+ * millions of embeddings costs a page-in.
+ *
+ * Rows are in the order faces became Ready. The file records the model's
+ * embedding generation and the last ready sequence it holds. sync() appends
+ * faces that became Ready since in place (the file keeps spare capacity) and
+ * rewrites the file when the generation or model no longer match. Not
+ * thread-safe by itself: when shared, hold mutex() across sync() and reads.
+ */
+class EmbeddingSnapshot {
+public:
+    static constexpr int kDims = 128;
+    
+    struct Stats {
+        bool rebuilt = false;       // Last sync rewrote the file
+        int64_t rows_appended = 0;  // Rows added by the last sync (including a rewrite)
+        double sync_ms = 0.0;
+    };
+    
+    explicit EmbeddingSnapshot(const std::string& path);
+    ~EmbeddingSnapshot();
+    
+    EmbeddingSnapshot(const EmbeddingSnapshot&) = delete;
+    EmbeddingSnapshot& operator=(const EmbeddingSnapshot&) = delete;
+    
+    /**
+     * Map the file as it is on disk, without consulting the database.
+     * @return false if the file is missing or malformed
+     */
+    bool open();
+    void close();
+    bool is_open() const;
+    
+    /**
+     * Bring the file up to date with the database and map it.
+     * Pointers from face_ids()/matrix() are invalidated.
+     */
+    void sync(IDatabase& database, const std::string& model);
+    
+    /**
+     * Whether the mapped file matches this database state (no rows missing).
+     */
+    bool is_current(IDatabase& database, const std::string& model) const;
+    
+    /**
+     * Serializes users sharing the snapshot (the indexer and the clusterer).
+     */
+    std::mutex& mutex() const;
+    
+    size_t size() const;
+    const int64_t* face_ids() const;  // Not sorted: see find()
+    std::optional<size_t> find(int64_t face_id) const;  // Row of a face
+    const float* matrix() const;    // size() x kDims, row-major
+    const float* row(size_t index) const;
+    
+    int64_t generation() const;
+    std::string model() const;
+    
+    Stats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace facefling
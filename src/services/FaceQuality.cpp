@@ -0,0 +1,67 @@
+/**
+ * FaceQuality implementation.
+ */
+
+#include "FaceQuality.h"
+#include <algorithm>
+#include <cmath>
+
+namespace facefling {
+
+// 68-point layout (iBUG 300-W): jaw 0-16, nose tip 30
+static constexpr size_t kNumLandmarks = 68;
+static constexpr size_t kJawLeft = 0;
+static constexpr size_t kJawRight = 16;
+static constexpr size_t kNoseTip = 30;
+
+float FaceQuality::pose_score(const std::vector<std::pair<int, int>>& landmarks)
+{
+    if (landmarks.size() != kNumLandmarks) {
+        return 1.0f;
+    }
+    
+    // Horizontal distance from the nose tip to each side of the jaw; equal for
+    // a frontal face, one side collapses towards zero as the head turns
+    const float left = static_cast<float>(landmarks[kNoseTip].first - landmarks[kJawLeft].first);
+    const float right = static_cast<float>(landmarks[kJawRight].first - landmarks[kNoseTip].first);
+    
+    const float larger = std::max(left, right);
+    if (larger <= 0.0f) {
+        return 0.0f;
+    }
+    return std::clamp(std::min(left, right) / larger, 0.0f, 1.0f);
+}
+
+double FaceQuality::laplacian_variance(const unsigned char* gray, int width, int height)
+{
+    if (gray == nullptr || width < 3 || height < 3) {
+        return 0.0;
+    }
+    
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (int y = 1; y < height - 1; ++y) {
+        const unsigned char* row = gray + static_cast<size_t>(y) * width;
+        const unsigned char* above = row - width;
+        const unsigned char* below = row + width;
+        for (int x = 1; x < width - 1; ++x) {
+            const double lap = static_cast<double>(above[x]) + below[x] + row[x - 1] + row[x + 1] - 4.0 * row[x];
+            sum += lap;
+            sum_sq += lap * lap;
+        }
+    }
+    
+    const double n = static_cast<double>(width - 2) * (height - 2);
+    const double mean = sum / n;
+    return std::max(0.0, sum_sq / n - mean * mean);
+}
+
+float FaceQuality::combine(float pose, double sharpness, double sharpness_reference)
+{
+    const double sharp = sharpness_reference > 0.0
+        ? std::min(1.0, sharpness / sharpness_reference)
+        : 1.0;
+    return static_cast<float>(std::clamp(static_cast<double>(pose), 0.0, 1.0) * sharp);
+}
+
+} // namespace facefling
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace facefling {
+
+/**
+ * Cheap face quality measures, computed before the embedding network runs.
+ * Faces that score low (extreme profile, heavy blur) produce unreliable
+ * embeddings that end up as single-face clusters, so they are stored
+ * without one.
+ */
+class FaceQuality {
+public:
+    /**
+     * Pose score from 68-point landmarks: 1 = frontal, 0 = full profile.
+     * Measures yaw as the balance of nose-tip distance to the two jaw ends.
+     * Returns 1 when landmarks are not the 68-point layout (no evidence).
+     */
+    static float pose_score(const std::vector<std::pair<int, int>>& landmarks);
+    
+    /**
+     * Variance of the 4-neighbour Laplacian over a grayscale image.
+     * Low values mean little high-frequency detail (blur).
+     */
+    static double laplacian_variance(const unsigned char* gray, int width, int height);
+    
+    /**
+     * Combined quality in [0, 1]: pose score scaled by sharpness relative to
+     * sharpness_reference (the Laplacian variance treated as fully sharp).
+     */
+    static float combine(float pose, double sharpness, double sharpness_reference);
+};
+
+} // namespace facefling
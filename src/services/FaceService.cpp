@@ -4,7 +4,11 @@
  */
 
 #include "FaceService.h"
+#include "FaceQuality.h"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <random>
 #include <stdexcept>
 #include <iostream>
 
@@ -48,10 +52,49 @@ using anet_type = dlib::loss_metric<dlib::fc_no_bias<128,dlib::avg_pool_everythi
     dlib::input_rgb_image_sized<150>
     >>>>>>>>>>>>;
 
+// ============================================================================
+// dlib MMOD network definition for CNN face detection
+// Matches mmod_human_face_detector.dat (dlib's dnn_mmod_face_detection example)
+// ============================================================================
+
+template <long num_filters, typename SUBNET> using con5d = dlib::con<num_filters,5,5,2,2,SUBNET>;
+template <long num_filters, typename SUBNET> using con5 = dlib::con<num_filters,5,5,1,1,SUBNET>;
+
+template <typename SUBNET> using downsampler = dlib::relu<dlib::affine<con5d<32,
+    dlib::relu<dlib::affine<con5d<32, dlib::relu<dlib::affine<con5d<16,SUBNET>>>>>>>>>;
+template <typename SUBNET> using rcon5 = dlib::relu<dlib::affine<con5<45,SUBNET>>>;
+
+using mmod_net_type = dlib::loss_mmod<dlib::con<1,9,9,1,1,rcon5<rcon5<rcon5<downsampler<
+    dlib::input_rgb_image_pyramid<dlib::pyramid_down<6>>
+    >>>>>>;
+
 // ============================================================================
 // FaceService::Impl - private implementation
 // ============================================================================
 
+namespace {
+
+// Smallest face the MMOD model reliably finds (its sliding window is ~40x40)
+constexpr double kMmodMinFaceSize = 40.0;
+
+// HOG detection window size; upsampling only helps faces smaller than this
+constexpr int kHogWindowSize = 80;
+
+// Both detectors score relative to a threshold of 0; map that onto (0, 1)
+// so 0.5 corresponds to the detector's own decision boundary
+float score_to_confidence(double score)
+{
+    return static_cast<float>(1.0 / (1.0 + std::exp(-score)));
+}
+
+double confidence_to_score(float confidence)
+{
+    const double c = std::clamp(static_cast<double>(confidence), 1e-6, 1.0 - 1e-6);
+    return std::log(c / (1.0 - c));
+}
+
+} // namespace
+
 class FaceService::Impl {
 public:
     Config config;
@@ -59,9 +102,26 @@ public:
     
     // dlib detectors and networks
     dlib::frontal_face_detector hog_detector;           // Fast HOG detector for fallback
+    mmod_net_type cnn_detector;                         // MMOD CNN detector (Cnn / Cascade)
     dlib::shape_predictor shape_predictor;              // 68-point landmark detector
     anet_type face_encoder;                              // ResNet face encoder
     
+    Stats stats;
+    std::mt19937 rng{0x5eed};                            // Cascade negative sampling
+    std::uniform_real_distribution<float> negative_sampler{0.0f, 1.0f};
+    
+    using Clock = std::chrono::steady_clock;
+    
+    // A detection in full-image coordinates with its mapped score
+    struct ScoredRect {
+        dlib::rectangle rect;
+        float confidence = 0.0f;
+    };
+    
+    static double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    
     // Converts our Image struct to dlib's rgb_image format
     dlib::matrix<dlib::rgb_pixel> to_dlib_image(const Image& image) {
         dlib::matrix<dlib::rgb_pixel> dlib_img(image.height, image.width);
@@ -96,6 +156,367 @@ public:
         }
         return landmarks;
     }
+    
+    // Aligned chip placement <-> stored ChipGeometry
+    static ChipGeometry to_geometry(const dlib::chip_details& details) {
+        const dlib::dpoint center = dlib::dcenter(details.rect);
+        ChipGeometry chip;
+        chip.center_x = static_cast<float>(center.x());
+        chip.center_y = static_cast<float>(center.y());
+        chip.width = static_cast<float>(details.rect.width());
+        chip.height = static_cast<float>(details.rect.height());
+        chip.angle = static_cast<float>(details.angle);
+        return chip;
+    }
+    
+    static dlib::chip_details from_geometry(const ChipGeometry& chip) {
+        const dlib::drectangle rect = dlib::centered_drect(
+            dlib::dpoint(chip.center_x, chip.center_y), chip.width, chip.height);
+        return dlib::chip_details(rect, dlib::chip_dims(150, 150), chip.angle);
+    }
+    
+    // Scale a rectangle found on a resized image back to the original and clip it
+    static dlib::rectangle unscale_rect(const dlib::rectangle& rect, double scale, const dlib::rectangle& bounds) {
+        dlib::rectangle out(
+            std::lround(rect.left() / scale),
+            std::lround(rect.top() / scale),
+            std::lround(rect.right() / scale),
+            std::lround(rect.bottom() / scale)
+        );
+        return out.intersect(bounds);
+    }
+    
+    bool passes_filters(const ScoredRect& det) const {
+        return !det.rect.is_empty() &&
+               static_cast<int>(det.rect.width()) >= config.min_face_size &&
+               static_cast<int>(det.rect.height()) >= config.min_face_size &&
+               det.confidence >= config.min_confidence;
+    }
+    
+    // HOG detection with SVM scores
+    std::vector<ScoredRect> detect_hog(const dlib::matrix<dlib::rgb_pixel>& img) {
+        const double threshold = confidence_to_score(config.min_confidence);
+        const int levels = config.min_face_size < kHogWindowSize ? std::max(0, config.upsample_count) : 0;
+        
+        std::vector<std::pair<double, dlib::rectangle>> dets;
+        if (levels == 0) {
+            hog_detector(img, dets, threshold);
+        } else {
+            dlib::matrix<dlib::rgb_pixel> upsampled = img;
+            for (int i = 0; i < levels; ++i) {
+                dlib::pyramid_up(upsampled);
+            }
+            hog_detector(upsampled, dets, threshold);
+        }
+        
+        const double scale = static_cast<double>(1 << levels);
+        const dlib::rectangle bounds = dlib::get_rect(img);
+        std::vector<ScoredRect> results;
+        for (const auto& [score, rect] : dets) {
+            ScoredRect det;
+            det.rect = unscale_rect(rect, scale, bounds);
+            det.confidence = score_to_confidence(score);
+            if (passes_filters(det)) {
+                results.push_back(det);
+            }
+        }
+        return results;
+    }
+    
+    // Scale at which an image is fed to the CNN: min_face_size maps to the
+    // smallest face the model finds, capped by cnn_max_dimension
+    double cnn_scale(const dlib::matrix<dlib::rgb_pixel>& img) const {
+        const double face_scale = kMmodMinFaceSize / std::max(1, config.min_face_size);
+        const double longest = static_cast<double>(std::max(img.nr(), img.nc()));
+        const double cap_scale = std::max(1, config.cnn_max_dimension) / longest;
+        return std::min(face_scale, cap_scale);
+    }
+    
+    // MMOD detection over several images. input_rgb_image_pyramid needs every
+    // image in a forward pass to have the same size, so each batch is scaled
+    // and letterboxed (top-left aligned, zero padding) onto a shared canvas.
+    // Inputs are batched largest-first so similarly sized ones share a canvas.
+    std::vector<std::vector<ScoredRect>> detect_cnn(const std::vector<const dlib::matrix<dlib::rgb_pixel>*>& imgs) {
+        std::vector<std::vector<ScoredRect>> results(imgs.size());
+        const double threshold = confidence_to_score(config.min_confidence);
+        const size_t batch_size = static_cast<size_t>(std::max(1, config.cnn_batch_size));
+        
+        std::vector<size_t> order(imgs.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const double scale_a = cnn_scale(*imgs[a]);
+            const double scale_b = cnn_scale(*imgs[b]);
+            return imgs[a]->size() * scale_a * scale_a > imgs[b]->size() * scale_b * scale_b;
+        });
+        
+        for (size_t start = 0; start < order.size(); start += batch_size) {
+            const size_t end = std::min(order.size(), start + batch_size);
+            
+            std::vector<double> scales;
+            std::vector<dlib::matrix<dlib::rgb_pixel>> scaled;
+            long canvas_rows = 0;
+            long canvas_cols = 0;
+            for (size_t j = start; j < end; ++j) {
+                const size_t i = order[j];
+                const double scale = cnn_scale(*imgs[i]);
+                dlib::matrix<dlib::rgb_pixel> resized(
+                    std::max(1L, std::lround(imgs[i]->nr() * scale)),
+                    std::max(1L, std::lround(imgs[i]->nc() * scale))
+                );
+                dlib::resize_image(*imgs[i], resized);
+                canvas_rows = std::max(canvas_rows, resized.nr());
+                canvas_cols = std::max(canvas_cols, resized.nc());
+                scales.push_back(scale);
+                scaled.push_back(std::move(resized));
+            }
+            
+            std::vector<dlib::matrix<dlib::rgb_pixel>> canvases;
+            canvases.reserve(scaled.size());
+            for (auto& resized : scaled) {
+                if (resized.nr() == canvas_rows && resized.nc() == canvas_cols) {
+                    canvases.push_back(std::move(resized));
+                    continue;
+                }
+                dlib::matrix<dlib::rgb_pixel> canvas(canvas_rows, canvas_cols);
+                dlib::assign_all_pixels(canvas, dlib::rgb_pixel(0, 0, 0));
+                dlib::set_subm(canvas, 0, 0, resized.nr(), resized.nc()) = resized;
+                canvases.push_back(std::move(canvas));
+                resized = dlib::matrix<dlib::rgb_pixel>();
+            }
+            
+            auto outputs = cnn_detector.process_batch(canvases, canvases.size(), threshold);
+            
+            for (size_t k = 0; k < outputs.size(); ++k) {
+                const size_t i = order[start + k];
+                const dlib::rectangle bounds = dlib::get_rect(*imgs[i]);
+                for (const auto& mmod : outputs[k]) {
+                    ScoredRect det;
+                    det.rect = unscale_rect(mmod.rect, scales[k], bounds);
+                    det.confidence = score_to_confidence(mmod.detection_confidence);
+                    if (passes_filters(det)) {
+                        results[i].push_back(det);
+                    }
+                }
+            }
+        }
+        return results;
+    }
+    
+    // Cascade pre-filter: permissive HOG on a downscaled copy, scaled so
+    // min_face_size fills the HOG window (capped by cascade_hog_max_dimension).
+    // Returns proposals in full-image coordinates.
+    std::vector<dlib::rectangle> propose_regions(const dlib::matrix<dlib::rgb_pixel>& img) {
+        const double longest = static_cast<double>(std::max(img.nr(), img.nc()));
+        const double face_scale = static_cast<double>(kHogWindowSize) / std::max(1, config.min_face_size);
+        const double cap_scale = std::max(1, config.cascade_hog_max_dimension) / longest;
+        const double scale = std::min({1.0, face_scale, cap_scale});
+        
+        std::vector<std::pair<double, dlib::rectangle>> dets;
+        const double threshold = confidence_to_score(config.cascade_candidate_confidence);
+        if (scale < 1.0) {
+            dlib::matrix<dlib::rgb_pixel> small(
+                std::max(1L, std::lround(img.nr() * scale)),
+                std::max(1L, std::lround(img.nc() * scale))
+            );
+            dlib::resize_image(img, small);
+            hog_detector(small, dets, threshold);
+        } else {
+            hog_detector(img, dets, threshold);
+        }
+        
+        const dlib::rectangle bounds = dlib::get_rect(img);
+        std::vector<dlib::rectangle> proposals;
+        for (const auto& det : dets) {
+            proposals.push_back(unscale_rect(det.second, scale, bounds));
+        }
+        return proposals;
+    }
+    
+    // Pad proposals by cascade_region_margin and merge overlapping ones, so
+    // each face is seen by exactly one CNN region
+    std::vector<dlib::rectangle> build_regions(const std::vector<dlib::rectangle>& proposals, const dlib::rectangle& bounds) const {
+        std::vector<dlib::rectangle> regions;
+        for (const auto& proposal : proposals) {
+            const long pad = std::lround(std::max(proposal.width(), proposal.height()) * config.cascade_region_margin);
+            regions.push_back(dlib::grow_rect(proposal, pad).intersect(bounds));
+        }
+        
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < regions.size() && !merged; ++i) {
+                for (size_t j = i + 1; j < regions.size(); ++j) {
+                    if (!regions[i].intersect(regions[j]).is_empty()) {
+                        regions[i] = regions[i] + regions[j];
+                        regions.erase(regions.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return regions;
+    }
+    
+    // CNN on proposed regions only, plus a sampled share of images without
+    // proposals (whole image) to measure what the pre-filter misses
+    std::vector<std::vector<ScoredRect>> detect_cascade(const std::vector<const dlib::matrix<dlib::rgb_pixel>*>& imgs) {
+        std::vector<std::vector<ScoredRect>> results(imgs.size());
+        
+        // A CNN input: a region crop, or a whole sampled negative image
+        struct Input {
+            size_t image;
+            dlib::point offset;
+            bool negative;
+        };
+        std::vector<Input> inputs;
+        std::vector<dlib::matrix<dlib::rgb_pixel>> crops;
+        std::vector<const dlib::matrix<dlib::rgb_pixel>*> cnn_imgs;
+        
+        auto hog_start = Clock::now();
+        for (size_t i = 0; i < imgs.size(); ++i) {
+            const auto regions = build_regions(propose_regions(*imgs[i]), dlib::get_rect(*imgs[i]));
+            if (regions.empty()) {
+                if (negative_sampler(rng) < config.cascade_negative_sample_rate) {
+                    inputs.push_back({i, dlib::point(0, 0), true});
+                    stats.negatives_sampled++;
+                }
+                continue;
+            }
+            stats.images_with_candidates++;
+            stats.candidate_regions += static_cast<int64_t>(regions.size());
+            for (const auto& region : regions) {
+                crops.push_back(dlib::subm(*imgs[i], region));
+                inputs.push_back({i, region.tl_corner(), false});
+            }
+        }
+        stats.hog_ms += elapsed_ms(hog_start);
+        
+        size_t next_crop = 0;
+        for (const auto& input : inputs) {
+            cnn_imgs.push_back(input.negative ? imgs[input.image] : &crops[next_crop++]);
+        }
+        
+        auto cnn_start = Clock::now();
+        auto outputs = detect_cnn(cnn_imgs);
+        stats.cnn_ms += elapsed_ms(cnn_start);
+        
+        for (size_t k = 0; k < inputs.size(); ++k) {
+            const Input& input = inputs[k];
+            if (input.negative) {
+                if (!outputs[k].empty()) {
+                    stats.negatives_with_faces++;
+                    stats.faces_in_negatives += static_cast<int64_t>(outputs[k].size());
+                }
+            } else if (!outputs[k].empty()) {
+                stats.regions_confirmed++;
+            }
+            for (auto det : outputs[k]) {
+                det.rect = dlib::translate_rect(det.rect, input.offset);
+                results[input.image].push_back(det);
+            }
+        }
+        return results;
+    }
+    
+    std::vector<std::vector<ScoredRect>> detect(const std::vector<const dlib::matrix<dlib::rgb_pixel>*>& imgs) {
+        stats.images += static_cast<int64_t>(imgs.size());
+        
+        if (config.detector == Detector::Cascade) {
+            return detect_cascade(imgs);
+        }
+        
+        auto start = Clock::now();
+        std::vector<std::vector<ScoredRect>> results;
+        if (config.detector == Detector::Cnn) {
+            results = detect_cnn(imgs);
+            stats.cnn_ms += elapsed_ms(start);
+        } else {
+            results.reserve(imgs.size());
+            for (const auto* img : imgs) {
+                results.push_back(detect_hog(*img));
+            }
+            stats.hog_ms += elapsed_ms(start);
+        }
+        return results;
+    }
+    
+    // Pose and sharpness of an aligned chip, before it reaches the encoder
+    float chip_quality(const dlib::matrix<dlib::rgb_pixel>& chip, const std::vector<std::pair<int, int>>& landmarks) const {
+        std::vector<unsigned char> gray(static_cast<size_t>(chip.size()));
+        for (long y = 0; y < chip.nr(); ++y) {
+            for (long x = 0; x < chip.nc(); ++x) {
+                const dlib::rgb_pixel& p = chip(y, x);
+                gray[static_cast<size_t>(y * chip.nc() + x)] =
+                    static_cast<unsigned char>((p.red * 299 + p.green * 587 + p.blue * 114) / 1000);
+            }
+        }
+        
+        const double sharpness = FaceQuality::laplacian_variance(
+            gray.data(), static_cast<int>(chip.nc()), static_cast<int>(chip.nr()));
+        return FaceQuality::combine(FaceQuality::pose_score(landmarks), sharpness, config.sharpness_reference);
+    }
+    
+    // Landmarks and embeddings for the detections of one image.
+    // Faces below min_quality keep their landmarks but get no embedding;
+    // the rest are encoded in batches of embedding_batch_size, or marked
+    // Pending when embed is false.
+    std::vector<FaceDetection> describe(const dlib::matrix<dlib::rgb_pixel>& img, const std::vector<ScoredRect>& dets, bool embed) {
+        std::vector<FaceDetection> results;
+        std::vector<dlib::matrix<dlib::rgb_pixel>> chips;
+        std::vector<size_t> chip_owners;  // Index into results for each chip
+        results.reserve(dets.size());
+        chips.reserve(dets.size());
+        
+        for (const auto& det : dets) {
+            // Get facial landmarks
+            dlib::full_object_detection shape = shape_predictor(img, det.rect);
+            
+            // Extract aligned face chip for embedding
+            const dlib::chip_details details = dlib::get_face_chip_details(shape, 150, 0.25);
+            dlib::matrix<dlib::rgb_pixel> face_chip;
+            dlib::extract_image_chip(img, details, face_chip);
+            
+            FaceDetection detection;
+            detection.bbox = rect_to_bbox(det.rect);
+            detection.confidence = det.confidence;
+            detection.landmarks = extract_landmarks(shape);
+            detection.chip = to_geometry(details);
+            detection.quality = chip_quality(face_chip, detection.landmarks);
+            
+            if (detection.quality < config.min_quality) {
+                detection.embedding_state = EmbeddingState::LowQuality;
+                stats.faces_low_quality++;
+            } else if (!embed) {
+                detection.embedding_state = EmbeddingState::Pending;
+            } else {
+                chip_owners.push_back(results.size());
+                chips.push_back(std::move(face_chip));
+            }
+            results.push_back(std::move(detection));
+        }
+        
+        if (chips.empty()) {
+            return results;
+        }
+        
+        // Compute 128-dimensional face embeddings
+        const size_t batch_size = static_cast<size_t>(std::max(1, config.embedding_batch_size));
+        std::vector<dlib::matrix<float, 0, 1>> descriptors = face_encoder(chips, batch_size);
+        
+        // Convert dlib embeddings to std::vector<float>
+        for (size_t k = 0; k < chip_owners.size(); ++k) {
+            results[chip_owners[k]].embedding_model = config.embedding_model;
+            FaceEmbedding& embedding = results[chip_owners[k]].embedding;
+            embedding.resize(128);
+            for (int j = 0; j < 128; ++j) {
+                embedding[j] = descriptors[k](j);
+            }
+        }
+        return results;
+    }
 };
 
 // ============================================================================
@@ -121,20 +542,31 @@ void FaceService::initialize()
     try {
         std::cout << "[FaceService] Loading HOG face detector..." << std::endl;
         m_impl->hog_detector = dlib::get_frontal_face_detector();
+        if (m_impl->config.upsample_count > 0 && m_impl->config.min_face_size >= kHogWindowSize) {
+            std::cout << "[FaceService] upsample_count ignored: faces of min_face_size "
+                      << m_impl->config.min_face_size << " fill the " << kHogWindowSize
+                      << "px HOG window" << std::endl;
+        }
+        
+        if (m_impl->config.detector != Detector::Hog) {
+            std::cout << "[FaceService] Loading CNN face detector from: "
+                      << model_dir + "/mmod_human_face_detector.dat" << std::endl;
+            dlib::deserialize(model_dir + "/mmod_human_face_detector.dat")
+                >> m_impl->cnn_detector;
+        }
         
         std::cout << "[FaceService] Loading shape predictor from: " 
                   << model_dir + "/shape_predictor_68_face_landmarks.dat" << std::endl;
         dlib::deserialize(model_dir + "/shape_predictor_68_face_landmarks.dat") 
             >> m_impl->shape_predictor;
         
-        std::cout << "[FaceService] Loading face encoder from: "
-                  << model_dir + "/dlib_face_recognition_resnet_model_v1.dat" << std::endl;
-        dlib::deserialize(model_dir + "/dlib_face_recognition_resnet_model_v1.dat") 
-            >> m_impl->face_encoder;
+        const std::string encoder_path = model_dir + "/" + m_impl->config.embedding_model + ".dat";
+        std::cout << "[FaceService] Loading face encoder from: " << encoder_path << std::endl;
+        dlib::deserialize(encoder_path) >> m_impl->face_encoder;
         
         m_impl->initialized = true;
         std::cout << "[FaceService] Models loaded successfully." << std::endl;
-        
+    
     } catch (const std::exception& e) {
         throw std::runtime_error(
             std::string("Failed to load dlib models: ") + e.what() +
@@ -149,68 +581,87 @@ bool FaceService::is_initialized() const
     return m_impl->initialized;
 }
 
+const std::string& FaceService::embedding_model() const
+{
+    return m_impl->config.embedding_model;
+}
+
 std::vector<FaceDetection> FaceService::detect_faces(const Image& image)
 {
-    if (!image.is_valid()) {
-        return {};
+    return detect_faces_batch({&image}).front();
+}
+
+std::vector<std::vector<FaceDetection>> FaceService::detect_faces_batch(
+    const std::vector<const Image*>& images)
+{
+    return run_detection(images, true);
+}
+
+std::vector<FaceDetection> FaceService::detect_faces_deferred(const Image& image)
+{
+    return run_detection({&image}, false).front();
+}
+
+std::vector<std::vector<FaceDetection>> FaceService::detect_faces_deferred_batch(
+    const std::vector<const Image*>& images)
+{
+    return run_detection(images, false);
+}
+
+std::vector<std::vector<FaceDetection>> FaceService::run_detection(
+    const std::vector<const Image*>& images,
+    bool embed)
+{
+    std::vector<std::vector<FaceDetection>> results(images.size());
+    
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (images[i] != nullptr && images[i]->is_valid()) {
+            indices.push_back(i);
+        }
+    }
+    if (indices.empty()) {
+        return results;
     }
     
     if (!m_impl->initialized) {
         initialize();
     }
     
-    std::vector<FaceDetection> results;
+    // Convert valid images to dlib format
+    std::vector<dlib::matrix<dlib::rgb_pixel>> dlib_imgs;
+    dlib_imgs.reserve(indices.size());
+    for (size_t i : indices) {
+        dlib_imgs.push_back(m_impl->to_dlib_image(*images[i]));
+    }
     
-    // Convert image to dlib format
-    dlib::matrix<dlib::rgb_pixel> dlib_img = m_impl->to_dlib_image(image);
+    std::vector<const dlib::matrix<dlib::rgb_pixel>*> img_ptrs;
+    for (const auto& img : dlib_imgs) {
+        img_ptrs.push_back(&img);
+    }
     
-    // Detect faces using HOG detector
-    // The upsample_count parameter upsamples the image for detecting smaller faces
-    std::vector<dlib::rectangle> face_rects = m_impl->hog_detector(
-        dlib_img, 
-        m_impl->config.upsample_count
-    );
-    
-    // Process each detected face
-    for (const auto& rect : face_rects) {
-        // Filter by minimum size
-        if (rect.width() < m_impl->config.min_face_size || 
-            rect.height() < m_impl->config.min_face_size) {
-            continue;
-        }
-        
-        // Get facial landmarks
-        dlib::full_object_detection shape = m_impl->shape_predictor(dlib_img, rect);
-        
-        // Extract aligned face chip for embedding
-        dlib::matrix<dlib::rgb_pixel> face_chip;
-        dlib::extract_image_chip(
-            dlib_img, 
-            dlib::get_face_chip_details(shape, 150, 0.25), 
-            face_chip
-        );
-        
-        // Compute 128-dimensional face embedding
-        dlib::matrix<float, 0, 1> face_descriptor = m_impl->face_encoder(face_chip);
-        
-        // Build result
-        FaceDetection detection;
-        detection.bbox = m_impl->rect_to_bbox(rect);
-        detection.confidence = 1.0f;  // HOG detector doesn't provide confidence, assume high
-        detection.landmarks = m_impl->extract_landmarks(shape);
-        
-        // Convert dlib embedding to std::vector<float>
-        detection.embedding.resize(128);
-        for (int i = 0; i < 128; ++i) {
-            detection.embedding[i] = face_descriptor(i);
-        }
-        
-        results.push_back(std::move(detection));
+    // Detect faces, then compute landmarks and embeddings per image
+    auto detections = m_impl->detect(img_ptrs);
+    auto describe_start = Impl::Clock::now();
+    for (size_t k = 0; k < indices.size(); ++k) {
+        results[indices[k]] = m_impl->describe(dlib_imgs[k], detections[k], embed);
+        m_impl->stats.faces += static_cast<int64_t>(results[indices[k]].size());
     }
+    m_impl->stats.describe_ms += Impl::elapsed_ms(describe_start);
     
     return results;
 }
 
+FaceService::Stats FaceService::get_stats() const
+{
+    return m_impl->stats;
+}
+
+void FaceService::reset_stats()
+{
+    m_impl->stats = Stats{};
+}
+
 std::vector<BoundingBox> FaceService::detect_faces_fast(const Image& image)
 {
     if (!image.is_valid()) {
@@ -226,18 +677,10 @@ std::vector<BoundingBox> FaceService::detect_faces_fast(const Image& image)
     // Convert image to dlib format
     dlib::matrix<dlib::rgb_pixel> dlib_img = m_impl->to_dlib_image(image);
     
-    // Detect faces using HOG detector (fast, no embedding)
-    std::vector<dlib::rectangle> face_rects = m_impl->hog_detector(
-        dlib_img, 
-        m_impl->config.upsample_count
-    );
-    
-    // Convert and filter results
-    for (const auto& rect : face_rects) {
-        if (rect.width() >= m_impl->config.min_face_size && 
-            rect.height() >= m_impl->config.min_face_size) {
-            results.push_back(m_impl->rect_to_bbox(rect));
-        }
+    // Detect faces with the configured backend (no embedding)
+    auto detections = m_impl->detect({&dlib_img});
+    for (const auto& det : detections.front()) {
+        results.push_back(m_impl->rect_to_bbox(det.rect));
     }
     
     return results;
@@ -247,47 +690,86 @@ std::optional<FaceEmbedding> FaceService::get_embedding(
     const Image& image,
     const BoundingBox& bbox)
 {
-    if (!image.is_valid()) {
-        return std::nullopt;
+    return get_embeddings(image, std::vector<BoundingBox>{bbox}).front();
+}
+
+std::vector<std::optional<FaceEmbedding>> FaceService::get_embeddings(
+    const Image& image,
+    const std::vector<BoundingBox>& bboxes)
+{
+    std::vector<Face> faces(bboxes.size());
+    for (size_t i = 0; i < bboxes.size(); ++i) {
+        faces[i].bbox = bboxes[i];
+    }
+    return compute_embeddings(image, faces);
+}
+
+std::vector<std::optional<FaceEmbedding>> FaceService::compute_embeddings(
+    const Image& image,
+    const std::vector<Face>& faces)
+{
+    std::vector<std::optional<FaceEmbedding>> results(faces.size());
+    if (!image.is_valid() || faces.empty()) {
+        return results;
     }
     
     if (!m_impl->initialized) {
         initialize();
     }
     
-    // Convert image to dlib format
+    // Convert image to dlib format (once for all faces)
     dlib::matrix<dlib::rgb_pixel> dlib_img = m_impl->to_dlib_image(image);
     
-    // Create dlib rectangle from bbox
-    dlib::rectangle rect(bbox.x, bbox.y, bbox.x + bbox.width - 1, bbox.y + bbox.height - 1);
-    
-    // Clamp rectangle to image bounds
-    rect = rect.intersect(dlib::rectangle(0, 0, image.width - 1, image.height - 1));
-    if (rect.is_empty()) {
-        return std::nullopt;
+    std::vector<dlib::matrix<dlib::rgb_pixel>> chips;
+    std::vector<size_t> chip_owners;
+    for (size_t i = 0; i < faces.size(); ++i) {
+        dlib::chip_details details;
+        
+        if (faces[i].chip.is_valid()) {
+            // Stored alignment: no shape prediction needed
+            details = Impl::from_geometry(faces[i].chip);
+        } else {
+            const BoundingBox& bbox = faces[i].bbox;
+            
+            // Create dlib rectangle from bbox
+            dlib::rectangle rect(bbox.x, bbox.y, bbox.x + bbox.width - 1, bbox.y + bbox.height - 1);
+            
+            // Clamp rectangle to image bounds
+            rect = rect.intersect(dlib::rectangle(0, 0, image.width - 1, image.height - 1));
+            if (rect.is_empty()) {
+                continue;
+            }
+            
+            // Get facial landmarks
+            dlib::full_object_detection shape = m_impl->shape_predictor(dlib_img, rect);
+            details = dlib::get_face_chip_details(shape, 150, 0.25);
+        }
+        
+        // Extract aligned face chip
+        dlib::matrix<dlib::rgb_pixel> face_chip;
+        dlib::extract_image_chip(dlib_img, details, face_chip);
+        chips.push_back(std::move(face_chip));
+        chip_owners.push_back(i);
     }
     
-    // Get facial landmarks
-    dlib::full_object_detection shape = m_impl->shape_predictor(dlib_img, rect);
-    
-    // Extract aligned face chip
-    dlib::matrix<dlib::rgb_pixel> face_chip;
-    dlib::extract_image_chip(
-        dlib_img, 
-        dlib::get_face_chip_details(shape, 150, 0.25), 
-        face_chip
-    );
+    if (chips.empty()) {
+        return results;
+    }
     
-    // Compute embedding
-    dlib::matrix<float, 0, 1> face_descriptor = m_impl->face_encoder(face_chip);
+    // Compute embeddings
+    const size_t batch_size = static_cast<size_t>(std::max(1, m_impl->config.embedding_batch_size));
+    std::vector<dlib::matrix<float, 0, 1>> descriptors = m_impl->face_encoder(chips, batch_size);
     
     // Convert to std::vector
-    FaceEmbedding embedding(128);
-    for (int i = 0; i < 128; ++i) {
-        embedding[i] = face_descriptor(i);
+    for (size_t k = 0; k < chip_owners.size(); ++k) {
+        FaceEmbedding embedding(128);
+        for (int j = 0; j < 128; ++j) {
+            embedding[j] = descriptors[k](j);
+        }
+        results[chip_owners[k]] = std::move(embedding);
     }
     
-    return embedding;
+    return results;
 }
 
 float FaceService::embedding_distance(const FaceEmbedding& a, const FaceEmbedding& b)
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <optional>
+#include <cstdint>
 #include "../models/Face.h"
 
 namespace facefling {
@@ -28,11 +29,86 @@ struct Image {
  */
 class FaceService {
 public:
+    /**
+     * Face detection backend.
+     * Hog: dlib's frontal_face_detector (fast, frontal faces only).
+     * Cnn: MMOD CNN (mmod_human_face_detector.dat), slower but finds
+     *      profile and poorly lit faces; runs batched over several images.
+     * Cascade: a downscaled, permissive HOG pass proposes regions and the
+     *      CNN runs only on those, plus a random sample of images without
+     *      proposals to estimate how many faces the pre-filter misses.
+     */
+    enum class Detector {
+        Hog,
+        Cnn,
+        Cascade
+    };
+    
     struct Config {
         std::string model_dir;          // Path to dlib model files
         int min_face_size = 80;         // Minimum face size in pixels
-        float min_confidence = 0.5f;    // Minimum detection confidence
-        int upsample_count = 1;         // Upsampling for small faces
+        float min_confidence = 0.5f;    // Minimum detection confidence (0.5 = detector's own threshold)
+        int upsample_count = 1;         // Upsampling for small faces (HOG, when min_face_size < 80)
+        
+        Detector detector = Detector::Hog;
+        int cnn_batch_size = 4;         // Images per CNN forward pass
+        int cnn_max_dimension = 1600;   // Cap on the longest image side fed to the CNN
+        int embedding_batch_size = 16;  // Face chips per encoder forward pass
+        
+        // Encoder file (<model_dir>/<embedding_model>.dat). Its name is stored
+        // with every embedding; embeddings from other encoders are re-embedded
+        // by the EmbeddingScheduler and never clustered together with these.
+        std::string embedding_model = kDefaultEmbeddingModel;
+        
+        // Quality gate: faces scoring below min_quality (pose x sharpness, see
+        // FaceQuality) are returned without an embedding. 0 disables the gate.
+        float min_quality = 0.25f;
+        float sharpness_reference = 100.0f;  // Chip Laplacian variance treated as fully sharp
+        
+        // Cascade pre-filter
+        int cascade_hog_max_dimension = 1200;        // Cap on the longest side for the HOG pass
+        float cascade_candidate_confidence = 0.3f;   // HOG proposal threshold (below min_confidence)
+        float cascade_region_margin = 0.75f;         // Region padding, as a fraction of the proposal size
+        float cascade_negative_sample_rate = 0.02f;  // Fraction of no-proposal images run through the CNN
+    };
+    
+    /**
+     * Per-stage timings and hit rates, accumulated since the last reset.
+     */
+    struct Stats {
+        int64_t images = 0;
+        double hog_ms = 0.0;                // HOG detection / cascade pre-filter
+        double cnn_ms = 0.0;                // CNN forward passes (incl. scaling)
+        double describe_ms = 0.0;           // Landmarks + embeddings
+        int64_t faces = 0;
+        int64_t faces_low_quality = 0;      // Returned without an embedding
+        
+        // Cascade only
+        int64_t images_with_candidates = 0; // Images where HOG proposed a region
+        int64_t candidate_regions = 0;      // Regions sent to the CNN (after merging)
+        int64_t regions_confirmed = 0;      // Regions where the CNN found a face
+        int64_t negatives_sampled = 0;      // No-proposal images run through the CNN
+        int64_t negatives_with_faces = 0;
+        int64_t faces_in_negatives = 0;
+        
+        double candidate_rate() const {
+            return images > 0 ? static_cast<double>(images_with_candidates) / images : 0.0;
+        }
+        double region_precision() const {
+            return candidate_regions > 0 ? static_cast<double>(regions_confirmed) / candidate_regions : 0.0;
+        }
+        // Share of images without proposals that actually contain faces
+        double negative_miss_rate() const {
+            return negatives_sampled > 0 ? static_cast<double>(negatives_with_faces) / negatives_sampled : 0.0;
+        }
+        // Estimated fraction of all faces lost in images the pre-filter skipped
+        double estimated_face_miss_rate(float sample_rate) const {
+            if (negatives_sampled == 0 || sample_rate <= 0.0f) {
+                return 0.0;
+            }
+            const double missed = faces_in_negatives / static_cast<double>(sample_rate) - faces_in_negatives;
+            return missed / (faces + missed);
+        }
     };
     
     explicit FaceService(const Config& config);
@@ -44,17 +120,45 @@ public:
     void initialize();
     bool is_initialized() const;
     
+    /**
+     * Version tag of the embeddings this service produces.
+     */
+    const std::string& embedding_model() const;
+    
     /**
      * Detect all faces in an image.
      * @return Vector of face detections with embeddings
      */
     std::vector<FaceDetection> detect_faces(const Image& image);
     
+    /**
+     * Detect faces in several images at once.
+     * With the CNN backend the images share forward passes (cnn_batch_size
+     * images per pass), which amortizes per-call overhead.
+     * @return One detection list per input image, in input order
+     */
+    std::vector<std::vector<FaceDetection>> detect_faces_batch(
+        const std::vector<const Image*>& images
+    );
+    
+    /**
+     * Detect faces with landmarks and quality but no embeddings.
+     * Faces that pass the quality gate come back EmbeddingState::Pending;
+     * compute their embeddings later with get_embeddings().
+     */
+    std::vector<FaceDetection> detect_faces_deferred(const Image& image);
+    std::vector<std::vector<FaceDetection>> detect_faces_deferred_batch(
+        const std::vector<const Image*>& images
+    );
+    
     /**
      * Detect faces without embeddings (faster for preview).
      */
     std::vector<BoundingBox> detect_faces_fast(const Image& image);
     
+    Stats get_stats() const;
+    void reset_stats();
+    
     /**
      * Get embedding for a specific face region.
      */
@@ -63,6 +167,27 @@ public:
         const BoundingBox& face_bbox
     );
     
+    /**
+     * Get embeddings for several face regions of one image.
+     * The image is converted once and the chips are encoded in batches.
+     * @return One entry per bbox (nullopt if the bbox lies outside the image)
+     */
+    std::vector<std::optional<FaceEmbedding>> get_embeddings(
+        const Image& image,
+        const std::vector<BoundingBox>& face_bboxes
+    );
+    
+    /**
+     * Recompute embeddings for stored faces of one image.
+     * Faces with stored chip geometry are re-aligned directly (no detection,
+     * no shape prediction); others fall back to their bbox.
+     * @return One entry per face (nullopt if it lies outside the image)
+     */
+    std::vector<std::optional<FaceEmbedding>> compute_embeddings(
+        const Image& image,
+        const std::vector<Face>& faces
+    );
+    
     /**
      * Calculate Euclidean distance between embeddings.
      * 0 = identical, typically < 0.6 = same person
@@ -82,6 +207,11 @@ public:
     );
 
 private:
+    std::vector<std::vector<FaceDetection>> run_detection(
+        const std::vector<const Image*>& images,
+        bool embed
+    );
+    
     class Impl;
     std::unique_ptr<Impl> m_impl;
 };
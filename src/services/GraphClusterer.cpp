@@ -0,0 +1,243 @@
+/**
+ * GraphClusterer implementation.
+ */
+
+#include "GraphClusterer.h"
+#include "KnnGraph.h"
+#include "ConcurrentUnionFind.h"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace facefling {
+
+namespace {
+
+// Below this many nodes a pass runs on the calling thread
+constexpr size_t kMinParallelNodes = 16384;
+constexpr size_t kChunkNodes = 4096;        // Nodes claimed by a worker at a time
+
+// Undirected, thresholded copy of the graph in CSR form
+struct Adjacency {
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> targets;
+    std::vector<float> weights;
+};
+
+Adjacency symmetrize(const KnnGraph& graph, float threshold)
+{
+    const size_t n = graph.size();
+    std::vector<uint64_t> degree(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t e = 0; e < graph.degree(i); ++e) {
+            if (graph.distances(i)[e] <= threshold) {
+                degree[i]++;
+                degree[graph.neighbors(i)[e]]++;
+            }
+        }
+    }
+    
+    Adjacency adjacency;
+    adjacency.offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        adjacency.offsets[i + 1] = adjacency.offsets[i] + degree[i];
+    }
+    
+    // Both directions of every edge; pairs listed by both ends appear twice
+    std::vector<std::pair<uint32_t, float>> edges(adjacency.offsets[n]);
+    std::vector<uint64_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t e = 0; e < graph.degree(i); ++e) {
+            const float distance = graph.distances(i)[e];
+            if (distance > threshold) {
+                continue;
+            }
+            // Closer neighbours count more: weight 1 at distance 0, 0.5 at the threshold
+            const float weight = threshold > 0.0f ? 1.0f - 0.5f * distance / threshold : 1.0f;
+            const uint32_t j = graph.neighbors(i)[e];
+            edges[fill[i]++] = {j, weight};
+            edges[fill[j]++] = {static_cast<uint32_t>(i), weight};
+        }
+    }
+    
+    // Drop duplicates per node
+    adjacency.targets.reserve(edges.size());
+    adjacency.weights.reserve(edges.size());
+    uint64_t begin = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t end = adjacency.offsets[i + 1];
+        std::sort(edges.begin() + begin, edges.begin() + end);
+        adjacency.offsets[i] = adjacency.targets.size();
+        for (uint64_t e = begin; e < end; ++e) {
+            if (e > begin && edges[e].first == edges[e - 1].first) {
+                continue;
+            }
+            adjacency.targets.push_back(edges[e].first);
+            adjacency.weights.push_back(edges[e].second);
+        }
+        begin = end;
+    }
+    adjacency.offsets[n] = adjacency.targets.size();
+    return adjacency;
+}
+
+// Renumber labels 0.. in order of first appearance
+std::vector<uint32_t> compact_labels(const std::vector<uint32_t>& raw)
+{
+    std::vector<uint32_t> mapping(raw.size(), UINT32_MAX);
+    std::vector<uint32_t> labels(raw.size());
+    uint32_t next = 0;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        uint32_t& mapped = mapping[raw[i]];
+        if (mapped == UINT32_MAX) {
+            mapped = next++;
+        }
+        labels[i] = mapped;
+    }
+    return labels;
+}
+
+int worker_count(const GraphClusterer::Config& config)
+{
+    if (config.threads > 0) {
+        return config.threads;
+    }
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+} // namespace
+
+GraphClusterer::GraphClusterer()
+    : GraphClusterer(Config{})
+{
+}
+
+GraphClusterer::GraphClusterer(const Config& config)
+    : m_config(config)
+{
+}
+
+std::vector<uint32_t> GraphClusterer::chinese_whispers(const KnnGraph& graph) const
+{
+    const size_t n = graph.size();
+    const Adjacency adjacency = symmetrize(graph, m_config.threshold);
+    
+    // Labels are read and written concurrently; a stale read only delays
+    // convergence by a pass, as in the sequential algorithm's visiting order
+    std::vector<std::atomic<uint32_t>> labels(n);
+    for (size_t i = 0; i < n; ++i) {
+        labels[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+    }
+    
+    const int threads = n < kMinParallelNodes ? 1 : worker_count(m_config);
+    
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    std::mt19937 rng(m_config.seed);
+    
+    for (int iteration = 0; iteration < m_config.iterations; ++iteration) {
+        std::shuffle(order.begin(), order.end(), rng);
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> changed{0};
+        
+        auto run = [&]() {
+            std::vector<std::pair<uint32_t, float>> votes;
+            size_t local_changed = 0;
+            for (size_t begin = next_chunk.fetch_add(kChunkNodes); begin < n;
+                 begin = next_chunk.fetch_add(kChunkNodes)) {
+                const size_t end = std::min(n, begin + kChunkNodes);
+                for (size_t o = begin; o < end; ++o) {
+                    const uint32_t node = order[o];
+                    
+                    // Sum edge weight per neighbouring label (degrees are small)
+                    votes.clear();
+                    for (uint64_t e = adjacency.offsets[node]; e < adjacency.offsets[node + 1]; ++e) {
+                        const uint32_t label = labels[adjacency.targets[e]].load(std::memory_order_relaxed);
+                        auto it = std::find_if(votes.begin(), votes.end(),
+                            [label](const std::pair<uint32_t, float>& v) { return v.first == label; });
+                        if (it == votes.end()) {
+                            votes.emplace_back(label, adjacency.weights[e]);
+                        } else {
+                            it->second += adjacency.weights[e];
+                        }
+                    }
+                    if (votes.empty()) {
+                        continue;
+                    }
+                    
+                    // Heaviest label; ties go to the smaller label so passes settle
+                    auto best = std::min_element(votes.begin(), votes.end(),
+                        [](const std::pair<uint32_t, float>& a, const std::pair<uint32_t, float>& b) {
+                            return a.second > b.second || (a.second == b.second && a.first < b.first);
+                        });
+                    if (best->first != labels[node].load(std::memory_order_relaxed)) {
+                        labels[node].store(best->first, std::memory_order_relaxed);
+                        local_changed++;
+                    }
+                }
+            }
+            changed += local_changed;
+        };
+        
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t) {
+            pool.emplace_back(run);
+        }
+        run();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        
+        if (changed == 0) {
+            break;
+        }
+    }
+    
+    std::vector<uint32_t> raw(n);
+    for (size_t i = 0; i < n; ++i) {
+        raw[i] = labels[i].load(std::memory_order_relaxed);
+    }
+    return compact_labels(raw);
+}
+
+std::vector<uint32_t> GraphClusterer::connected_components(const KnnGraph& graph) const
+{
+    const size_t n = graph.size();
+    ConcurrentUnionFind sets(n);
+    
+    const int threads = n < kMinParallelNodes ? 1 : worker_count(m_config);
+    std::atomic<size_t> next_chunk{0};
+    auto run = [&]() {
+        for (size_t begin = next_chunk.fetch_add(kChunkNodes); begin < n;
+             begin = next_chunk.fetch_add(kChunkNodes)) {
+            const size_t end = std::min(n, begin + kChunkNodes);
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t e = 0; e < graph.degree(i); ++e) {
+                    if (graph.distances(i)[e] > m_config.threshold) {
+                        break;  // Neighbours are sorted by distance
+                    }
+                    sets.unite(static_cast<uint32_t>(i), graph.neighbors(i)[e]);
+                }
+            }
+        }
+    };
+    
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.emplace_back(run);
+    }
+    run();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return sets.labels();
+}
+
+size_t GraphClusterer::label_count(const std::vector<uint32_t>& labels)
+{
+    return labels.empty() ? 0 : static_cast<size_t>(*std::max_element(labels.begin(), labels.end())) + 1;
+}
+
+} // namespace facefling
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace facefling {
+
+// Forward declarations
+class KnnGraph;
+
+/**
+ * Clustering on a kNN graph thresholded at a distance.
+ * Only edges no longer than the threshold are used, and they are treated
+ * as undirected. Both algorithms run in time near-linear in the edge count;
+ * unlike centroid linkage, no centroid drifts towards unrelated faces.
+ *
+ * Results are labels per graph node, numbered 0.. in order of first
+ * appearance.
+ */
+class GraphClusterer {
+public:
+    struct Config {
+        float threshold = 0.6f;     // Edges longer than this are ignored
+        int iterations = 20;        // Chinese Whispers passes (stops early once stable)
+        int threads = 0;            // Worker threads (0 = hardware concurrency)
+        uint32_t seed = 1;          // Node visiting order
+    };
+    
+    GraphClusterer();
+    explicit GraphClusterer(const Config& config);
+    
+    /**
+     * Chinese Whispers: each node repeatedly takes the label with the most
+     * edge weight among its neighbours (closer neighbours weigh more).
+     * Splits groups joined by a few stray edges.
+     */
+    std::vector<uint32_t> chinese_whispers(const KnnGraph& graph) const;
+    
+    /**
+     * Connected components: any path of short edges joins two nodes.
+     * Edges are united in parallel through a ConcurrentUnionFind.
+     */
+    std::vector<uint32_t> connected_components(const KnnGraph& graph) const;
+    
+    /**
+     * Number of distinct labels (labels are 0..count-1).
+     */
+    static size_t label_count(const std::vector<uint32_t>& labels);
+
+private:
+    Config m_config;
+};
+
+} // namespace facefling
@@ -0,0 +1,101 @@
+/**
+ * ImageBufferPool implementation.
+ */
+
+#include "ImageBufferPool.h"
+
+namespace facefling {
+
+ImageBufferPool::ImageBufferPool(size_t max_pooled_bytes)
+    : m_max_pooled_bytes(max_pooled_bytes)
+{
+}
+
+size_t ImageBufferPool::size_class(size_t bytes)
+{
+    if (bytes <= 4096) {
+        return 4096;
+    }
+    
+    // Largest power of two <= bytes, then round up in quarter steps (<= 25% waste)
+    size_t base = 4096;
+    while (base * 2 <= bytes) {
+        base *= 2;
+    }
+    const size_t step = base / 4;
+    return ((bytes + step - 1) / step) * step;
+}
+
+std::vector<unsigned char> ImageBufferPool::acquire(size_t bytes)
+{
+    const size_t cls = size_class(bytes);
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Buffers keep the length they were returned at (growing one would
+        // zero-fill the tail), so prefer one already long enough: the resize
+        // then only shrinks. Failing that, the longest, so the least is filled.
+        auto range = m_free.equal_range(cls);
+        auto best = m_free.end();
+        for (auto it = range.first; it != range.second; ++it) {
+            if (best == m_free.end() || it->second.size() > best->second.size()) {
+                best = it;
+            }
+            if (best->second.size() >= bytes) {
+                break;
+            }
+        }
+        if (best != m_free.end()) {
+            std::vector<unsigned char> buffer = std::move(best->second);
+            m_free.erase(best);
+            m_stats.pooled_bytes -= buffer.capacity();
+            m_stats.hits++;
+            
+            buffer.resize(bytes);
+            return buffer;
+        }
+        m_stats.misses++;
+    }
+    
+    std::vector<unsigned char> buffer;
+    buffer.reserve(cls);
+    buffer.resize(bytes);
+    return buffer;
+}
+
+void ImageBufferPool::release(std::vector<unsigned char>&& buffer)
+{
+    const size_t capacity = buffer.capacity();
+    if (capacity == 0) {
+        return;
+    }
+    
+    // Only buffers that exactly fill a class can be handed out without reallocation
+    const size_t cls = size_class(capacity);
+    if (cls != capacity) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stats.pooled_bytes + capacity > m_max_pooled_bytes) {
+        return;
+    }
+    
+    m_stats.pooled_bytes += capacity;
+    m_free.emplace(cls, std::move(buffer));
+}
+
+void ImageBufferPool::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.clear();
+    m_stats.pooled_bytes = 0;
+}
+
+ImageBufferPool::Stats ImageBufferPool::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace facefling
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace facefling {
+
+/**
+ * Size-classed pool of pixel buffers.
+ * Decoded frames are large (a 48MP RGB frame is ~144MB), so buffers are
+ * recycled between images instead of being reallocated for every decode.
+ * Thread-safe.
+ */
+class ImageBufferPool {
+public:
+    struct Stats {
+        int64_t hits = 0;          // Acquires served from the pool
+        int64_t misses = 0;        // Acquires that allocated
+        size_t pooled_bytes = 0;   // Capacity currently held for reuse
+    };
+    
+    explicit ImageBufferPool(size_t max_pooled_bytes = 512u << 20);
+    
+    /**
+     * Get a buffer with size() == bytes.
+     * Contents are unspecified (recycled buffers are not cleared).
+     */
+    std::vector<unsigned char> acquire(size_t bytes);
+    
+    /**
+     * Return a buffer for reuse. Dropped if the pool is full.
+     */
+    void release(std::vector<unsigned char>&& buffer);
+    
+    /**
+     * Free all pooled buffers.
+     */
+    void clear();
+    
+    Stats get_stats() const;
+    
+    // Size class a request is rounded up to (quarter steps between powers of two)
+    static size_t size_class(size_t bytes);
+
+private:
+    size_t m_max_pooled_bytes;
+    mutable std::mutex m_mutex;
+    std::multimap<size_t, std::vector<unsigned char>> m_free;  // Keyed by size class (capacity); size() as returned
+    Stats m_stats;
+};
+
+} // namespace facefling
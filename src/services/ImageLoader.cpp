@@ -3,6 +3,7 @@
  */
 
 #include "ImageLoader.h"
+#include "ImageBufferPool.h"
 #include <QImage>
 #include <QImageReader>
 #include <stdexcept>
@@ -25,14 +26,8 @@ ImageLoader::ImageLoader()
 
 ImageLoader::~ImageLoader() = default;
 
-Image ImageLoader::load(const std::string& path)
-{
-    QImage qimg(QString::fromStdString(path));
-    
-    if (qimg.isNull()) {
-        throw std::runtime_error("Failed to load image: " + path);
-    }
-    
+// Copy a decoded QImage into an RGB buffer of exactly width * height * 3 bytes
+static Image to_rgb_image(QImage qimg, std::vector<unsigned char> buffer) {
     // Convert to RGB format
     qimg = qimg.convertToFormat(QImage::Format_RGB888);
     
@@ -42,7 +37,8 @@ Image ImageLoader::load(const std::string& path)
     result.channels = 3;
     
     // Copy pixel data
-    const size_t size = static_cast<size_t>(result.width * result.height * result.channels);
+    const size_t size = static_cast<size_t>(result.width) * result.height * result.channels;
+    result.data = std::move(buffer);
     result.data.resize(size);
     
     // QImage stores rows with potential padding, so copy row by row
@@ -54,13 +50,48 @@ Image ImageLoader::load(const std::string& path)
         std::copy(
             src + y * bytesPerLine,
             src + y * bytesPerLine + rowBytes,
-            result.data.data() + y * rowBytes
+            result.data.data() + static_cast<size_t>(y) * rowBytes
         );
     }
     
     return result;
 }
 
+Image ImageLoader::load(const std::string& path)
+{
+    QImage qimg(QString::fromStdString(path));
+    
+    if (qimg.isNull()) {
+        throw std::runtime_error("Failed to load image: " + path);
+    }
+    
+    return to_rgb_image(std::move(qimg), {});
+}
+
+Image ImageLoader::load(const std::string& path, ImageBufferPool& pool)
+{
+    QImage qimg(QString::fromStdString(path));
+    
+    if (qimg.isNull()) {
+        throw std::runtime_error("Failed to load image: " + path);
+    }
+    
+    const size_t size = static_cast<size_t>(qimg.width()) * qimg.height() * 3;
+    return to_rgb_image(std::move(qimg), pool.acquire(size));
+}
+
+std::optional<std::pair<int, int>> ImageLoader::image_size(const std::string& path) const
+{
+    QImageReader reader(QString::fromStdString(path));
+    QSize size = reader.size();
+    
+    if (!size.isValid()) {
+        return std::nullopt;
+    }
+    
+    return std::make_pair(size.width(), size.height());
+}
+
 void ImageLoader::save_thumbnail(
     const Image& image,
     const BoundingBox& region,
@@ -3,10 +3,14 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <utility>
 #include "FaceService.h"
 
 namespace facefling {
 
+class ImageBufferPool;
+
 /**
  * Image loading service.
  * Supports various image formats via Qt.
@@ -23,6 +27,18 @@ public:
      */
     Image load(const std::string& path);
     
+    /**
+     * Load an image into a buffer taken from pool.
+     * Return the buffer with pool.release(std::move(image.data)) when done.
+     */
+    Image load(const std::string& path, ImageBufferPool& pool);
+    
+    /**
+     * Read image dimensions from the file header without decoding pixels.
+     * @return (width, height), or nullopt if the header cannot be read
+     */
+    std::optional<std::pair<int, int>> image_size(const std::string& path) const;
+    
     /**
      * Save a thumbnail (cropped region) to disk.
      * @param image Source image
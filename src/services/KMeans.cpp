@@ -0,0 +1,97 @@
+/**
+ * KMeans implementation.
+ */
+
+#include "KMeans.h"
+#include "DistanceEngine.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace facefling {
+
+namespace {
+
+constexpr size_t kQueryBlock = 256;         // Rows per distance block
+
+} // namespace
+
+KMeans::KMeans()
+    : m_config()
+{
+}
+
+KMeans::KMeans(const Config& config)
+    : m_config(config)
+{
+}
+
+std::vector<float> KMeans::train(const float* matrix, size_t n, size_t dims, size_t k) const
+{
+    if (n == 0) {
+        return {};
+    }
+    k = std::max<size_t>(1, std::min(k, n));
+    
+    std::mt19937 rng(m_config.seed);
+    std::vector<uint32_t> sample(n);
+    std::iota(sample.begin(), sample.end(), 0u);
+    std::shuffle(sample.begin(), sample.end(), rng);
+    sample.resize(std::max(k, std::min(n, m_config.sample)));
+    
+    std::vector<float> rows(sample.size() * dims);
+    for (size_t i = 0; i < sample.size(); ++i) {
+        std::copy(matrix + sample[i] * dims, matrix + (sample[i] + 1) * dims, rows.begin() + i * dims);
+    }
+    std::vector<float> centroids(rows.begin(), rows.begin() + k * dims);
+    
+    std::uniform_int_distribution<size_t> pick(0, sample.size() - 1);
+    for (int iteration = 0; iteration < m_config.iterations; ++iteration) {
+        const std::vector<uint32_t> cells = assign(rows.data(), sample.size(), centroids.data(), k, dims);
+        
+        std::vector<double> sums(k * dims, 0.0);
+        std::vector<size_t> counts(k, 0);
+        for (size_t i = 0; i < sample.size(); ++i) {
+            const size_t cell = cells[i];
+            counts[cell]++;
+            for (size_t d = 0; d < dims; ++d) {
+                sums[cell * dims + d] += rows[i * dims + d];
+            }
+        }
+        for (size_t cell = 0; cell < k; ++cell) {
+            float* centroid = centroids.data() + cell * dims;
+            if (counts[cell] == 0) {
+                // Empty cell: reseed from a random sample row
+                const size_t row = pick(rng);
+                std::copy(rows.begin() + row * dims, rows.begin() + (row + 1) * dims, centroid);
+                continue;
+            }
+            for (size_t d = 0; d < dims; ++d) {
+                centroid[d] = static_cast<float>(sums[cell * dims + d] / counts[cell]);
+            }
+        }
+    }
+    return centroids;
+}
+
+std::vector<uint32_t> KMeans::assign(const float* matrix, size_t n, const float* centroids, size_t k,
+                                     size_t dims) const
+{
+    DistanceEngine::Config engine_config;
+    engine_config.threads = m_config.threads;
+    DistanceEngine engine(engine_config);
+    
+    std::vector<uint32_t> cells(n);
+    std::vector<float> block(kQueryBlock * k);
+    for (size_t q = 0; q < n; q += kQueryBlock) {
+        const size_t rows = std::min(kQueryBlock, n - q);
+        engine.squared_distances(matrix + q * dims, rows, centroids, k, dims, block.data());
+        for (size_t r = 0; r < rows; ++r) {
+            const float* d2 = block.data() + r * k;
+            cells[q + r] = static_cast<uint32_t>(std::min_element(d2, d2 + k) - d2);
+        }
+    }
+    return cells;
+}
+
+} // namespace facefling
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace facefling {
+
+/**
+ * Lloyd's k-means over row-major embedding matrices, trained on a random
+ * sample of the rows. Distances go through the DistanceEngine.
+ * Used to partition embeddings into cells (IVF lists, clustering shards).
+ */
+class KMeans {
+public:
+    struct Config {
+        int iterations = 8;
+        size_t sample = 100000;     // Rows used to train
+        int threads = 0;            // Worker threads (0 = hardware concurrency)
+        uint32_t seed = 42;
+    };
+    
+    KMeans();
+    explicit KMeans(const Config& config);
+    
+    /**
+     * Train k centroids (k x dims, row-major) on rows [0, n). k is clamped to [1, n].
+     */
+    std::vector<float> train(const float* matrix, size_t n, size_t dims, size_t k) const;
+    
+    /**
+     * Index of the nearest of k centroids for each of n rows.
+     */
+    std::vector<uint32_t> assign(const float* matrix, size_t n, const float* centroids, size_t k,
+                                 size_t dims) const;
+
+private:
+    Config m_config;
+};
+
+} // namespace facefling
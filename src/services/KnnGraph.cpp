@@ -0,0 +1,635 @@
+/**
+ * KnnGraph implementation.
+ */
+
+#include "KnnGraph.h"
+#include "DistanceEngine.h"
+#include "EmbeddingSnapshot.h"
+#include "KMeans.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <tuple>
+
+namespace facefling {
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'F', 'K', 'N', 'N', 'G', 'R', 'F'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kModelChars = 64;
+constexpr size_t kQueryBlock = 256;         // Query rows per distance block
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t dims;
+    uint32_t k;
+    uint32_t lists;                         // IVF cells (0 = exact)
+    uint64_t nodes;
+    uint64_t edges;
+    int64_t generation;
+    char model[kModelChars];
+};
+
+struct Neighbor {
+    float distance;
+    uint32_t node;
+};
+using NeighborList = std::vector<Neighbor>;
+
+// Reverse edge found while inserting: node `target` gains `source` at `distance`
+struct Update {
+    uint32_t target;
+    uint32_t source;
+    float distance;
+};
+
+template <typename T>
+void write_array(std::ofstream& out, const std::vector<T>& values)
+{
+    out.write(reinterpret_cast<const char*>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+bool read_array(std::ifstream& in, std::vector<T>& values, size_t count)
+{
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    return static_cast<bool>(in);
+}
+
+} // namespace
+
+class KnnGraph::Impl {
+public:
+    std::string path;
+    Config config;
+    Stats stats;
+    
+    int64_t generation = -1;
+    std::string model;
+    std::vector<int64_t> face_ids;
+    std::vector<uint32_t> by_id;            // Nodes ordered by face id; empty when they already are
+    std::vector<uint64_t> offsets = {0};
+    std::vector<uint32_t> targets;
+    std::vector<float> distances;
+    
+    // IVF index (empty when built exactly)
+    size_t dims = 0;
+    std::vector<float> centroids;           // lists x dims
+    std::vector<uint32_t> assignment;       // Cell of each node
+    
+    // Snapshot rows, and so nodes, follow the order faces became Ready
+    void index_ids() {
+        by_id.clear();
+        if (std::is_sorted(face_ids.begin(), face_ids.end())) {
+            return;
+        }
+        by_id.resize(face_ids.size());
+        for (uint32_t i = 0; i < by_id.size(); ++i) {
+            by_id[i] = i;
+        }
+        std::sort(by_id.begin(), by_id.end(),
+                  [this](uint32_t a, uint32_t b) { return face_ids[a] < face_ids[b]; });
+    }
+    
+    size_t k() const {
+        return static_cast<size_t>(std::max(1, config.k));
+    }
+    
+    size_t list_count() const {
+        return dims > 0 ? centroids.size() / dims : 0;
+    }
+    
+    int workers() const {
+        if (config.threads > 0) {
+            return config.threads;
+        }
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    
+    float max_squared() const {
+        return config.max_distance * config.max_distance;
+    }
+    
+    // Keep the list sorted and at most k long
+    void insert(NeighborList& list, uint32_t node, float distance) const {
+        if (list.size() >= k() && distance >= list.back().distance) {
+            return;
+        }
+        auto pos = std::upper_bound(list.begin(), list.end(), distance,
+            [](float d, const Neighbor& n) { return d < n.distance; });
+        list.insert(pos, Neighbor{distance, node});
+        if (list.size() > k()) {
+            list.pop_back();
+        }
+    }
+    
+    // Scan one row of squared distances to candidate nodes
+    void scan_row(const float* d2, const uint32_t* candidates, size_t count, uint32_t self,
+                  NeighborList& list) const {
+        const float limit = max_squared();
+        for (size_t j = 0; j < count; ++j) {
+            if (candidates[j] == self || d2[j] > limit) {
+                continue;
+            }
+            const float distance = std::sqrt(std::max(0.0f, d2[j]));
+            if (list.size() < k() || distance < list.back().distance) {
+                insert(list, candidates[j], distance);
+            }
+        }
+    }
+    
+    std::vector<NeighborList> expand() const {
+        std::vector<NeighborList> lists(face_ids.size());
+        for (size_t i = 0; i < lists.size(); ++i) {
+            for (uint64_t e = offsets[i]; e < offsets[i + 1]; ++e) {
+                lists[i].push_back(Neighbor{distances[e], targets[e]});
+            }
+        }
+        return lists;
+    }
+    
+    void compact(const std::vector<NeighborList>& lists) {
+        offsets.assign(1, 0);
+        targets.clear();
+        distances.clear();
+        offsets.reserve(lists.size() + 1);
+        for (const auto& list : lists) {
+            for (const auto& neighbor : list) {
+                targets.push_back(neighbor.node);
+                distances.push_back(neighbor.distance);
+            }
+            offsets.push_back(targets.size());
+        }
+    }
+    
+    void apply(const std::vector<Update>& updates, std::vector<NeighborList>& lists) const {
+        for (const auto& update : updates) {
+            insert(lists[update.target], update.source, update.distance);
+        }
+    }
+    
+    // Queries [query_begin, n) against every row in [0, n)
+    void search_exact(const float* matrix, size_t n, size_t query_begin,
+                      std::vector<NeighborList>& lists) const {
+        DistanceEngine::Config engine_config;
+        engine_config.threads = config.threads;
+        DistanceEngine engine(engine_config);
+        
+        std::vector<uint32_t> all(n);
+        std::iota(all.begin(), all.end(), 0u);
+        std::vector<float> block(kQueryBlock * n);
+        std::vector<Update> updates;
+        const float limit = max_squared();
+        
+        for (size_t q = query_begin; q < n; q += kQueryBlock) {
+            const size_t rows = std::min(kQueryBlock, n - q);
+            engine.squared_distances(matrix + q * dims, rows, matrix, n, dims, block.data());
+            for (size_t r = 0; r < rows; ++r) {
+                const float* d2 = block.data() + r * n;
+                const uint32_t self = static_cast<uint32_t>(q + r);
+                scan_row(d2, all.data(), n, self, lists[self]);
+                
+                // Existing nodes may be displaced by the new one
+                for (size_t c = 0; c < query_begin; ++c) {
+                    if (d2[c] <= limit) {
+                        updates.push_back({static_cast<uint32_t>(c), self, std::sqrt(std::max(0.0f, d2[c]))});
+                    }
+                }
+            }
+        }
+        apply(updates, lists);
+    }
+    
+    KMeans kmeans() const {
+        KMeans::Config kmeans_config;
+        kmeans_config.iterations = config.kmeans_iterations;
+        kmeans_config.sample = config.kmeans_sample;
+        kmeans_config.threads = config.threads;
+        return KMeans(kmeans_config);
+    }
+    
+    // Nearest cell of each row in [begin, end)
+    void assign(const float* matrix, size_t begin, size_t end) {
+        const std::vector<uint32_t> cells = kmeans().assign(matrix + begin * dims, end - begin,
+                                                            centroids.data(), list_count(), dims);
+        assignment.resize(end);
+        std::copy(cells.begin(), cells.end(), assignment.begin() + begin);
+    }
+    
+    void train(const float* matrix, size_t n) {
+        const size_t lists = config.ivf_lists > 0
+            ? static_cast<size_t>(config.ivf_lists)
+            : static_cast<size_t>(std::sqrt(static_cast<double>(n)));
+        centroids = kmeans().train(matrix, n, dims, lists);
+    }
+    
+    // Queries [query_begin, n) against the rows of the cells nearest to theirs
+    void search_ivf(const float* matrix, size_t n, size_t query_begin,
+                    std::vector<NeighborList>& lists) const {
+        const size_t cells = list_count();
+        const size_t probes = std::min(cells, static_cast<size_t>(std::max(1, config.ivf_probes)));
+        
+        std::vector<std::vector<uint32_t>> members(cells);
+        for (size_t i = 0; i < n; ++i) {
+            members[assignment[i]].push_back(static_cast<uint32_t>(i));
+        }
+        
+        // Cells probed from each cell (itself first)
+        std::vector<std::vector<uint32_t>> probed(cells);
+        {
+            DistanceEngine::Config engine_config;
+            engine_config.threads = config.threads;
+            DistanceEngine engine(engine_config);
+            std::vector<float> block(kQueryBlock * cells);
+            for (size_t c = 0; c < cells; c += kQueryBlock) {
+                const size_t rows = std::min(kQueryBlock, cells - c);
+                engine.squared_distances(centroids.data() + c * dims, rows, centroids.data(), cells,
+                                         dims, block.data());
+                for (size_t r = 0; r < rows; ++r) {
+                    const float* d2 = block.data() + r * cells;
+                    std::vector<uint32_t> order(cells);
+                    std::iota(order.begin(), order.end(), 0u);
+                    std::partial_sort(order.begin(), order.begin() + probes, order.end(),
+                        [d2](uint32_t x, uint32_t y) { return d2[x] < d2[y]; });
+                    order.resize(probes);
+                    probed[c + r] = std::move(order);
+                }
+            }
+        }
+        
+        // Cells are independent; each worker runs its own single-threaded engine
+        DistanceEngine::Config engine_config;
+        engine_config.threads = 1;
+        const DistanceEngine engine(engine_config);
+        const float limit = max_squared();
+        
+        const int threads = std::max(1, std::min(workers(), static_cast<int>(cells)));
+        std::vector<std::vector<Update>> updates(threads);
+        std::atomic<size_t> next_cell{0};
+        auto run = [&](int worker) {
+            std::vector<float> queries;
+            std::vector<float> candidates;
+            std::vector<uint32_t> candidate_ids;
+            std::vector<float> block;
+            
+            for (size_t cell = next_cell++; cell < cells; cell = next_cell++) {
+                std::vector<uint32_t> query_ids;
+                for (uint32_t node : members[cell]) {
+                    if (node >= query_begin) {
+                        query_ids.push_back(node);
+                    }
+                }
+                if (query_ids.empty()) {
+                    continue;
+                }
+                
+                candidate_ids.clear();
+                for (uint32_t other : probed[cell]) {
+                    candidate_ids.insert(candidate_ids.end(), members[other].begin(), members[other].end());
+                }
+                candidates.resize(candidate_ids.size() * dims);
+                for (size_t j = 0; j < candidate_ids.size(); ++j) {
+                    const float* src = matrix + static_cast<size_t>(candidate_ids[j]) * dims;
+                    std::copy(src, src + dims, candidates.begin() + j * dims);
+                }
+                
+                for (size_t q = 0; q < query_ids.size(); q += kQueryBlock) {
+                    const size_t rows = std::min(kQueryBlock, query_ids.size() - q);
+                    queries.resize(rows * dims);
+                    for (size_t r = 0; r < rows; ++r) {
+                        const float* src = matrix + static_cast<size_t>(query_ids[q + r]) * dims;
+                        std::copy(src, src + dims, queries.begin() + r * dims);
+                    }
+                    block.resize(rows * candidate_ids.size());
+                    engine.squared_distances(queries.data(), rows, candidates.data(), candidate_ids.size(),
+                                             dims, block.data());
+                    
+                    for (size_t r = 0; r < rows; ++r) {
+                        const float* d2 = block.data() + r * candidate_ids.size();
+                        const uint32_t self = query_ids[q + r];
+                        scan_row(d2, candidate_ids.data(), candidate_ids.size(), self, lists[self]);
+                        
+                        if (query_begin == 0) {
+                            continue;
+                        }
+                        for (size_t j = 0; j < candidate_ids.size(); ++j) {
+                            if (candidate_ids[j] < query_begin && d2[j] <= limit) {
+                                updates[worker].push_back(
+                                    {candidate_ids[j], self, std::sqrt(std::max(0.0f, d2[j]))});
+                            }
+                        }
+                    }
+                }
+            }
+        };
+        
+        std::vector<std::thread> pool;
+        for (int w = 1; w < threads; ++w) {
+            pool.emplace_back(run, w);
+        }
+        run(0);
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        for (const auto& worker_updates : updates) {
+            apply(worker_updates, lists);
+        }
+    }
+};
+
+KnnGraph::KnnGraph(const std::string& path)
+    : KnnGraph(path, Config{})
+{
+}
+
+KnnGraph::KnnGraph(const std::string& path, const Config& config)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->path = path;
+    m_impl->config = config;
+}
+
+KnnGraph::~KnnGraph() = default;
+
+bool KnnGraph::load()
+{
+    std::ifstream in(m_impl->path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    
+    Header header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        std::cerr << "[KnnGraph] Ignoring malformed graph: " << m_impl->path << std::endl;
+        return false;
+    }
+    
+    std::vector<int64_t> face_ids;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> targets;
+    std::vector<float> distances;
+    std::vector<float> centroids;
+    std::vector<uint32_t> assignment;
+    bool ok = read_array(in, face_ids, header.nodes) &&
+              read_array(in, offsets, header.nodes + 1) &&
+              read_array(in, targets, header.edges) &&
+              read_array(in, distances, header.edges) &&
+              read_array(in, centroids, static_cast<size_t>(header.lists) * header.dims) &&
+              read_array(in, assignment, header.lists > 0 ? header.nodes : 0);
+    ok = ok && offsets.front() == 0 && offsets.back() == header.edges;
+    for (uint32_t target : targets) {
+        ok = ok && target < header.nodes;
+    }
+    if (!ok) {
+        std::cerr << "[KnnGraph] Ignoring truncated graph: " << m_impl->path << std::endl;
+        return false;
+    }
+    
+    m_impl->generation = header.generation;
+    m_impl->model = std::string(header.model, strnlen(header.model, kModelChars));
+    m_impl->dims = header.dims;
+    m_impl->face_ids = std::move(face_ids);
+    m_impl->index_ids();
+    m_impl->offsets = std::move(offsets);
+    m_impl->targets = std::move(targets);
+    m_impl->distances = std::move(distances);
+    m_impl->centroids = std::move(centroids);
+    m_impl->assignment = std::move(assignment);
+    return true;
+}
+
+void KnnGraph::sync(const EmbeddingSnapshot& snapshot)
+{
+    const size_t n = snapshot.size();
+    const int64_t* ids = snapshot.face_ids();
+    const size_t held = size();
+    
+    // Snapshot appends keep row order, so the graph is a prefix of it unless rebuilt
+    const bool prefix = held <= n &&
+                        m_impl->generation == snapshot.generation() &&
+                        m_impl->model == snapshot.model() &&
+                        (held == 0 || m_impl->face_ids.back() == ids[held - 1]);
+    
+    if (prefix && held == n) {
+        m_impl->stats = Stats{};
+        m_impl->stats.approximate = is_approximate();
+        return;
+    }
+    if (prefix && held > 0) {
+        extend(snapshot.matrix(), ids, n, EmbeddingSnapshot::kDims);
+    } else {
+        build(snapshot.matrix(), ids, n, EmbeddingSnapshot::kDims);
+    }
+    m_impl->generation = snapshot.generation();
+    m_impl->model = snapshot.model();
+    
+    if (!save()) {
+        std::cerr << "[KnnGraph] Failed to write graph: " << m_impl->path << std::endl;
+    }
+    std::cout << "[KnnGraph] " << (m_impl->stats.rebuilt ? "Built" : "Extended")
+              << (m_impl->stats.approximate ? " approximate" : " exact") << " graph with "
+              << m_impl->stats.nodes_added << " new nodes (" << size() << " total, "
+              << edge_count() << " edges) in " << static_cast<int64_t>(m_impl->stats.build_ms)
+              << " ms" << std::endl;
+}
+
+void KnnGraph::build(const float* matrix, const int64_t* face_ids, size_t n, size_t dims)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_impl->stats = Stats{};
+    m_impl->generation = -1;
+    m_impl->model.clear();
+    m_impl->dims = dims;
+    m_impl->centroids.clear();
+    m_impl->assignment.clear();
+    m_impl->face_ids.assign(face_ids, face_ids + n);
+    m_impl->index_ids();
+    
+    std::vector<NeighborList> lists(n);
+    if (n > m_impl->config.exact_max_nodes) {
+        m_impl->train(matrix, n);
+        m_impl->assign(matrix, 0, n);
+        m_impl->search_ivf(matrix, n, 0, lists);
+    } else if (n > 0) {
+        m_impl->search_exact(matrix, n, 0, lists);
+    }
+    m_impl->compact(lists);
+    
+    m_impl->stats.rebuilt = true;
+    m_impl->stats.nodes_added = static_cast<int64_t>(n);
+    m_impl->stats.approximate = is_approximate();
+    m_impl->stats.build_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void KnnGraph::extend(const float* matrix, const int64_t* face_ids, size_t n, size_t dims)
+{
+    const size_t held = size();
+    if (held == 0 || dims != m_impl->dims ||
+        (!is_approximate() && n > m_impl->config.exact_max_nodes)) {
+        // Nothing to extend, or the set outgrew exact search: build the index
+        build(matrix, face_ids, n, dims);
+        return;
+    }
+    
+    const auto start = std::chrono::steady_clock::now();
+    m_impl->stats = Stats{};
+    if (n <= held) {
+        return;
+    }
+    
+    std::vector<NeighborList> lists = m_impl->expand();
+    lists.resize(n);
+    m_impl->face_ids.insert(m_impl->face_ids.end(), face_ids + held, face_ids + n);
+    m_impl->index_ids();
+    if (is_approximate()) {
+        m_impl->assign(matrix, held, n);
+        m_impl->search_ivf(matrix, n, held, lists);
+    } else {
+        m_impl->search_exact(matrix, n, held, lists);
+    }
+    m_impl->compact(lists);
+    
+    m_impl->stats.nodes_added = static_cast<int64_t>(n - held);
+    m_impl->stats.approximate = is_approximate();
+    m_impl->stats.build_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+bool KnnGraph::save() const
+{
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.dims = static_cast<uint32_t>(m_impl->dims);
+    header.k = static_cast<uint32_t>(m_impl->k());
+    header.lists = static_cast<uint32_t>(m_impl->list_count());
+    header.nodes = m_impl->face_ids.size();
+    header.edges = m_impl->targets.size();
+    header.generation = m_impl->generation;
+    std::strncpy(header.model, m_impl->model.c_str(), kModelChars - 1);
+    
+    const std::string tmp_path = m_impl->path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_array(out, m_impl->face_ids);
+        write_array(out, m_impl->offsets);
+        write_array(out, m_impl->targets);
+        write_array(out, m_impl->distances);
+        write_array(out, m_impl->centroids);
+        write_array(out, m_impl->assignment);
+        if (!out.flush()) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+    
+    if (std::rename(tmp_path.c_str(), m_impl->path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+size_t KnnGraph::size() const
+{
+    return m_impl->face_ids.size();
+}
+
+size_t KnnGraph::edge_count() const
+{
+    return m_impl->targets.size();
+}
+
+bool KnnGraph::is_approximate() const
+{
+    return !m_impl->centroids.empty();
+}
+
+int64_t KnnGraph::generation() const
+{
+    return m_impl->generation;
+}
+
+const std::string& KnnGraph::model() const
+{
+    return m_impl->model;
+}
+
+int64_t KnnGraph::face_id(size_t node) const
+{
+    return m_impl->face_ids[node];
+}
+
+std::optional<size_t> KnnGraph::node_of(int64_t face_id) const
+{
+    const auto& ids = m_impl->face_ids;
+    const auto& by_id = m_impl->by_id;
+    if (by_id.empty()) {
+        auto it = std::lower_bound(ids.begin(), ids.end(), face_id);
+        if (it == ids.end() || *it != face_id) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(it - ids.begin());
+    }
+    auto it = std::lower_bound(by_id.begin(), by_id.end(), face_id,
+                               [&ids](uint32_t node, int64_t id) { return ids[node] < id; });
+    if (it == by_id.end() || ids[*it] != face_id) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+size_t KnnGraph::degree(size_t node) const
+{
+    return static_cast<size_t>(m_impl->offsets[node + 1] - m_impl->offsets[node]);
+}
+
+const uint32_t* KnnGraph::neighbors(size_t node) const
+{
+    return m_impl->targets.data() + m_impl->offsets[node];
+}
+
+const float* KnnGraph::distances(size_t node) const
+{
+    return m_impl->distances.data() + m_impl->offsets[node];
+}
+
+const std::vector<uint64_t>& KnnGraph::offsets() const
+{
+    return m_impl->offsets;
+}
+
+const std::vector<uint32_t>& KnnGraph::edge_targets() const
+{
+    return m_impl->targets;
+}
+
+const std::vector<float>& KnnGraph::edge_distances() const
+{
+    return m_impl->distances;
+}
+
+KnnGraph::Stats KnnGraph::get_stats() const
+{
+    return m_impl->stats;
+}
+
+} // namespace facefling
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace facefling {
+
+// Forward declarations
+class EmbeddingSnapshot;
+
+/**
+ * Sparse k-nearest-neighbour graph over face embeddings, in CSR form.
+ * Node i is row i of the EmbeddingSnapshot it was built from; each node
+ * lists up to k neighbours (nearest first) with their distances. The graph
+ * is directed: j in knn(i) does not imply i in knn(j).
+ *
+ * Small sets are built exactly with the DistanceEngine. Larger ones use an
+ * IVF index (k-means cells, each cell searched against its nearest cells),
+ * which is kept with the graph so that faces added later are inserted
+ * without a rebuild. Persisted next to the snapshot and validated against
+ * its generation.
+ */
+class KnnGraph {
+public:
+    struct Config {
+        int k = 16;                     // Neighbours per node
+        float max_distance = 1.0f;      // Edges longer than this are dropped
+        size_t exact_max_nodes = 20000; // Larger sets use the IVF index
+        int ivf_lists = 0;              // k-means cells (0 = sqrt(nodes))
+        int ivf_probes = 8;             // Cells searched per cell
+        int kmeans_iterations = 8;
+        size_t kmeans_sample = 100000;  // Rows used to train the cells
+        int threads = 0;                // Worker threads (0 = hardware concurrency)
+    };
+    
+    struct Stats {
+        bool rebuilt = false;           // Last sync built the graph from scratch
+        int64_t nodes_added = 0;        // Nodes inserted by the last sync
+        bool approximate = false;       // Built with the IVF index
+        double build_ms = 0.0;
+    };
+    
+    explicit KnnGraph(const std::string& path);
+    KnnGraph(const std::string& path, const Config& config);
+    ~KnnGraph();
+    
+    KnnGraph(const KnnGraph&) = delete;
+    KnnGraph& operator=(const KnnGraph&) = delete;
+    
+    /**
+     * Read the persisted graph. @return false if missing or malformed
+     */
+    bool load();
+    
+    /**
+     * Bring the graph up to date with a synced snapshot and persist it:
+     * rows appended to the snapshot are inserted, anything else rebuilds.
+     */
+    void sync(const EmbeddingSnapshot& snapshot);
+    
+    /**
+     * Build over rows [0, n) of a row-major matrix (one per face, in any order).
+     */
+    void build(const float* matrix, const int64_t* face_ids, size_t n, size_t dims);
+    
+    /**
+     * Insert rows [size(), n) of the same matrix the graph was built from,
+     * updating existing nodes whose neighbours they displace.
+     */
+    void extend(const float* matrix, const int64_t* face_ids, size_t n, size_t dims);
+    
+    /**
+     * Write the graph to its path (atomically). @return false on failure
+     */
+    bool save() const;
+    
+    size_t size() const;
+    size_t edge_count() const;
+    bool is_approximate() const;
+    int64_t generation() const;         // Snapshot generation it matches (-1 if unknown)
+    const std::string& model() const;
+    
+    int64_t face_id(size_t node) const;
+    std::optional<size_t> node_of(int64_t face_id) const;
+    
+    // Neighbours of a node, nearest first
+    size_t degree(size_t node) const;
+    const uint32_t* neighbors(size_t node) const;
+    const float* distances(size_t node) const;
+    
+    // Raw CSR arrays: edges of node i are [offsets[i], offsets[i + 1])
+    const std::vector<uint64_t>& offsets() const;
+    const std::vector<uint32_t>& edge_targets() const;
+    const std::vector<float>& edge_distances() const;
+    
+    Stats get_stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace facefling
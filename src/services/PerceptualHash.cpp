@@ -0,0 +1,155 @@
+/**
+ * Perceptual hash and BK-tree implementation.
+ */
+
+#include "PerceptualHash.h"
+#include <algorithm>
+#include <bitset>
+
+namespace facefling {
+
+// dHash grid: 9 columns so that each of the 8 rows yields 8 comparisons
+static constexpr int kHashCols = 9;
+static constexpr int kHashRows = 8;
+
+// Samples per cell axis; large images are subsampled rather than fully averaged
+static constexpr int kSamplesPerCell = 16;
+
+// Hashes with fewer set (or clear) bits than this are too flat to compare
+static constexpr int kMinInformativeBits = 8;
+
+uint64_t PerceptualHash::dhash(const Image& image)
+{
+    if (!image.is_valid()) {
+        return 0;
+    }
+    
+    const int channels = image.channels;
+    const unsigned char* src = image.data.data();
+    
+    float grid[kHashRows][kHashCols];
+    
+    for (int r = 0; r < kHashRows; ++r) {
+        const int y0 = r * image.height / kHashRows;
+        const int y1 = std::max(y0 + 1, (r + 1) * image.height / kHashRows);
+        const int step_y = std::max(1, (y1 - y0) / kSamplesPerCell);
+        
+        for (int c = 0; c < kHashCols; ++c) {
+            const int x0 = c * image.width / kHashCols;
+            const int x1 = std::max(x0 + 1, (c + 1) * image.width / kHashCols);
+            const int step_x = std::max(1, (x1 - x0) / kSamplesPerCell);
+            
+            // Average luminance (BT.601 weights) over the sampled cell
+            float sum = 0.0f;
+            int count = 0;
+            for (int y = y0; y < std::min(y1, image.height); y += step_y) {
+                const unsigned char* row = src + static_cast<size_t>(y) * image.width * channels;
+                for (int x = x0; x < std::min(x1, image.width); x += step_x) {
+                    const unsigned char* px = row + static_cast<size_t>(x) * channels;
+                    sum += channels >= 3
+                        ? 0.299f * px[0] + 0.587f * px[1] + 0.114f * px[2]
+                        : static_cast<float>(px[0]);
+                    ++count;
+                }
+            }
+            grid[r][c] = count > 0 ? sum / static_cast<float>(count) : 0.0f;
+        }
+    }
+    
+    uint64_t hash = 0;
+    for (int r = 0; r < kHashRows; ++r) {
+        for (int c = 0; c < kHashCols - 1; ++c) {
+            hash <<= 1;
+            if (grid[r][c] > grid[r][c + 1]) {
+                hash |= 1;
+            }
+        }
+    }
+    return hash;
+}
+
+int PerceptualHash::hamming_distance(uint64_t a, uint64_t b)
+{
+    return static_cast<int>(std::bitset<64>(a ^ b).count());
+}
+
+bool PerceptualHash::is_informative(uint64_t hash)
+{
+    const int bits = static_cast<int>(std::bitset<64>(hash).count());
+    return bits >= kMinInformativeBits && bits <= 64 - kMinInformativeBits;
+}
+
+// ============================================================================
+// BkTree
+// ============================================================================
+
+void BkTree::insert(uint64_t hash, int64_t id)
+{
+    Node node;
+    node.hash = hash;
+    node.id = id;
+    
+    if (m_nodes.empty()) {
+        m_nodes.push_back(std::move(node));
+        return;
+    }
+    
+    size_t current = 0;
+    while (true) {
+        const int dist = PerceptualHash::hamming_distance(hash, m_nodes[current].hash);
+        
+        auto& children = m_nodes[current].children;
+        auto it = std::find_if(children.begin(), children.end(),
+            [dist](const std::pair<int, size_t>& child) { return child.first == dist; });
+        
+        if (it == children.end()) {
+            children.emplace_back(dist, m_nodes.size());
+            m_nodes.push_back(std::move(node));
+            return;
+        }
+        current = it->second;
+    }
+}
+
+std::vector<BkTree::Match> BkTree::find_within(uint64_t hash, int max_distance) const
+{
+    std::vector<Match> results;
+    if (m_nodes.empty()) {
+        return results;
+    }
+    
+    std::vector<size_t> pending = {0};
+    while (!pending.empty()) {
+        const size_t index = pending.back();
+        pending.pop_back();
+        
+        const Node& node = m_nodes[index];
+        const int dist = PerceptualHash::hamming_distance(hash, node.hash);
+        if (dist <= max_distance) {
+            results.push_back({node.id, node.hash, dist});
+        }
+        
+        // Triangle inequality: only subtrees within [dist - r, dist + r] can match
+        for (const auto& child : node.children) {
+            if (child.first >= dist - max_distance && child.first <= dist + max_distance) {
+                pending.push_back(child.second);
+            }
+        }
+    }
+    
+    return results;
+}
+
+bool BkTree::find_nearest(uint64_t hash, int max_distance, Match& out) const
+{
+    std::vector<Match> matches = find_within(hash, max_distance);
+    if (matches.empty()) {
+        return false;
+    }
+    
+    out = *std::min_element(matches.begin(), matches.end(),
+        [](const Match& a, const Match& b) { return a.distance < b.distance; });
+    return true;
+}
+
+} // namespace facefling
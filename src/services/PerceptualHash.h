@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include "FaceService.h"
+
+namespace facefling {
+
+/**
+ * 64-bit perceptual image hash (dHash).
+ * Resized and re-encoded copies of the same photo hash to nearby values,
+ * so near-duplicates can be found by Hamming distance.
+ */
+class PerceptualHash {
+public:
+    /**
+     * Compute the difference hash of an image.
+     * The image is reduced to a 9x8 grayscale grid and each bit records
+     * whether a cell is brighter than its right-hand neighbour.
+     */
+    static uint64_t dhash(const Image& image);
+    
+    /**
+     * Number of differing bits between two hashes.
+     */
+    static int hamming_distance(uint64_t a, uint64_t b);
+    
+    /**
+     * Whether a hash carries enough structure to identify a photo.
+     * Flat, near-uniform and undecodable images hash to (almost) all zeros
+     * or all ones and would match each other; callers should not look them up.
+     */
+    static bool is_informative(uint64_t hash);
+};
+
+/**
+ * BK-tree over 64-bit hashes for Hamming-radius lookup.
+ */
+class BkTree {
+public:
+    struct Match {
+        int64_t id = 0;
+        uint64_t hash = 0;
+        int distance = 0;
+    };
+    
+    /**
+     * Add a hash with an associated id (e.g. photo ID).
+     */
+    void insert(uint64_t hash, int64_t id);
+    
+    /**
+     * Find all entries within max_distance of hash.
+     */
+    std::vector<Match> find_within(uint64_t hash, int max_distance) const;
+    
+    /**
+     * Find the closest entry within max_distance, if any.
+     */
+    bool find_nearest(uint64_t hash, int max_distance, Match& out) const;
+    
+    size_t size() const { return m_nodes.size(); }
+    bool empty() const { return m_nodes.empty(); }
+    void clear() { m_nodes.clear(); }
+
+private:
+    struct Node {
+        uint64_t hash = 0;
+        int64_t id = 0;
+        std::vector<std::pair<int, size_t>> children;  // (distance, node index)
+    };
+    
+    std::vector<Node> m_nodes;
+};
+
+} // namespace facefling
@@ -0,0 +1,174 @@
+/**
+ * PrototypeSet implementation.
+ */
+
+#include "PrototypeSet.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace facefling {
+
+namespace {
+
+constexpr int kMedoidRounds = 3;
+
+float distance_between(const float* a, const float* b, size_t dims) {
+    float sum = 0.0f;
+    for (size_t k = 0; k < dims; ++k) {
+        const float diff = a[k] - b[k];
+        sum += diff * diff;
+    }
+    return std::sqrt(sum);
+}
+
+} // namespace
+
+std::vector<float> PrototypeSet::select(const float* matrix, size_t n, size_t dims, size_t k)
+{
+    if (n == 0 || k == 0) {
+        return {};
+    }
+    
+    // Evenly spaced subsample
+    const size_t m = std::min(n, kMaxSample);
+    std::vector<const float*> rows(m);
+    for (size_t i = 0; i < m; ++i) {
+        rows[i] = matrix + (i * n / m) * dims;
+    }
+    
+    std::vector<size_t> chosen;
+    if (m <= k) {
+        for (size_t i = 0; i < m; ++i) {
+            chosen.push_back(i);
+        }
+    } else {
+        std::vector<float> dist(m * m, 0.0f);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = i + 1; j < m; ++j) {
+                dist[i * m + j] = dist[j * m + i] = distance_between(rows[i], rows[j], dims);
+            }
+        }
+        
+        // Seed with the row nearest the mean, then repeatedly the row farthest from all picks
+        std::vector<float> mean(dims, 0.0f);
+        for (const float* row : rows) {
+            for (size_t d = 0; d < dims; ++d) {
+                mean[d] += row[d] / static_cast<float>(m);
+            }
+        }
+        size_t first = 0;
+        float first_dist = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < m; ++i) {
+            const float d = distance_between(rows[i], mean.data(), dims);
+            if (d < first_dist) {
+                first_dist = d;
+                first = i;
+            }
+        }
+        chosen.push_back(first);
+        
+        std::vector<float> nearest(dist.begin() + first * m, dist.begin() + (first + 1) * m);
+        while (chosen.size() < k) {
+            const size_t next = std::max_element(nearest.begin(), nearest.end()) - nearest.begin();
+            if (nearest[next] <= 0.0f) {
+                break;  // Only duplicates left
+            }
+            chosen.push_back(next);
+            for (size_t i = 0; i < m; ++i) {
+                nearest[i] = std::min(nearest[i], dist[next * m + i]);
+            }
+        }
+        
+        // Move each prototype to the medoid of the rows it is nearest to
+        std::vector<size_t> owner(m);
+        for (int round = 0; round < kMedoidRounds; ++round) {
+            for (size_t i = 0; i < m; ++i) {
+                size_t best = 0;
+                for (size_t p = 1; p < chosen.size(); ++p) {
+                    if (dist[i * m + chosen[p]] < dist[i * m + chosen[best]]) {
+                        best = p;
+                    }
+                }
+                owner[i] = best;
+            }
+            
+            bool changed = false;
+            for (size_t p = 0; p < chosen.size(); ++p) {
+                size_t medoid = chosen[p];
+                float medoid_cost = std::numeric_limits<float>::max();
+                for (size_t i = 0; i < m; ++i) {
+                    if (owner[i] != p) continue;
+                    float cost = 0.0f;
+                    for (size_t j = 0; j < m; ++j) {
+                        if (owner[j] == p) {
+                            cost += dist[i * m + j];
+                        }
+                    }
+                    if (cost < medoid_cost) {
+                        medoid_cost = cost;
+                        medoid = i;
+                    }
+                }
+                changed = changed || medoid != chosen[p];
+                chosen[p] = medoid;
+            }
+            if (!changed) {
+                break;
+            }
+        }
+    }
+    
+    std::vector<float> prototypes(chosen.size() * dims);
+    for (size_t p = 0; p < chosen.size(); ++p) {
+        std::copy(rows[chosen[p]], rows[chosen[p]] + dims, prototypes.begin() + p * dims);
+    }
+    return prototypes;
+}
+
+bool PrototypeSet::add(std::vector<float>& prototypes, const float* row, size_t dims, size_t k)
+{
+    const size_t count = prototypes.size() / dims;
+    if (count < k) {
+        prototypes.insert(prototypes.end(), row, row + dims);
+        return true;
+    }
+    if (count < 2) {
+        return false;
+    }
+    
+    size_t close_a = 0;
+    size_t close_b = 1;
+    float closest = std::numeric_limits<float>::max();
+    for (size_t a = 0; a < count; ++a) {
+        for (size_t b = a + 1; b < count; ++b) {
+            const float d = distance_between(&prototypes[a * dims], &prototypes[b * dims], dims);
+            if (d < closest) {
+                closest = d;
+                close_a = a;
+                close_b = b;
+            }
+        }
+    }
+    if (distance(prototypes, row, dims) <= closest) {
+        return false;
+    }
+    
+    // Of the closest pair, the one nearer the new row is the one it makes redundant
+    const size_t replaced = distance_between(&prototypes[close_a * dims], row, dims) <
+                            distance_between(&prototypes[close_b * dims], row, dims)
+        ? close_a : close_b;
+    std::copy(row, row + dims, prototypes.begin() + replaced * dims);
+    return true;
+}
+
+float PrototypeSet::distance(const std::vector<float>& prototypes, const float* row, size_t dims)
+{
+    float best = std::numeric_limits<float>::infinity();
+    for (size_t offset = 0; offset + dims <= prototypes.size(); offset += dims) {
+        best = std::min(best, distance_between(&prototypes[offset], row, dims));
+    }
+    return best;
+}
+
+} // namespace facefling
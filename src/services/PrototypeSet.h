@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace facefling {
+
+/**
+ * A few member embeddings (medoids) that stand in for a cluster when faces
+ * are matched against it. The mean of a person photographed over decades
+ * can lie far from every actual face, whereas the nearest of a handful of
+ * well-spread members stays close to any new photo of them.
+ * Prototypes are packed k x dims, row-major, so a whole library's worth
+ * can go through one DistanceEngine pass.
+ */
+class PrototypeSet {
+public:
+    /**
+     * Pick up to k prototypes from n rows: farthest-first seeding from the
+     * row nearest the mean, then rounds of moving each prototype to the
+     * medoid of the rows nearest to it. Large sets are subsampled.
+     */
+    static std::vector<float> select(const float* matrix, size_t n, size_t dims, size_t k);
+    
+    /**
+     * Fold in a new member. Below k prototypes the row is kept; at k it
+     * replaces one of the two closest prototypes if it lies farther from
+     * the set than they lie from each other, so the set keeps its spread.
+     * @return true if the prototypes changed
+     */
+    static bool add(std::vector<float>& prototypes, const float* row, size_t dims, size_t k);
+    
+    /**
+     * Distance from row to the nearest prototype (infinity if there are none).
+     */
+    static float distance(const std::vector<float>& prototypes, const float* row, size_t dims);
+    
+    static constexpr size_t kMaxSample = 128;  // Rows considered by select()
+};
+
+} // namespace facefling
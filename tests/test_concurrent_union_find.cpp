@@ -0,0 +1,63 @@
+/**
+ * Concurrent union-find unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/ConcurrentUnionFind.h"
+#include <numeric>
+#include <random>
+#include <thread>
+
+using namespace facefling;
+
+TEST(ConcurrentUnionFindTest, StartsAsSingletons) {
+    ConcurrentUnionFind sets(5);
+    EXPECT_EQ(sets.size(), 5u);
+    for (uint32_t i = 0; i < 5; ++i) {
+        EXPECT_EQ(sets.find(i), i);
+    }
+    EXPECT_EQ(sets.labels(), (std::vector<uint32_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(ConcurrentUnionFindTest, UniteJoinsSetsUnderSmallestMember) {
+    ConcurrentUnionFind sets(6);
+    EXPECT_TRUE(sets.unite(4, 2));
+    EXPECT_TRUE(sets.unite(5, 4));
+    EXPECT_FALSE(sets.unite(2, 5));
+    EXPECT_TRUE(sets.unite(3, 1));
+    
+    EXPECT_EQ(sets.find(5), 2u);
+    EXPECT_EQ(sets.find(3), 1u);
+    EXPECT_EQ(sets.labels(), (std::vector<uint32_t>{0, 1, 2, 1, 2, 2}));
+}
+
+TEST(ConcurrentUnionFindTest, ThreadedUnionsMatchSequential) {
+    const size_t n = 200000;
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<uint32_t> pick(0, n - 1);
+    std::vector<std::pair<uint32_t, uint32_t>> edges(150000);
+    for (auto& edge : edges) {
+        edge = {pick(rng), pick(rng)};
+    }
+    
+    ConcurrentUnionFind sequential(n);
+    for (const auto& edge : edges) {
+        sequential.unite(edge.first, edge.second);
+    }
+    
+    ConcurrentUnionFind threaded(n);
+    const size_t workers = 8;
+    std::vector<std::thread> pool;
+    for (size_t w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w]() {
+            for (size_t e = w; e < edges.size(); e += workers) {
+                threaded.unite(edges[e].first, edges[e].second);
+            }
+        });
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    
+    EXPECT_EQ(threaded.labels(), sequential.labels());
+}
@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 #include "services/Database.h"
+#include "services/EmbeddingQuantizer.h"
 #include "models/Photo.h"
 #include "models/Face.h"
 #include "models/Cluster.h"
@@ -115,6 +116,23 @@ TEST_F(DatabaseTest, UniquePhotoPaths) {
     EXPECT_THROW(db->insert_photo(photo), std::runtime_error);
 }
 
+TEST_F(DatabaseTest, PhotoHashPersistence) {
+    auto hashed = make_photo("/photos/hashed.jpg");
+    hashed.phash = 0xF0F0F0F0F0F0F0F0ULL;  // High bit set: stored as negative INTEGER
+    int64_t hashed_id = db->insert_photo(hashed);
+    db->insert_photo(make_photo("/photos/unhashed.jpg"));
+    
+    auto retrieved = db->get_photo(hashed_id);
+    ASSERT_TRUE(retrieved.has_value());
+    ASSERT_TRUE(retrieved->phash.has_value());
+    EXPECT_EQ(retrieved->phash.value(), hashed.phash.value());
+    
+    auto hashes = db->get_photo_hashes();
+    ASSERT_EQ(hashes.size(), 1u);
+    EXPECT_EQ(hashes[0].first, hashed_id);
+    EXPECT_EQ(hashes[0].second, hashed.phash.value());
+}
+
 // =============================================================================
 // Face Tests
 // =============================================================================
@@ -232,7 +250,7 @@ TEST_F(DatabaseTest, UpdateClusterCentroid) {
     
     // Update centroid
     std::vector<float> new_centroid(128, 0.5f);
-    db->update_cluster_centroid(id, new_centroid);
+    db->update_cluster_centroid(id, new_centroid, kDefaultEmbeddingModel);
     
     auto retrieved = db->get_cluster(id);
     ASSERT_TRUE(retrieved.has_value());
@@ -240,6 +258,27 @@ TEST_F(DatabaseTest, UpdateClusterCentroid) {
     EXPECT_FLOAT_EQ(retrieved->centroid[0], 0.5f);
 }
 
+TEST_F(DatabaseTest, ClusterPrototypesRoundTrip) {
+    Cluster cluster;
+    cluster.face_count = 2;
+    cluster.centroid.assign(128, 0.5f);
+    cluster.prototypes.assign(2 * 128, 0.25f);
+    int64_t id = db->insert_cluster(cluster);
+    
+    auto retrieved = db->get_cluster(id);
+    ASSERT_TRUE(retrieved.has_value());
+    ASSERT_EQ(retrieved->prototypes.size(), 256u);
+    EXPECT_FLOAT_EQ(retrieved->prototypes[255], 0.25f);
+    
+    std::vector<float> updated(3 * 128, 0.75f);
+    db->update_cluster_prototypes(id, updated);
+    EXPECT_EQ(db->get_cluster(id)->prototypes, updated);
+    
+    db->update_cluster_prototypes(id, {});
+    EXPECT_TRUE(db->get_cluster(id)->prototypes.empty());
+    EXPECT_EQ(db->get_cluster(id)->centroid.size(), 128u);
+}
+
 TEST_F(DatabaseTest, DeleteCluster) {
     Cluster cluster;
     cluster.face_count = 1;
@@ -302,6 +341,84 @@ TEST_F(DatabaseTest, DeletePerson) {
     EXPECT_FALSE(retrieved.has_value());
 }
 
+// =============================================================================
+// Scan Session Tests
+// =============================================================================
+
+TEST_F(DatabaseTest, ScanSessionLifecycle) {
+    ScanSession scan;
+    scan.root_path = "/photos";
+    scan.total_files = 3;
+    int64_t scan_id = db->insert_scan(scan);
+    EXPECT_GT(scan_id, 0);
+    
+    db->update_scan_progress(scan_id, 2, 5);
+    db->update_scan_status(scan_id, ScanSession::kCancelled);
+    
+    auto retrieved = db->get_scan(scan_id);
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_EQ(retrieved->root_path, "/photos");
+    EXPECT_EQ(retrieved->total_files, 3);
+    EXPECT_EQ(retrieved->processed_files, 2);
+    EXPECT_EQ(retrieved->total_faces, 5);
+    EXPECT_EQ(retrieved->status, ScanSession::kCancelled);
+    EXPECT_TRUE(retrieved->end_date.has_value());
+    EXPECT_EQ(db->get_resumable_scans().size(), 1u);
+    
+    db->update_scan_status(scan_id, ScanSession::kCompleted);
+    EXPECT_TRUE(db->get_resumable_scans().empty());
+}
+
+TEST_F(DatabaseTest, ScanQueuePendingFiles) {
+    ScanSession scan;
+    scan.root_path = "/photos";
+    int64_t scan_id = db->insert_scan(scan);
+    
+    db->enqueue_scan_files(scan_id, {"/photos/c.jpg", "/photos/a.jpg", "/photos/b.jpg"});
+    db->update_scan_file_status(scan_id, "/photos/c.jpg", ScanFileStatus::Done);
+    db->update_scan_file_status(scan_id, "/photos/b.jpg", ScanFileStatus::Failed);
+    
+    auto pending = db->get_pending_scan_files(scan_id);
+    ASSERT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending[0], "/photos/a.jpg");
+}
+
+TEST_F(DatabaseTest, ScanQueueRolledBackBatchStaysPending) {
+    ScanSession scan;
+    scan.root_path = "/photos";
+    int64_t scan_id = db->insert_scan(scan);
+    db->enqueue_scan_files(scan_id, {"/photos/a.jpg", "/photos/b.jpg"});
+    
+    db->begin_transaction();
+    db->update_scan_file_status(scan_id, "/photos/a.jpg", ScanFileStatus::Done);
+    db->commit();
+    
+    db->begin_transaction();
+    db->update_scan_file_status(scan_id, "/photos/b.jpg", ScanFileStatus::Done);
+    db->rollback();
+    
+    auto pending = db->get_pending_scan_files(scan_id);
+    ASSERT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending[0], "/photos/b.jpg");
+}
+
+TEST_F(DatabaseTest, ScanQueueClearedOnCompletion) {
+    ScanSession scan;
+    scan.root_path = "/photos";
+    int64_t scan_id = db->insert_scan(scan);
+    db->enqueue_scan_files(scan_id, {"/photos/a.jpg", "/photos/b.jpg"});
+    
+    db->update_scan_status(scan_id, ScanSession::kCancelled);
+    EXPECT_EQ(db->get_pending_scan_files(scan_id).size(), 2u);
+    
+    db->update_scan_status(scan_id, ScanSession::kCompleted);
+    EXPECT_TRUE(db->get_pending_scan_files(scan_id).empty());
+    
+    // Re-enqueueing proves the rows were deleted, not just marked
+    db->enqueue_scan_files(scan_id, {"/photos/a.jpg"});
+    EXPECT_EQ(db->get_pending_scan_files(scan_id).size(), 1u);
+}
+
 // =============================================================================
 // Transaction Tests
 // =============================================================================
@@ -383,3 +500,397 @@ TEST_F(DatabaseTest, GetUnclusteredFaces) {
     EXPECT_EQ(unclustered.size(), 1u);
     EXPECT_FALSE(unclustered[0].cluster_id.has_value());
 }
+
+TEST_F(DatabaseTest, LowQualityFacesStoredWithoutEmbedding) {
+    auto photo = make_photo("/photos/blurry.jpg");
+    int64_t photo_id = db->insert_photo(photo);
+    
+    auto good = make_face(photo_id, 100, 100);
+    good.quality = 0.9f;
+    
+    auto blurry = make_face(photo_id, 300, 100);
+    blurry.embedding.clear();
+    blurry.quality = 0.1f;
+    blurry.embedding_state = EmbeddingState::LowQuality;
+    
+    db->insert_face(good);
+    int64_t blurry_id = db->insert_face(blurry);
+    
+    auto retrieved = db->get_face(blurry_id);
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_TRUE(retrieved->embedding.empty());
+    EXPECT_FALSE(retrieved->has_embedding());
+    EXPECT_EQ(retrieved->embedding_state, EmbeddingState::LowQuality);
+    EXPECT_NEAR(retrieved->quality, 0.1f, 1e-6f);
+    
+    // Still listed for its photo, but never handed to clustering
+    EXPECT_EQ(db->get_faces_for_photo(photo_id).size(), 2u);
+    
+    auto unclustered = db->get_unclustered_faces();
+    ASSERT_EQ(unclustered.size(), 1u);
+    EXPECT_EQ(unclustered[0].embedding_state, EmbeddingState::Ready);
+    EXPECT_EQ(db->get_all_faces_with_embeddings().size(), 1u);
+}
+
+TEST_F(DatabaseTest, PendingEmbeddingsInPhotoOrder) {
+    int64_t photo_a = db->insert_photo(make_photo("/photos/a.jpg"));
+    int64_t photo_b = db->insert_photo(make_photo("/photos/b.jpg"));
+    
+    auto pending = [](Face face) {
+        face.embedding.clear();
+        face.embedding_state = EmbeddingState::Pending;
+        return face;
+    };
+    
+    int64_t b1 = db->insert_face(pending(make_face(photo_b, 10, 10)));
+    int64_t a1 = db->insert_face(pending(make_face(photo_a, 10, 10)));
+    int64_t a2 = db->insert_face(pending(make_face(photo_a, 200, 10)));
+    db->insert_face(make_face(photo_a, 400, 10));  // Already embedded
+    
+    EXPECT_EQ(db->count_faces_in_state(EmbeddingState::Pending), 3);
+    EXPECT_EQ(db->get_unclustered_faces().size(), 1u);
+    
+    // Grouped by photo, in photo order
+    auto faces = db->get_pending_embedding_faces(0, 10);
+    ASSERT_EQ(faces.size(), 3u);
+    EXPECT_EQ(faces[0].id, a1);
+    EXPECT_EQ(faces[1].id, a2);
+    EXPECT_EQ(faces[2].id, b1);
+    
+    // Cursor skips photos at or before it
+    auto after_a = db->get_pending_embedding_faces(photo_a, 10);
+    ASSERT_EQ(after_a.size(), 1u);
+    EXPECT_EQ(after_a[0].id, b1);
+    
+    EXPECT_EQ(db->get_pending_embedding_faces(0, 2).size(), 2u);
+}
+
+TEST_F(DatabaseTest, UpdateFaceEmbeddingMarksReady) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/deferred.jpg"));
+    
+    Face face = make_face(photo_id);
+    FaceEmbedding embedding = face.embedding;
+    face.embedding.clear();
+    face.embedding_state = EmbeddingState::Pending;
+    int64_t face_id = db->insert_face(face);
+    
+    EXPECT_TRUE(db->get_unclustered_faces().empty());
+    
+    db->update_face_embedding(face_id, embedding, kDefaultEmbeddingModel);
+    
+    auto retrieved = db->get_face(face_id);
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_EQ(retrieved->embedding_state, EmbeddingState::Ready);
+    EXPECT_EQ(retrieved->embedding, embedding);
+    EXPECT_EQ(retrieved->embedding_model, kDefaultEmbeddingModel);
+    EXPECT_EQ(db->count_faces_in_state(EmbeddingState::Pending), 0);
+    EXPECT_EQ(db->get_unclustered_faces().size(), 1u);
+}
+
+TEST_F(DatabaseTest, LandmarksAndChipGeometryRoundTrip) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/aligned.jpg"));
+    
+    Face face = make_face(photo_id);
+    for (int i = 0; i < 68; ++i) {
+        face.landmarks.emplace_back(100 + i, 180 - i);
+    }
+    face.chip.center_x = 140.5f;
+    face.chip.center_y = 138.25f;
+    face.chip.width = 96.0f;
+    face.chip.height = 96.0f;
+    face.chip.angle = -0.125f;
+    int64_t face_id = db->insert_face(face);
+    
+    Face bare = make_face(photo_id, 300, 300);
+    int64_t bare_id = db->insert_face(bare);
+    
+    auto retrieved = db->get_face(face_id);
+    ASSERT_TRUE(retrieved.has_value());
+    EXPECT_EQ(retrieved->landmarks, face.landmarks);
+    ASSERT_TRUE(retrieved->chip.is_valid());
+    EXPECT_FLOAT_EQ(retrieved->chip.center_x, 140.5f);
+    EXPECT_FLOAT_EQ(retrieved->chip.center_y, 138.25f);
+    EXPECT_FLOAT_EQ(retrieved->chip.width, 96.0f);
+    EXPECT_FLOAT_EQ(retrieved->chip.height, 96.0f);
+    EXPECT_FLOAT_EQ(retrieved->chip.angle, -0.125f);
+    
+    auto retrieved_bare = db->get_face(bare_id);
+    ASSERT_TRUE(retrieved_bare.has_value());
+    EXPECT_TRUE(retrieved_bare->landmarks.empty());
+    EXPECT_FALSE(retrieved_bare->chip.is_valid());
+}
+
+TEST_F(DatabaseTest, StaleEmbeddingsByModel) {
+    const std::string old_model = "dlib_face_recognition_resnet_model_v1";
+    const std::string new_model = "face_encoder_v2";
+    int64_t photo_a = db->insert_photo(make_photo("/photos/a.jpg"));
+    int64_t photo_b = db->insert_photo(make_photo("/photos/b.jpg"));
+    
+    Face old_b = make_face(photo_b);
+    old_b.embedding_model = old_model;
+    int64_t old_b_id = db->insert_face(old_b);
+    
+    Face old_a = make_face(photo_a);
+    old_a.embedding_model = old_model;
+    int64_t old_a_id = db->insert_face(old_a);
+    
+    Face current = make_face(photo_a, 200, 200);
+    current.embedding_model = new_model;
+    db->insert_face(current);
+    
+    Face pending = make_face(photo_a, 300, 300);
+    pending.embedding.clear();
+    pending.embedding_state = EmbeddingState::Pending;
+    db->insert_face(pending);
+    
+    EXPECT_EQ(db->count_stale_embeddings(new_model), 2);
+    EXPECT_EQ(db->count_stale_embeddings(old_model), 1);
+    
+    auto stale = db->get_stale_embedding_faces(new_model, 0, 10);
+    ASSERT_EQ(stale.size(), 2u);
+    EXPECT_EQ(stale[0].id, old_a_id);
+    EXPECT_EQ(stale[1].id, old_b_id);
+    EXPECT_EQ(db->get_stale_embedding_faces(new_model, photo_a, 10).size(), 1u);
+    
+    db->update_face_embedding(old_a_id, old_a.embedding, new_model);
+    EXPECT_EQ(db->count_stale_embeddings(new_model), 1);
+    EXPECT_EQ(db->get_face(old_a_id)->embedding_model, new_model);
+}
+
+TEST_F(DatabaseTest, ClusterEmbeddingModelRoundTrip) {
+    Cluster cluster;
+    cluster.centroid.assign(128, 0.5f);
+    cluster.embedding_model = "face_encoder_v2";
+    int64_t id = db->insert_cluster(cluster);
+    
+    EXPECT_EQ(db->get_cluster(id)->embedding_model, "face_encoder_v2");
+    
+    db->update_cluster_centroid(id, cluster.centroid, kDefaultEmbeddingModel);
+    EXPECT_EQ(db->get_cluster(id)->embedding_model, kDefaultEmbeddingModel);
+}
+
+TEST_F(DatabaseTest, QuantizedFacesSkipFloatBlob) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/codes.jpg"));
+    
+    Face clustered = make_face(photo_id);
+    clustered.embedding_model = kDefaultEmbeddingModel;
+    int64_t clustered_id = db->insert_face(clustered);
+    db->update_face_cluster(clustered_id, 7);
+    
+    Face loose = make_face(photo_id, 200, 200);
+    loose.embedding_model = kDefaultEmbeddingModel;
+    int64_t loose_id = db->insert_face(loose);
+    
+    EXPECT_EQ(db->get_quantized_faces(false).size(), 2u);
+    
+    auto faces = db->get_quantized_faces(true);
+    ASSERT_EQ(faces.size(), 1u);
+    EXPECT_EQ(faces[0].id, loose_id);
+    EXPECT_EQ(faces[0].embedding_model, kDefaultEmbeddingModel);
+    EXPECT_TRUE(faces[0].embedding.empty());
+    ASSERT_EQ(faces[0].embedding_q.values.size(), 128u);
+    
+    FaceEmbedding restored = EmbeddingQuantizer::dequantize(faces[0].embedding_q);
+    for (size_t i = 0; i < restored.size(); ++i) {
+        EXPECT_NEAR(restored[i], loose.embedding[i], faces[0].embedding_q.scale);
+    }
+}
+
+TEST_F(DatabaseTest, BulkClusterAssignmentAndSizes) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/bulk.jpg"));
+    
+    std::vector<int64_t> ids;
+    for (int i = 0; i < 5; ++i) {
+        Face face = make_face(photo_id, 100 + i * 50, 100);
+        face.embedding_model = kDefaultEmbeddingModel;
+        ids.push_back(db->insert_face(face));
+    }
+    Face other = make_face(photo_id, 500, 500);
+    other.embedding_model = "other_model";
+    int64_t other_id = db->insert_face(other);
+    
+    db->begin_transaction();
+    db->update_face_clusters({{ids[0], 3}, {ids[1], 3}, {ids[2], 3}, {ids[3], 9}, {other_id, 9}});
+    db->commit();
+    
+    EXPECT_EQ(db->get_face(ids[2])->cluster_id, std::optional<int64_t>(3));
+    EXPECT_EQ(db->get_face(ids[3])->cluster_id, std::optional<int64_t>(9));
+    EXPECT_FALSE(db->get_face(ids[4])->cluster_id.has_value());
+    
+    // Only faces of the requested model are counted
+    auto sizes = db->get_cluster_sizes(kDefaultEmbeddingModel);
+    ASSERT_EQ(sizes.size(), 2u);
+    EXPECT_EQ(sizes[3], 3);
+    EXPECT_EQ(sizes[9], 1);
+}
+
+TEST_F(DatabaseTest, ClusterChangeFeed) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/feed.jpg"));
+    int64_t face_id = db->insert_face(make_face(photo_id, 100, 100));
+    
+    const int64_t start = db->get_cluster_change_sequence();
+    
+    Cluster cluster;
+    cluster.face_count = 1;
+    int64_t a = db->insert_cluster(cluster);
+    int64_t b = db->insert_cluster(cluster);
+    db->update_face_cluster(face_id, a);
+    db->update_face_cluster(face_id, a);  // No change, not logged
+    db->update_face_cluster(face_id, b);
+    
+    Person person;
+    person.name = "Ada";
+    int64_t person_id = db->insert_person(person);
+    db->update_cluster_person(b, person_id);
+    db->delete_cluster(a);
+    
+    auto changes = db->get_cluster_changes(start, 100);
+    ASSERT_EQ(changes.size(), 6u);
+    EXPECT_EQ(changes[0].type, ClusterChange::Type::ClusterCreated);
+    EXPECT_EQ(changes[0].cluster_id, std::optional<int64_t>(a));
+    EXPECT_EQ(changes[2].type, ClusterChange::Type::FaceMoved);
+    EXPECT_EQ(changes[2].face_id, face_id);
+    EXPECT_FALSE(changes[2].from_cluster_id.has_value());
+    EXPECT_EQ(changes[3].from_cluster_id, std::optional<int64_t>(a));
+    EXPECT_EQ(changes[3].cluster_id, std::optional<int64_t>(b));
+    EXPECT_EQ(changes[4].type, ClusterChange::Type::PersonAssigned);
+    EXPECT_EQ(changes[4].person_id, std::optional<int64_t>(person_id));
+    EXPECT_EQ(changes[5].type, ClusterChange::Type::ClusterDeleted);
+    for (size_t i = 1; i < changes.size(); ++i) {
+        EXPECT_EQ(changes[i].sequence, changes[i - 1].sequence + 1);
+    }
+    
+    // Paging, and trimming keeps the sequence going
+    EXPECT_EQ(db->get_cluster_changes(changes[1].sequence, 2).front().sequence, changes[2].sequence);
+    db->trim_cluster_changes(2);
+    EXPECT_EQ(db->get_cluster_changes(start, 100).size(), 2u);
+    EXPECT_EQ(db->get_cluster_change_sequence(), changes.back().sequence);
+    db->insert_cluster(cluster);
+    EXPECT_EQ(db->get_cluster_change_sequence(), changes.back().sequence + 1);
+}
+
+TEST_F(DatabaseTest, MergeByAliasAndCompaction) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/merge.jpg"));
+    
+    Cluster cluster;
+    int64_t a = db->insert_cluster(cluster);
+    int64_t b = db->insert_cluster(cluster);
+    int64_t c = db->insert_cluster(cluster);
+    std::vector<int64_t> ids;
+    for (int i = 0; i < 6; ++i) {
+        Face face = make_face(photo_id, 100 + i * 50, 100);
+        face.embedding_model = kDefaultEmbeddingModel;
+        face.cluster_id = i < 2 ? a : (i < 4 ? b : c);
+        ids.push_back(db->insert_face(face));
+    }
+    
+    // C into B, then B into A: both read as A without touching face rows
+    db->merge_clusters(b, c);
+    db->merge_clusters(a, b);
+    const int64_t start = db->get_cluster_change_sequence();
+    EXPECT_EQ(db->get_faces_for_cluster(a).size(), 6u);
+    EXPECT_EQ(db->get_face(ids[5])->cluster_id, std::optional<int64_t>(a));
+    EXPECT_EQ(db->get_cluster(c)->id, a);
+    EXPECT_EQ(db->get_all_clusters().size(), 1u);
+    EXPECT_EQ(db->count_cluster_faces(a, kDefaultEmbeddingModel), 6);
+    auto sizes = db->get_cluster_sizes(kDefaultEmbeddingModel);
+    ASSERT_EQ(sizes.size(), 1u);
+    EXPECT_EQ(sizes[a], 6);
+    
+    // Moves onto an alias land on its target
+    db->update_face_cluster(ids[0], b);
+    EXPECT_EQ(db->get_face(ids[0])->cluster_id, std::optional<int64_t>(a));
+    db->update_face_clusters({{ids[1], c}});
+    EXPECT_EQ(db->get_face(ids[1])->cluster_id, std::optional<int64_t>(a));
+    
+    // Compaction rewrites the rows quietly and drops the emptied aliases
+    EXPECT_EQ(db->compact_cluster_aliases(3), 3);
+    EXPECT_EQ(db->compact_cluster_aliases(3), 1);
+    EXPECT_EQ(db->compact_cluster_aliases(3), 0);
+    EXPECT_FALSE(db->get_cluster(b).has_value());
+    EXPECT_FALSE(db->get_cluster(c).has_value());
+    EXPECT_EQ(db->get_faces_for_cluster(a).size(), 6u);
+    EXPECT_TRUE(db->get_cluster_changes(start, 100).empty());
+}
+
+TEST_F(DatabaseTest, MergeIsLoggedAsOneChange) {
+    Cluster cluster;
+    int64_t a = db->insert_cluster(cluster);
+    int64_t b = db->insert_cluster(cluster);
+    const int64_t start = db->get_cluster_change_sequence();
+    
+    db->merge_clusters(a, b);
+    
+    auto changes = db->get_cluster_changes(start, 100);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].type, ClusterChange::Type::ClustersMerged);
+    EXPECT_EQ(changes[0].cluster_id, std::optional<int64_t>(a));
+    EXPECT_EQ(changes[0].from_cluster_id, std::optional<int64_t>(b));
+}
+
+TEST_F(DatabaseTest, SetBasedClusterUpdates) {
+    int64_t photo_id = db->insert_photo(make_photo("/photos/sets.jpg"));
+    
+    Cluster cluster;
+    int64_t a = db->insert_cluster(cluster);
+    int64_t b = db->insert_cluster(cluster);
+    std::vector<int64_t> ids;
+    for (int i = 0; i < 4; ++i) {
+        Face face = make_face(photo_id, 100 + i * 50, 100);
+        face.embedding_model = i < 3 ? kDefaultEmbeddingModel : "other_model";
+        face.cluster_id = a;
+        ids.push_back(db->insert_face(face));
+    }
+    
+    EXPECT_EQ(db->move_faces_to_cluster({ids[2], ids[0], ids[2]}, b), 2);
+    EXPECT_EQ(db->get_cluster_face_ids(a), (std::vector<int64_t>{ids[1], ids[3]}));
+    EXPECT_EQ(db->get_cluster_face_ids(b), (std::vector<int64_t>{ids[0], ids[2]}));
+    
+    // Only Ready faces of the requested model
+    auto embeddings = db->get_embeddings({ids[3], ids[1], 999}, kDefaultEmbeddingModel);
+    ASSERT_EQ(embeddings.size(), 1u);
+    EXPECT_EQ(embeddings[0].first, ids[1]);
+    EXPECT_EQ(embeddings[0].second, db->get_face(ids[1])->embedding);
+    
+    int64_t person_id = db->insert_person(make_person("Grace"));
+    EXPECT_EQ(db->update_cluster_faces_person(a, person_id), 2);
+    EXPECT_EQ(db->get_face(ids[3])->person_id, std::optional<int64_t>(person_id));
+    EXPECT_FALSE(db->get_face(ids[0])->person_id.has_value());
+    EXPECT_EQ(db->update_cluster_faces_person(a, std::nullopt), 2);
+    EXPECT_FALSE(db->get_face(ids[1])->person_id.has_value());
+}
+
+TEST_F(DatabaseTest, PhotosForPersonAndCluster) {
+    Photo dated = make_photo("/photos/export/b.jpg");
+    dated.exif_date = "2019:07:04 12:00:00";
+    int64_t first = db->insert_photo(make_photo("/photos/export/a.jpg"));
+    int64_t second = db->insert_photo(dated);
+    int64_t other = db->insert_photo(make_photo("/photos/export/c.jpg"));
+    int64_t person_id = db->insert_person(make_person("Alice"));
+    
+    Cluster cluster;
+    int64_t a = db->insert_cluster(cluster);
+    int64_t b = db->insert_cluster(cluster);
+    for (int64_t photo_id : {second, first, second, other}) {
+        Face face = make_face(photo_id);
+        face.cluster_id = photo_id == other ? b : a;
+        int64_t face_id = db->insert_face(face);
+        if (photo_id != other) {
+            db->update_face_person(face_id, person_id);
+        }
+    }
+    
+    // One entry per photo, in id order, with the photo's full record
+    auto photos = db->get_photos_for_person(person_id);
+    ASSERT_EQ(photos.size(), 2u);
+    EXPECT_EQ(photos[0].id, first);
+    EXPECT_EQ(photos[1].id, second);
+    EXPECT_EQ(photos[1].exif_date, std::optional<std::string>("2019:07:04 12:00:00"));
+    
+    // Clusters merged in by alias count as part of the cluster
+    EXPECT_EQ(db->get_photos_for_cluster(a).size(), 2u);
+    db->merge_clusters(a, b);
+    photos = db->get_photos_for_cluster(a);
+    ASSERT_EQ(photos.size(), 3u);
+    EXPECT_EQ(photos[2].id, other);
+}
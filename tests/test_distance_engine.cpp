@@ -0,0 +1,150 @@
+/**
+ * Pairwise distance engine unit tests.
+ * Checks the blocked kernel against a naive double loop.
+ */
+
+#include <gtest/gtest.h>
+#include "services/DistanceEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+
+using namespace facefling;
+
+class DistanceEngineTest : public ::testing::Test {
+protected:
+    static constexpr size_t kDims = 128;
+    
+    std::vector<float> make_matrix(size_t rows, unsigned seed, float spread = 0.1f) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal(0.0f, spread);
+        std::vector<float> m(rows * kDims);
+        for (auto& v : m) {
+            v = normal(rng);
+        }
+        return m;
+    }
+    
+    float naive_distance(const float* a, const float* b) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < kDims; ++k) {
+            sum += (a[k] - b[k]) * (a[k] - b[k]);
+        }
+        return std::sqrt(sum);
+    }
+    
+    // Small tiles so tests cross many tile boundaries
+    DistanceEngine::Config small_tiles(int threads) {
+        DistanceEngine::Config config;
+        config.threads = threads;
+        config.tile_rows = 7;
+        config.tile_cols = 13;
+        return config;
+    }
+};
+
+TEST_F(DistanceEngineTest, DenseBlockMatchesNaive) {
+    auto a = make_matrix(37, 1);
+    auto b = make_matrix(53, 2);
+    DistanceEngine engine(small_tiles(1));
+    
+    std::vector<float> out(37 * 53);
+    engine.squared_distances(a.data(), 37, b.data(), 53, kDims, out.data());
+    
+    for (size_t i = 0; i < 37; ++i) {
+        for (size_t j = 0; j < 53; ++j) {
+            float expected = naive_distance(&a[i * kDims], &b[j * kDims]);
+            EXPECT_NEAR(std::sqrt(out[i * 53 + j]), expected, 1e-4f);
+        }
+    }
+}
+
+TEST_F(DistanceEngineTest, PairsWithinMatchNaive) {
+    auto a = make_matrix(40, 3);
+    auto b = make_matrix(60, 4);
+    const float threshold = 1.55f;
+    
+    std::vector<std::pair<uint32_t, uint32_t>> expected;
+    for (uint32_t i = 0; i < 40; ++i) {
+        for (uint32_t j = 0; j < 60; ++j) {
+            if (naive_distance(&a[i * kDims], &b[j * kDims]) <= threshold) {
+                expected.emplace_back(i, j);
+            }
+        }
+    }
+    ASSERT_FALSE(expected.empty());
+    ASSERT_LT(expected.size(), 40u * 60u);
+    
+    auto pairs = DistanceEngine(small_tiles(1)).pairs_within(a.data(), 40, b.data(), 60, kDims, threshold);
+    ASSERT_EQ(pairs.size(), expected.size());
+    for (size_t p = 0; p < pairs.size(); ++p) {
+        EXPECT_EQ(pairs[p].a, expected[p].first);
+        EXPECT_EQ(pairs[p].b, expected[p].second);
+    }
+}
+
+TEST_F(DistanceEngineTest, SelfPairsAreUpperTriangle) {
+    auto a = make_matrix(50, 5);
+    auto pairs = DistanceEngine(small_tiles(1)).pairs_within(a.data(), 50, kDims, 100.0f);
+    
+    // Everything is within range: exactly n(n-1)/2 pairs, each with a < b
+    ASSERT_EQ(pairs.size(), 50u * 49u / 2u);
+    for (const auto& pair : pairs) {
+        EXPECT_LT(pair.a, pair.b);
+        EXPECT_NEAR(pair.distance, naive_distance(&a[pair.a * kDims], &a[pair.b * kDims]), 1e-4f);
+    }
+}
+
+TEST_F(DistanceEngineTest, ThreadedMatchesSingleThreaded) {
+    // Large enough to take the parallel path
+    auto a = make_matrix(600, 6);
+    const float threshold = 1.5f;
+    
+    auto single = DistanceEngine(small_tiles(1)).pairs_within(a.data(), 600, kDims, threshold);
+    auto threaded = DistanceEngine(small_tiles(4)).pairs_within(a.data(), 600, kDims, threshold);
+    
+    ASSERT_EQ(single.size(), threaded.size());
+    for (size_t p = 0; p < single.size(); ++p) {
+        EXPECT_EQ(single[p].a, threaded[p].a);
+        EXPECT_EQ(single[p].b, threaded[p].b);
+    }
+}
+
+TEST_F(DistanceEngineTest, StreamedPairsMatchCollected) {
+    auto a = make_matrix(600, 7);
+    const float threshold = 1.5f;
+    DistanceEngine engine(small_tiles(4));
+    
+    std::mutex mutex;
+    std::vector<DistanceEngine::Pair> streamed;
+    engine.for_each_pair_within(a.data(), 600, kDims, threshold,
+        [&](const DistanceEngine::Pair* pairs, size_t count) {
+            std::lock_guard<std::mutex> lock(mutex);
+            streamed.insert(streamed.end(), pairs, pairs + count);
+        });
+    std::sort(streamed.begin(), streamed.end(), [](const auto& x, const auto& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    
+    auto collected = engine.pairs_within(a.data(), 600, kDims, threshold);
+    ASSERT_EQ(streamed.size(), collected.size());
+    for (size_t p = 0; p < collected.size(); ++p) {
+        EXPECT_EQ(streamed[p].a, collected[p].a);
+        EXPECT_EQ(streamed[p].b, collected[p].b);
+    }
+}
+
+TEST_F(DistanceEngineTest, PackZeroesMalformedRows) {
+    std::vector<FaceEmbedding> vectors = {FaceEmbedding(128, 1.0f), FaceEmbedding(3, 2.0f)};
+    auto packed = DistanceEngine::pack(vectors);
+    ASSERT_EQ(packed.size(), 256u);
+    EXPECT_FLOAT_EQ(packed[127], 1.0f);
+    EXPECT_FLOAT_EQ(packed[128], 0.0f);
+}
+
+TEST_F(DistanceEngineTest, EmptyInputs) {
+    DistanceEngine engine;
+    EXPECT_TRUE(engine.pairs_within(nullptr, 0, kDims, 1.0f).empty());
+    EXPECT_TRUE(engine.pairs_within(nullptr, 0, nullptr, 0, kDims, 1.0f).empty());
+}
@@ -0,0 +1,92 @@
+/**
+ * Embedding quantization unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/EmbeddingQuantizer.h"
+#include <cmath>
+#include <random>
+
+using namespace facefling;
+
+class EmbeddingQuantizerTest : public ::testing::Test {
+protected:
+    // Unit-length 128-d vector, roughly the distribution of dlib embeddings
+    FaceEmbedding make_embedding(std::mt19937& rng) {
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        FaceEmbedding emb(128);
+        float norm = 0.0f;
+        for (auto& v : emb) {
+            v = normal(rng);
+            norm += v * v;
+        }
+        for (auto& v : emb) {
+            v /= std::sqrt(norm);
+        }
+        return emb;
+    }
+    
+    float float_distance(const FaceEmbedding& a, const FaceEmbedding& b) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < a.size(); ++i) {
+            sum += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+        return std::sqrt(sum);
+    }
+};
+
+TEST_F(EmbeddingQuantizerTest, RoundTripWithinHalfStep) {
+    std::mt19937 rng(1);
+    FaceEmbedding emb = make_embedding(rng);
+    
+    QuantizedEmbedding code = EmbeddingQuantizer::quantize(emb);
+    ASSERT_EQ(code.values.size(), 128u);
+    
+    FaceEmbedding restored = EmbeddingQuantizer::dequantize(code);
+    for (size_t i = 0; i < emb.size(); ++i) {
+        EXPECT_LE(std::fabs(restored[i] - emb[i]), code.scale * 0.5f + 1e-6f);
+    }
+}
+
+TEST_F(EmbeddingQuantizerTest, DistanceTracksFloat) {
+    std::mt19937 rng(2);
+    for (int trial = 0; trial < 200; ++trial) {
+        FaceEmbedding a = make_embedding(rng);
+        FaceEmbedding b = make_embedding(rng);
+        QuantizedEmbedding qa = EmbeddingQuantizer::quantize(a);
+        QuantizedEmbedding qb = EmbeddingQuantizer::quantize(b);
+        
+        const float exact = float_distance(a, b);
+        const float approx = EmbeddingQuantizer::distance(qa, qb);
+        EXPECT_LE(std::fabs(exact - approx), EmbeddingQuantizer::max_error(qa, qb));
+        EXPECT_LT(std::fabs(exact - approx), 0.02f);
+    }
+}
+
+TEST_F(EmbeddingQuantizerTest, IdenticalVectorsHaveZeroDistance) {
+    std::mt19937 rng(3);
+    QuantizedEmbedding code = EmbeddingQuantizer::quantize(make_embedding(rng));
+    EXPECT_FLOAT_EQ(EmbeddingQuantizer::distance(code, code), 0.0f);
+}
+
+TEST_F(EmbeddingQuantizerTest, EncodeDecodeRoundTrip) {
+    std::mt19937 rng(4);
+    QuantizedEmbedding code = EmbeddingQuantizer::quantize(make_embedding(rng));
+    
+    auto bytes = EmbeddingQuantizer::encode(code);
+    EXPECT_EQ(bytes.size(), 132u);
+    
+    QuantizedEmbedding decoded = EmbeddingQuantizer::decode(bytes.data(), static_cast<int>(bytes.size()));
+    EXPECT_EQ(decoded.values, code.values);
+    EXPECT_FLOAT_EQ(decoded.scale, code.scale);
+    EXPECT_EQ(decoded.norm_sq, code.norm_sq);
+}
+
+TEST_F(EmbeddingQuantizerTest, EmptyAndZeroVectors) {
+    EXPECT_TRUE(EmbeddingQuantizer::quantize({}).empty());
+    EXPECT_TRUE(std::isinf(EmbeddingQuantizer::distance({}, {})));
+    
+    QuantizedEmbedding zero = EmbeddingQuantizer::quantize(FaceEmbedding(128, 0.0f));
+    EXPECT_EQ(zero.norm_sq, 0);
+    EXPECT_GT(zero.scale, 0.0f);
+}
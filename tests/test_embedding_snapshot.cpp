@@ -0,0 +1,222 @@
+/**
+ * Embedding snapshot unit tests.
+ * Tests the mmap'd snapshot against a real SQLite database.
+ */
+
+#include <gtest/gtest.h>
+#include "services/EmbeddingSnapshot.h"
+#include "services/Database.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace facefling;
+
+class EmbeddingSnapshotTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        db_path = fs::temp_directory_path() / "facefling_snapshot_test.db";
+        snapshot_path = fs::temp_directory_path() / "facefling_snapshot_test.snap";
+        fs::remove(db_path);
+        fs::remove(snapshot_path);
+        
+        db = std::make_unique<Database>(db_path.string());
+        db->initialize();
+        photo_id = db->insert_photo(make_photo());
+    }
+    
+    void TearDown() override {
+        db.reset();
+        fs::remove(db_path);
+        fs::remove(snapshot_path);
+    }
+    
+    Photo make_photo() {
+        Photo p;
+        p.file_path = "/photos/snapshot.jpg";
+        p.file_name = "snapshot.jpg";
+        p.folder_path = "/photos";
+        p.scan_date = "2026-02-22T10:00:00Z";
+        return p;
+    }
+    
+    int64_t add_pending_face() {
+        Face f;
+        f.photo_id = photo_id;
+        f.bbox = {10, 10, 80, 80};
+        f.embedding_state = EmbeddingState::Pending;
+        return db->insert_face(f);
+    }
+    
+    int64_t add_face(float base, const std::string& model = kDefaultEmbeddingModel) {
+        Face f;
+        f.photo_id = photo_id;
+        f.bbox = {10, 10, 80, 80};
+        f.embedding_model = model;
+        f.embedding.resize(128);
+        for (int i = 0; i < 128; ++i) {
+            f.embedding[i] = base + static_cast<float>(i) * 0.001f;
+        }
+        return db->insert_face(f);
+    }
+    
+    fs::path db_path;
+    fs::path snapshot_path;
+    std::unique_ptr<Database> db;
+    int64_t photo_id = 0;
+};
+
+TEST_F(EmbeddingSnapshotTest, BuildsFromDatabase) {
+    int64_t a = add_face(0.1f);
+    int64_t b = add_face(0.2f);
+    add_face(0.3f, "other_model");
+    
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    EXPECT_FALSE(snapshot.open());
+    
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_TRUE(snapshot.get_stats().rebuilt);
+    ASSERT_EQ(snapshot.size(), 2u);
+    EXPECT_EQ(snapshot.face_ids()[0], a);
+    EXPECT_EQ(snapshot.face_ids()[1], b);
+    EXPECT_FLOAT_EQ(snapshot.row(1)[5], 0.205f);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(snapshot.matrix()) % 64, 0u);
+    EXPECT_TRUE(snapshot.is_current(*db, kDefaultEmbeddingModel));
+}
+
+TEST_F(EmbeddingSnapshotTest, ReopensWithoutDatabase) {
+    add_face(0.1f);
+    {
+        EmbeddingSnapshot snapshot(snapshot_path.string());
+        snapshot.sync(*db, kDefaultEmbeddingModel);
+    }
+    
+    EmbeddingSnapshot reopened(snapshot_path.string());
+    ASSERT_TRUE(reopened.open());
+    EXPECT_EQ(reopened.size(), 1u);
+    EXPECT_EQ(reopened.model(), kDefaultEmbeddingModel);
+    EXPECT_EQ(reopened.generation(), db->get_embedding_generation(kDefaultEmbeddingModel));
+    EXPECT_TRUE(reopened.is_current(*db, kDefaultEmbeddingModel));
+    
+    reopened.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_FALSE(reopened.get_stats().rebuilt);
+    EXPECT_EQ(reopened.get_stats().rows_appended, 0);
+}
+
+TEST_F(EmbeddingSnapshotTest, AppendsNewFacesInPlace) {
+    add_face(0.1f);
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    
+    int64_t added = add_face(0.4f);
+    EXPECT_FALSE(snapshot.is_current(*db, kDefaultEmbeddingModel));
+    
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_FALSE(snapshot.get_stats().rebuilt);
+    EXPECT_EQ(snapshot.get_stats().rows_appended, 1);
+    ASSERT_EQ(snapshot.size(), 2u);
+    EXPECT_EQ(snapshot.face_ids()[1], added);
+    EXPECT_FLOAT_EQ(snapshot.row(1)[0], 0.4f);
+}
+
+TEST_F(EmbeddingSnapshotTest, GrowsPastCapacity) {
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    add_face(0.0f);
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    
+    db->begin_transaction();
+    for (int i = 0; i < 1500; ++i) {
+        add_face(static_cast<float>(i) * 0.0001f);
+    }
+    db->commit();
+    
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_FALSE(snapshot.get_stats().rebuilt);
+    EXPECT_EQ(snapshot.get_stats().rows_appended, 1500);
+    EXPECT_EQ(snapshot.size(), 1501u);
+    EXPECT_TRUE(snapshot.is_current(*db, kDefaultEmbeddingModel));
+}
+
+TEST_F(EmbeddingSnapshotTest, RebuildsWhenEmbeddingChanges) {
+    int64_t a = add_face(0.1f);
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    
+    db->update_face_embedding(a, FaceEmbedding(128, 0.9f), kDefaultEmbeddingModel);
+    EXPECT_FALSE(snapshot.is_current(*db, kDefaultEmbeddingModel));
+    
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_TRUE(snapshot.get_stats().rebuilt);
+    ASSERT_EQ(snapshot.size(), 1u);
+    EXPECT_FLOAT_EQ(snapshot.row(0)[0], 0.9f);
+}
+
+TEST_F(EmbeddingSnapshotTest, AppendsDeferredFacesWhenReady) {
+    int64_t a = add_face(0.1f);
+    int64_t deferred = add_pending_face();
+    int64_t b = add_face(0.2f);
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    ASSERT_EQ(snapshot.size(), 2u);
+    EXPECT_FALSE(snapshot.find(deferred).has_value());
+    
+    db->update_face_embedding(deferred, FaceEmbedding(128, 0.5f), kDefaultEmbeddingModel);
+    EXPECT_FALSE(snapshot.is_current(*db, kDefaultEmbeddingModel));
+    
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_FALSE(snapshot.get_stats().rebuilt);
+    EXPECT_EQ(snapshot.get_stats().rows_appended, 1);
+    ASSERT_EQ(snapshot.size(), 3u);
+    EXPECT_EQ(snapshot.face_ids()[2], deferred);
+    EXPECT_EQ(snapshot.find(a), std::optional<size_t>(0));
+    EXPECT_EQ(snapshot.find(b), std::optional<size_t>(1));
+    EXPECT_EQ(snapshot.find(deferred), std::optional<size_t>(2));
+    EXPECT_FLOAT_EQ(snapshot.row(*snapshot.find(deferred))[0], 0.5f);
+    
+    // The same order survives reopening
+    EmbeddingSnapshot reopened(snapshot_path.string());
+    ASSERT_TRUE(reopened.open());
+    EXPECT_EQ(reopened.find(deferred), std::optional<size_t>(2));
+    EXPECT_TRUE(reopened.is_current(*db, kDefaultEmbeddingModel));
+}
+
+TEST_F(EmbeddingSnapshotTest, ReembeddingAppendsToTheNewModel) {
+    int64_t old_face = add_face(0.1f, "old_model");
+    add_face(0.2f);
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    const int64_t old_generation = db->get_embedding_generation("old_model");
+    
+    db->update_face_embedding(old_face, FaceEmbedding(128, 0.3f), kDefaultEmbeddingModel);
+    EXPECT_NE(db->get_embedding_generation("old_model"), old_generation);
+    
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_FALSE(snapshot.get_stats().rebuilt);
+    EXPECT_EQ(snapshot.get_stats().rows_appended, 1);
+    EXPECT_EQ(snapshot.find(old_face), std::optional<size_t>(1));
+}
+
+TEST_F(EmbeddingSnapshotTest, RebuildsForOtherModel) {
+    add_face(0.1f);
+    add_face(0.2f, "other_model");
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    
+    snapshot.sync(*db, "other_model");
+    EXPECT_TRUE(snapshot.get_stats().rebuilt);
+    EXPECT_EQ(snapshot.size(), 1u);
+    EXPECT_EQ(snapshot.model(), "other_model");
+}
+
+TEST_F(EmbeddingSnapshotTest, RejectsMalformedFile) {
+    {
+        std::ofstream out(snapshot_path, std::ios::binary);
+        out << std::string(4096, 'x');
+    }
+    EmbeddingSnapshot snapshot(snapshot_path.string());
+    EXPECT_FALSE(snapshot.open());
+    
+    add_face(0.1f);
+    snapshot.sync(*db, kDefaultEmbeddingModel);
+    EXPECT_EQ(snapshot.size(), 1u);
+}
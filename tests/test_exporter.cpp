@@ -0,0 +1,216 @@
+/**
+ * Exporter unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "core/Exporter.h"
+#include "services/Database.h"
+#include "models/Photo.h"
+#include "models/Face.h"
+#include "models/Cluster.h"
+#include "models/Person.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+using namespace facefling;
+
+class ExporterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir = fs::temp_directory_path() / "facefling_export_test";
+        fs::remove_all(test_dir);
+        fs::create_directories(test_dir / "out");
+        
+        database = std::make_shared<Database>((test_dir / "test.db").string());
+        database->initialize();
+        
+        Person person;
+        person.name = "Alice";
+        person.created_date = "2026-02-22T10:00:00Z";
+        person_id = database->insert_person(person);
+        cluster_id = database->insert_cluster(Cluster{});
+    }
+    
+    void TearDown() override {
+        database.reset();
+        fs::remove_all(test_dir);
+    }
+    
+    // Write a photo file and record it with one face of Alice
+    fs::path add_photo(const std::string& relative_path, const std::string& contents,
+                       std::optional<std::string> exif_date = std::nullopt) {
+        const fs::path path = test_dir / "photos" / relative_path;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path, std::ios::binary) << contents;
+        
+        Photo photo;
+        photo.file_path = path.string();
+        photo.file_name = path.filename().string();
+        photo.folder_path = path.parent_path().string();
+        photo.file_size = static_cast<int64_t>(contents.size());
+        photo.exif_date = exif_date;
+        photo.scan_date = "2026-02-22T10:00:00Z";
+        const int64_t photo_id = database->insert_photo(photo);
+        
+        Face face;
+        face.photo_id = photo_id;
+        face.bbox = {10, 10, 50, 50};
+        face.cluster_id = cluster_id;
+        database->update_face_person(database->insert_face(face), person_id);
+        return path;
+    }
+    
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    
+    Exporter::Options plain_options() const {
+        Exporter::Options options;
+        options.include_date = false;
+        options.include_original_folder = false;
+        options.workers = 2;
+        return options;
+    }
+    
+    fs::path test_dir;
+    std::shared_ptr<Database> database;
+    int64_t person_id = 0;
+    int64_t cluster_id = 0;
+};
+
+TEST_F(ExporterTest, CopiesWithCollisionSuffixes) {
+    const fs::path first = add_photo("2019/IMG_1.jpg", "first photo");
+    add_photo("2020/img_1.JPG", "second");
+    add_photo("2020/IMG_2.jpg", std::string(3u << 20, 'x'));
+    
+    Exporter exporter(database);
+    int last = 0;
+    int total = 0;
+    exporter.export_person(person_id, (test_dir / "out").string(), plain_options(),
+                           [&](int current, int count) {
+                               EXPECT_EQ(current, last + 1);
+                               last = current;
+                               total = count;
+                           });
+    
+    EXPECT_EQ(last, 3);
+    EXPECT_EQ(total, 3);
+    EXPECT_EQ(read_file(test_dir / "out" / "Alice_IMG_1.jpg"), "first photo");
+    EXPECT_EQ(read_file(test_dir / "out" / "Alice_img_1_2.JPG"), "second");
+    EXPECT_EQ(fs::file_size(test_dir / "out" / "Alice_IMG_2.jpg"), 3u << 20);
+    EXPECT_EQ(fs::last_write_time(test_dir / "out" / "Alice_IMG_1.jpg"), fs::last_write_time(first));
+    
+    auto stats = exporter.get_stats();
+    EXPECT_EQ(stats.files_total, 3);
+    EXPECT_EQ(stats.cloned + stats.copied, 3);
+    EXPECT_EQ(stats.failed, 0);
+}
+
+TEST_F(ExporterTest, ResumesAPartialExport) {
+    add_photo("a/one.jpg", "one");
+    add_photo("b/one.jpg", "two");
+    add_photo("c/three.jpg", "three");
+    const fs::path out = test_dir / "out";
+    
+    Exporter exporter(database);
+    exporter.export_person(person_id, out.string(), plain_options());
+    
+    // Interrupted run: one file never made it, another was left half-written
+    fs::remove(out / "Alice_one_2.jpg");
+    fs::remove(out / "Alice_three.jpg");
+    std::ofstream(out / "Alice_three.jpg.part") << "th";
+    
+    exporter.export_person(person_id, out.string(), plain_options());
+    auto stats = exporter.get_stats();
+    EXPECT_EQ(stats.skipped, 1);
+    EXPECT_EQ(stats.cloned + stats.copied, 2);
+    EXPECT_EQ(read_file(out / "Alice_one.jpg"), "one");
+    EXPECT_EQ(read_file(out / "Alice_one_2.jpg"), "two");
+    EXPECT_EQ(read_file(out / "Alice_three.jpg"), "three");
+    EXPECT_FALSE(fs::exists(out / "Alice_three.jpg.part"));
+}
+
+TEST_F(ExporterTest, ResumeAllowsForCoarseTimestamps) {
+    const fs::path source = add_photo("a/one.jpg", "one");
+    const fs::path out = test_dir / "out";
+    
+    Exporter exporter(database);
+    exporter.export_person(person_id, out.string(), plain_options());
+    
+    // As a FAT drive would store it: rounded up to the next even second
+    fs::last_write_time(out / "Alice_one.jpg", fs::last_write_time(source) + std::chrono::milliseconds(1500));
+    exporter.export_person(person_id, out.string(), plain_options());
+    EXPECT_EQ(exporter.get_stats().skipped, 1);
+    EXPECT_FALSE(fs::exists(out / "Alice_one_2.jpg"));
+}
+
+TEST_F(ExporterTest, ProgressMayReadStats) {
+    add_photo("a/one.jpg", "one");
+    add_photo("a/two.jpg", "two");
+    
+    Exporter exporter(database);
+    int64_t seen = 0;
+    exporter.export_person(person_id, (test_dir / "out").string(), plain_options(),
+                           [&](int, int) {
+                               auto stats = exporter.get_stats();
+                               seen = stats.copied + stats.cloned;
+                           });
+    EXPECT_EQ(seen, 2);
+}
+
+TEST_F(ExporterTest, UnrelatedFilesAreNotOverwritten) {
+    add_photo("a/one.jpg", "photo");
+    std::ofstream(test_dir / "out" / "Alice_one.jpg") << "someone else's file";
+    
+    Exporter exporter(database);
+    exporter.export_person(person_id, (test_dir / "out").string(), plain_options());
+    
+    EXPECT_EQ(read_file(test_dir / "out" / "Alice_one.jpg"), "someone else's file");
+    EXPECT_EQ(read_file(test_dir / "out" / "Alice_one_2.jpg"), "photo");
+}
+
+TEST_F(ExporterTest, HardlinksOnTheSameFilesystem) {
+    const fs::path source = add_photo("a/one.jpg", "linked");
+    
+    Exporter::Options options = plain_options();
+    options.hardlink = true;
+    Exporter exporter(database);
+    exporter.export_person(person_id, (test_dir / "out").string(), options);
+    
+    EXPECT_EQ(exporter.get_stats().linked, 1);
+    EXPECT_TRUE(fs::equivalent(source, test_dir / "out" / "Alice_one.jpg"));
+    
+    // A rerun recognises the link
+    exporter.export_person(person_id, (test_dir / "out").string(), options);
+    EXPECT_EQ(exporter.get_stats().skipped, 1);
+}
+
+TEST_F(ExporterTest, NamesIncludeDateAndFolder) {
+    add_photo("Holiday/IMG_9.jpg", "dated", "2019:07:04 12:00:00");
+    
+    Exporter::Options options;
+    Exporter exporter(database);
+    exporter.export_cluster(cluster_id, (test_dir / "out").string(), options);
+    
+    // The cluster has no person, so no name prefix
+    EXPECT_TRUE(fs::exists(test_dir / "out" / "2019-07-04_Holiday_IMG_9.jpg"));
+}
+
+TEST_F(ExporterTest, MissingSourcesAndUnknownIds) {
+    const fs::path gone = add_photo("a/gone.jpg", "gone");
+    add_photo("a/kept.jpg", "kept");
+    fs::remove(gone);
+    
+    Exporter exporter(database);
+    exporter.export_person(person_id, (test_dir / "out").string(), plain_options());
+    auto stats = exporter.get_stats();
+    EXPECT_EQ(stats.failed, 1);
+    EXPECT_EQ(stats.cloned + stats.copied, 1);
+    
+    EXPECT_THROW(exporter.export_person(person_id + 100, (test_dir / "out").string(), plain_options()), std::invalid_argument);
+    EXPECT_THROW(exporter.export_cluster(cluster_id + 100, (test_dir / "out").string(), plain_options()), std::invalid_argument);
+}
@@ -0,0 +1,87 @@
+/**
+ * Face quality measure unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/FaceQuality.h"
+#include <vector>
+
+using namespace facefling;
+
+class FaceQualityTest : public ::testing::Test {
+protected:
+    // 68 landmarks with the jaw ends and nose tip at the given x positions
+    std::vector<std::pair<int, int>> make_landmarks(int jaw_left, int nose, int jaw_right) {
+        std::vector<std::pair<int, int>> landmarks(68, {100, 100});
+        landmarks[0] = {jaw_left, 100};
+        landmarks[16] = {jaw_right, 100};
+        landmarks[30] = {nose, 120};
+        return landmarks;
+    }
+    
+    // Grayscale image: checkerboard of the given cell size
+    std::vector<unsigned char> make_checkerboard(int size, int cell) {
+        std::vector<unsigned char> gray(static_cast<size_t>(size) * size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                gray[static_cast<size_t>(y) * size + x] = ((x / cell + y / cell) % 2) ? 200 : 50;
+            }
+        }
+        return gray;
+    }
+};
+
+TEST_F(FaceQualityTest, FrontalFaceScoresHigh) {
+    EXPECT_NEAR(FaceQuality::pose_score(make_landmarks(0, 50, 100)), 1.0f, 1e-6f);
+}
+
+TEST_F(FaceQualityTest, TurnedFaceScoresLower) {
+    float slight = FaceQuality::pose_score(make_landmarks(0, 40, 100));
+    float strong = FaceQuality::pose_score(make_landmarks(0, 90, 100));
+    
+    EXPECT_LT(slight, 1.0f);
+    EXPECT_LT(strong, slight);
+    EXPECT_NEAR(strong, 10.0f / 90.0f, 1e-5f);
+}
+
+TEST_F(FaceQualityTest, ProfileFaceScoresZero) {
+    // Nose beyond the visible jaw line
+    EXPECT_EQ(FaceQuality::pose_score(make_landmarks(0, 110, 100)), 0.0f);
+}
+
+TEST_F(FaceQualityTest, NonStandardLandmarksAreNotPenalized) {
+    std::vector<std::pair<int, int>> five_points(5, {10, 10});
+    EXPECT_EQ(FaceQuality::pose_score(five_points), 1.0f);
+    EXPECT_EQ(FaceQuality::pose_score({}), 1.0f);
+}
+
+TEST_F(FaceQualityTest, FlatImageHasZeroSharpness) {
+    std::vector<unsigned char> flat(64 * 64, 128);
+    EXPECT_DOUBLE_EQ(FaceQuality::laplacian_variance(flat.data(), 64, 64), 0.0);
+}
+
+TEST_F(FaceQualityTest, FineDetailIsSharperThanCoarse) {
+    auto fine = make_checkerboard(64, 2);
+    auto coarse = make_checkerboard(64, 16);
+    
+    double fine_var = FaceQuality::laplacian_variance(fine.data(), 64, 64);
+    double coarse_var = FaceQuality::laplacian_variance(coarse.data(), 64, 64);
+    
+    EXPECT_GT(coarse_var, 0.0);
+    EXPECT_GT(fine_var, coarse_var);
+}
+
+TEST_F(FaceQualityTest, TinyImageHasZeroSharpness) {
+    unsigned char pixels[4] = {0, 255, 255, 0};
+    EXPECT_DOUBLE_EQ(FaceQuality::laplacian_variance(pixels, 2, 2), 0.0);
+    EXPECT_DOUBLE_EQ(FaceQuality::laplacian_variance(nullptr, 64, 64), 0.0);
+}
+
+TEST_F(FaceQualityTest, CombineScalesPoseBySharpness) {
+    EXPECT_FLOAT_EQ(FaceQuality::combine(1.0f, 200.0, 100.0), 1.0f);
+    EXPECT_FLOAT_EQ(FaceQuality::combine(0.8f, 50.0, 100.0), 0.4f);
+    EXPECT_FLOAT_EQ(FaceQuality::combine(0.5f, 0.0, 100.0), 0.0f);
+    
+    // No reference disables the sharpness term
+    EXPECT_FLOAT_EQ(FaceQuality::combine(0.7f, 0.0, 0.0), 0.7f);
+}
@@ -0,0 +1,152 @@
+/**
+ * Graph clustering unit tests.
+ * Graphs are built with KnnGraph over synthetic embeddings.
+ */
+
+#include <gtest/gtest.h>
+#include "services/GraphClusterer.h"
+#include "services/KnnGraph.h"
+#include <random>
+
+using namespace facefling;
+
+class GraphClustererTest : public ::testing::Test {
+protected:
+    static constexpr size_t kDims = 128;
+    
+    std::vector<float> rows;
+    std::mt19937 rng{7};
+    
+    // Random direction scaled to the given length
+    std::vector<float> offset(float length) {
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> v(kDims);
+        float norm = 0.0f;
+        for (auto& x : v) {
+            x = normal(rng);
+            norm += x * x;
+        }
+        for (auto& x : v) {
+            x *= length / std::sqrt(norm);
+        }
+        return v;
+    }
+    
+    void add_row(const std::vector<float>& v) {
+        rows.insert(rows.end(), v.begin(), v.end());
+    }
+    
+    // Tight group of faces around a centre (pairwise distances ~0.14)
+    void add_blob(const std::vector<float>& centre, size_t count) {
+        std::normal_distribution<float> noise(0.0f, 0.01f);
+        for (size_t i = 0; i < count; ++i) {
+            std::vector<float> v = centre;
+            for (auto& x : v) {
+                x += noise(rng);
+            }
+            add_row(v);
+        }
+    }
+    
+    size_t size() const {
+        return rows.size() / kDims;
+    }
+    
+    void build(KnnGraph& graph) {
+        std::vector<int64_t> ids(size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            ids[i] = static_cast<int64_t>(i + 1);
+        }
+        graph.build(rows.data(), ids.data(), size(), kDims);
+    }
+    
+    GraphClusterer::Config config() {
+        GraphClusterer::Config c;
+        c.threshold = 0.6f;
+        c.threads = 1;
+        return c;
+    }
+};
+
+TEST_F(GraphClustererTest, SeparateGroupsFoundByBothMethods) {
+    const std::vector<float> a = offset(1.0f);
+    const std::vector<float> b = offset(1.0f);
+    const std::vector<float> c = offset(1.0f);
+    add_blob(a, 30);
+    add_blob(b, 25);
+    add_blob(c, 20);
+    
+    KnnGraph graph("");
+    build(graph);
+    GraphClusterer clusterer(config());
+    
+    for (const auto& labels : {clusterer.chinese_whispers(graph), clusterer.connected_components(graph)}) {
+        ASSERT_EQ(labels.size(), 75u);
+        EXPECT_EQ(GraphClusterer::label_count(labels), 3u);
+        for (size_t i = 0; i < 75; ++i) {
+            const size_t group = i < 30 ? 0 : (i < 55 ? 30 : 55);
+            EXPECT_EQ(labels[i], labels[group]);
+        }
+        EXPECT_NE(labels[0], labels[30]);
+        EXPECT_NE(labels[30], labels[55]);
+    }
+}
+
+TEST_F(GraphClustererTest, ChainJoinsComponentsButNotWhispers) {
+    // Two groups 3.0 apart, linked by a chain of single faces 0.4 apart
+    const std::vector<float> a(kDims, 0.0f);
+    const std::vector<float> step = offset(0.4f);
+    std::vector<float> b(kDims);
+    for (size_t d = 0; d < kDims; ++d) {
+        b[d] = step[d] * 7.5f;
+    }
+    add_blob(a, 40);
+    add_blob(b, 40);
+    for (int s = 1; s <= 6; ++s) {
+        std::vector<float> v(kDims);
+        for (size_t d = 0; d < kDims; ++d) {
+            v[d] = step[d] * (s + 0.25f);
+        }
+        add_row(v);
+    }
+    
+    KnnGraph graph("");
+    build(graph);
+    GraphClusterer clusterer(config());
+    
+    auto components = clusterer.connected_components(graph);
+    EXPECT_EQ(GraphClusterer::label_count(components), 1u);
+    
+    auto whispers = clusterer.chinese_whispers(graph);
+    for (size_t i = 0; i < 40; ++i) {
+        EXPECT_EQ(whispers[i], whispers[0]);
+        EXPECT_EQ(whispers[40 + i], whispers[40]);
+    }
+    EXPECT_NE(whispers[0], whispers[40]);
+}
+
+TEST_F(GraphClustererTest, EdgesBeyondThresholdAreIgnored) {
+    add_blob(offset(1.0f), 10);
+    add_row(offset(1.0f));    // Far from everything
+    
+    KnnGraph graph("");
+    build(graph);
+    auto c = config();
+    GraphClusterer clusterer(c);
+    
+    auto labels = clusterer.chinese_whispers(graph);
+    EXPECT_EQ(GraphClusterer::label_count(labels), 2u);
+    EXPECT_EQ(labels[10], 1u);
+    
+    // Below the blob's own spread every face stands alone
+    c.threshold = 0.01f;
+    EXPECT_EQ(GraphClusterer::label_count(GraphClusterer(c).connected_components(graph)), 11u);
+}
+
+TEST_F(GraphClustererTest, EmptyGraph) {
+    KnnGraph graph("");
+    GraphClusterer clusterer(config());
+    EXPECT_TRUE(clusterer.chinese_whispers(graph).empty());
+    EXPECT_TRUE(clusterer.connected_components(graph).empty());
+    EXPECT_EQ(GraphClusterer::label_count({}), 0u);
+}
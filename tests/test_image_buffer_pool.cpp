@@ -0,0 +1,92 @@
+/**
+ * Pixel buffer pool unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/ImageBufferPool.h"
+
+using namespace facefling;
+
+TEST(ImageBufferPoolTest, SizeClassesRoundUpInQuarterSteps) {
+    EXPECT_EQ(ImageBufferPool::size_class(0), 4096u);
+    EXPECT_EQ(ImageBufferPool::size_class(4096), 4096u);
+    EXPECT_EQ(ImageBufferPool::size_class(5000), 5120u);
+    EXPECT_EQ(ImageBufferPool::size_class(8192), 8192u);
+    EXPECT_EQ(ImageBufferPool::size_class(10000), 10240u);
+    EXPECT_EQ(ImageBufferPool::size_class(16385), 20480u);
+}
+
+TEST(ImageBufferPoolTest, CountsHitsAndMisses) {
+    ImageBufferPool pool;
+    
+    auto buffer = pool.acquire(10000);
+    EXPECT_EQ(buffer.size(), 10000u);
+    EXPECT_EQ(buffer.capacity(), ImageBufferPool::size_class(10000));
+    auto stats = pool.get_stats();
+    EXPECT_EQ(stats.hits, 0);
+    EXPECT_EQ(stats.misses, 1);
+    
+    pool.release(std::move(buffer));
+    EXPECT_EQ(pool.get_stats().pooled_bytes, 10240u);
+    
+    // Any request of the same class is served from the pool
+    buffer = pool.acquire(9500);
+    EXPECT_EQ(buffer.size(), 9500u);
+    stats = pool.get_stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.pooled_bytes, 0u);
+    
+    // Other classes still allocate
+    auto other = pool.acquire(100000);
+    EXPECT_EQ(pool.get_stats().misses, 2);
+}
+
+TEST(ImageBufferPoolTest, ReusesBufferReturnedShorter) {
+    ImageBufferPool pool;
+    
+    auto buffer = pool.acquire(10000);
+    buffer.resize(9000);
+    const unsigned char* storage = buffer.data();
+    pool.release(std::move(buffer));
+    
+    // Growing back within the class keeps the same storage
+    auto reused = pool.acquire(10200);
+    EXPECT_EQ(reused.size(), 10200u);
+    EXPECT_EQ(reused.data(), storage);
+    EXPECT_EQ(pool.get_stats().hits, 1);
+}
+
+TEST(ImageBufferPoolTest, PooledBytesStayWithinLimit) {
+    ImageBufferPool pool(16384);
+    
+    auto a = pool.acquire(10000);
+    auto b = pool.acquire(10000);
+    pool.release(std::move(a));
+    pool.release(std::move(b));
+    EXPECT_EQ(pool.get_stats().pooled_bytes, 10240u);
+    
+    auto small = pool.acquire(4096);
+    pool.release(std::move(small));
+    EXPECT_EQ(pool.get_stats().pooled_bytes, 14336u);
+    
+    pool.clear();
+    EXPECT_EQ(pool.get_stats().pooled_bytes, 0u);
+    pool.acquire(10000);
+    EXPECT_EQ(pool.get_stats().hits, 0);
+}
+
+TEST(ImageBufferPoolTest, DropsBuffersOutsideSizeClasses) {
+    ImageBufferPool pool;
+    
+    std::vector<unsigned char> odd;
+    odd.reserve(5000);
+    ASSERT_NE(ImageBufferPool::size_class(odd.capacity()), odd.capacity());
+    pool.release(std::move(odd));
+    pool.release(std::vector<unsigned char>());
+    EXPECT_EQ(pool.get_stats().pooled_bytes, 0u);
+    
+    pool.acquire(5000);
+    EXPECT_EQ(pool.get_stats().hits, 0);
+    EXPECT_EQ(pool.get_stats().misses, 1);
+}
@@ -0,0 +1,87 @@
+/**
+ * k-means unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/KMeans.h"
+#include <random>
+#include <set>
+
+using namespace facefling;
+
+namespace {
+
+constexpr size_t kDims = 8;
+
+// count rows around each of the given centres (spread 0.05)
+std::vector<float> make_blobs(const std::vector<std::vector<float>>& centres, size_t count) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<float> matrix;
+    for (const auto& centre : centres) {
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t d = 0; d < kDims; ++d) {
+                matrix.push_back(centre[d] + noise(rng));
+            }
+        }
+    }
+    return matrix;
+}
+
+std::vector<float> axis(size_t d, float value) {
+    std::vector<float> v(kDims, 0.0f);
+    v[d] = value;
+    return v;
+}
+
+} // namespace
+
+TEST(KMeansTest, RecoversSeparatedBlobs) {
+    const size_t per_blob = 200;
+    const auto matrix = make_blobs({axis(0, 5.0f), axis(1, 5.0f), axis(2, 5.0f)}, per_blob);
+    const size_t n = matrix.size() / kDims;
+    
+    KMeans kmeans;
+    const auto centroids = kmeans.train(matrix.data(), n, kDims, 3);
+    ASSERT_EQ(centroids.size(), 3 * kDims);
+    
+    const auto cells = kmeans.assign(matrix.data(), n, centroids.data(), 3, kDims);
+    ASSERT_EQ(cells.size(), n);
+    
+    // Every blob lands in one cell, and the blobs in different cells
+    std::set<uint32_t> blob_cells;
+    for (size_t b = 0; b < 3; ++b) {
+        const uint32_t cell = cells[b * per_blob];
+        for (size_t i = 0; i < per_blob; ++i) {
+            EXPECT_EQ(cells[b * per_blob + i], cell);
+        }
+        blob_cells.insert(cell);
+    }
+    EXPECT_EQ(blob_cells.size(), 3u);
+}
+
+TEST(KMeansTest, AssignPicksNearestCentroid) {
+    std::vector<float> centroids;
+    for (size_t d = 0; d < 3; ++d) {
+        const auto c = axis(d, 1.0f);
+        centroids.insert(centroids.end(), c.begin(), c.end());
+    }
+    
+    std::vector<float> rows;
+    for (size_t d : {2, 0, 1}) {
+        const auto r = axis(d, 0.9f);
+        rows.insert(rows.end(), r.begin(), r.end());
+    }
+    
+    KMeans kmeans;
+    EXPECT_EQ(kmeans.assign(rows.data(), 3, centroids.data(), 3, kDims),
+              (std::vector<uint32_t>{2, 0, 1}));
+}
+
+TEST(KMeansTest, ClampsKToRowCount) {
+    const auto matrix = make_blobs({axis(0, 1.0f)}, 4);
+    
+    KMeans kmeans;
+    EXPECT_EQ(kmeans.train(matrix.data(), 4, kDims, 10).size(), 4 * kDims);
+    EXPECT_EQ(kmeans.train(matrix.data(), 4, kDims, 0).size(), kDims);
+}
@@ -0,0 +1,256 @@
+/**
+ * kNN graph unit tests.
+ * Exact graphs are checked against brute force; the IVF path for recall.
+ */
+
+#include <gtest/gtest.h>
+#include "services/KnnGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <set>
+
+using namespace facefling;
+
+class KnnGraphTest : public ::testing::Test {
+protected:
+    static constexpr size_t kDims = 128;
+    
+    std::string path = "/tmp/facefling_test_knn.graph";
+    
+    void SetUp() override {
+        std::remove(path.c_str());
+    }
+    
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+    
+    // Points scattered around a few centres, like faces of a few people
+    std::vector<float> make_clusters(size_t rows, size_t centres, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> wide(0.0f, 0.3f);
+        std::normal_distribution<float> tight(0.0f, 0.03f);
+        std::vector<float> means(centres * kDims);
+        for (auto& v : means) {
+            v = wide(rng);
+        }
+        std::vector<float> m(rows * kDims);
+        for (size_t i = 0; i < rows; ++i) {
+            const size_t c = i % centres;
+            for (size_t d = 0; d < kDims; ++d) {
+                m[i * kDims + d] = means[c * kDims + d] + tight(rng);
+            }
+        }
+        return m;
+    }
+    
+    std::vector<int64_t> make_ids(size_t rows) {
+        std::vector<int64_t> ids(rows);
+        for (size_t i = 0; i < rows; ++i) {
+            ids[i] = static_cast<int64_t>(i * 3 + 1);
+        }
+        return ids;
+    }
+    
+    // True k nearest (excluding self) within max_distance
+    std::vector<uint32_t> brute_force(const std::vector<float>& m, size_t n, size_t node, size_t k,
+                                      float max_distance) {
+        std::vector<std::pair<float, uint32_t>> all;
+        for (size_t j = 0; j < n; ++j) {
+            if (j == node) {
+                continue;
+            }
+            float sum = 0.0f;
+            for (size_t d = 0; d < kDims; ++d) {
+                float diff = m[node * kDims + d] - m[j * kDims + d];
+                sum += diff * diff;
+            }
+            if (std::sqrt(sum) <= max_distance) {
+                all.push_back({std::sqrt(sum), static_cast<uint32_t>(j)});
+            }
+        }
+        std::sort(all.begin(), all.end());
+        std::vector<uint32_t> nearest;
+        for (size_t i = 0; i < std::min(k, all.size()); ++i) {
+            nearest.push_back(all[i].second);
+        }
+        return nearest;
+    }
+    
+    KnnGraph::Config exact_config() {
+        KnnGraph::Config config;
+        config.k = 8;
+        config.threads = 2;
+        return config;
+    }
+};
+
+TEST_F(KnnGraphTest, ExactBuildMatchesBruteForce) {
+    auto m = make_clusters(300, 6, 1);
+    auto ids = make_ids(300);
+    KnnGraph graph(path, exact_config());
+    graph.build(m.data(), ids.data(), 300, kDims);
+    
+    EXPECT_FALSE(graph.is_approximate());
+    ASSERT_EQ(graph.size(), 300u);
+    for (size_t i = 0; i < 300; ++i) {
+        auto expected = brute_force(m, 300, i, 8, 1.0f);
+        ASSERT_EQ(graph.degree(i), expected.size());
+        for (size_t e = 0; e < expected.size(); ++e) {
+            EXPECT_EQ(graph.neighbors(i)[e], expected[e]);
+            if (e > 0) {
+                EXPECT_LE(graph.distances(i)[e - 1], graph.distances(i)[e]);
+            }
+        }
+    }
+}
+
+TEST_F(KnnGraphTest, MaxDistanceDropsLongEdges) {
+    auto m = make_clusters(120, 4, 2);
+    auto ids = make_ids(120);
+    auto config = exact_config();
+    config.k = 64;
+    config.max_distance = 1.5f;
+    KnnGraph graph(path, config);
+    graph.build(m.data(), ids.data(), 120, kDims);
+    
+    // Only the 29 other members of each tight cluster are within reach
+    for (size_t i = 0; i < 120; ++i) {
+        ASSERT_EQ(graph.degree(i), 29u);
+        for (size_t e = 0; e < graph.degree(i); ++e) {
+            EXPECT_EQ(graph.neighbors(i)[e] % 4, i % 4);
+            EXPECT_LE(graph.distances(i)[e], 1.5f);
+        }
+    }
+}
+
+TEST_F(KnnGraphTest, ApproximateBuildHasHighRecall) {
+    const size_t n = 4000;
+    auto m = make_clusters(n, 50, 3);
+    auto ids = make_ids(n);
+    KnnGraph::Config config;
+    config.k = 10;
+    config.exact_max_nodes = 1000;
+    config.threads = 4;
+    KnnGraph graph(path, config);
+    graph.build(m.data(), ids.data(), n, kDims);
+    
+    EXPECT_TRUE(graph.is_approximate());
+    size_t found = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < n; i += 37) {
+        auto expected = brute_force(m, n, i, 10, 1.0f);
+        std::set<uint32_t> got(graph.neighbors(i), graph.neighbors(i) + graph.degree(i));
+        for (uint32_t node : expected) {
+            found += got.count(node);
+        }
+        total += expected.size();
+    }
+    EXPECT_GT(static_cast<double>(found) / total, 0.95);
+}
+
+TEST_F(KnnGraphTest, ExtendMatchesFullBuild) {
+    auto m = make_clusters(400, 8, 4);
+    auto ids = make_ids(400);
+    
+    KnnGraph incremental(path, exact_config());
+    incremental.build(m.data(), ids.data(), 250, kDims);
+    incremental.extend(m.data(), ids.data(), 400, kDims);
+    EXPECT_EQ(incremental.get_stats().nodes_added, 150);
+    EXPECT_FALSE(incremental.get_stats().rebuilt);
+    
+    KnnGraph full(path, exact_config());
+    full.build(m.data(), ids.data(), 400, kDims);
+    
+    ASSERT_EQ(incremental.size(), full.size());
+    EXPECT_EQ(incremental.offsets(), full.offsets());
+    EXPECT_EQ(incremental.edge_targets(), full.edge_targets());
+}
+
+TEST_F(KnnGraphTest, ApproximateExtendAddsNewNodes) {
+    const size_t n = 3000;
+    auto m = make_clusters(n, 30, 5);
+    auto ids = make_ids(n);
+    KnnGraph::Config config;
+    config.k = 10;
+    config.exact_max_nodes = 1000;
+    KnnGraph graph(path, config);
+    graph.build(m.data(), ids.data(), 2500, kDims);
+    graph.extend(m.data(), ids.data(), n, kDims);
+    
+    EXPECT_TRUE(graph.is_approximate());
+    ASSERT_EQ(graph.size(), n);
+    
+    // New nodes have neighbours in their own cluster, and old nodes link to new ones
+    bool old_links_new = false;
+    for (size_t i = 0; i < n; ++i) {
+        if (i >= 2500) {
+            ASSERT_EQ(graph.degree(i), 10u);
+        }
+        for (size_t e = 0; e < graph.degree(i); ++e) {
+            EXPECT_EQ(graph.neighbors(i)[e] % 30, i % 30);
+            old_links_new = old_links_new || (i < 2500 && graph.neighbors(i)[e] >= 2500);
+        }
+    }
+    EXPECT_TRUE(old_links_new);
+}
+
+TEST_F(KnnGraphTest, SaveAndLoadRoundTrip) {
+    const size_t n = 1500;
+    auto m = make_clusters(n, 20, 6);
+    auto ids = make_ids(n);
+    KnnGraph::Config config;
+    config.k = 6;
+    config.exact_max_nodes = 500;
+    KnnGraph graph(path, config);
+    graph.build(m.data(), ids.data(), 1200, kDims);
+    ASSERT_TRUE(graph.save());
+    
+    KnnGraph loaded(path, config);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_TRUE(loaded.is_approximate());
+    EXPECT_EQ(loaded.size(), graph.size());
+    EXPECT_EQ(loaded.offsets(), graph.offsets());
+    EXPECT_EQ(loaded.edge_targets(), graph.edge_targets());
+    EXPECT_EQ(loaded.edge_distances(), graph.edge_distances());
+    EXPECT_EQ(loaded.node_of(ids[77]), std::optional<size_t>(77));
+    EXPECT_FALSE(loaded.node_of(2).has_value());
+    
+    // The loaded index can still take new nodes
+    loaded.extend(m.data(), ids.data(), n, kDims);
+    graph.extend(m.data(), ids.data(), n, kDims);
+    EXPECT_EQ(loaded.edge_targets(), graph.edge_targets());
+}
+
+TEST_F(KnnGraphTest, FindsNodesOfUnorderedIds) {
+    const size_t n = 300;
+    auto m = make_clusters(n, 10, 8);
+    auto ids = make_ids(n);
+    std::swap(ids[5], ids[250]);    // A face that became Ready late
+    KnnGraph graph(path, exact_config());
+    graph.build(m.data(), ids.data(), 200, kDims);
+    graph.extend(m.data(), ids.data(), n, kDims);
+    
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(graph.node_of(ids[i]), std::optional<size_t>(i));
+    }
+    EXPECT_FALSE(graph.node_of(2).has_value());
+    
+    ASSERT_TRUE(graph.save());
+    KnnGraph loaded(path, exact_config());
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.node_of(ids[5]), std::optional<size_t>(5));
+}
+
+TEST_F(KnnGraphTest, LoadRejectsMissingOrCorruptFile) {
+    KnnGraph graph(path);
+    EXPECT_FALSE(graph.load());
+    
+    FILE* f = std::fopen(path.c_str(), "wb");
+    std::fputs("not a graph", f);
+    std::fclose(f);
+    EXPECT_FALSE(graph.load());
+    EXPECT_EQ(graph.size(), 0u);
+}
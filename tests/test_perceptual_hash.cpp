@@ -0,0 +1,145 @@
+/**
+ * Perceptual hash and BK-tree unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/PerceptualHash.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace facefling;
+
+class PerceptualHashTest : public ::testing::Test {
+protected:
+    // Helper to create a smooth gradient image with a bright blob
+    Image make_image(int width, int height) {
+        Image img;
+        img.width = width;
+        img.height = height;
+        img.channels = 3;
+        img.data.resize(static_cast<size_t>(width) * height * 3);
+        
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float fx = static_cast<float>(x) / width;
+                float fy = static_cast<float>(y) / height;
+                float blob = (fx - 0.3f) * (fx - 0.3f) + (fy - 0.6f) * (fy - 0.6f) < 0.04f ? 120.0f : 0.0f;
+                unsigned char v = static_cast<unsigned char>(std::min(255.0f, fx * 100.0f + fy * 30.0f + blob));
+                size_t idx = (static_cast<size_t>(y) * width + x) * 3;
+                img.data[idx] = v;
+                img.data[idx + 1] = v;
+                img.data[idx + 2] = v;
+            }
+        }
+        return img;
+    }
+};
+
+TEST_F(PerceptualHashTest, HammingDistance) {
+    EXPECT_EQ(PerceptualHash::hamming_distance(0, 0), 0);
+    EXPECT_EQ(PerceptualHash::hamming_distance(0, 0xFF), 8);
+    EXPECT_EQ(PerceptualHash::hamming_distance(~0ULL, 0), 64);
+}
+
+TEST_F(PerceptualHashTest, InvalidImageHashesToZero) {
+    Image empty;
+    EXPECT_EQ(PerceptualHash::dhash(empty), 0u);
+}
+
+TEST_F(PerceptualHashTest, FlatImagesAreNotInformative) {
+    Image black = make_image(320, 240);
+    std::fill(black.data.begin(), black.data.end(), static_cast<unsigned char>(0));
+    Image gray = make_image(640, 480);
+    std::fill(gray.data.begin(), gray.data.end(), static_cast<unsigned char>(128));
+    
+    // Two unrelated flat images hash alike, so they must not be looked up
+    const uint64_t black_hash = PerceptualHash::dhash(black);
+    const uint64_t gray_hash = PerceptualHash::dhash(gray);
+    EXPECT_LE(PerceptualHash::hamming_distance(black_hash, gray_hash), 4);
+    EXPECT_FALSE(PerceptualHash::is_informative(black_hash));
+    EXPECT_FALSE(PerceptualHash::is_informative(gray_hash));
+    EXPECT_FALSE(PerceptualHash::is_informative(PerceptualHash::dhash(Image{})));
+    EXPECT_FALSE(PerceptualHash::is_informative(~0ULL));
+    
+    EXPECT_TRUE(PerceptualHash::is_informative(0x00FF00FF00FF00FFULL));
+}
+
+TEST_F(PerceptualHashTest, ResizedCopyIsNear) {
+    auto original = make_image(800, 600);
+    auto resized = make_image(200, 150);
+    
+    int dist = PerceptualHash::hamming_distance(
+        PerceptualHash::dhash(original),
+        PerceptualHash::dhash(resized)
+    );
+    EXPECT_LE(dist, 4);
+}
+
+TEST_F(PerceptualHashTest, NoiseKeepsHashNear) {
+    auto original = make_image(400, 300);
+    auto noisy = original;
+    srand(42);
+    for (auto& v : noisy.data) {
+        int n = static_cast<int>(v) + (rand() % 5) - 2;
+        v = static_cast<unsigned char>(std::max(0, std::min(255, n)));
+    }
+    
+    int dist = PerceptualHash::hamming_distance(
+        PerceptualHash::dhash(original),
+        PerceptualHash::dhash(noisy)
+    );
+    EXPECT_LE(dist, 4);
+}
+
+TEST_F(PerceptualHashTest, BkTreeFindWithin) {
+    BkTree tree;
+    tree.insert(0x0000000000000000ULL, 1);
+    tree.insert(0x0000000000000001ULL, 2);   // distance 1
+    tree.insert(0x000000000000000FULL, 3);   // distance 4
+    tree.insert(0xFFFFFFFFFFFFFFFFULL, 4);   // distance 64
+    EXPECT_EQ(tree.size(), 4u);
+    
+    auto matches = tree.find_within(0, 1);
+    EXPECT_EQ(matches.size(), 2u);
+    
+    matches = tree.find_within(0, 4);
+    EXPECT_EQ(matches.size(), 3u);
+    
+    matches = tree.find_within(0xFFFFFFFFFFFFFFFEULL, 2);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].id, 4);
+}
+
+TEST_F(PerceptualHashTest, BkTreeFindNearest) {
+    BkTree tree;
+    tree.insert(0x00FF, 10);
+    tree.insert(0x00F0, 20);
+    tree.insert(0xF000, 30);
+    
+    BkTree::Match match;
+    ASSERT_TRUE(tree.find_nearest(0x00F1, 8, match));
+    EXPECT_EQ(match.id, 20);
+    EXPECT_EQ(match.distance, 1);
+    
+    EXPECT_FALSE(tree.find_nearest(0x0F0F0F0F0F0F0F0FULL, 2, match));
+}
+
+TEST_F(PerceptualHashTest, BkTreeMatchesBruteForce) {
+    BkTree tree;
+    std::vector<uint64_t> hashes;
+    srand(7);
+    for (int i = 0; i < 500; ++i) {
+        uint64_t h = (static_cast<uint64_t>(rand()) << 32) ^ static_cast<uint64_t>(rand());
+        hashes.push_back(h);
+        tree.insert(h, i);
+    }
+    
+    uint64_t query = hashes[123] ^ 0x5;  // 2 bits off an existing hash
+    size_t expected = 0;
+    for (uint64_t h : hashes) {
+        if (PerceptualHash::hamming_distance(query, h) <= 10) {
+            expected++;
+        }
+    }
+    EXPECT_EQ(tree.find_within(query, 10).size(), expected);
+}
@@ -0,0 +1,62 @@
+/**
+ * Cluster prototype (medoid) set unit tests.
+ */
+
+#include <gtest/gtest.h>
+#include "services/PrototypeSet.h"
+#include <cmath>
+
+using namespace facefling;
+
+TEST(PrototypeSetTest, SmallSetsKeepEveryRow) {
+    const std::vector<float> rows = {0, 0, 1, 1, 2, 2};
+    EXPECT_EQ(PrototypeSet::select(rows.data(), 3, 2, 4), rows);
+    EXPECT_TRUE(PrototypeSet::select(rows.data(), 3, 2, 0).empty());
+    EXPECT_TRUE(PrototypeSet::select(rows.data(), 0, 2, 4).empty());
+}
+
+TEST(PrototypeSetTest, PrototypesCoverAnElongatedCluster) {
+    // 101 points along a line: the mean is 5 away from both ends
+    std::vector<float> rows;
+    for (int i = 0; i <= 100; ++i) {
+        rows.push_back(i * 0.1f);
+        rows.push_back(0.0f);
+    }
+    const auto prototypes = PrototypeSet::select(rows.data(), 101, 2, 4);
+    ASSERT_EQ(prototypes.size(), 4u * 2);
+    
+    // Every prototype is a member, and every member is near one
+    for (size_t p = 0; p < 4; ++p) {
+        const float x = prototypes[p * 2];
+        EXPECT_NEAR(x * 10.0f, std::round(x * 10.0f), 1e-3f);
+    }
+    for (int i = 0; i <= 100; ++i) {
+        EXPECT_LE(PrototypeSet::distance(prototypes, &rows[i * 2], 2), 1.6f);
+    }
+}
+
+TEST(PrototypeSetTest, AddFillsThenReplacesTheClosestPair) {
+    std::vector<float> prototypes;
+    const float a[] = {0.0f, 0.0f};
+    const float b[] = {0.1f, 0.0f};
+    const float far[] = {5.0f, 0.0f};
+    const float near[] = {0.05f, 0.0f};
+    
+    EXPECT_TRUE(PrototypeSet::add(prototypes, a, 2, 2));
+    EXPECT_TRUE(PrototypeSet::add(prototypes, b, 2, 2));
+    EXPECT_EQ(prototypes.size(), 4u);
+    
+    // Inside the spread of the set: no change
+    EXPECT_FALSE(PrototypeSet::add(prototypes, near, 2, 2));
+    
+    // Farther out than the closest pair: replaces the one of the pair nearer to it
+    EXPECT_TRUE(PrototypeSet::add(prototypes, far, 2, 2));
+    EXPECT_EQ(prototypes, (std::vector<float>{0.0f, 0.0f, 5.0f, 0.0f}));
+}
+
+TEST(PrototypeSetTest, DistanceIsToNearestPrototype) {
+    const std::vector<float> prototypes = {0, 0, 3, 4};
+    const float row[] = {3.0f, 0.0f};
+    EXPECT_FLOAT_EQ(PrototypeSet::distance(prototypes, row, 2), 3.0f);
+    EXPECT_TRUE(std::isinf(PrototypeSet::distance({}, row, 2)));
+}